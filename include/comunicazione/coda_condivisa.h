@@ -1,16 +1,22 @@
 #ifndef CODA_CONDIVISA_H
 #define CODA_CONDIVISA_H
 
-#include <pthread.h>
-#include <semaphore.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdatomic.h>
 
 #include "protocollo_comunicazione.h"
-#include "../my_lib/thread_shared_static_fifo.h"
+
+#ifndef SUCCESS
+#define SUCCESS 0
+#endif
 
 #ifndef ERR_SYSTEM_CALL
 #define ERR_SYSTEM_CALL -1
 #endif
 
+struct rispostaPronta;
+
 /**
  * @struct elementoCoda
  * @brief Struttura per rappresentare un elemento da inserire in una coda di messaggi.
@@ -26,41 +32,82 @@
  * @param client_fd
  * File descriptor del socket associato al client che ha inviato la richiesta. Questo identificatore
  * viene utilizzato per inviare la risposta al client appropriato.
+ *
+ * @param risposta
+ * Risposta (vedere "socket_comunication.h") in cui il worker mette il risultato e che restituisce al reattore.
+ *
+ * @param inserimento
+ * Istante (`CLOCK_MONOTONIC`, in nanosecondi) in cui la richiesta è stata messa in coda, usato dal pool di worker
+ * per misurare quanto le richieste aspettano.
+ *
+ * @param stato
+ * Stato di una richiesta la cui risposta è mandata a pezzi: NULL la prima volta che un worker prende la richiesta,
+ * poi quello che il worker ha lasciato per il pezzo successivo (vedere `sockcom_server_consegnaPezzo`).
+ *
+ * @param annullata
+ * 1 se la risposta a pezzi non va continuata, perché il client non c'è più: il worker deve solo liberare `stato`.
  */
 struct elementoCoda
 {
     struct messaggio richiesta;
     int client_fd;
+    struct rispostaPronta *risposta;
+    int64_t inserimento;
+    void *stato;
+    int annullata;
+};
+
+/**
+ * @brief Cella della coda: un elemento e il numero di sequenza che dice a chi tocca la cella.
+ *
+ * @param sequenza
+ * Vale `posizione` quando la cella è libera per il produttore che ha preso la posizione `posizione`, e `posizione + 1`
+ * quando contiene l'elemento per il consumatore della stessa posizione.
+ */
+struct cellaCoda
+{
+    _Atomic size_t sequenza;
+    struct elementoCoda elemento;
 };
 
 /**
  * @struct coda_condivisa
- * @brief Struttura per rappresentare una coda condivisa tra thread.
+ * @brief Coda limitata condivisa tra più produttori e più consumatori, senza lock (algoritmo di Vyukov).
+ *
+ * Produttori e consumatori si contendono solo `testa` e `coda`, con una compare-and-swap, e poi lavorano ognuno sulla
+ * propria cella. Un thread che trova la coda vuota (o piena) prima riprova, poi si addormenta con una futex sul
+ * contatore degli eventi opposti; chi inserisce (o toglie) un elemento fa la chiamata di sistema solo se qualcuno
+ * dorme. I campi scritti da thread diversi stanno su linee di cache diverse.
+ *
+ * @param celle, maschera
+ * Array di `maschera + 1` celle, una potenza di 2: la posizione `p` usa la cella `p & maschera`.
  *
- * @param fifo
- * Una struttura `static_fifo` che funge da buffer per memorizzare gli elementi della coda.
+ * @param testa
+ * Prossima posizione in cui inserire.
  *
- * @param mutex
- * utilizzato per sincronizzare l'accesso alla coda tra thread differenti, assicurando
- * che solo un thread alla volta possa modificare la coda.
+ * @param coda
+ * Prossima posizione da cui prendere.
  *
- * @param spazio_libero
- * Un semaforo `sem_t` che tiene traccia dello spazio disponibile nella coda. Viene utilizzato per bloccare
- * i thread produttori quando la coda è piena.
+ * @param inserimenti, prelievi
+ * Contatori (futex) degli elementi inseriti e presi, su cui dormono rispettivamente consumatori e produttori.
  *
- * @param numero_elementi
- * Un semaforo `sem_t` che tiene traccia del numero di elementi presenti nella coda. Viene utilizzato per
- * bloccare i thread consumatori quando la coda è vuota.
+ * @param consumatoriInAttesa, produttoriInAttesa
+ * Thread addormentati su `inserimenti` e su `prelievi`: se sono 0 nessuno va svegliato.
  */
 struct coda_condivisa
 {
-    struct static_fifo fifo;
-    pthread_mutex_t mutex;
-    sem_t spazio_libero, numero_elementi;
+    struct cellaCoda *celle;
+    size_t maschera;
+    _Alignas(64) _Atomic size_t testa;
+    _Alignas(64) _Atomic size_t coda;
+    _Alignas(64) _Atomic uint32_t inserimenti;
+    _Atomic uint32_t consumatoriInAttesa;
+    _Alignas(64) _Atomic uint32_t prelievi;
+    _Atomic uint32_t produttoriInAttesa;
 };
 
 /**
- * Inizializza uno `struct coda_condivisa` con una dimensione specificata.
+ * Inizializza uno `struct coda_condivisa` con una dimensione specificata, arrotondata alla potenza di 2 successiva.
  *
  * @return Restituisce `SUCCESS` se la coda è stata creata e inizializzata con successo. Restituisce `ERR_SYSTEM_CALL`
  *         se si verifica un errore durante la creazione o l'inizializzazione dei componenti della coda, dopo aver eseguito
@@ -69,19 +116,33 @@ struct coda_condivisa
 int cc_crea(struct coda_condivisa *coda, size_t dimensioneCoda);
 
 /**
- * Aggiunge un elemento alla coda condivisa in modo thread-safe.
+ * Aggiunge un elemento alla coda condivisa in modo thread-safe. Se la coda è piena aspetta che si liberi una cella.
  *
  * @return SUCCESS se aggiunto con successo, altrimenti ERR_SYSTEM_CALL.
  */
 int cc_put(struct coda_condivisa *coda, const struct elementoCoda *elemento);
 
 /**
- * Prende un elemento dalla coda condivisa in modo thread-safe.
+ * Prende un elemento dalla coda condivisa in modo thread-safe. Se la coda è vuota aspetta che venga inserito un elemento.
  *
- * @return SUCCESS se aggiunto con successo, altrimenti ERR_SYSTEM_CALL.
+ * @return SUCCESS se preso con successo, altrimenti ERR_SYSTEM_CALL.
  */
 int cc_get(struct coda_condivisa *coda, struct elementoCoda *buffer);
 
+/**
+ * Aggiunge un elemento alla coda condivisa in modo thread-safe senza aspettare, e senza svegliare chi aspetta in `cc_get`.
+ *
+ * @return 1 se l'elemento è stato aggiunto, 0 se la coda è piena.
+ */
+int cc_provaPut(struct coda_condivisa *coda, const struct elementoCoda *elemento);
+
+/**
+ * Prende un elemento dalla coda condivisa in modo thread-safe senza aspettare, e senza svegliare chi aspetta in `cc_put`.
+ *
+ * @return 1 se un elemento è stato preso, 0 se la coda è vuota.
+ */
+int cc_provaGet(struct coda_condivisa *coda, struct elementoCoda *buffer);
+
 void cc_destroy(struct coda_condivisa *coda);
 
 #endif
\ No newline at end of file
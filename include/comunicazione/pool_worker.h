@@ -0,0 +1,190 @@
+#ifndef POOL_WORKER_H
+#define POOL_WORKER_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdatomic.h>
+#include <pthread.h>
+
+#include "coda_condivisa.h"
+
+#ifndef SUCCESS
+#define SUCCESS 0
+#endif
+
+#ifndef ERR_SYSTEM_CALL
+#define ERR_SYSTEM_CALL -1
+#endif
+
+/**
+ * Restituito da `pw_provaInserisci` quando le code di tutti i worker sono piene.
+ */
+#define PW_CODE_PIENE 1
+
+/**
+ * Numero di richieste che la coda di ogni worker può contenere.
+ */
+#ifndef PW_DIMENSIONE_CODA_WORKER
+#define PW_DIMENSIONE_CODA_WORKER 16
+#endif
+
+/**
+ * Se una richiesta ha aspettato in coda più di così (in nanosecondi) prima di essere presa, il pool aggiunge un worker.
+ */
+#ifndef PW_SOGLIA_ATTESA_NS
+#define PW_SOGLIA_ATTESA_NS 2000000
+#endif
+
+/**
+ * Un worker che non trova richieste per così tanti millisecondi esce, se i worker sono più del minimo.
+ */
+#ifndef PW_INATTIVITA_MS
+#define PW_INATTIVITA_MS 2000
+#endif
+
+/**
+ * @brief Stato di un posto del pool.
+ *
+ * - `PW_LIBERO`: nessun thread, il posto può essere preso da un nuovo worker.
+ * - `PW_ATTIVO`: il worker riceve nuove richieste nella sua coda.
+ * - `PW_USCENTE`: il worker sta uscendo e non riceve più richieste; quelle rimaste nella sua coda vengono rubate.
+ * - `PW_USCITO`: il thread è terminato ma non ancora aspettato con `pthread_join`.
+ */
+enum statoPosto
+{
+    PW_LIBERO,
+    PW_ATTIVO,
+    PW_USCENTE,
+    PW_USCITO
+};
+
+struct pool_worker;
+
+/**
+ * @brief Un posto per un worker: la sua coda e il suo thread.
+ *
+ * Le code di tutti i posti esistono per tutta la vita del pool, anche quando il posto è libero, così un worker
+ * può sempre rubare da una coda il cui proprietario è uscito.
+ */
+struct postoWorker
+{
+    struct coda_condivisa coda;
+    pthread_t thread;
+    _Atomic int stato;
+    size_t indice;
+    struct pool_worker *pool;
+};
+
+/**
+ * @struct pool_worker
+ * @brief Pool di worker che si rubano il lavoro, con un numero di thread che varia tra un minimo e un massimo.
+ *
+ * Ogni worker ha la sua coda (un anello `coda_condivisa`) in cui `pw_inserisci` mette le richieste a turno. Un worker
+ * prende dalla propria coda e, se è vuota, ruba dalle code degli altri worker partendo dal successivo; le code sono FIFO
+ * e si ruba dallo stesso lato da cui prende il proprietario, quindi nessuna richiesta viene scavalcata da quelle
+ * arrivate dopo. Solo quando tutte le code sono vuote il worker dorme su una futex.
+ *
+ * Quando un worker prende una richiesta che ha aspettato più di `PW_SOGLIA_ATTESA_NS` (o quando tutte le code sono
+ * piene) il pool avvia un nuovo worker, fino a `massimo`; un worker che resta senza lavoro per `PW_INATTIVITA_MS` esce,
+ * finché i worker restano almeno `minimo`.
+ *
+ * @param posti
+ * Array di `massimo` posti.
+ *
+ * @param gestisci
+ * Funzione chiamata dai worker per ogni richiesta presa.
+ *
+ * @param attivi
+ * Numero dei posti `PW_ATTIVO`.
+ *
+ * @param prossimo
+ * Contatore usato per scegliere a turno la coda in cui inserire.
+ *
+ * @param inserimenti, workerInAttesa
+ * Contatore (futex) delle richieste inserite, su cui dormono i worker senza lavoro, e numero dei worker addormentati.
+ *
+ * @param prelievi, produttoriInAttesa
+ * Contatore (futex) delle richieste prese, su cui dorme chi trova tutte le code piene, e numero di chi ci dorme.
+ *
+ * @param avvisoRichiesto, avviso_fd
+ * `avvisoRichiesto` diventa 1 quando `pw_provaInserisci` trova tutte le code piene: il primo worker che poi prende una
+ * richiesta lo rimette a 0 e scrive 1 sull'eventfd `avviso_fd` (impostato con `pw_impostaAvviso`, -1 se non c'è).
+ *
+ * @param chiuso
+ * Diventa 1 con `pw_distruggi`: i worker svuotano le code ed escono.
+ *
+ * @param mutexPosti
+ * Serializza l'avvio dei worker, il `pthread_join` di quelli usciti e la chiusura. Non serve per inserire o prendere
+ * richieste.
+ */
+struct pool_worker
+{
+    struct postoWorker *posti;
+    size_t minimo, massimo;
+    void (*gestisci)(struct elementoCoda *richiesta);
+    _Alignas(64) _Atomic size_t attivi;
+    _Alignas(64) _Atomic size_t prossimo;
+    _Alignas(64) _Atomic uint32_t inserimenti;
+    _Atomic uint32_t workerInAttesa;
+    _Alignas(64) _Atomic uint32_t prelievi;
+    _Atomic uint32_t produttoriInAttesa;
+    _Atomic int avvisoRichiesto;
+    int avviso_fd;
+    _Atomic int chiuso;
+    pthread_mutex_t mutexPosti;
+};
+
+/**
+ * Crea il pool e avvia `minimo` worker.
+ *
+ * @param minimo Numero di worker sempre attivi, almeno 1.
+ * @param massimo Numero massimo di worker, almeno `minimo`.
+ * @param gestisci Funzione eseguita dai worker per ogni richiesta; la richiesta le appartiene (anche `richiesta.data`).
+ * @return SUCCESS, o ERR_SYSTEM_CALL dopo aver liberato quello che era stato creato.
+ */
+int pw_crea(struct pool_worker *pool, size_t minimo, size_t massimo, void (*gestisci)(struct elementoCoda *richiesta));
+
+/**
+ * Inserisce una richiesta nella coda di un worker. Se tutte le code sono piene prova ad aggiungere un worker e poi
+ * aspetta che una richiesta venga presa.
+ *
+ * @return SUCCESS, o ERR_SYSTEM_CALL.
+ */
+int pw_inserisci(struct pool_worker *pool, struct elementoCoda *richiesta);
+
+/**
+ * Come `pw_inserisci`, ma non aspetta mai: se tutte le code sono piene anche dopo aver provato ad aggiungere un worker
+ * restituisce PW_CODE_PIENE, e il primo worker che prende una richiesta lo fa sapere scrivendo sull'eventfd di
+ * `pw_impostaAvviso`. È l'inserimento del reattore, che non può fermarsi ad aspettare i worker.
+ *
+ * @return SUCCESS, o PW_CODE_PIENE (la richiesta resta al chiamante).
+ */
+int pw_provaInserisci(struct pool_worker *pool, struct elementoCoda *richiesta);
+
+/**
+ * Inserisce `numero` richieste come `pw_provaInserisci`, distribuendole a turno tra le code dei worker, ma sveglia i
+ * worker addormentati con una sola chiamata di sistema alla fine invece che una per richiesta. Si ferma alla prima
+ * richiesta che non trova posto.
+ *
+ * @return Il numero di richieste inserite, le prime `numero` se c'era posto per tutte.
+ */
+size_t pw_provaInserisciLotto(struct pool_worker *pool, struct elementoCoda *richieste, size_t numero);
+
+/**
+ * Imposta l'eventfd su cui i worker avvisano che le code, trovate piene da `pw_provaInserisci`, hanno di nuovo posto.
+ * Va chiamata prima di inserire richieste.
+ */
+void pw_impostaAvviso(struct pool_worker *pool, int avviso_fd);
+
+/**
+ * @return Il numero di worker attivi in questo momento.
+ */
+size_t pw_numeroWorker(struct pool_worker *pool);
+
+/**
+ * Chiude il pool: i worker gestiscono le richieste ancora in coda ed escono, e la funzione li aspetta tutti prima di
+ * liberare le code. Non si possono inserire richieste durante o dopo la chiusura.
+ */
+void pw_distruggi(struct pool_worker *pool);
+
+#endif
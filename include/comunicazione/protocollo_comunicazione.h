@@ -8,12 +8,18 @@
 #define MSG_NO 'N'
 #define MSG_ERROR 'E'
 
+// sessione: se è il primo messaggio di una connessione, la connessione resta aperta per più richieste
+#define MSG_SESSIONE 'S'
+// lotto: più richieste indipendenti in un solo messaggio, con una risposta per ognuna
+#define MSG_LOTTO 'B'
+// pezzo: parte di una risposta lunga, che continua nei messaggi successivi
+#define MSG_PEZZO 'C'
+
 #define STR_ERR_SYSCALL "C'è stato un fallimento di sistema durante la ricerca dei libri richiesti.\n"
 #define STR_ERR_FRMT_RIC "La richiesta inviata non è del formato corretto.\n"
 
 // path delle varie cose
 #define SOCKET_DIR "sockets/"
-#define BIB_CONF_PATH "config/bib.conf"
 #define LOGS_DIR "logs/"
 #define BUILD_DIR "build/"
 #define FILE_RECORDS_DIR "data/file_records/"
@@ -44,4 +50,33 @@ struct messaggio
     int32_t length;
 };
 
+/*
+ * Protocollo delle sessioni.
+ *
+ * Normalmente una connessione porta una sola richiesta: il client la manda (`type`, `length`, `data`), chiude il
+ * canale in scrittura, e il server risponde con un messaggio nello stesso formato e chiude.
+ *
+ * Se il primo messaggio di una connessione è di tipo `MSG_SESSIONE` (con `length` 1 e `data` "") la connessione
+ * diventa una sessione e resta aperta finché il client non la chiude. Da lì in poi ogni messaggio, in entrambe le
+ * direzioni, ha anche un identificativo scelto dal client: `type` (1 byte), `id` (uint32_t), `length` (int32_t),
+ * `data`. Il client può mandare più richieste senza aspettare le risposte, che arrivano nell'ordine in cui sono pronte
+ * e portano l'`id` della richiesta a cui rispondono.
+ *
+ * Protocollo dei lotti.
+ *
+ * Un messaggio `MSG_LOTTO` porta in `data` più richieste indipendenti (`MSG_QUERY` o `MSG_LOAN`), una dopo l'altra, ognuna
+ * nel formato normale: `type` (1 byte), `length` (int32_t), `data`. Il server risponde con un messaggio per ogni
+ * richiesta del lotto, nel formato delle sessioni e nell'ordine in cui sono pronte: su una connessione normale l'`id`
+ * di ogni risposta è la posizione della richiesta nel lotto (da 0), in una sessione è l'`id` del lotto più la posizione,
+ * quindi un lotto di N richieste occupa gli id da `id` a `id + N - 1`.
+ *
+ * Risposte a pezzi.
+ *
+ * Il server manda una risposta lunga a pezzi, appena sono pronti: zero o più messaggi `MSG_PEZZO`, i cui `data` sono
+ * parti della risposta senza terminatore, seguiti dal messaggio finale (`MSG_RECORD`, `MSG_NO` o `MSG_ERROR`). Per
+ * `MSG_RECORD` la risposta è la concatenazione dei pezzi e dei dati del messaggio finale, che contengono il terminatore;
+ * con `MSG_NO` o `MSG_ERROR` i pezzi già arrivati vanno scartati. Una risposta corta è un solo messaggio finale, come
+ * prima dei pezzi. In una sessione o in un lotto tutti i pezzi di una risposta hanno l'`id` della sua richiesta.
+ */
+
 #endif
@@ -0,0 +1,158 @@
+/**
+ * @file registro_biblioteche.h
+ * @brief Registro delle biblioteche attive in memoria condivisa: i server vi pubblicano il percorso del loro socket e
+ *        i client lo leggono per sapere a chi mandare la richiesta.
+ *
+ * Il registro è un oggetto di memoria condivisa POSIX (REG_NOME) di dimensione fissa, con un posto per biblioteca.
+ * Nessun lock e nessun semaforo: ogni posto ha un numero di versione, dispari mentre un server lo sta scrivendo.
+ * Un server prende un posto libero scrivendoci il proprio pid con una compare-and-swap, poi rende dispari la versione,
+ * scrive il posto e la rende pari; un client legge la versione, il posto e di nuovo la versione, e se sono uguali e
+ * pari ha letto una copia coerente. Dopo aver mappato il registro un client lo legge quindi solo con dei load, senza
+ * chiamate di sistema (tranne che per un posto lasciato dispari, vedi reg_leggi).
+ *
+ * Il registro nasce vuoto (la memoria di un oggetto appena creato è tutta a zero) e resta in /dev/shm anche quando
+ * non ci sono server. Il pid viene scritto per primo, quindi un server terminato senza ritirarsi, anche a metà della
+ * scrittura del posto, vi lascia sempre il suo pid: il posto viene ripreso dal primo server che si pubblica dopo.
+ */
+#ifndef REGISTRO_BIBLIOTECHE_H
+#define REGISTRO_BIBLIOTECHE_H
+
+#include <stdint.h>
+#include <stdatomic.h>
+
+#include "protocollo_comunicazione.h"
+
+#ifndef SUCCESS
+#define SUCCESS 0
+#endif
+
+#ifndef ERR_SYSTEM_CALL
+#define ERR_SYSTEM_CALL -1
+#endif
+
+#ifndef ERR_BUFFER_OVERFLOW
+#define ERR_BUFFER_OVERFLOW 4365
+#endif
+
+#ifndef MAX_PATH
+#define MAX_PATH 108
+#endif
+
+/**
+ * Nome dell'oggetto di memoria condivisa del registro (in Linux il file /dev/shm/bib_registro).
+ */
+#ifndef REG_NOME
+#define REG_NOME "/bib_registro"
+#endif
+
+/**
+ * Versione della disposizione del registro in memoria: va cambiata se cambiano le strutture qui sotto.
+ */
+#define REG_FORMATO 1
+
+/**
+ * Numero massimo di biblioteche attive contemporaneamente.
+ */
+#ifndef REG_NUMERO_POSTI
+#define REG_NUMERO_POSTI 64
+#endif
+
+/**
+ * Lunghezza massima del nome di una biblioteca, terminatore compreso.
+ */
+#ifndef REG_MAX_NOME
+#define REG_MAX_NOME 64
+#endif
+
+/**
+ * Letture di un posto che un client tenta prima di considerarlo libero, se lo trova sempre in scrittura da un server
+ * ancora attivo.
+ */
+#ifndef REG_TENTATIVI_LETTURA
+#define REG_TENTATIVI_LETTURA 1000
+#endif
+
+/**
+ * @brief Un posto del registro.
+ *
+ * @param reg_versione Dispari mentre un server scrive il posto; cresce di 2 a ogni pubblicazione.
+ * @param reg_pid Pid del server che occupa il posto, 0 se il posto è libero. Chi lo cambia con una compare-and-swap
+ *                prende o lascia il posto.
+ * @param reg_nome, reg_socket Nome della biblioteca e percorso del suo socket.
+ */
+struct postoRegistro
+{
+    _Alignas(64) _Atomic uint64_t reg_versione;
+    _Atomic int32_t reg_pid;
+    char reg_nome[REG_MAX_NOME];
+    char reg_socket[MAX_PATH];
+};
+
+/**
+ * @brief Il registro, così com'è nella memoria condivisa.
+ *
+ * @param reg_formato REG_FORMATO, scritto dal primo server che apre il registro (0 finché nessuno l'ha aperto).
+ * @param reg_posti I posti delle biblioteche.
+ */
+struct registroBiblioteche
+{
+    _Atomic uint32_t reg_formato;
+    struct postoRegistro reg_posti[REG_NUMERO_POSTI];
+};
+
+/**
+ * @brief Copia di un posto occupato, letta con reg_leggi.
+ */
+struct bibliotecaRegistrata
+{
+    char nome[REG_MAX_NOME];
+    char socket[MAX_PATH];
+};
+
+/**
+ * @brief Mappa il registro nella memoria del processo.
+ *
+ * @param scrittura 1 per un server, che crea il registro se non esiste e vi scrive; 0 per un client, che lo mappa in
+ *                  sola lettura.
+ * @return Il registro mappato, da chiudere con reg_chiudi, o NULL. Se un client trova che il registro non esiste
+ *         ritorna NULL con errno uguale a ENOENT: nessun server è mai stato avviato.
+ */
+struct registroBiblioteche *reg_apri(int scrittura);
+
+/**
+ * @brief Toglie il registro dalla memoria del processo. Il registro resta nella memoria condivisa.
+ */
+void reg_chiudi(struct registroBiblioteche *registro);
+
+//! FUNZIONI PER IL SERVER
+
+/**
+ * @brief Pubblica la biblioteca `nome` con il socket `socket` in un posto libero del registro.
+ *
+ * I posti occupati da server che non esistono più vengono considerati liberi.
+ *
+ * @return Il posto occupato, da passare a reg_ritira; ERR_BUFFER_OVERFLOW se nome o percorso sono troppo lunghi,
+ *         ERR_SYSTEM_CALL (con errno uguale a ENOSPC) se non ci sono posti liberi.
+ */
+int reg_pubblica(struct registroBiblioteche *registro, const char *nome, const char *socket);
+
+/**
+ * @brief Libera il posto occupato con reg_pubblica, azzerandone il pid. Si può chiamare da un gestore di segnali.
+ *
+ * @return SUCCESS, o ERR_SYSTEM_CALL se il posto non è di questo processo.
+ */
+int reg_ritira(struct registroBiblioteche *registro, int posto);
+
+//! FUNZIONI PER IL CLIENT
+
+/**
+ * @brief Legge il posto `posto` del registro, senza chiamate di sistema.
+ *
+ * Un posto trovato in scrittura viene considerato libero subito se il server che lo scrive non esiste più (questo
+ * controllo usa kill), altrimenti dopo REG_TENTATIVI_LETTURA letture.
+ *
+ * @return 1 se il posto è occupato e `dst` ne contiene una copia coerente, 0 se è libero.
+ */
+int reg_leggi(struct registroBiblioteche *registro, int posto, struct bibliotecaRegistrata *dst);
+
+#endif
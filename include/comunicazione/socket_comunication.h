@@ -3,12 +3,26 @@
 
 #include <pthread.h>
 #include <semaphore.h>
-#include <poll.h>
+#include <stdint.h>
+#include <stdatomic.h>
+#include <signal.h>
+#include <sys/uio.h>
 
-#include "coda_condivisa.h"
+#include "pool_worker.h"
+#include "../my_lib/dynamic_array.h"
 
-#ifndef MAX_CLIENTS
-#define MAX_CLIENTS 40
+/**
+ * Capacità iniziale della tabella delle connessioni, che poi raddoppia quando serve.
+ */
+#ifndef SOCKCOM_CONNESSIONI_INIZIALI
+#define SOCKCOM_CONNESSIONI_INIZIALI 64
+#endif
+
+/**
+ * Numero massimo di eventi restituiti da una chiamata a epoll_wait.
+ */
+#ifndef SOCKCOM_EVENTI_PER_ATTESA
+#define SOCKCOM_EVENTI_PER_ATTESA 256
 #endif
 
 #ifndef ERR_SYSTEM_CALL
@@ -23,6 +37,10 @@
 #define SUCCESS 0
 #endif
 
+#ifndef RISPOSTA_INCOMPLETA
+#define RISPOSTA_INCOMPLETA 1
+#endif
+
 /**
  * @brief Apre un socket server associato a un percorso UNIX univoco.
  *
@@ -35,40 +53,305 @@
 int sockcom_apriServer(char socket_path_univoco[108]);
 
 /**
- * @brief Configura e avvia un server per gestire connessioni client asincrone con poll(), interrompibile via signal handler.
+ * Lunghezza massima (`length`) di una richiesta: un client che ne annuncia una più lunga viene disconnesso.
+ */
+#ifndef SOCKCOM_MAX_RICHIESTA
+#define SOCKCOM_MAX_RICHIESTA (1 << 16)
+#endif
+
+/**
+ * Byte dell'intestazione di un messaggio: `type` seguito da `length`.
+ */
+#define SOCKCOM_INTESTAZIONE (sizeof(char) + sizeof(int32_t))
+
+/**
+ * Byte dell'intestazione di un messaggio in una sessione: `type`, `id` e `length`.
+ */
+#define SOCKCOM_INTESTAZIONE_SESSIONE (sizeof(char) + sizeof(uint32_t) + sizeof(int32_t))
+
+/**
+ * Richieste di una sessione che possono essere nel pool allo stesso momento: oltre questo numero il reattore smette di
+ * leggere dalla connessione finché non torna una risposta.
+ */
+#ifndef SOCKCOM_MAX_IN_VOLO
+#define SOCKCOM_MAX_IN_VOLO 64
+#endif
+
+/**
+ * Numero massimo di richieste in un lotto (`MSG_LOTTO`): un client che ne manda di più viene disconnesso.
+ */
+#ifndef SOCKCOM_MAX_PER_LOTTO
+#define SOCKCOM_MAX_PER_LOTTO 1024
+#endif
+
+/**
+ * Numero massimo di parti (intestazioni e parti del contenuto delle risposte) scritte con una sola sendmsg. Non deve
+ * superare IOV_MAX.
+ */
+#ifndef SOCKCOM_PARTI_PER_SCRITTURA
+#define SOCKCOM_PARTI_PER_SCRITTURA 1024
+#endif
+
+/**
+ * @brief Risposta prodotta da un worker e restituita al reattore, che la scrive sul socket del client.
+ *
+ * Viene allocata dal reattore insieme alla richiesta e passata al worker nell'`elementoCoda`; il worker la riempie e
+ * la restituisce con `sockcom_server_consegnaRisposta`, senza mai toccare il socket del client.
+ *
+ * @param prossima
+ * Risposta successiva nella pila delle risposte pronte del reattore, e poi nella lista delle risposte da scrivere
+ * della connessione.
+ *
+ * @param client_fd
+ * Connessione a cui va scritta la risposta.
+ *
+ * @param id
+ * Identificativo della richiesta, ripetuto nella risposta se la connessione è una sessione.
+ *
+ * @param type, length
+ * Tipo e lunghezza del messaggio di risposta, come in `struct messaggio`.
+ *
+ * @param parti, numeroParti, dati
+ * Il contenuto del messaggio, diviso in parti che il reattore scrive nell'ordine senza copiarle in un solo buffer;
+ * `length` è la somma delle loro lunghezze. Un contenuto in un solo buffer è la parte `dati`.
+ *
+ * @param memoria
+ * Se non è NULL appartiene alla risposta e viene liberata con `free` dopo la scrittura.
+ *
+ * @param intestazione, dimensioneIntestazione, scritti
+ * Intestazione del messaggio pronta da scrivere, sua lunghezza e byte del messaggio (intestazione compresa) già
+ * scritti.
+ *
+ * @param continua, continuazione
+ * Se `continua` è 1 la risposta è un pezzo (`MSG_PEZZO`) e la richiesta non è finita: quando il pezzo è stato scritto
+ * il reattore rimette `continuazione` nel pool per il pezzo successivo.
+ */
+struct rispostaPronta
+{
+    struct rispostaPronta *prossima;
+    int client_fd;
+    uint32_t id;
+    char type;
+    int32_t length;
+    struct iovec *parti;
+    int numeroParti;
+    struct iovec dati;
+    void *memoria;
+    char intestazione[SOCKCOM_INTESTAZIONE_SESSIONE];
+    size_t dimensioneIntestazione, scritti;
+    int continua;
+    struct elementoCoda continuazione;
+};
+
+/**
+ * @brief Richiesta completa che il reattore non ha potuto passare al pool perché le code dei worker erano piene.
+ *
+ * Le richieste in attesa formano una lista FIFO nel reattore: passano al pool nell'ordine di arrivo quando un worker
+ * avvisa che c'è di nuovo posto, e intanto la loro connessione non legge.
+ *
+ * @param prossima
+ * Richiesta in attesa successiva.
+ *
+ * @param elemento
+ * La richiesta, con la sua risposta, come andrà nella coda di un worker. Se `richiesta.data` è NULL è la continuazione
+ * di una risposta a pezzi.
+ */
+struct richiestaInAttesa
+{
+    struct richiestaInAttesa *prossima;
+    struct elementoCoda elemento;
+};
+
+/**
+ * @struct connessione
+ * @brief Una connessione aperta con un client: la richiesta che sta arrivando, letta un pezzo alla volta, e le risposte
+ *        da scrivere.
+ *
+ * Il socket del client non è bloccante: a ogni evento il reattore legge quello che è arrivato e lo aggiunge alla
+ * richiesta, che passa al pool solo quando è completa. Un client lento non ferma quindi gli altri. Una connessione
+ * normale porta una sola richiesta; una sessione (vedere "protocollo_comunicazione.h") ne porta quante il client vuole,
+ * fino a `SOCKCOM_MAX_IN_VOLO` nel pool allo stesso momento, e le risposte vengono scritte nell'ordine in cui tornano.
+ *
+ * La connessione non viene chiusa finché ha richieste nel pool, così il suo fd non può essere riusato da un'altra.
+ *
+ * @param fd
+ * File descriptor del socket del client.
+ *
+ * @param sessione
+ * 1 se la connessione è una sessione.
+ *
+ * @param eventi
+ * Eventi per cui la connessione è registrata su epoll, 0 se non è registrata.
+ *
+ * @param intestazione
+ * L'intestazione della richiesta che sta arrivando, da cui si ricavano `richiesta.type`, `id` e `richiesta.length`.
+ *
+ * @param letti
+ * Byte della richiesta che sta arrivando letti finora, intestazione compresa.
+ *
+ * @param id, richiesta
+ * La richiesta che sta arrivando: `data` viene allocato quando l'intestazione è completa.
+ *
+ * @param richiesteRicevute
+ * Richieste complete ricevute sulla connessione.
+ *
+ * @param inVolo
+ * Richieste passate al pool la cui risposta non è ancora tornata, comprese quelle ancora in attesa di posto nel pool.
+ *
+ * @param inAttesa
+ * Richieste della connessione in attesa di posto nel pool (`struct richiestaInAttesa`): finché ce ne sono la connessione
+ * non legge.
+ *
+ * @param fineInput
+ * 1 quando il client ha chiuso il suo lato della connessione.
+ *
+ * @param guasta
+ * 1 dopo un errore: la connessione non legge e non scrive più, e viene chiusa appena non ha richieste nel pool.
+ *
+ * @param primaUscita, ultimaUscita
+ * Lista delle risposte da scrivere, la prima eventualmente scritta a metà.
+ */
+struct connessione
+{
+    int fd;
+    int sessione;
+    uint32_t eventi;
+    char intestazione[SOCKCOM_INTESTAZIONE_SESSIONE];
+    size_t letti;
+    uint32_t id;
+    struct messaggio richiesta;
+    size_t richiesteRicevute, inVolo, inAttesa;
+    int fineInput, guasta;
+    struct rispostaPronta *primaUscita, *ultimaUscita;
+};
+
+/**
+ * @struct reattore
+ * @brief Ciclo degli eventi del server, basato su epoll.
+ *
+ * @param server_fd
+ * File descriptor del socket server, in ascolto. Il reattore lo rende non bloccante ma non lo chiude.
+ *
+ * @param epoll_fd
+ * Istanza di epoll su cui sono registrati il socket server e le connessioni.
+ *
+ * @param evento_fd
+ * Eventfd registrato su epoll con cui i worker avvisano il reattore che ci sono risposte pronte, o che c'è di nuovo posto
+ * nelle code del pool.
+ *
+ * @param segnale_fd
+ * Signalfd registrato su epoll per i segnali che fermano il reattore, -1 se non ce ne sono.
+ *
+ * @param risposte
+ * Pila senza lock delle risposte restituite dai worker e non ancora raccolte dal reattore.
+ *
+ * @param connessioni
+ * Tabella delle connessioni (`struct connessione`) indicizzata per file descriptor: la cella di un fd è occupata
+ * finché la connessione appartiene al reattore. Raddoppia quando arriva un fd più grande della sua capacità.
+ *
+ * @param numeroConnessioni
+ * Numero di celle occupate in `connessioni`.
+ *
+ * @param pool
+ * Pool dei worker a cui il reattore passa le richieste, NULL finché non viene avviato.
+ *
+ * @param primaInAttesa, ultimaInAttesa
+ * Lista delle richieste complete che aspettano posto nelle code del pool.
+ */
+struct reattore
+{
+    int server_fd, epoll_fd, evento_fd, segnale_fd;
+    _Atomic(struct rispostaPronta *) risposte;
+    struct dynamic_array connessioni;
+    size_t numeroConnessioni;
+    struct pool_worker *pool;
+    struct richiestaInAttesa *primaInAttesa, *ultimaInAttesa;
+};
+
+/**
+ * @brief Crea il reattore per il socket server `server_fd`, restituito da `sockcom_apriServer`.
+ *
+ * @param segnali Segnali che fermano il reattore, o NULL. Vanno bloccati in tutti i thread prima di crearli (con
+ *                pthread_sigmask all'inizio del main): il reattore li riceve da un signalfd, tra un evento e l'altro.
+ * @return SUCCESS, o ERR_SYSTEM_CALL dopo aver liberato quello che era stato creato.
+ */
+int sockcom_creaReattore(struct reattore *reattore, int server_fd, const sigset_t *segnali);
+
+/**
+ * @brief Avvia il ciclo degli eventi del server, che si ferma quando arriva uno dei segnali del reattore.
  *
  * @details
  * Passi principali:
- * - Imposta il server per accettare connessioni.
- * - Usa un ciclo infinito con `poll()` per monitorare eventi sui file descriptor.
- * - Accetta connessioni client, gestisce richieste e le inserisce in coda.
+ * - Aspetta con `epoll_wait()` gli eventi dei soli file descriptor pronti.
+ * - Accetta tutte le connessioni in attesa e le aggiunge alla tabella delle connessioni, senza limite al loro numero.
+ * - Legge le richieste dei client senza bloccarsi, un pezzo alla volta, e passa quelle complete al pool dei worker.
+ *   Il reattore non aspetta mai il pool: se le code dei worker sono piene la richiesta resta in attesa nel reattore, la
+ *   sua connessione smette di leggere, e passa al pool quando un worker avvisa con l'eventfd (dato al pool con `pw_impostaAvviso`) che c'è di nuovo posto.
+ *   Sulle sessioni continua a leggere, così il client può mandare più richieste senza aspettare le risposte. Le
+ *   richieste di un lotto passano al pool insieme, ognuna con la sua risposta.
+ * - Raccoglie le risposte restituite dai worker e le scrive senza bloccarsi, poi chiude la connessione quando il
+ *   client ha chiuso il suo lato. I worker non fanno quindi nessuna operazione sui socket.
  * - Gestisce errori e pulizia risorse.
+ * - Legge dal signalfd i segnali passati a `sockcom_creaReattore` e, quando ne arriva uno, esce dal ciclo.
  *
- * Richiede configurazione pre-esecuzione del signal handler per garantire chiusura pulita dei file descriptor.
+ * @warning I segnali vanno gestiti solo così: un signal handler che chiudesse il server interromperebbe il reattore
+ *          a metà di una malloc o di una printf. Dopo il ritorno il chiamante, dal suo thread, chiude il pool con
+ *          `pw_distruggi` e poi il reattore con `sockcom_chiudiReattore`.
  *
- * @warning Da grandi poteri derivano grandi responsabilità. Necessaria configurazione del signal handler e
- *          dimensionamento corretto di `poll_fds` a `MAX_CLIENTS + 1`.
+ * @return SUCCESS quando arriva un segnale; `ERR_SYSTEM_CALL` per errore, dopo aver chiuso il reattore.
+ */
+int sockcom_avviaServer(struct reattore *reattore, struct pool_worker *pool);
+
+/**
+ * @brief Restituisce al reattore la risposta di una richiesta. Chiamata dai worker, è thread-safe e non blocca.
  *
- * @param poll_fds Inserire fd del server in poll_fds[0].fd. Gestisce fino a `MAX_CLIENTS`.
- * @return `ERR_SYSTEM_CALL` per errore, altrimenti esecuzione continua fino a interruzione.
+ * @param risposta La risposta ricevuta con la richiesta nell'`elementoCoda`.
+ * @param messaggio Il messaggio da scrivere al client. `data` deve restare valido fino alla scrittura.
+ * @param liberaData Se diverso da 0 il reattore libera `messaggio->data` con `free` dopo averlo scritto.
+ * @return SUCCESS, o ERR_SYSTEM_CALL se non è stato possibile svegliare il reattore.
  */
-int sockcom_avviaServer(struct pollfd poll_fds[MAX_CLIENTS + 1], struct coda_condivisa *coda);
+int sockcom_server_consegnaRisposta(struct reattore *reattore, struct rispostaPronta *risposta,
+                                     struct messaggio *messaggio, int liberaData);
 
 /**
- * @brief Trasmette una risposta a un client controllando la prontezza del fd con `poll()`.
+ * @brief Come `sockcom_server_consegnaRisposta`, ma il contenuto del messaggio è la concatenazione di `numeroParti`
+ *        parti sparse in memoria, che il reattore scrive con sendmsg direttamente da dove sono, senza copiarle.
  *
- * Verifica la disponibilità del fd del client per l'invio (POLLOUT) usando `poll()` e invia la risposta
- * (`type`, `length`, `data`) sequenzialmente.
+ * @param type Tipo del messaggio.
+ * @param parti Le parti del contenuto. L'array e le parti devono restare validi fino alla scrittura.
+ * @param memoria Se non è NULL il reattore la libera con `free` dopo la scrittura: può contenere l'array delle parti e
+ *                le parti stesse.
+ * @return SUCCESS, o ERR_SYSTEM_CALL se non è stato possibile svegliare il reattore.
+ */
+int sockcom_server_consegnaParti(struct reattore *reattore, struct rispostaPronta *risposta, char type,
+                                 struct iovec *parti, int numeroParti, void *memoria);
+
+/**
+ * @brief Restituisce al reattore un pezzo della risposta di una richiesta che non è ancora finita. Chiamata dai worker.
  *
- * @return
- * - `SUCCESS` per invio riuscito.
- * - `ERR_SYSTEM_CALL` per errori di sistema nell'invio.
- * - `ERR_COMUNICAZIONE` per errori di comunicazione, come chiusura inaspettata del canale o fd non valido.
+ * Il reattore scrive il pezzo come una risposta qualsiasi e, solo quando l'ha scritto tutto, rimette `richiesta` nel
+ * pool con una nuova risposta, così il worker che la prende produce il pezzo successivo. Chi produce i pezzi non va
+ * quindi mai più veloce del client che li legge, e per ogni richiesta c'è al massimo un pezzo in memoria. Il worker
+ * salva in `richiesta->stato` quello che serve per continuare; se `richiesta->annullata` è 1 deve invece liberarlo e
+ * chiudere la richiesta con `sockcom_server_consegnaRisposta`.
  *
- * @warning Da grandi poteri derivano grandi responsabilità. È compito del chiamante chiudere il fd del client
- *          e liberare la memoria. In caso di errore, usare shutdown prima di chiudere.
+ * @param richiesta La richiesta presa dal pool, con lo stato per il pezzo successivo. `richiesta->richiesta.data` deve
+ *                  essere già stato liberato (o passato a `stato`).
+ * @param parti, numeroParti, memoria Il contenuto del pezzo (di tipo `MSG_PEZZO`), come in
+ *                                   `sockcom_server_consegnaParti`.
+ * @return SUCCESS, o ERR_SYSTEM_CALL se la malloc fallisce: in questo caso la richiesta va chiusa con
+ *         `sockcom_server_consegnaRisposta`.
  */
-int sockcom_server_trasmettiRisposta(int client_fd, struct messaggio *risposta);
+int sockcom_server_consegnaPezzo(struct reattore *reattore, struct elementoCoda *richiesta, struct iovec *parti,
+                                 int numeroParti, void *memoria);
+
+/**
+ * @brief Chiude tutte le connessioni ancora nella tabella e l'istanza di epoll. Il socket server resta aperto.
+ *
+ * Le risposte già restituite dai worker hanno un ultimo tentativo di scrittura; per non perderne nessuna va chiamata
+ * dopo `pw_distruggi`.
+ */
+void sockcom_chiudiReattore(struct reattore *reattore);
 
 /**
  * @brief Invia una richiesta a un server tramite socket UNIX.
@@ -95,7 +378,8 @@ int sockcom_client_mandaRichiesta(char socketServerPath[108], struct messaggio *
  *
  * Legge la risposta inviata dal server su un socket specificato, allocando dinamicamente lo spazio necessario per i dati
  * ricevuti e popolando la struttura `messaggio` fornita. La funzione si aspetta di ricevere prima il tipo e la lunghezza
- * della risposta, seguiti dai dati effettivi.
+ * della risposta, seguiti dai dati effettivi. Se la risposta arriva a pezzi (`MSG_PEZZO`) li riunisce e ritorna quando
+ * arriva il messaggio finale.
  *
  * @return
  * - `SUCCESS` se la risposta viene ricevuta correttamente.
@@ -109,4 +393,85 @@ int sockcom_client_mandaRichiesta(char socketServerPath[108], struct messaggio *
  */
 int sockcom_client_riceviRisposta(int sock_fd, struct messaggio *risposta);
 
+/**
+ * @struct rispostaInArrivo
+ * @brief Risposta ricevuta un pezzo alla volta con `sockcom_client_continuaRisposta`.
+ *
+ * @param intestazione, letti
+ * I primi `SOCKCOM_INTESTAZIONE` byte della risposta e i byte della risposta letti finora, intestazione compresa.
+ *
+ * @param risposta
+ * Il messaggio che sta arrivando: `data` viene allocato quando l'intestazione è completa.
+ *
+ * @param pezzi, lunghezzaPezzi, capacitaPezzi
+ * I dati dei messaggi `MSG_PEZZO` già arrivati, la loro lunghezza e lo spazio allocato.
+ */
+struct rispostaInArrivo
+{
+    char intestazione[SOCKCOM_INTESTAZIONE];
+    size_t letti;
+    struct messaggio risposta;
+    char *pezzi;
+    size_t lunghezzaPezzi, capacitaPezzi;
+};
+
+/**
+ * @brief Legge con una sola read il prossimo pezzo della risposta del server su `sock_fd`.
+ *
+ * Serve a chi aspetta le risposte di più server insieme con poll: dopo che poll ha segnalato `sock_fd` come leggibile la
+ * chiamata non si blocca, e il client può passare subito agli altri server. `arrivo` va inizializzato a zero prima del
+ * primo pezzo.
+ *
+ * @return
+ * - `SUCCESS` quando la risposta è completa in `arrivo->risposta`, con i pezzi già riuniti; il chiamante ne libera
+ *   `data` e chiude `sock_fd`.
+ * - `RISPOSTA_INCOMPLETA` se mancano ancora dei byte.
+ * - `ERR_SYSTEM_CALL` o `ERR_COMUNICAZIONE` come `sockcom_client_riceviRisposta`; `arrivo` è già stato liberato.
+ */
+int sockcom_client_continuaRisposta(int sock_fd, struct rispostaInArrivo *arrivo);
+
+/**
+ * @brief Compone in `lotto` un messaggio `MSG_LOTTO` con le `numero` richieste di `richieste`.
+ *
+ * Il lotto si manda come una richiesta qualsiasi, con `sockcom_client_mandaRichiesta` o in una sessione con
+ * `sockcom_client_mandaRichiestaSessione`; le risposte, una per richiesta, si ricevono con
+ * `sockcom_client_riceviRispostaSessione` e il loro id dice a quale richiesta del lotto rispondono (vedere
+ * "protocollo_comunicazione.h").
+ *
+ * @return `SUCCESS`, o `ERR_SYSTEM_CALL` se la malloc fallisce o il lotto supera `SOCKCOM_MAX_PER_LOTTO` richieste o
+ *         `SOCKCOM_MAX_RICHIESTA` byte. Il chiamante libera `lotto->data`.
+ */
+int sockcom_componiLotto(struct messaggio *lotto, struct messaggio *richieste, size_t numero);
+
+/**
+ * @brief Apre una sessione con il server: si connette e manda la richiesta `MSG_SESSIONE`.
+ *
+ * Sulla sessione si possono poi mandare più richieste con `sockcom_client_mandaRichiestaSessione`, senza aspettare le
+ * risposte, che arrivano nell'ordine in cui il server le completa e si riconoscono dall'id.
+ *
+ * @return Il file descriptor della sessione, o `ERR_SYSTEM_CALL`. Il chiamante chiude la sessione con `close`.
+ */
+int sockcom_client_apriSessione(char socketServerPath[108]);
+
+/**
+ * @brief Manda una richiesta sulla sessione `sock_fd` con l'id scelto dal chiamante.
+ *
+ * Il server accetta al massimo `SOCKCOM_MAX_IN_VOLO` richieste senza risposta per sessione: oltre, smette di leggere
+ * finché non ne ha completata qualcuna, quindi chi manda molte richieste deve leggere anche le risposte.
+ *
+ * @return `SUCCESS`, o `ERR_SYSTEM_CALL`.
+ */
+int sockcom_client_mandaRichiestaSessione(int sock_fd, uint32_t id, struct messaggio *richiesta);
+
+/**
+ * @brief Riceve il prossimo messaggio dalla sessione `sock_fd` e l'id della richiesta a cui risponde.
+ *
+ * I pezzi (`MSG_PEZZO`) di risposte diverse possono alternarsi: la funzione li restituisce uno alla volta, così come
+ * arrivano, e la risposta a una richiesta è finita quando arriva un messaggio di un altro tipo con il suo id.
+ *
+ * @return `SUCCESS`, `ERR_SYSTEM_CALL`, o `ERR_COMUNICAZIONE` se il server chiude la sessione. Il chiamante libera
+ *         `risposta->data`.
+ */
+int sockcom_client_riceviRispostaSessione(int sock_fd, uint32_t *id, struct messaggio *risposta);
+
 #endif
\ No newline at end of file
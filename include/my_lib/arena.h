@@ -0,0 +1,109 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <stddef.h>
+#include <errno.h>
+
+#ifndef SUCCESS
+#define SUCCESS 0
+#endif
+
+#ifndef FAILURE
+#define FAILURE -1
+#endif
+
+/**
+ * Default size of the blocks of an arena: big enough that a block serves thousands of small allocations.
+ */
+#ifndef AR_BLOCK_SIZE
+#define AR_BLOCK_SIZE (1 << 20)
+#endif
+
+/**
+ * Structure representing a block of memory of an arena. The memory served by the block follows the header.
+ *
+ * @param ar_next Pointer to the block allocated before this one.
+ * @param ar_size The number of bytes that follow the header.
+ * @param ar_used The number of bytes already served.
+ */
+struct arena_block
+{
+    struct arena_block *ar_next;
+    size_t ar_size, ar_used;
+};
+
+/**
+ * Structure representing an arena (region) allocator.
+ *
+ * Allocations are served by moving a pointer forward in the current block; when the block is full a new one is
+ * allocated. Single allocations are never freed: all the memory of the arena is freed at once by ar_destroy.
+ *
+ * @param ar_blocks Pointer to the block currently used for the allocations, the head of the list of all the blocks.
+ * @param ar_blockSize The size of the blocks allocated when the current one is full. Bigger allocations get a block
+ *                     of their own.
+ * @param ar_bytesUsed The number of bytes served by the arena, padding included.
+ * @param ar_bytesAllocated The number of bytes allocated with malloc, block headers included.
+ */
+struct arena
+{
+    struct arena_block *ar_blocks;
+    size_t ar_blockSize;
+    size_t ar_bytesUsed, ar_bytesAllocated;
+};
+
+/**
+ * Initializes an empty arena. No memory is allocated until the first ar_alloc.
+ *
+ * @param blockSize The size of the blocks, 0 to use AR_BLOCK_SIZE.
+ * @return An initialized arena structure.
+ */
+struct arena ar_create(size_t blockSize);
+
+/**
+ * Allocates `size` bytes from the arena, aligned for any type.
+ *
+ * @return Pointer to the memory, or NULL if malloc fails.
+ * @warning The memory must not be passed to free or realloc, it is valid until ar_destroy.
+ */
+void *ar_alloc(struct arena *object, size_t size);
+
+/**
+ * Copies the null-terminated `string` in the arena.
+ *
+ * @return Pointer to the copy, or NULL if malloc fails.
+ */
+char *ar_strdup(struct arena *object, const char *string);
+
+/**
+ * Copies the first `length` bytes of `string` in the arena and adds the null terminator. `string` does not need to be
+ * null-terminated.
+ *
+ * @return Pointer to the copy, or NULL if malloc fails.
+ */
+char *ar_strndup(struct arena *object, const char *string, size_t length);
+
+/**
+ * @return The number of bytes served by the arena, padding included.
+ */
+size_t ar_bytesUsed(const struct arena *object);
+
+/**
+ * @return The number of bytes that the arena allocated with malloc.
+ */
+size_t ar_bytesAllocated(const struct arena *object);
+
+/**
+ * Moves all the blocks of `other` into `object`, leaving `other` empty. The memory served by `other` stays valid and
+ * is freed by ar_destroy(object).
+ *
+ * Useful to build parts of a structure in different threads, each one with its own arena (an arena is not thread
+ * safe), and then give all the memory to a single owner.
+ */
+void ar_merge(struct arena *object, struct arena *other);
+
+/**
+ * Frees all the memory of the arena at once, and leaves it empty and ready to be used again.
+ */
+void ar_destroy(struct arena *object);
+
+#endif
@@ -3,6 +3,7 @@
 
 #include <stddef.h>
 #include <errno.h>
+#include "arena.h"
 
 #ifndef SUCCESS
 #define SUCCESS 0
@@ -12,17 +13,29 @@
 #define FAILURE -1
 #endif
 
+/**
+ * @param bt_node_height Height of the subtree rooted in this node (a leaf has height 1). It is kept up to date
+ *                       only by the balanced (AVL) functions, the plain ones leave it to 1.
+ */
 struct binary_tree_node
 {
     void *bt_node_element;
     struct binary_tree_node *bt_node_left, *bt_node_right;
+    int bt_node_height;
 };
 
+/**
+ * @param bt_balanced If non-zero the tree is kept balanced (AVL) by bt_insert and bt_delete, so that searches
+ *                    stay O(log N) even when the elements are inserted already sorted.
+ * @param bt_arena If not NULL, the arena that owns the nodes of the tree (see bt_createInArena).
+ */
 struct binary_tree
 {
     struct binary_tree_node *bt_root;
     size_t bt_elementSize;
     int (*bt_compareFunction)(const void *, const void *);
+    int bt_balanced;
+    struct arena *bt_arena;
 };
 
 //* FUNCTIONS TO WORK DIRECTLY ON THE NODES
@@ -38,6 +51,7 @@ struct binary_tree_node *bt_node_findMin(struct binary_tree_node *root);
 
 /**
  * Dynamically allocates memory for a new binary tree node and its element, copying the element data into the new node.
+ * The node and its element are allocated together, so freeing the node frees the element too.
  *
  * @return Pointer to the newly created node, or NULL if memory allocation fails.
  */
@@ -59,6 +73,32 @@ struct binary_tree_node *bt_node_insert(struct binary_tree_node **root, const vo
  */
 struct binary_tree_node *bt_node_delete(struct binary_tree_node *root, const void *element, size_t elementSize, int (*compare_function)(const void *, const void *));
 
+/**
+ * @return Height of the subtree rooted in `root`, 0 if `root` is NULL.
+ */
+int bt_node_height(struct binary_tree_node *root);
+
+/**
+ * @brief Inserts an element into an AVL tree.
+ *
+ * Same as bt_node_insert, but after the insertion the nodes on the path to the root are rebalanced with rotations,
+ * so that the height of the tree stays O(log N). Elements equal to an existing one are inserted after it in the
+ * inorder sequence, but rotations may move them in the left subtree of the equal element.
+ *
+ * @return Pointer to the inserted node, or NULL on failure.
+ *
+ * @warning from great power comes great responsibility. Use it only on trees built with the balanced functions,
+ *          the heights of a tree built with bt_node_insert are not valid.
+ */
+struct binary_tree_node *bt_node_insertBalanced(struct binary_tree_node **root, const void *element, size_t elementSize, int (*compare_function)(const void *, const void *));
+
+/**
+ * @brief Deletes a node with the specified element from an AVL tree, rebalancing it.
+ *
+ * @return The new root of the tree.
+ */
+struct binary_tree_node *bt_node_deleteBalanced(struct binary_tree_node *root, const void *element, size_t elementSize, int (*compare_function)(const void *, const void *));
+
 /**
  * @brief Searches for a node containing the specified element in the binary tree.
  *
@@ -80,7 +120,7 @@ void bt_node_visitInOrder(struct binary_tree_node *root, void (*visualizeElement
 /**
  * @brief Frees all nodes of the binary tree.
  *
- * Recursively frees the memory of all nodes in the binary tree, including their elements.
+ * Recursively frees the memory of all nodes in the binary tree, including their elements (allocated with the nodes).
  *
  * @warning from great power comes great responsibility. Ensure proper use to avoid memory leaks or dangling pointers.
  */
@@ -97,6 +137,27 @@ void bt_node_freeTree(struct binary_tree_node *root);
  */
 struct binary_tree bt_create(size_t elementSize, int (*compare_function)(const void *, const void *));
 
+/**
+ * @brief Initializes a new balanced (AVL) binary tree.
+ *
+ * Like bt_create, but bt_insert and bt_delete will keep the tree balanced.
+ *
+ * @return An initialized binary_tree structure.
+ */
+struct binary_tree bt_createBalanced(size_t elementSize, int (*compare_function)(const void *, const void *));
+
+/**
+ * @brief Initializes a new balanced (AVL) binary tree whose nodes are allocated from `arena`.
+ *
+ * Building a big tree costs a bump of the arena pointer per node instead of a malloc, and the nodes are freed all at
+ * once with the arena.
+ *
+ * @return An initialized binary_tree structure.
+ * @warning The nodes cannot be freed one by one: bt_delete has no effect, and bt_freeTree only empties the tree.
+ *          The arena must outlive the tree.
+ */
+struct binary_tree bt_createInArena(size_t elementSize, int (*compare_function)(const void *, const void *), struct arena *arena);
+
 /**
  * @brief Inserts an element into the binary tree.
  *
@@ -106,8 +167,28 @@ struct binary_tree bt_create(size_t elementSize, int (*compare_function)(const v
  */
 int bt_insert(struct binary_tree *object, const void *element);
 
+/**
+ * @brief Inserts an element into the binary tree, like bt_insert.
+ *
+ * @return Pointer to the copy of the element stored in the tree, or NULL if the allocation fails. The pointer stays
+ *         valid until the node is deleted, because rotations move the nodes but not their elements.
+ */
+void *bt_insertElement(struct binary_tree *object, const void *element);
+
+/**
+ * @brief Builds a balanced tree from `count` elements already sorted by the compare function of the tree.
+ *
+ * The middle element becomes the root, recursively, so that no comparison and no rotation is needed: it is the fast
+ * way to rebuild a tree saved in order.
+ *
+ * @param elements Array of `count` elements of `bt_elementSize` bytes, copied in the nodes.
+ * @return SUCCESS on success, FAILURE if the tree is not empty or if an allocation fails (the tree is left empty).
+ */
+int bt_buildFromSorted(struct binary_tree *object, const void *elements, size_t count);
+
 /**
  * @brief Deletes an element from the binary tree.
+ * @note It has no effect on trees created with bt_createInArena.
  */
 void bt_delete(struct binary_tree *object, const void *element);
 
@@ -133,7 +214,8 @@ void bt_visitInOrder(struct binary_tree *object, void (*visualizeElement)(const
  * @brief Frees all nodes of the binary tree.
  *
  * Recursively frees the memory of all nodes in the binary tree, setting the root to NULL.
- * You can still use the freed tree for the same type of elements.
+ * You can still use the freed tree for the same type of elements. The nodes of a tree created with bt_createInArena
+ * are left to the arena.
  *
  * @warning from great power comes great responsibility. Ensure proper use to avoid memory leaks.
  */
@@ -0,0 +1,153 @@
+#ifndef COMPRESSED_BITMAP_H
+#define COMPRESSED_BITMAP_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <errno.h>
+
+#ifndef SUCCESS
+#define SUCCESS 0
+#endif
+
+#ifndef FAILURE
+#define FAILURE -1
+#endif
+
+/**
+ * A container with more than CB_ARRAY_MAX elements is stored as a bitmap: at that size the sorted array and the
+ * bitmap (65536 bits) take the same 8KB.
+ */
+#ifndef CB_ARRAY_MAX
+#define CB_ARRAY_MAX 4096
+#endif
+
+#define CB_BITMAP_WORDS 1024 // 65536 bits / 64
+
+#define CB_ARRAY 0
+#define CB_BITMAP 1
+
+/**
+ * Structure representing the elements of a compressed bitmap that share the same 16 high bits.
+ *
+ * @param cb_key The 16 high bits shared by the elements of the container.
+ * @param cb_type CB_ARRAY if `cb_data` is a sorted array of `uint16_t`, CB_BITMAP if it is an array of
+ *                CB_BITMAP_WORDS `uint64_t` words.
+ * @param cb_cardinality The number of elements in the container.
+ * @param cb_capacity The number of `uint16_t` that `cb_data` can hold, only meaningful for CB_ARRAY containers.
+ * @param cb_data Pointer to the dynamically allocated low 16 bits of the elements.
+ */
+struct cb_container
+{
+    uint16_t cb_key, cb_type;
+    uint32_t cb_cardinality, cb_capacity;
+    void *cb_data;
+};
+
+/**
+ * Structure representing a compressed set of 32 bit unsigned integers, in the style of Roaring bitmaps.
+ *
+ * The integers are split by their 16 high bits in containers, kept sorted by key. Sparse containers are sorted arrays
+ * of the 16 low bits, dense ones are plain bitmaps, so that both take at most 8KB and intersections and unions work
+ * on whole 64 bit words whenever both containers are dense.
+ *
+ * @param cb_containers Pointer to the dynamically allocated array of containers, sorted by `cb_key`.
+ * @param cb_size The number of containers in use.
+ * @param cb_capacity The number of containers that `cb_containers` can hold.
+ */
+struct compressed_bitmap
+{
+    struct cb_container *cb_containers;
+    uint32_t cb_size, cb_capacity;
+};
+
+/**
+ * @return An empty compressed bitmap. It does not allocate memory until the first insertion.
+ */
+struct compressed_bitmap cb_create(void);
+
+/**
+ * Adds `value` to the bitmap, if not already present.
+ *
+ * @return SUCCESS on success, FAILURE if malloc fails (the bitmap is left unchanged).
+ * @note Adding values in increasing order is the fast path: it never moves containers or array elements.
+ */
+int cb_add(struct compressed_bitmap *object, uint32_t value);
+
+/**
+ * @return 1 if `value` is in the bitmap, 0 otherwise.
+ */
+int cb_contains(const struct compressed_bitmap *object, uint32_t value);
+
+/**
+ * @return The number of values in the bitmap.
+ */
+uint64_t cb_cardinality(const struct compressed_bitmap *object);
+
+/**
+ * Keeps in `object` only the values that are also in `other`.
+ *
+ * @return SUCCESS on success, FAILURE if malloc fails (`object` is left in a valid but unspecified state).
+ */
+int cb_andInPlace(struct compressed_bitmap *object, const struct compressed_bitmap *other);
+
+/**
+ * Adds to `object` all the values of `other`.
+ *
+ * @return SUCCESS on success, FAILURE if malloc fails (`object` is left in a valid but unspecified state).
+ */
+int cb_orInPlace(struct compressed_bitmap *object, const struct compressed_bitmap *other);
+
+/**
+ * Initializes `destination` as a copy of `source`.
+ *
+ * @return SUCCESS on success, FAILURE if malloc fails (`destination` is left empty).
+ */
+int cb_copy(struct compressed_bitmap *destination, const struct compressed_bitmap *source);
+
+/**
+ * Writes all the values of the bitmap in `buffer`, in increasing order.
+ *
+ * @param buffer Array of at least cb_cardinality(object) elements.
+ * @return The number of values written.
+ */
+size_t cb_toArray(const struct compressed_bitmap *object, uint32_t *buffer);
+
+/**
+ * @return The number of bytes allocated by the bitmap.
+ */
+size_t cb_sizeInBytes(const struct compressed_bitmap *object);
+
+/**
+ * @return The number of bytes written by cb_serialize.
+ */
+size_t cb_serializedSize(const struct compressed_bitmap *object);
+
+/**
+ * Writes the bitmap in `buffer` in a flat format without pointers, that can be saved to a file and read back with
+ * cb_deserialize. The format is: the number of containers (uint32_t), then for each container its key, type (uint16_t)
+ * and cardinality (uint32_t), then the data of all the containers in the same order.
+ *
+ * @param buffer Memory of at least cb_serializedSize(object) bytes, with no alignment requirement.
+ * @return The number of bytes written.
+ */
+size_t cb_serialize(const struct compressed_bitmap *object, void *buffer);
+
+/**
+ * Initializes `object` from `size` bytes written by cb_serialize. The data is copied, `buffer` can be freed or
+ * unmapped afterwards.
+ *
+ * The content of the containers is checked too, since the buffer may come from a damaged file: array containers must
+ * be strictly increasing, the cardinality of bitmap containers must match their popcount, and every value must be
+ * below `limit`.
+ *
+ * @return SUCCESS on success, FAILURE if malloc fails or if the buffer is not a valid serialized bitmap (`object` is
+ *         left empty).
+ */
+int cb_deserialize(struct compressed_bitmap *object, const void *buffer, size_t size, uint64_t limit);
+
+/**
+ * Frees all memory allocated for the bitmap and leaves it empty.
+ */
+void cb_destroy(struct compressed_bitmap *object);
+
+#endif
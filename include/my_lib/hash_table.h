@@ -0,0 +1,112 @@
+#ifndef HASH_TABLE_H
+#define HASH_TABLE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <errno.h>
+
+#ifndef SUCCESS
+#define SUCCESS 0
+#endif
+
+#ifndef FAILURE
+#define FAILURE -1
+#endif
+
+/**
+ * Structure representing a hash table with open addressing (linear probing), storing elements of any data type.
+ * Like the binary_tree, the table stores whole elements: the key is the part of the element read by the hash and
+ * compare functions, the rest of the element is the value.
+ *
+ * @param ht_slots Pointer to the dynamically allocated array of `ht_capacity` elements.
+ * @param ht_occupied Pointer to a dynamically allocated array of flags, one per slot, set to 1 if the slot holds an element.
+ * @param ht_inserted The number of elements currently stored in the table.
+ * @param ht_capacity The number of slots, always a power of 2.
+ * @param ht_elementSize The size, in bytes, of each element.
+ * @param ht_hashFunction Function that computes the hash of the key of an element.
+ * @param ht_compareFunction Function that returns 0 if the keys of the two elements are equal.
+ *
+ * @note The table grows (doubling its capacity) when it is more than 70% full, so that the average cost of
+ *       search, insertion and deletion stays O(1).
+ */
+struct hash_table
+{
+    void *ht_slots;
+    unsigned char *ht_occupied;
+    size_t ht_inserted, ht_capacity;
+    size_t ht_elementSize;
+    uint64_t (*ht_hashFunction)(const void *);
+    int (*ht_compareFunction)(const void *, const void *);
+};
+
+/**
+ * Initializes a hash table able to hold at least `capacity` elements before growing.
+ *
+ * @return An initialized hash_table structure.
+ * @warning If allocation fails the returned `ht_slots` is NULL, check it before using the table.
+ */
+struct hash_table ht_create(size_t elementSize, size_t capacity, uint64_t (*hash_function)(const void *), int (*compare_function)(const void *, const void *));
+
+/**
+ * Searches the element with the same key of `element`.
+ *
+ * @return Pointer to the element stored in the table, or NULL if it is not found.
+ * @warning The pointer is valid only until the next insertion or deletion, which can move the elements.
+ */
+void *ht_search(struct hash_table *object, const void *element);
+
+/**
+ * Inserts a copy of `element` in the table, if no element with the same key is already present.
+ *
+ * @return Pointer to the element stored in the table (the new one, or the one already present with the same key),
+ *         NULL if the table needed to grow and malloc failed.
+ * @warning The pointer is valid only until the next insertion or deletion, which can move the elements.
+ */
+void *ht_insert(struct hash_table *object, const void *element);
+
+/**
+ * Removes the element with the same key of `element`, if present.
+ *
+ * @return SUCCESS if the element was removed, FAILURE if it was not found.
+ */
+int ht_delete(struct hash_table *object, const void *element);
+
+/**
+ * Applies `visitElement` to every element of the table, in no particular order.
+ *
+ * @warning The function must not insert or delete elements of the same table.
+ */
+void ht_visit(struct hash_table *object, void (*visitElement)(void *));
+
+/**
+ * Iterates over the elements of the table, in no particular order, when the visit needs more state than ht_visit
+ * can pass to its function.
+ *
+ * @param position Must be 0 for the first call, then it is updated by each call.
+ * @return Pointer to the next element, or NULL when all the elements have been returned.
+ * @warning The table must not be modified during the iteration.
+ */
+void *ht_next(struct hash_table *object, size_t *position);
+
+/**
+ * Frees all memory allocated for the table and resets its properties.
+ * @note The elements are not freed one by one: if they own memory, free it first with ht_visit.
+ */
+void ht_destroy(struct hash_table *object);
+
+/**
+ * @return The 64 bit FNV-1a hash of `length` bytes starting at `data`.
+ */
+uint64_t ht_hashBytes(const void *data, size_t length);
+
+/**
+ * @return The 64 bit FNV-1a hash of a null-terminated string.
+ */
+uint64_t ht_hashString(const char *string);
+
+/**
+ * @return A well mixed hash of a 64 bit integer (finalizer of MurmurHash3).
+ */
+uint64_t ht_hashInteger(uint64_t key);
+
+#endif
@@ -3,85 +3,224 @@
 
 #include "libro.h"
 #include "arrayCampi.h"
+#include "snapshot.h"
 #include "../my_lib/dynamic_array.h"
 #include "../my_lib/binary_tree.h"
+#include "../my_lib/hash_table.h"
+#include "../my_lib/compressed_bitmap.h"
+#include <stdint.h>
 
 #ifndef ERR_SYSTEM_CALL
 #define ERR_SYSTEM_CALL 876
 #endif
 
+/**
+ * Lunghezza delle sottostringhe usate dall'indice dei valori: ogni valore viene indicizzato sotto tutti i suoi
+ * trigrammi, così una ricerca "contiene" deve controllare solo i valori che hanno tutti i trigrammi cercati.
+ */
+#ifndef LUNGHEZZA_TRIGRAMMA
+#define LUNGHEZZA_TRIGRAMMA 3
+#endif
+
+/**
+ * Valore restituito da arrCampi_idCampo per un campo che non compare in nessun libro.
+ */
+#ifndef ID_CAMPO_ASSENTE
+#define ID_CAMPO_ASSENTE -1
+#endif
+
+/**
+ * @struct valoreLibro
+ * @brief Struttura per mappare un valore di un campo ai libri che lo contengono.
+ *
+ * Ogni valore (normalizzato) compare una sola volta nell'albero del suo campo, insieme alla lista di tutti i libri
+ * che hanno quel valore per quel campo.
+ *
+ * @param valoreCampo
+ * Il valore specifico del campo. Questa stringa rappresenta il valore del campo (ad esempio, il nome di un autore).
+ * È allocata nell'arena della struttura dati.
+ *
+ * @param libriAssociati
+ * Bitmap compressa degli ordinali (`lib_ordinale`) dei libri associati a questo valore. Le richieste con più coppie
+ * vengono risolte intersecando queste bitmap, prima di leggere qualsiasi libro.
+ */
+struct valoreLibro
+{
+    char *valoreCampo;
+    struct compressed_bitmap libriAssociati;
+};
+
+/**
+ * @struct trigrammaValori
+ * @brief Elemento dell'indice dei trigrammi di un campo.
+ *
+ * @param trigramma
+ * I tre byte del trigramma, impacchettati in un intero.
+ *
+ * @param valori
+ * Array dinamico di `struct valoreLibro *`, i valori del campo che contengono il trigramma. Ogni valore compare una
+ * sola volta, nell'ordine in cui è stato inserito nell'albero.
+ */
+struct trigrammaValori
+{
+    uint32_t trigramma;
+    struct dynamic_array valori;
+};
+
 /**
  * @struct campoAlbero
  * @brief Struttura per mappare un campo a un albero di valori.
  *
  * Questa struttura è utilizzata per associare un nome di campo a un albero binario di ricerca che memorizza
- * i valori specifici per quel campo. Ogni nodo dell'albero rappresenta un valore unico per il campo, consentendo
- * una ricerca efficiente dei valori associati.
+ * i valori specifici per quel campo, e a un indice dei trigrammi di quei valori per le ricerche per sottostringa.
  *
  * @param nomeCampo
  * Nome del campo. Questa stringa identifica il campo di cui l'albero di valori mantiene traccia.
  *
  * @param alberoValori
- * Albero binario di ricerca che contiene i valori associati al campo. Ogni valore è unico all'interno dell'albero,
- * e l'albero permette operazioni di ricerca, inserimento e cancellazione efficienti per gestire i valori del campo.
+ * Albero binario di ricerca bilanciato (AVL) di `struct valoreLibro`, ordinati con strcmp. Ogni valore è unico
+ * all'interno dell'albero. Essendo bilanciato, l'altezza resta log N anche quando il file record è ordinato per quel campo.
+ * I nodi sono allocati nell'arena della struttura dati (bt_createInArena).
+ *
+ * @param indiceTrigrammi
+ * Tabella hash di `struct trigrammaValori`. I puntatori ai valori puntano agli elementi dei nodi dell'albero, che non
+ * vengono mai cancellati né spostati finché il campo esiste.
+ *
+ * @param numeroValori, numeroOccorrenze
+ * Statistiche del campo usate per pianificare le richieste: il numero di valori distinti nell'albero e il numero di
+ * coppie con questo campo in tutti i libri. Il numero di libri di ogni valore è la cardinalità di `libriAssociati`.
  */
 struct campoAlbero
 {
     char *nomeCampo;
     struct binary_tree alberoValori;
+    struct hash_table indiceTrigrammi;
+    int numeroValori, numeroOccorrenze;
 };
 
 /**
- * @struct valoreLibro
- * @brief Struttura per mappare un valore di un campo a un libro specifico.
+ * @struct voceDirettorio
+ * @brief Elemento del direttorio dei campi, che associa il nome di un campo al suo id.
  *
- * Questa struttura collega un valore specifico di un campo a un libro, permettendo di associare
- * direttamente un valore (ad esempio, un autore o un genere) a un libro nella collezione. Viene utilizzata
- * principalmente all'interno degli alberi binari di ricerca per memorizzare e recuperare rapidamente i libri
- * basati sui valori dei loro campi.
+ * L'id di un campo è la posizione del suo `campoAlbero` nell'array dei campi: viene assegnato la prima volta che il
+ * campo compare in un libro e non cambia più, perché i campi non vengono mai rimossi.
  *
- * @param valoreCampo
- * Il valore specifico del campo. Questa stringa rappresenta il valore del campo (ad esempio, il nome di un autore)
- * a cui il libro è associato.
+ * @param nomeCampo
+ * Punta alla stringa `nomeCampo` del `campoAlbero`, che ne resta proprietario.
  *
- * @param libroAssociato
- * Puntatore a un libro. Questo puntatore riferisce a una struttura libro che contiene tutti i dettagli
- * del libro associato a questo valore del campo.
+ * @param idCampo
+ * Indice del `campoAlbero` nell'array dei campi.
  */
-struct valoreLibro
+struct voceDirettorio
 {
-    char *valoreCampo;
-    struct libro *libroAssociato;
+    char *nomeCampo;
+    int idCampo;
 };
 
+/**
+ * @brief Crea il direttorio dei campi, una tabella hash di `struct voceDirettorio` indicizzata per nome del campo.
+ *
+ * @return struct hash_table il direttorio vuoto.
+ * @warning Se l'allocazione fallisce `ht_slots` è NULL.
+ */
+struct hash_table arrCampi_creaDirettorio(void);
+
+/**
+ * @brief Trova l'id di un campo con una sola ricerca nel direttorio.
+ *
+ * @param nomeCampo Il nome del campo, già normalizzato con lib_formattaStringa.
+ * @return int L'id del campo, o ID_CAMPO_ASSENTE se nessun libro ha quel campo.
+ */
+int arrCampi_idCampo(struct hash_table *direttorioCampi, const char *nomeCampo);
+
 /**
  * @brief Aggiunge un libro all'array dinamico specificato di elementi `campoAlbero`.
  *
- * Questa funzione analizza la rappresentazione stringa di un libro, estrae coppie chiave-valore e le aggiunge
- * all'array dinamico.
+ * Questa funzione aggiunge all'array dinamico le coppie chiave-valore già analizzate da lib_crea, e salva in ognuna
+ * l'id del suo campo. I campi nuovi vengono aggiunti in fondo all'array e registrati nel direttorio.
  *
+ * @param arena Arena da cui allocare i nodi degli alberi e le stringhe dei valori nuovi. Deve essere la stessa per
+ *              tutti i libri, e va liberata solo dopo arrCampi_free.
  * @return int SUCCESS se l'operazione è riuscita, ERR_SYSTEM_CALL in caso di errore.
  */
-int arrCampi_aggiungiLibro(struct dynamic_array *arrayCampi, struct libro *libro);
+int arrCampi_aggiungiLibro(struct dynamic_array *arrayCampi, struct hash_table *direttorioCampi, struct arena *arena, struct libro *libro);
 
 /**
- * @brief Genera una lista di libri che soddisfano una data richiesta, verificando ogni libro completamente.
+ * @brief Come arrCampi_aggiungiLibro, ma per un indice parziale costruito da un solo thread su una porzione di libri.
  *
- * Analizza la richiesta per identificare un campo e un valore iniziale di ricerca, trova i libri potenzialmente corrispondenti
- * nell'array di `campoAlbero` basandosi su quel singolo campo e valore. Per ogni libro trovato, effettua un ulteriore controllo
- * confrontando l'intero libro con la richiesta completa per assicurarsi che soddisfi tutti i criteri specificati.
- * I libri che passano questo controllo aggiuntivo vengono aggiunti a `lista_libri`.
+ * Non costruisce gli indici dei trigrammi: vengono costruiti da arrCampi_unisci solo per i valori che entrano
+ * nell'indice completo. Gli id salvati nelle coppie dei libri sono quelli dell'indice parziale finché non viene unito.
  *
- *  @return int SUCCESS se l'operazione è riuscita, ERR_SYSTEM_CALL in caso di errore.
+ * @param arena Arena del thread che costruisce l'indice parziale.
+ * @return int SUCCESS se l'operazione è riuscita, ERR_SYSTEM_CALL in caso di errore.
+ */
+int arrCampi_aggiungiLibroParziale(struct dynamic_array *arrayCampi, struct hash_table *direttorioCampi, struct arena *arena, struct libro *libro);
+
+/**
+ * @brief Unisce un indice parziale all'indice completo, e poi libera l'indice parziale.
+ *
+ * I campi mancanti vengono creati, le bitmap dei valori presenti in entrambi vengono unite e i valori nuovi vengono
+ * spostati nell'indice completo. Gli id dei campi nelle coppie di `libri` vengono tradotti negli id dell'indice completo.
+ * Unendo le porzioni nell'ordine del file record si ottengono gli stessi id di un caricamento sequenziale.
+ *
+ * @param arena Arena dell'indice completo. Le stringhe dei valori restano nell'arena dell'indice parziale, che va
+ *              quindi unita ad `arena` (ar_merge) e non liberata.
+ * @param libri Array dinamico di `struct libro *`, i libri indicizzati nell'indice parziale.
+ * @return int SUCCESS se l'operazione è riuscita, ERR_SYSTEM_CALL in caso di errore.
+ */
+int arrCampi_unisci(struct dynamic_array *arrayCampi, struct hash_table *direttorioCampi, struct arena *arena,
+                    struct dynamic_array *arrayParziale, struct hash_table *direttorioParziale, struct dynamic_array *libri);
+
+/**
+ * @brief Scrive nello snapshot tutti i campi, con i loro valori in ordine, le bitmap e gli indici dei trigrammi.
+ *
+ * Nell'indice dei trigrammi i puntatori ai valori diventano posizioni nell'array dei valori del campo.
+ *
+ * @return L'offset dell'array di `arrayCampi->da_inserted` `struct snap_campo`, o SNAP_OFFSET_NULLO in caso di errore.
+ */
+uint64_t arrCampi_scriviSnapshot(struct dynamic_array *arrayCampi, struct snapshotScrittura *snapshot);
+
+/**
+ * @brief Ricostruisce i campi scritti da arrCampi_scriviSnapshot, senza analizzare nessun valore.
+ *
+ * Gli alberi vengono costruiti già bilanciati dagli array ordinati (bt_buildFromSorted) e gli indici dei trigrammi
+ * dalle posizioni salvate. Le stringhe dei valori non vengono copiate: puntano allo snapshot, che deve restare mappato
+ * finché esistono i campi.
+ *
+ * @param arrayCampi, direttorioCampi L'array dei campi e il direttorio, vuoti.
+ * @param arena Arena da cui allocare i nodi degli alberi.
+ * @param numeroLibri Numero dei libri dello snapshot: le bitmap con un ordinale non minore rendono lo snapshot non
+ *                    coerente.
+ * @return int SUCCESS se l'operazione è riuscita, ERR_SYSTEM_CALL in caso di errore o se lo snapshot non è coerente.
+ *         In caso di errore i campi già creati vanno liberati con arrCampi_free.
+ */
+int arrCampi_leggiSnapshot(struct dynamic_array *arrayCampi, struct hash_table *direttorioCampi, struct arena *arena,
+                           const struct snapshotLettura *snapshot, uint64_t offsetCampi, uint32_t numeroCampi,
+                           uint32_t numeroLibri);
+
+/**
+ * @brief Genera una lista di libri che soddisfano una data richiesta.
+ *
+ * Per ogni coppia campo:valore della richiesta stima quanti libri la soddisfano, usando l'indice dei trigrammi del
+ * campo (o, per valori cercati più corti di un trigramma, le statistiche del campo). La coppia più selettiva guida
+ * la ricerca: l'unione delle bitmap dei suoi valori sono i candidati iniziali. Le bitmap delle altre coppie vengono
+ * intersecate con i candidati; solo le coppie con valori più corti di un trigramma, che richiederebbero di visitare
+ * tutto l'albero, vengono controllate sui candidati rimasti con lib_contieneCoppia, sulle coppie già analizzate dei
+ * libri. I libri vengono aggiunti a `lista_libri` nell'ordine del file record.
+ *
+ * Compilando con -DSPIEGA_PIANO viene stampato il piano scelto per ogni richiesta.
+ *
+ * @param ptrLibri Array dinamico di `struct libro *` indicizzato per `lib_ordinale`.
+ * @return int SUCCESS se l'operazione è riuscita, ERR_SYSTEM_CALL in caso di errore.
  */
-int arrCampi_generaLista(struct dynamic_array *arrayCampi, struct dynamic_array *lista_libri, const char *richiesta, pthread_mutex_t *mutex, pthread_cond_t *cond);
+int arrCampi_generaLista(struct dynamic_array *arrayCampi, struct hash_table *direttorioCampi, struct dynamic_array *ptrLibri, struct dynamic_array *lista_libri, const char *richiesta);
 
 /**
- * @brief Libera l'intero array dinamico di elementi `campoAlbero`.
+ * @brief Libera l'intero array dinamico di elementi `campoAlbero` e il direttorio dei campi.
  *
  * Questa funzione itera sull'array dinamico e libera ogni elemento `campoAlbero` insieme al suo albero binario
  * di elementi `valoreLibro` associato.
  */
-void arrCampi_free(struct dynamic_array *arrayCampi);
+void arrCampi_free(struct dynamic_array *arrayCampi, struct hash_table *direttorioCampi);
 
 #endif
\ No newline at end of file
@@ -0,0 +1,177 @@
+/**
+ * @file cache_richieste.h
+ * @brief Cache delle risposte alle query: per le richieste più frequenti evita di cercare e rileggere i libri.
+ *
+ * La chiave è la richiesta normalizzata con lib_formattaStringa, quindi due richieste che differiscono solo per spazi
+ * o maiuscole usano la stessa voce. Ogni voce contiene le stringhe dei libri della risposta, così come vengono mandate
+ * al client, e gli ordinali dei libri.
+ *
+ * Una voce non viene mai servita se la risposta a quella richiesta è cambiata. I libri di una risposta cambiano solo
+ * con un prestito o con la scadenza di un prestito: ogni prestito toglie dalla cache le voci che contengono il libro
+ * prestato (cache_invalidaLibro), e ogni voce ricorda l'istante in cui scade il primo prestito dei suoi libri, dopo il
+ * quale viene tolta alla prima ricerca.
+ *
+ * La cache è divisa in CACHE_PARTIZIONI partizioni, ognuna con il suo mutex, la sua tabella hash e la sua lista LRU,
+ * quindi i worker che cercano richieste diverse raramente si aspettano. Quando una partizione supera la sua parte di
+ * CACHE_MAX_VOCI voci o di CACHE_MAX_BYTE byte perde le voci usate meno di recente.
+ */
+#ifndef CACHE_RICHIESTE_H
+#define CACHE_RICHIESTE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdatomic.h>
+#include <pthread.h>
+
+#include "../my_lib/hash_table.h"
+
+#ifndef SUCCESS
+#define SUCCESS 0
+#endif
+
+#ifndef ERR_SYSTEM_CALL
+#define ERR_SYSTEM_CALL -1
+#endif
+
+/**
+ * Numero di partizioni della cache, ognuna con il suo mutex.
+ */
+#ifndef CACHE_PARTIZIONI
+#define CACHE_PARTIZIONI 8
+#endif
+
+/**
+ * Numero massimo di voci in tutta la cache.
+ */
+#ifndef CACHE_MAX_VOCI
+#define CACHE_MAX_VOCI 512
+#endif
+
+/**
+ * Byte massimi delle risposte in tutta la cache.
+ */
+#ifndef CACHE_MAX_BYTE
+#define CACHE_MAX_BYTE (16 << 20)
+#endif
+
+/**
+ * Le risposte più lunghe di così non vengono salvate.
+ */
+#ifndef CACHE_MAX_RISPOSTA
+#define CACHE_MAX_RISPOSTA (1 << 20)
+#endif
+
+/**
+ * @brief Risposta a una richiesta, salvata nella cache.
+ *
+ * Tutto tranne `cache_riferimenti` e la lista LRU non cambia dopo l'inserimento, quindi chi ha un riferimento alla
+ * voce la legge senza lock.
+ *
+ * @param cache_richiesta Richiesta normalizzata, la chiave della voce.
+ * @param cache_risposta, cache_lunghezza Le stringhe dei libri, una dopo l'altra come vengono mandate al client.
+ * @param cache_ordinali, cache_numeroLibri Gli ordinali dei libri della risposta, in ordine crescente.
+ * @param cache_scadenza Ultimo istante (time_t) in cui la risposta è ancora valida: l'istante in cui scade il primo
+ *                       prestito dei suoi libri, o INT64_MAX se nessuno è in prestito.
+ * @param cache_riferimenti La cache ha un riferimento finché la voce è nella tabella; chi la trova con cache_cerca ne
+ *                          ha un altro fino a cache_rilascia. La voce viene liberata quando non ne restano.
+ * @param cache_precedente, cache_successiva Vicini nella lista LRU della partizione.
+ */
+struct voceCache
+{
+    char *cache_richiesta;
+    char *cache_risposta;
+    size_t cache_lunghezza;
+    uint32_t *cache_ordinali;
+    int cache_numeroLibri;
+    int64_t cache_scadenza;
+    _Atomic int cache_riferimenti;
+    struct voceCache *cache_precedente, *cache_successiva;
+};
+
+/**
+ * @brief Una partizione della cache.
+ *
+ * @param cache_voci Tabella hash di `struct voceCache *`, con chiave `cache_richiesta`.
+ * @param cache_piuRecente, cache_menoRecente Estremi della lista LRU: la voce usata più di recente e quella da togliere
+ *                                            per prima.
+ * @param cache_numeroVoci, cache_byte Voci nella partizione e somma delle lunghezze delle loro risposte.
+ */
+struct partizioneCache
+{
+    pthread_mutex_t cache_mutex;
+    struct hash_table cache_voci;
+    struct voceCache *cache_piuRecente, *cache_menoRecente;
+    size_t cache_numeroVoci, cache_byte;
+};
+
+/**
+ * @brief Cache delle risposte alle query.
+ *
+ * @param cache_invalidazioni Numero di chiamate a cache_invalidaLibro. Chi costruisce una risposta lo legge prima di
+ *                            leggere i libri: se è cambiato quando la risposta è pronta un libro può essere stato
+ *                            prestato nel frattempo, e la risposta non viene salvata.
+ * @param cache_attiva 0 se la cache non è stata creata: cache_cerca non trova nulla e cache_inserisci non salva nulla.
+ */
+struct cacheRichieste
+{
+    struct partizioneCache cache_partizioni[CACHE_PARTIZIONI];
+    _Atomic uint64_t cache_invalidazioni;
+    int cache_attiva;
+};
+
+/**
+ * @return Una cache non attiva, su cui tutte le funzioni si possono chiamare senza effetto.
+ */
+struct cacheRichieste cache_nonAttiva(void);
+
+/**
+ * @brief Crea una cache vuota.
+ *
+ * @return SUCCESS, o ERR_SYSTEM_CALL (e la cache resta non attiva).
+ */
+int cache_crea(struct cacheRichieste *cache);
+
+/**
+ * @brief Cerca la risposta a `richiesta`, già normalizzata.
+ *
+ * Una voce scaduta viene tolta dalla cache e non viene trovata. Una voce trovata diventa la più recente.
+ *
+ * @return La voce con un riferimento in più, da restituire con cache_rilascia, o NULL.
+ */
+struct voceCache *cache_cerca(struct cacheRichieste *cache, const char *richiesta);
+
+/**
+ * @brief Restituisce il riferimento ottenuto con cache_cerca.
+ */
+void cache_rilascia(struct voceCache *voce);
+
+/**
+ * @return Il valore di `cache_invalidazioni` da passare a cache_inserisci, letto prima di leggere i libri della risposta.
+ */
+uint64_t cache_inizioRisposta(struct cacheRichieste *cache);
+
+/**
+ * @brief Salva la risposta a `richiesta`, se nessun libro è stato prestato da quando è stata letta `invalidazioni`.
+ *
+ * @param risposta Stringhe dei libri, allocate con malloc: la cache ne diventa proprietaria (e le libera anche se non
+ *                 le salva).
+ * @param ordinali Ordinali dei libri in ordine crescente, allocati con malloc: come `risposta`.
+ * @param scadenza Ultimo istante in cui la risposta è valida (vedi `struct voceCache`).
+ * @return SUCCESS anche se la risposta non viene salvata, ERR_SYSTEM_CALL se un'allocazione fallisce.
+ */
+int cache_inserisci(struct cacheRichieste *cache, const char *richiesta, char *risposta, size_t lunghezza,
+                    uint32_t *ordinali, int numeroLibri, int64_t scadenza, uint64_t invalidazioni);
+
+/**
+ * @brief Toglie dalla cache le risposte che contengono il libro `ordinale`. Va chiamata dopo aver cambiato il prestito
+ *        del libro.
+ */
+void cache_invalidaLibro(struct cacheRichieste *cache, uint32_t ordinale);
+
+/**
+ * @brief Libera tutte le voci e la cache, che torna non attiva. Le voci ancora in uso vengono liberate da
+ *        cache_rilascia.
+ */
+void cache_distruggi(struct cacheRichieste *cache);
+
+#endif
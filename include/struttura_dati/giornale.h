@@ -0,0 +1,185 @@
+/**
+ * @file giornale.h
+ * @brief Giornale dei prestiti: file in sola aggiunta che rende durevole ogni prestito senza riscrivere il file record.
+ *
+ * Ogni prestito viene aggiunto in fondo al giornale come una `struct voceGiornale` di dimensione fissa. La scrittura
+ * costa una pwrite; la sincronizzazione sul disco è di gruppo (group commit): un solo fdatasync rende durevoli tutte
+ * le voci scritte fino a quel momento, e i thread che aspettano la stessa sincronizzazione non ne fanno un'altra.
+ *
+ * All'avvio le voci valide vengono riapplicate ai libri, nell'ordine in cui sono state scritte. Un thread in background
+ * compatta il giornale quando supera una soglia: il chiamante riscrive il file record con lo stato attuale dei libri,
+ * e le voci già contenute nel file record vengono tolte dal giornale. Riapplicare una voce già contenuta nel file
+ * record non cambia nulla, quindi un crash in qualsiasi momento della compattazione non perde prestiti.
+ *
+ * L'intestazione lega il giornale al file record con dimensione, inode e data di modifica, come per gli snapshot: le
+ * voci di un giornale scritto per un altro file record (o per questo prima che fosse sostituito) vengono ignorate.
+ * Chi riscrive il file record annuncia il file che lo sostituirà con gior_nuovoRecord prima della rename, così anche
+ * un crash subito dopo la rename trova un giornale valido.
+ */
+#ifndef GIORNALE_H
+#define GIORNALE_H
+
+#include <stdint.h>
+#include <pthread.h>
+#include <time.h>
+#include <sys/stat.h>
+
+#ifndef SUCCESS
+#define SUCCESS 0
+#endif
+
+#ifndef ERR_SYSTEM_CALL
+#define ERR_SYSTEM_CALL -1
+#endif
+
+#define GIOR_MAGICO "BIBWAL"
+#define GIOR_ESTENSIONE ".wal"
+#define GIOR_VERSIONE 3
+
+// come per gli snapshot, riconosce i giornali scritti su macchine con un ordine dei byte diverso
+#define GIOR_CONTROLLO 0x01020304u
+
+/**
+ * Numero di voci oltre il quale il giornale viene compattato nel file record.
+ */
+#ifndef GIOR_SOGLIA_COMPATTAZIONE
+#define GIOR_SOGLIA_COMPATTAZIONE (1 << 16)
+#endif
+
+/**
+ * @brief Dimensione, data di ultima modifica e inode di un file record, tutti a 0 se non c'è nessun file.
+ */
+struct identitaRecord
+{
+    uint64_t gior_dimensione;
+    int64_t gior_modifica, gior_modificaNs;
+    uint64_t gior_inode;
+};
+
+/**
+ * @brief Intestazione all'inizio del giornale.
+ *
+ * @param gior_numeroLibri Numero di libri del file record a cui si riferisce il giornale: un giornale con un numero
+ *                         diverso appartiene a un altro file record e viene ignorato.
+ * @param gior_record Il file record a cui si riferisce il giornale.
+ * @param gior_recordNuovo Il file record annunciato con gior_nuovoRecord, che sostituirà `gior_record`: anche con
+ *                         questo il giornale è valido.
+ */
+struct intestazioneGiornale
+{
+    char gior_magico[8];
+    uint32_t gior_versione, gior_controllo;
+    uint64_t gior_numeroLibri;
+    struct identitaRecord gior_record, gior_recordNuovo;
+};
+
+/**
+ * @brief Voce del giornale: il prestito di un libro.
+ *
+ * @param gior_tempo Istante del prestito (time_t), il valore scritto in `lib_prestito`.
+ * @param gior_ordinale `lib_ordinale` del libro prestato.
+ * @param gior_controllo Checksum dei campi precedenti: una voce scritta solo in parte da un crash non la supera.
+ */
+struct voceGiornale
+{
+    int64_t gior_tempo;
+    uint32_t gior_ordinale;
+    uint32_t gior_controllo;
+};
+
+/**
+ * @brief Giornale aperto in scrittura.
+ *
+ * @param gior_fd Descrittore del file, sostituito da ogni compattazione: va letto con `gior_mutex`.
+ * @param gior_percorso Percorso del file, NULL se il giornale non è aperto: in questo caso gior_registra,
+ *                      gior_attendi e gior_nuovoRecord non fanno nulla. Non cambia mentre il giornale è aperto.
+ * @param gior_intestazione L'intestazione scritta nel file, da leggere con `gior_mutex`.
+ * @param gior_scritte, gior_sincronizzate Numero di voci scritte nel file e numero di voci già sincronizzate sul disco.
+ * @param gior_sincronizzazioneInCorso 1 mentre un thread esegue fdatasync per conto di tutti gli altri.
+ * @param gior_prossimaCompattazione Numero di voci raggiunto il quale il thread di compattazione si sveglia.
+ * @param gior_compatta, gior_argomento Funzione chiamata dal thread di compattazione per riscrivere il file record
+ *                                      con lo stato attuale dei libri.
+ */
+struct giornale
+{
+    int gior_fd;
+    char *gior_percorso;
+    struct intestazioneGiornale gior_intestazione;
+
+    pthread_mutex_t gior_mutex;
+    pthread_cond_t gior_condSincronizzazione, gior_condCompattazione;
+    uint64_t gior_scritte, gior_sincronizzate;
+    int gior_sincronizzazioneInCorso;
+
+    pthread_t gior_compattatore;
+    int gior_compattatoreAvviato, gior_chiusura;
+    uint64_t gior_soglia, gior_prossimaCompattazione;
+    int (*gior_compatta)(void *);
+    void *gior_argomento;
+};
+
+/**
+ * @return Un giornale chiuso, su cui gior_registra, gior_attendi e gior_chiudi non fanno nulla.
+ */
+struct giornale gior_crea(void);
+
+/**
+ * @brief Apre il giornale `percorso` e riapplica le sue voci, o lo crea vuoto se non esiste.
+ *
+ * Le voci vengono lette nell'ordine in cui sono state scritte e passate ad `applica`, fino alla prima non valida:
+ * quelle che seguono (scritte solo in parte da un crash) vengono tolte dal file. Un giornale di un altro file record
+ * viene svuotato senza riapplicare nulla.
+ *
+ * @param record Informazioni (fstat) del file record da cui è stata generata la struttura dati.
+ * @param numeroLibri Numero di libri della struttura dati: le voci con un ordinale non valido vengono scartate.
+ * @param applica Funzione chiamata per ogni voce valida, con `argomento`.
+ * @return SUCCESS se il giornale è aperto, ERR_SYSTEM_CALL altrimenti (il giornale resta chiuso).
+ */
+int gior_apri(struct giornale *giornale, const char *percorso, const struct stat *record, uint32_t numeroLibri,
+              void (*applica)(void *, const struct voceGiornale *), void *argomento);
+
+/**
+ * @brief Avvia il thread che compatta il giornale ogni volta che supera `soglia` voci.
+ *
+ * @param compatta Funzione che riscrive il file record e lo sincronizza sul disco, e ritorna SUCCESS: solo allora le
+ *                 voci scritte prima della sua chiamata vengono tolte dal giornale. Viene chiamata senza lock e deve
+ *                 leggere i libri in modo thread-safe, perché i worker continuano a prestarli.
+ * @param compattaSubito Se diverso da 0 la prima compattazione parte subito.
+ * @return SUCCESS, ERR_SYSTEM_CALL se il thread non può essere creato.
+ */
+int gior_avviaCompattazione(struct giornale *giornale, uint64_t soglia, int (*compatta)(void *), void *argomento, int compattaSubito);
+
+/**
+ * @brief Aggiunge in fondo al giornale il prestito del libro `ordinale`, senza aspettare che sia sul disco.
+ *
+ * @param sequenza Riceve il numero della voce, da passare a gior_attendi.
+ * @return SUCCESS se la voce è stata scritta, ERR_SYSTEM_CALL altrimenti.
+ */
+int gior_registra(struct giornale *giornale, uint32_t ordinale, int64_t tempo, uint64_t *sequenza);
+
+/**
+ * @brief Aspetta che la voce `sequenza`, e quindi tutte quelle scritte prima, sia sincronizzata sul disco.
+ *
+ * Se nessun thread sta sincronizzando il giornale il chiamante esegue fdatasync per tutti; altrimenti aspetta quella
+ * in corso e, se non bastava, la successiva.
+ *
+ * @return SUCCESS se la voce è durevole, ERR_SYSTEM_CALL se fdatasync fallisce.
+ */
+int gior_attendi(struct giornale *giornale, uint64_t sequenza);
+
+/**
+ * @brief Annuncia il file che sta per sostituire il file record con una rename: dopo la rename il giornale resta
+ *        valido, e la prossima compattazione (o apertura) lo lega solo al nuovo file.
+ *
+ * @param record Informazioni (fstat) del nuovo file, già completo e sincronizzato sul disco: la rename non le cambia.
+ * @return SUCCESS se l'intestazione aggiornata è sul disco, ERR_SYSTEM_CALL altrimenti (il file record non va
+ *         sostituito, o al prossimo avvio il giornale verrebbe ignorato).
+ */
+int gior_nuovoRecord(struct giornale *giornale, const struct stat *record);
+
+/**
+ * @brief Ferma il thread di compattazione (aspettando la compattazione in corso), sincronizza e chiude il giornale.
+ */
+void gior_chiudi(struct giornale *giornale);
+
+#endif
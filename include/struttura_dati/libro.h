@@ -10,7 +10,9 @@
 
 #include <pthread.h>
 #include <stdint.h>
+#include <stdatomic.h>
 #include "personal_time.h"
+#include "../my_lib/arena.h"
 
 #ifndef SUCCESS
 #define SUCCESS 0
@@ -33,11 +35,67 @@
 #define ERR_FORMATO_DATA -2
 #endif
 
+#ifndef ERR_FORMATO_STR
+#define ERR_FORMATO_STR 9325
+#endif
+
+/**
+ * Valore di `lib_prestito` di un libro che non è mai stato prestato.
+ */
+#define LIB_NESSUN_PRESTITO INT64_MIN
+
+/**
+ * Secondi dopo i quali un prestito scade e il libro si può prestare di nuovo.
+ */
+#ifndef LIB_DURATA_PRESTITO
+#define LIB_DURATA_PRESTITO 30
+#endif
+
+/**
+ * Spazio per la parte finale della stringa di un libro scritta da lib_scriviPrestito, terminatore compreso.
+ */
+#define LIB_DIMENSIONE_PRESTITO sizeof(" prestito: gg-mm-aaaa hh:mn:sc;\n")
+
+/**
+ * Id di una coppia del libro il cui campo non è ancora stato registrato nella struttura dati.
+ */
+#ifndef ID_COPPIA_NON_ASSEGNATO
+#define ID_COPPIA_NON_ASSEGNATO -1
+#endif
+
+/**
+ * @brief Coppia campo:valore di un libro, già normalizzata con lib_formattaStringa.
+ *
+ * @param lib_campo, lib_valore Puntano all'interno di `lib_normalizzata` del libro.
+ * @param lib_idCampo Id del campo assegnato dalla struttura dati, ID_COPPIA_NON_ASSEGNATO finché non viene indicizzato.
+ */
+struct coppiaLibro
+{
+    char *lib_campo, *lib_valore;
+    int lib_idCampo;
+};
+
+/**
+ * @param lib_lunghezza Lunghezza di `lib_stringa`, che non cambia dopo la creazione.
+ * @param lib_normalizzata Copia di `lib_stringa` divisa nelle coppie del libro e normalizzata, creata una sola volta
+ *                         da lib_crea. Non viene mai modificata, quindi si può leggere senza accedere al libro.
+ * @param lib_coppie Array di `lib_numeroCoppie` coppie del libro, nell'ordine in cui compaiono in `lib_stringa`.
+ * @param lib_ordinale Posizione del libro nel file record, assegnata dalla struttura dati. Le bitmap dei libri
+ *                     dell'indice contengono gli ordinali.
+ * @param lib_prestito Istante (time_t) dell'ultimo prestito, o LIB_NESSUN_PRESTITO: è l'unico campo che cambia dopo
+ *                     la creazione. Stato del prestito e sua data sono una sola parola, quindi si leggono insieme con
+ *                     un solo load e si prestano con una compare-and-swap: nessun thread accede mai al libro in modo
+ *                     esclusivo. Il prestito è in corso se non sono passati più di LIB_DURATA_PRESTITO secondi.
+ */
 struct libro
 {
     char *lib_stringa;
-    __int8_t lib_inPrestito, lib_inUso;
-    struct tm lib_dataPrestito;
+    size_t lib_lunghezza;
+    char *lib_normalizzata;
+    struct coppiaLibro *lib_coppie;
+    int lib_numeroCoppie;
+    uint32_t lib_ordinale;
+    _Atomic int64_t lib_prestito;
 };
 
 //! FUNZIONI UTILI ANCHE ALLA STRUTTURA DATI
@@ -48,7 +106,8 @@ struct libro
  * Utilizza ":" per separare chiave e valore, e ";" per terminare una coppia. La prima chiamata utilizza la stringa target,
  * chiamate successive passano NULL per continuare dall'ultima posizione.
  *
- * @note Modifica la stringa inserendo '\0' al posto dei delimitatori. Non è thread-safe.
+ * @note Modifica la stringa inserendo '\0' al posto dei delimitatori. La posizione raggiunta è salvata per thread,
+ *       quindi ogni thread può estrarre coppie dalla sua stringa, ma non da due stringhe alternandole.
  * @param stringa La stringa sorgente o NULL per proseguire l'estrazione.
  * @return 1 per successo, 0 altrimenti.
  * @warning Passare stringhe non valide o modificare la stringa tra le chiamate può causare errori.
@@ -88,24 +147,29 @@ int lib_controllaFormatoCorretto(const char *stringa);
 /**
  * @brief Inizializza una struttura libro da una stringa.
  *
- * Alloca e copia `str` in `dst->lib_stringa`, rimuove il carattere di nuova riga finale se presente, e
- * inizializza i dati di prestito. Assume che `str` sia nel formato corretto.
+ * Copia i primi `lunghezza` caratteri di `str` in `dst->lib_stringa`, ne verifica il formato con
+ * lib_controllaFormatoCorretto, rimuove il carattere di nuova riga finale se presente, inizializza i dati di prestito
+ * e divide il libro nelle sue coppie normalizzate (`lib_coppie`).
  *
  * @param dst Puntatore alla struttura `libro` da inizializzare.
- * @param str Stringa con i dati del libro.
- *
- * @return `SUCCESS` se l'operazione è riuscita, altrimenti `ERR_SYSTEM_CALL` per errori di allocazione memoria
- *         o `ERR_FORMATO_DATA` se il formato data di prestito è invalido.
- *
- * @warning La funzione non verifica il che il formato di `str` sia corretto. Da un grande potere derivano grandi responsabilità.
+ * @param str Dati del libro. Non serve che sia terminata da '\0', quindi può puntare direttamente dentro al file record.
+ * @param lunghezza Numero di caratteri del libro in `str`.
+ * @param arena Arena da cui vengono allocate le stringhe e le coppie del libro. Non c'è una funzione per liberare un
+ *              singolo libro: la sua memoria viene liberata insieme a tutta l'arena con ar_destroy.
+ *
+ * @return `SUCCESS` se l'operazione è riuscita, altrimenti `ERR_SYSTEM_CALL` per errori di allocazione memoria,
+ *         `ERR_FORMATO_STR` se il libro non è nel formato corretto o `ERR_FORMATO_DATA` se il formato data di
+ *         prestito è invalido.
  */
-int lib_crea(struct libro *dst, const char *str);
+int lib_crea(struct libro *dst, const char *str, size_t lunghezza, struct arena *arena);
 
 /**
  * @brief Genera una stringa contenente i dati di un libro, inclusi i dettagli del prestito se presente.
  *
  * Alloca una nuova stringa per contenere i dati del libro da `libro->lib_stringa`, aggiungendo informazioni di prestito
- * se applicabile. La stringa risultante include un carattere di nuova riga finale.
+ * se applicabile. La stringa risultante include un carattere di nuova riga finale. È thread-safe e non si blocca mai:
+ * `lib_stringa` non cambia e lo stato del prestito viene letto con un solo load di `lib_prestito`, anche mentre altri
+ * thread prestano il libro.
  *
  * @return Puntatore alla stringa allocata contenente i dati del libro e, se in prestito, la data di prestito
  *         formattata come "prestito: gg-mm-aaaa hh:mn:sc;". Ritorna NULL in caso di errore di allocazione
@@ -115,49 +179,64 @@ int lib_crea(struct libro *dst, const char *str);
 char *lib_leggi(struct libro *libro);
 
 /**
- * @brief Genera in modo thread-safe una stringa con i dati di un libro, inclusi i dettagli del prestito.
+ * @brief Scrive in `dst` quello che lib_leggi aggiunge a `lib_stringa`: la data del prestito, se in corso, e il
+ *        carattere di nuova riga.
  *
- * Invoca `lib_leggi` per ottenere i dati del libro specificato, assicurandosi l'accesso esclusivo alla risorsa
- * mediante l'uso di mutex e variabili di condizione.
+ * `lib_stringa` seguita da `dst` è la stringa del libro, quindi chi la deve solo scrivere (su un socket o su un file)
+ * può farlo senza allocare memoria e senza copiare `lib_stringa`. Come lib_leggi legge il prestito con un solo load.
  *
- * @return Puntatore alla stringa allocata con i dati del libro e, se applicabile, dettagli del prestito.
- *         Ritorna NULL in caso di errore nell'allocazione della memoria o fallimento nelle funzioni di lock/unlock.
- * @note È responsabilità del chiamante liberare la memoria della stringa restituita.
+ * @param dst Almeno LIB_DIMENSIONE_PRESTITO caratteri.
+ * @return La lunghezza scritta in `dst` (senza terminatore), o ERR_SYSTEM_CALL se la conversione della data fallisce.
  */
-char *lib_leggiThreadSafe(struct libro *libro, pthread_mutex_t *mutex, pthread_cond_t *cond);
+int lib_scriviPrestito(struct libro *libro, char *dst);
 
 /**
  * @brief Effettua in modo thread-safe il prestito di un libro.
  *
- * Tenta di marcare un libro come prestato, verificando prima lo stato del prestito. L'operazione è protetta
- * da mutex per garantire la sicurezza in un ambiente multithread. La data del prestito viene impostata al momento attuale.
+ * Se il prestito precedente è scaduto scrive in `lib_prestito` l'istante attuale con una sola compare-and-swap, senza
+ * lock: se un altro thread presta il libro nel frattempo la compare-and-swap fallisce e il controllo viene ripetuto,
+ * quindi di due prestiti contemporanei ne riesce solo uno.
  *
- * @return Ritorna `1` se il libro è stato prestato con successo, `0` se il libro era già in prestito,
- *         o `ERR_SYSTEM_CALL` in caso di errore nelle operazioni di lock, unlock, o nell'impostazione della data.
- * @note La funzione assicura che le risorse vengano rilasciate correttamente in caso di errore.
+ * @param tempoPrestito Se non è NULL riceve l'istante del prestito.
+ * @param precedente Se non è NULL riceve il valore di `lib_prestito` sostituito, per `lib_annullaPrestito`.
+ * @return Ritorna `1` se il libro è stato prestato con successo, `0` se il libro era già in prestito.
  */
-int lib_prestaThreadSafe(struct libro *libro, pthread_mutex_t *mutex, pthread_cond_t *cond);
+int lib_prestaThreadSafe(struct libro *libro, int64_t *tempoPrestito, int64_t *precedente);
 
 /**
- * @brief Verifica in modo thread-safe se un libro soddisfa una richiesta specificata.
+ * @brief Annulla il prestito fatto con `lib_prestaThreadSafe` all'istante `tempoPrestito`, rimettendo in `lib_prestito`
+ *        il valore `precedente` con una compare-and-swap.
+ *
+ * Serve quando il prestito non può essere reso durevole: finché è in corso nessun altro thread può prestare il libro,
+ * quindi la compare-and-swap fallisce solo se `lib_prestito` non contiene più quel prestito.
  *
- * Confronta le coppie campo-valore specificate in `richiesta` con i dati del libro, eseguendo l'operazione
- * in modo thread-safe. Utilizza la normalizzazione delle stringhe per garantire corrispondenze accurate.
+ * @return `1` se il prestito è stato annullato, `0` altrimenti.
+ */
+int lib_annullaPrestito(struct libro *libro, int64_t tempoPrestito, int64_t precedente);
+
+/**
+ * @return `1` se il prestito iniziato all'istante `prestito` (o LIB_NESSUN_PRESTITO) è ancora in corso all'istante
+ *         `adesso`, `0` altrimenti.
+ */
+int lib_prestitoInCorso(int64_t prestito, int64_t adesso);
+
+/**
+ * @brief Copia in `copia` lo stato attuale di un libro, in modo thread-safe.
  *
- * @param richiesta Stringa contenente coppie "campo:valore;"" da verificare nel libro.
- * @return Ritorna `1` se tutte le coppie campo-valore specificate in `richiesta` corrispondono a quelle nel libro,
- *         `0` se almeno una coppia non corrisponde, o `ERR_SYSTEM_CALL` in caso di errore di allocazione o lettura dei dati.
- * @note La funzione assicura la pulizia delle risorse in caso di errore o al termine del controllo.
+ * La copia condivide le stringhe e le coppie del libro, che non cambiano dopo la creazione; solo `lib_prestito`
+ * viene copiato. Serve a leggere tutti i libri (ad esempio per riscrivere il file record) mentre i worker li prestano.
  */
-int lib_controllaRichiestaThreadSafe(struct libro *libro, const char *richiesta, pthread_mutex_t *mutex, pthread_cond_t *cond);
+void lib_copiaThreadSafe(const struct libro *libro, struct libro *copia);
 
 /**
- * @brief Libera le risorse allocate per una struttura libro.
+ * @brief Verifica se una coppia del libro con il campo `idCampo` contiene `valore`.
  *
- * Dealloca la memoria utilizzata per i campi `lib_stringa` e `lib_dataPrestito` di un libro.
+ * Lavora solo sulle coppie già analizzate e normalizzate da lib_crea, senza allocare memoria e senza accedere al libro:
+ * le coppie non vengono mai modificate dopo la creazione, quindi non servono mutex.
  *
- * @note La funzione verifica la validità del puntatore `libro` e dei suoi campi prima della deallocazione per prevenire dereferenziazioni di puntatori NULL.
+ * @param valore Valore cercato, già normalizzato con lib_formattaStringa.
+ * @return Ritorna `1` se almeno una coppia del campo contiene `valore`, `0` altrimenti.
  */
-void lib_free(struct libro *libro);
+int lib_contieneCoppia(const struct libro *libro, int idCampo, const char *valore);
 
 #endif
@@ -27,4 +27,8 @@ int pt_currentTime(struct tm *dst);
 int pt_secDiff(struct tm *time1, struct tm *time2);
 int pt_creaStringaData(char *dst, size_t size, const struct tm *src);
 
+// Come pt_estraiData e pt_creaStringaData, ma con l'istante come time_t (ora locale)
+int pt_estraiTempo(time_t *dst, const char *src);
+int pt_creaStringaTempo(char *dst, size_t size, time_t src);
+
 #endif // PERSONAL_TIME_H
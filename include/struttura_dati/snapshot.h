@@ -0,0 +1,201 @@
+/**
+ * @file snapshot.h
+ * @brief Formato binario dello snapshot della struttura dati e funzioni per scriverlo e leggerlo.
+ *
+ * Lo snapshot è un file salvato accanto al file record (con estensione SNAP_ESTENSIONE) che contiene i libri già
+ * analizzati, il loro stato di prestito e gli indici dei campi già costruiti. Al posto dei puntatori contiene offset
+ * dall'inizio del file, quindi si può mappare in memoria a qualsiasi indirizzo e usare senza analizzare nulla.
+ * Tutte le strutture sono allineate a 8 byte all'interno del file.
+ */
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/stat.h>
+
+#ifndef SUCCESS
+#define SUCCESS 0
+#endif
+
+#ifndef FAILURE
+#define FAILURE -1
+#endif
+
+#define SNAP_MAGICO "BIBSNAP"
+#define SNAP_ESTENSIONE ".snap"
+
+/**
+ * Da incrementare ogni volta che cambia una delle strutture di questo file: gli snapshot di versioni diverse vengono
+ * ignorati.
+ */
+#define SNAP_VERSIONE 2
+
+// scritto nell'intestazione per riconoscere gli snapshot scritti su macchine con un ordine dei byte diverso
+#define SNAP_CONTROLLO 0x01020304u
+
+#define SNAP_OFFSET_NULLO UINT64_MAX
+
+/**
+ * @brief Intestazione all'inizio dello snapshot.
+ *
+ * @param snap_dimensioneRecord, snap_modificaRecord, snap_modificaRecordNs, snap_inodeRecord
+ * Dimensione, data di ultima modifica e inode del file record da cui è stato generato lo snapshot: se il file record
+ * non corrisponde più lo snapshot non è aggiornato e viene ignorato.
+ *
+ * @param snap_libri, snap_campi Offset degli array di `struct snap_libro` e `struct snap_campo`.
+ */
+struct snap_intestazione
+{
+    char snap_magico[8];
+    uint32_t snap_versione, snap_controllo;
+    uint64_t snap_dimensione;
+    uint64_t snap_dimensioneRecord;
+    int64_t snap_modificaRecord, snap_modificaRecordNs;
+    uint64_t snap_inodeRecord;
+    uint32_t snap_numeroLibri, snap_numeroCampi;
+    uint64_t snap_libri, snap_campi;
+};
+
+/**
+ * @brief Libro dello snapshot, nell'ordine degli ordinali.
+ *
+ * @param snap_stringa Offset di `lib_stringa`.
+ * @param snap_normalizzata Offset di `lib_normalizzata`, lunga quanto `lib_stringa` compreso il '\0'.
+ * @param snap_coppie Offset dell'array di `snap_numeroCoppie` `struct snap_coppia`.
+ * @param snap_prestito Valore di `lib_prestito`.
+ */
+struct snap_libro
+{
+    uint64_t snap_stringa, snap_normalizzata, snap_coppie;
+    uint32_t snap_numeroCoppie;
+    int32_t snap_riservato;
+    int64_t snap_prestito;
+};
+
+/**
+ * @param snap_campo, snap_valore Posizioni del campo e del valore all'interno di `lib_normalizzata` del libro.
+ */
+struct snap_coppia
+{
+    uint32_t snap_campo, snap_valore;
+    int32_t snap_idCampo;
+    int32_t snap_riservato;
+};
+
+/**
+ * @brief Campo dello snapshot, nell'ordine degli id.
+ *
+ * @param snap_valori Offset dell'array di `snap_numeroValori` `struct snap_valore`, in ordine crescente.
+ * @param snap_trigrammi Offset dell'array di `snap_numeroTrigrammi` `struct snap_trigramma`.
+ */
+struct snap_campo
+{
+    uint64_t snap_nome;
+    uint32_t snap_numeroValori, snap_numeroOccorrenze;
+    uint64_t snap_valori;
+    uint64_t snap_numeroTrigrammi, snap_trigrammi;
+};
+
+/**
+ * @param snap_bitmap, snap_dimensioneBitmap La bitmap dei libri del valore scritta da cb_serialize.
+ */
+struct snap_valore
+{
+    uint64_t snap_stringa;
+    uint64_t snap_bitmap, snap_dimensioneBitmap;
+};
+
+/**
+ * @param snap_valori Offset dell'array di `snap_numeroValori` `uint32_t`, le posizioni dei valori che contengono il
+ *                    trigramma nell'array `snap_valori` del campo.
+ */
+struct snap_trigramma
+{
+    uint32_t snap_trigramma, snap_numeroValori;
+    uint64_t snap_valori;
+};
+
+/**
+ * @brief Snapshot in costruzione in memoria, prima di essere salvato su file con snap_salva.
+ */
+struct snapshotScrittura
+{
+    char *snap_dati;
+    size_t snap_dimensione, snap_capacita;
+};
+
+/**
+ * @brief Snapshot mappato in memoria in sola lettura.
+ */
+struct snapshotLettura
+{
+    const char *snap_dati;
+    size_t snap_dimensione;
+};
+
+/**
+ * @return Uno snapshot vuoto da riempire con snap_aggiungi.
+ */
+struct snapshotScrittura snap_creaScrittura(void);
+
+/**
+ * @brief Aggiunge in fondo allo snapshot `dimensione` byte, allineati a 8.
+ *
+ * @param dati I byte da copiare, o NULL per riservare byte a zero da riempire dopo tramite snap_at.
+ * @return L'offset dei byte aggiunti, o SNAP_OFFSET_NULLO se l'allocazione fallisce.
+ * @warning Ogni aggiunta può spostare i dati: i puntatori ottenuti con snap_at vanno richiesti di nuovo.
+ */
+uint64_t snap_aggiungi(struct snapshotScrittura *snapshot, const void *dati, size_t dimensione);
+
+/**
+ * @brief Aggiunge allo snapshot una stringa terminata da '\0'.
+ *
+ * @return L'offset della stringa, o SNAP_OFFSET_NULLO se l'allocazione fallisce.
+ */
+uint64_t snap_aggiungiStringa(struct snapshotScrittura *snapshot, const char *stringa);
+
+/**
+ * @return Puntatore ai byte dello snapshot in costruzione all'offset `offset`.
+ */
+void *snap_at(struct snapshotScrittura *snapshot, uint64_t offset);
+
+/**
+ * @brief Salva lo snapshot nel file `percorso`, sostituendo in modo atomico quello precedente.
+ *
+ * Scrive un file temporaneo nella stessa cartella, lo sincronizza sul disco e lo rinomina: un crash durante il
+ * salvataggio lascia lo snapshot precedente.
+ *
+ * @return SUCCESS se l'operazione è riuscita, FAILURE altrimenti.
+ */
+int snap_salva(struct snapshotScrittura *snapshot, const char *percorso);
+
+/**
+ * Libera la memoria dello snapshot in costruzione.
+ */
+void snap_distruggiScrittura(struct snapshotScrittura *snapshot);
+
+/**
+ * @brief Mappa in memoria lo snapshot `percorso` e ne verifica l'intestazione.
+ *
+ * @param record Informazioni (fstat) del file record: lo snapshot è valido solo se è stato generato da questo file.
+ * @return SUCCESS se lo snapshot esiste, è della versione SNAP_VERSIONE ed è aggiornato, FAILURE altrimenti.
+ */
+int snap_apri(struct snapshotLettura *snapshot, const char *percorso, const struct stat *record);
+
+/**
+ * @return Puntatore ai `dimensione` byte all'offset `offset`, o NULL se non sono tutti dentro lo snapshot.
+ */
+const void *snap_leggi(const struct snapshotLettura *snapshot, uint64_t offset, uint64_t dimensione);
+
+/**
+ * @return Puntatore alla stringa all'offset `offset`, o NULL se non è terminata da '\0' dentro lo snapshot.
+ */
+const char *snap_leggiStringa(const struct snapshotLettura *snapshot, uint64_t offset);
+
+/**
+ * Rimuove la mappatura dello snapshot. Da chiamare solo quando nessun puntatore ai suoi dati è più in uso.
+ */
+void snap_chiudi(struct snapshotLettura *snapshot);
+
+#endif
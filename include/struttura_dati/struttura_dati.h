@@ -1,9 +1,14 @@
 #ifndef STRUTTURA_DATI_H
 #define STRUTTURA_DATI_H
 
+#include <stdio.h>
+#include <sys/uio.h>
+
 #include "../my_lib/dynamic_array.h"
 #include "libro.h"
 #include "arrayCampi.h"
+#include "giornale.h"
+#include "cache_richieste.h"
 
 
 #ifndef SUCCESS
@@ -38,6 +43,18 @@
 #define MAX_PATH 108
 #endif
 
+/**
+ * str_d_genera carica il file record con al più MAX_THREAD_CARICAMENTO thread, dando a ciascuno almeno
+ * MIN_PORZIONE_CARICAMENTO byte del file.
+ */
+#ifndef MAX_THREAD_CARICAMENTO
+#define MAX_THREAD_CARICAMENTO 8
+#endif
+
+#ifndef MIN_PORZIONE_CARICAMENTO
+#define MIN_PORZIONE_CARICAMENTO (1 << 16)
+#endif
+
 /**
  * @struct strutturaDati
  * @brief Struttura principale per la gestione dei libri e dei loro campi.
@@ -50,20 +67,145 @@
  * Array dinamico di `elemento_array_campo`. Ogni elemento dell'array rappresenta un campo diverso (es. autore, titolo)
  * e il corrispondente albero di valori che organizza i libri secondo quel campo.
  *
+ * @param str_d_direttorioCampi
+ * Tabella hash di `struct voceDirettorio` che associa il nome di ogni campo al suo id, cioè alla sua posizione in
+ * `str_d_arrayCampi`, così da trovare il campo di una coppia senza confrontarlo con tutti gli altri.
+ *
  * @param str_d_ptrLibri
  * Array dinamico di puntatori a libri. Questo array memorizza i puntatori a tutte le strutture libro gestite
  * dalla struttura dati, consentendo un accesso rapido e diretto ai libri senza necessità di attraversare gli alberi di valori.
+ *
+ * @param str_d_arena
+ * Arena che possiede i libri, le loro stringhe e coppie, i nodi degli alberi di valori e le stringhe dei valori. Durante
+ * il caricamento queste allocazioni costano solo l'avanzamento di un puntatore, e alla chiusura vengono liberate tutte
+ * insieme invece che una alla volta.
+ *
+ * @param str_d_snapshot
+ * Lo snapshot da cui è stata caricata la struttura dati, se esiste. Le stringhe dei libri e dei valori puntano al suo
+ * interno, quindi resta mappato fino a str_d_dealloca.
+ *
+ * @param str_d_giornale
+ * Giornale dei prestiti aperto da str_d_apriGiornale: ogni prestito viene registrato qui invece di riscrivere il file
+ * record. Resta chiuso (e i prestiti non sono durevoli) se str_d_apriGiornale non viene chiamata.
+ *
+ * @param str_d_compattazione
+ * Argomento della compattazione del giornale, allocato da str_d_apriGiornale.
+ *
+ * @param str_d_cache
+ * Cache delle risposte alle query (vedi cache_richieste.h): str_d_apriRisposta la consulta, str_d_raccogliPezzo vi
+ * salva le risposte complete e ne toglie quelle che contengono un libro appena prestato.
  */
 struct strutturaDati
 {
     struct dynamic_array str_d_arrayCampi;
+    struct hash_table str_d_direttorioCampi;
     struct dynamic_array str_d_ptrLibri;
+    struct arena str_d_arena;
+    struct snapshotLettura str_d_snapshot;
+    struct giornale str_d_giornale;
+    struct contestoCompattazione *str_d_compattazione;
+    struct cacheRichieste str_d_cache;
+};
+
+/**
+ * @struct rispostaAPezzi
+ * @brief Risposta a una richiesta di libri, prodotta un pezzo alla volta (vedi str_d_apriRisposta).
+ *
+ * @param libri
+ * Array dinamico di `struct libro *`, i libri che corrispondono alla richiesta. In un prestito i libri che erano già in
+ * prestito vengono sostituiti da NULL quando arriva il loro turno.
+ *
+ * @param prossimo
+ * Posizione in `libri` del prossimo libro da leggere o prestare: quelli prima sono già stati letti o prestati.
+ *
+ * @param presta
+ * 1 se la richiesta è un prestito.
+ *
+ * @param numeroLibri
+ * Libri letti o prestati finora.
+ *
+ * @param voce, servito
+ * Se la risposta è nella cache la voce (di cui la risposta tiene un riferimento) e i suoi byte già messi nei pezzi; in
+ * questo caso `libri` è vuoto.
+ *
+ * @param chiave, costruita, lunghezzaCostruita, capacitaCostruita, invalidazioni, inizio
+ * Se la risposta non è nella cache ma si può salvare: la richiesta normalizzata, i byte dei pezzi già prodotti, il
+ * valore di `cache_invalidazioni` e l'istante letti prima di leggere i libri. `chiave` è NULL se la risposta non verrà
+ * salvata (prestiti, risposte più lunghe di CACHE_MAX_RISPOSTA).
+ */
+struct rispostaAPezzi
+{
+    struct dynamic_array libri;
+    int prossimo;
+    int presta;
+    int numeroLibri;
+    struct voceCache *voce;
+    size_t servito;
+    char *chiave, *costruita;
+    size_t lunghezzaCostruita, capacitaCostruita;
+    uint64_t invalidazioni;
+    int64_t inizio;
+};
+
+/**
+ * Un pezzo di risposta (vedi str_d_raccogliPezzo) si chiude quando arriva a questi byte, o quando contiene
+ * STR_D_LIBRI_PER_PEZZO libri.
+ */
+#ifndef STR_D_DIMENSIONE_PEZZO
+#define STR_D_DIMENSIONE_PEZZO (1 << 14)
+#endif
+
+/**
+ * Numero massimo di libri in un pezzo di risposta.
+ */
+#ifndef STR_D_LIBRI_PER_PEZZO
+#define STR_D_LIBRI_PER_PEZZO 256
+#endif
+
+/**
+ * I libri lunghi almeno così non vengono copiati nel pezzo ma solo indicati con una parte: sotto questa lunghezza una
+ * parte in più nella sendmsg costa più della copia.
+ */
+#ifndef STR_D_SOGLIA_RIFERIMENTO
+#define STR_D_SOGLIA_RIFERIMENTO 1024
+#endif
+
+/**
+ * @struct pezzoLibri
+ * @brief Un pezzo di risposta diviso in parti, da scrivere nell'ordine con una sola writev/sendmsg.
+ *
+ * I libri corti e le date dei prestiti vengono scritti uno dopo l'altro in `copia` direttamente da `lib_stringa`, senza
+ * allocare una stringa per libro, e occupano una sola parte. I libri lunghi almeno STR_D_SOGLIA_RIFERIMENTO non vengono
+ * copiati: la loro parte punta a `lib_stringa`, che non cambia mai dopo la creazione e resta valida finché la struttura
+ * dati non viene deallocata.
+ *
+ * @param parti, numeroParti
+ * Le parti del pezzo. C'è posto per una parte in più, che il chiamante può aggiungere in fondo (ad esempio il
+ * terminatore della risposta).
+ *
+ * @param lunghezza
+ * Somma delle lunghezze delle parti.
+ *
+ * @param copia, copiati
+ * Lo spazio per i libri copiati e per le date dei prestiti, e i byte già usati.
+ */
+struct pezzoLibri
+{
+    struct iovec parti[2 * STR_D_LIBRI_PER_PEZZO + 1];
+    int numeroParti;
+    size_t lunghezza;
+    char copia[STR_D_DIMENSIONE_PEZZO + STR_D_SOGLIA_RIFERIMENTO + LIB_DIMENSIONE_PRESTITO];
+    size_t copiati;
 };
 
 /**
  * @brief Genera la struttura dati da un file di record.
  *
  * Legge un file di record, popola la struttura dati con libri, campi e valori estratti dal record.
+ * Se accanto al file record c'è uno snapshot aggiornato (file_record con estensione SNAP_ESTENSIONE, vedi
+ * str_d_salvaSnapshot) la struttura dati viene ricostruita da quello, senza analizzare il file record.
+ * Altrimenti il file viene mappato in memoria e diviso in porzioni di righe intere, che vengono analizzate e
+ * indicizzate in parallelo e poi unite nell'ordine del file. Le righe non hanno una lunghezza massima.
  *
  * @param file_record Percorso del file di record.
  * @return int `ERR_SYSTEM_CALL` se ci sono errori di sistema, `ERR_FORMATO_STR` se una stringa di un libro
@@ -76,19 +218,72 @@ int str_d_genera(struct strutturaDati *strutturaDati, const char *file_record);
  * @brief Gestisce la richiesta di libri in base a una query fornita.
  *
  * Filtra i libri nella struttura dati in base alla query fornita, leggendo o prestando i libri corrispondenti.
- * Ritorna il numero di libri letti o prestati.
+ * Ritorna il numero di libri letti o prestati, tutti in una sola stringa (vedi str_d_apriRisposta per produrla a
+ * pezzi). Se il giornale è aperto i prestiti vengono registrati e la funzione ritorna solo quando sono sul disco.
  *
  * @param dst Puntatore alla stringa di destinazione dove aggregare i risultati.
  * @param richiesta Query di ricerca dei libri.
  * @param presta Flag che indica se prestare i libri (1) o solo leggerli (0).
  * @return int Numero di libri letti o prestati, ERR_FORMATO_STR se la richiesta non è del formato corretto, ERR_SYSTEM_CALL per errori di sistema, o 0 se nessun libro corrisponde.
  */
-int str_d_chiediLibri(struct strutturaDati *strutturaDati, char **dst, char *richiesta, const int presta, pthread_mutex_t *mutex, pthread_cond_t *cond);
+int str_d_chiediLibri(struct strutturaDati *strutturaDati, char **dst, char *richiesta, const int presta);
+
+/**
+ * @brief Cerca i libri che corrispondono alla richiesta, senza ancora leggerli o prestarli: la risposta si produce poi
+ *        un pezzo alla volta con str_d_raccogliPezzo.
+ *
+ * Se la richiesta non è un prestito e la sua risposta è nella cache, i pezzi vengono copiati dalla voce della cache
+ * senza cercare né rileggere i libri.
+ *
+ * @param richiesta Query di ricerca dei libri, che viene formattata sul posto.
+ * @param presta Flag che indica se prestare i libri (1) o solo leggerli (0).
+ * @return int SUCCESS, ERR_FORMATO_STR se la richiesta non è del formato corretto o ERR_SYSTEM_CALL. Se la funzione
+ *         ritorna SUCCESS la risposta va chiusa con str_d_chiudiRisposta.
+ */
+int str_d_apriRisposta(struct strutturaDati *strutturaDati, struct rispostaAPezzi *risposta, char *richiesta, const int presta);
+
+/**
+ * @brief Legge o presta i prossimi libri della risposta, finché il pezzo non arriva a STR_D_DIMENSIONE_PEZZO byte o a
+ *        STR_D_LIBRI_PER_PEZZO libri, e li raccoglie in `pezzo` (vedi `struct pezzoLibri`).
+ *
+ * I prestiti del pezzo vengono registrati nel giornale e la funzione ritorna solo quando sono sul disco, quindi ogni
+ * pezzo può essere mandato al client appena è pronto. Ogni libro prestato toglie dalla cache le risposte che lo
+ * contengono; l'ultimo pezzo di una query salva la risposta nella cache.
+ *
+ * @return int 1 se restano altri libri da leggere o prestare, 0 se il pezzo è l'ultimo, ERR_SYSTEM_CALL.
+ */
+int str_d_raccogliPezzo(struct strutturaDati *strutturaDati, struct rispostaAPezzi *risposta, struct pezzoLibri *pezzo);
+
+/**
+ * @brief Scrive su `file` le stringhe dei libri letti o prestati finora dalla risposta, rileggendone il prestito.
+ *
+ * @return int SUCCESS, o ERR_SYSTEM_CALL.
+ */
+int str_d_scriviRisposta(struct rispostaAPezzi *risposta, FILE *file);
+
+/**
+ * @brief Libera la risposta, anche se non è stata prodotta fino all'ultimo pezzo.
+ */
+void str_d_chiudiRisposta(struct rispostaAPezzi *risposta);
+
+/**
+ * @brief Apre il giornale dei prestiti di `file_record` (con estensione GIOR_ESTENSIONE) e riapplica i prestiti registrati.
+ *
+ * Va chiamata subito dopo str_d_genera, prima che i libri vengano prestati. Avvia anche il thread che, ogni
+ * GIOR_SOGLIA_COMPATTAZIONE prestiti, riscrive il file record e lo snapshot con lo stato attuale dei libri e toglie
+ * dal giornale i prestiti che contengono. Se la struttura dati non è stata caricata da uno snapshot la prima
+ * compattazione parte subito, così al prossimo avvio lo snapshot c'è.
+ *
+ * @param build_directory Directory dove creare il file temporaneo del file record, deve terminare con "/".
+ * @return int SUCCESS se il giornale è aperto, ERR_SYSTEM_CALL altrimenti.
+ */
+int str_d_apriGiornale(struct strutturaDati *strutturaDati, const char *file_record, const char *build_directory);
 
 /**
  * @brief Aggiorna il file di record con i libri attuali nella struttura dati.
  *
- * Crea un file temporaneo per scrivere i libri aggiornati, quindi sostituisce il file di record esistente.
+ * Crea un file temporaneo per scrivere i libri aggiornati, lo sincronizza sul disco e lo rinomina al posto del file di
+ * record esistente. Il giornale dei prestiti, se aperto, resta valido per il nuovo file.
  *
  * @param file_record Percorso del file di record da aggiornare.
  * @param build_directory Directory dove creare il file temporaneo, deve terminare con "/".
@@ -97,10 +292,22 @@ int str_d_chiediLibri(struct strutturaDati *strutturaDati, char **dst, char *ric
  */
 int str_d_aggiornaFileRecord(struct strutturaDati *strutturaDati, const char *file_record, const char *build_directory);
 
+/**
+ * @brief Salva lo snapshot della struttura dati accanto al file record, per caricarla al prossimo avvio senza analizzarlo.
+ *
+ * Lo snapshot è legato al file record così com'è su disco in questo momento: va salvato subito dopo
+ * str_d_aggiornaFileRecord, e qualsiasi modifica successiva del file record lo rende non più valido.
+ *
+ * @param file_record Percorso del file di record.
+ * @return int SUCCESS se l'operazione è riuscita, ERR_SYSTEM_CALL altrimenti.
+ */
+int str_d_salvaSnapshot(struct strutturaDati *strutturaDati, const char *file_record);
+
 /**
  * @brief Dealloca la struttura dati e tutti i libri in essa contenuti.
  *
- * Libera la memoria occupata dalla struttura dati, inclusi i libri e i campi associati. Non ci sono valori di ritorno
+ * Libera la memoria occupata dalla struttura dati, inclusi i libri e i campi associati, dopo aver chiuso il giornale
+ * (aspettando la compattazione in corso). Non ci sono valori di ritorno
  * specificati per gli errori in questa funzione poiché si assume che completi sempre con successo la liberazione delle risorse.
  */
 void str_d_dealloca(struct strutturaDati *strutturaDati);
@@ -1,60 +1,209 @@
 #include "../../include/comunicazione/coda_condivisa.h"
 #include <stdio.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
 
-int cc_crea(struct coda_condivisa *coda, size_t dimensioneCoda)
+// tentativi di prendere o inserire un elemento prima di addormentarsi sulla futex
+#define TENTATIVI_PRIMA_DI_DORMIRE 64
+
+//! FUNZIONI PRIVATE
+
+/**
+ * @brief Dorme finché `*indirizzo` vale `atteso`. Ritorna anche se il valore è già cambiato o per un segnale.
+ *
+ * @return SUCCESS, o ERR_SYSTEM_CALL se la futex fallisce per un altro motivo.
+ */
+int futex_aspetta(_Atomic uint32_t *indirizzo, uint32_t atteso)
 {
-    (*coda) = (struct coda_condivisa){.fifo = fifost_create(dimensioneCoda, sizeof(struct elementoCoda)),
-                                      .mutex = PTHREAD_MUTEX_INITIALIZER};
-    if (!((coda->fifo).fifost_queue))
+    if (syscall(SYS_futex, (uint32_t *)indirizzo, FUTEX_WAIT_PRIVATE, atteso, NULL, NULL, 0) == -1 &&
+        errno != EAGAIN && errno != EINTR)
     {
-        perror("Creazione coda condivisa fallita");
-        goto distruggi_mutex;
+        perror("Errore futex wait");
+        return ERR_SYSTEM_CALL;
     }
+    return SUCCESS;
+}
 
-    if (sem_init(&(coda->numero_elementi), 0, 0) == -1)
+/**
+ * @brief Sveglia un thread addormentato su `indirizzo`.
+ */
+void futex_sveglia(_Atomic uint32_t *indirizzo)
+{
+    if (syscall(SYS_futex, (uint32_t *)indirizzo, FUTEX_WAKE_PRIVATE, 1, NULL, NULL, 0) == -1)
+        perror("Errore futex wake");
+}
+
+/**
+ * @brief Inserisce `elemento` senza aspettare.
+ *
+ * @return 1 se l'elemento è stato inserito, 0 se la coda è piena.
+ */
+int prova_put(struct coda_condivisa *coda, const struct elementoCoda *elemento)
+{
+    size_t posizione = atomic_load_explicit(&(coda->testa), memory_order_relaxed);
+    struct cellaCoda *cella;
+
+    while (1)
     {
-        perror("Errore init semaforo");
-        goto distruggi_coda;
+        cella = coda->celle + (posizione & coda->maschera);
+        size_t sequenza = atomic_load_explicit(&(cella->sequenza), memory_order_acquire);
+        intptr_t differenza = (intptr_t)sequenza - (intptr_t)posizione;
+
+        if (differenza == 0)
+        {
+            // la cella è libera: se la compare-and-swap riesce è di questo thread
+            if (atomic_compare_exchange_weak_explicit(&(coda->testa), &posizione, posizione + 1,
+                                                      memory_order_relaxed, memory_order_relaxed))
+                break;
+        }
+        else if (differenza < 0)
+            return 0; // la cella contiene ancora l'elemento di un giro precedente
+        else
+            posizione = atomic_load_explicit(&(coda->testa), memory_order_relaxed);
     }
 
-    if (sem_init(&(coda->spazio_libero), 0, dimensioneCoda) == -1)
+    cella->elemento = *elemento;
+    atomic_store_explicit(&(cella->sequenza), posizione + 1, memory_order_release);
+    return 1;
+}
+
+/**
+ * @brief Prende un elemento senza aspettare.
+ *
+ * @return 1 se un elemento è stato preso, 0 se la coda è vuota.
+ */
+int prova_get(struct coda_condivisa *coda, struct elementoCoda *buffer)
+{
+    size_t posizione = atomic_load_explicit(&(coda->coda), memory_order_relaxed);
+    struct cellaCoda *cella;
+
+    while (1)
     {
-        perror("Errore init semaforo");
-        goto distruggi_numero_elementi;
+        cella = coda->celle + (posizione & coda->maschera);
+        size_t sequenza = atomic_load_explicit(&(cella->sequenza), memory_order_acquire);
+        intptr_t differenza = (intptr_t)sequenza - (intptr_t)(posizione + 1);
+
+        if (differenza == 0)
+        {
+            if (atomic_compare_exchange_weak_explicit(&(coda->coda), &posizione, posizione + 1,
+                                                      memory_order_relaxed, memory_order_relaxed))
+                break;
+        }
+        else if (differenza < 0)
+            return 0; // l'elemento di questa posizione non è ancora stato inserito
+        else
+            posizione = atomic_load_explicit(&(coda->coda), memory_order_relaxed);
     }
 
+    *buffer = cella->elemento;
+    // la cella torna libera per il produttore del giro successivo
+    atomic_store_explicit(&(cella->sequenza), posizione + coda->maschera + 1, memory_order_release);
+    return 1;
+}
+
+/**
+ * @brief Esegue `prova` finché non riesce, addormentandosi su `eventi` quando non può riuscire.
+ *
+ * Prima di dormire il thread legge `eventi`, si conta in `inAttesa` e riprova: se nel frattempo l'altra parte ha
+ * cambiato la coda ha anche incrementato `eventi`, quindi la futex ritorna subito invece di perdere il risveglio.
+ * Dopo l'operazione incrementa `altriEventi` e sveglia un thread dell'altra parte, se ne dorme qualcuno.
+ */
+int esegui_o_aspetta(struct coda_condivisa *coda, int (*prova)(struct coda_condivisa *, void *), void *argomento,
+                     _Atomic uint32_t *eventi, _Atomic uint32_t *inAttesa,
+                     _Atomic uint32_t *altriEventi, _Atomic uint32_t *altriInAttesa)
+{
+    int tentativi = 0;
+
+    while (!prova(coda, argomento))
+    {
+        if (++tentativi < TENTATIVI_PRIMA_DI_DORMIRE)
+            continue;
+
+        uint32_t visti = atomic_load(eventi);
+        atomic_fetch_add(inAttesa, 1);
+        if (prova(coda, argomento))
+        {
+            atomic_fetch_sub(inAttesa, 1);
+            break;
+        }
+        int risultato = futex_aspetta(eventi, visti);
+        atomic_fetch_sub(inAttesa, 1);
+        if (risultato == ERR_SYSTEM_CALL)
+            return ERR_SYSTEM_CALL;
+    }
+
+    atomic_fetch_add(altriEventi, 1);
+    if (atomic_load(altriInAttesa) > 0)
+        futex_sveglia(altriEventi);
+
     return SUCCESS;
+}
+
+int prova_put_generica(struct coda_condivisa *coda, void *elemento)
+{
+    return prova_put(coda, (const struct elementoCoda *)elemento);
+}
 
-distruggi_numero_elementi:
-    sem_destroy(&(coda->numero_elementi));
+int prova_get_generica(struct coda_condivisa *coda, void *buffer)
+{
+    return prova_get(coda, (struct elementoCoda *)buffer);
+}
 
-distruggi_coda:
-    fifost_destroy(&(coda->fifo));
+//! FUNZIONI PUBBLICHE
 
-distruggi_mutex:
-    pthread_mutex_destroy(&(coda->mutex));
+int cc_crea(struct coda_condivisa *coda, size_t dimensioneCoda)
+{
+    size_t numeroCelle = 2;
+    while (numeroCelle < dimensioneCoda)
+        numeroCelle <<= 1;
 
-    return ERR_SYSTEM_CALL;
+    *coda = (struct coda_condivisa){.celle = NULL, .maschera = numeroCelle - 1};
+    if (posix_memalign((void **)&(coda->celle), 64, numeroCelle * sizeof(struct cellaCoda)))
+    {
+        coda->celle = NULL;
+        perror("Creazione coda condivisa fallita");
+        return ERR_SYSTEM_CALL;
+    }
+
+    for (size_t index = 0; index < numeroCelle; index++)
+        atomic_init(&(coda->celle[index].sequenza), index);
+    atomic_init(&(coda->testa), 0);
+    atomic_init(&(coda->coda), 0);
+    atomic_init(&(coda->inserimenti), 0);
+    atomic_init(&(coda->consumatoriInAttesa), 0);
+    atomic_init(&(coda->prelievi), 0);
+    atomic_init(&(coda->produttoriInAttesa), 0);
+
+    return SUCCESS;
 }
 
 int cc_put(struct coda_condivisa *coda, const struct elementoCoda *elemento)
 {
-    int error = fifost_threadSafePut(&(coda->fifo), elemento, &(coda->mutex), &(coda->spazio_libero), &(coda->numero_elementi));
-    return (error == SUCCESS) ? SUCCESS : ERR_SYSTEM_CALL;
+    return esegui_o_aspetta(coda, prova_put_generica, (void *)elemento, &(coda->prelievi), &(coda->produttoriInAttesa),
+                            &(coda->inserimenti), &(coda->consumatoriInAttesa));
 }
 
 int cc_get(struct coda_condivisa *coda, struct elementoCoda *buffer)
 {
-    int error = fifost_threadSafeGet(&(coda->fifo), buffer, &(coda->mutex), &(coda->spazio_libero), &(coda->numero_elementi));
-    return (error == SUCCESS) ? SUCCESS : ERR_SYSTEM_CALL;
+    return esegui_o_aspetta(coda, prova_get_generica, buffer, &(coda->inserimenti), &(coda->consumatoriInAttesa),
+                            &(coda->prelievi), &(coda->produttoriInAttesa));
 }
 
-void cc_destroy(struct coda_condivisa *coda)
+int cc_provaPut(struct coda_condivisa *coda, const struct elementoCoda *elemento)
 {
-    fifost_destroy(&(coda->fifo));
+    return prova_put(coda, elemento);
+}
 
-    sem_destroy(&(coda->numero_elementi));
-    sem_destroy(&(coda->spazio_libero));
+int cc_provaGet(struct coda_condivisa *coda, struct elementoCoda *buffer)
+{
+    return prova_get(coda, buffer);
+}
 
-    pthread_mutex_destroy(&(coda->mutex));
-}
\ No newline at end of file
+void cc_destroy(struct coda_condivisa *coda)
+{
+    free(coda->celle);
+    coda->celle = NULL;
+}
@@ -0,0 +1,433 @@
+#include "../../include/comunicazione/pool_worker.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <errno.h>
+#include <time.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+
+// tentativi di trovare una richiesta in tutte le code prima di addormentarsi sulla futex
+#define TENTATIVI_PRIMA_DI_DORMIRE 64
+
+// valori di ritorno di dormi_su
+#define SVEGLIATO 0
+#define TEMPO_SCADUTO 1
+
+//! FUNZIONI PRIVATE
+
+int64_t adesso_ns()
+{
+    struct timespec adesso;
+    clock_gettime(CLOCK_MONOTONIC, &adesso);
+    return (int64_t)adesso.tv_sec * 1000000000 + adesso.tv_nsec;
+}
+
+/**
+ * @brief Dorme finché `*indirizzo` vale `atteso`, al massimo `millisecondi` (per sempre se negativo).
+ *
+ * @return TEMPO_SCADUTO se nessuno ha svegliato il thread in tempo, SVEGLIATO altrimenti (anche se il valore era
+ *         già cambiato, per un segnale o per un errore, che viene stampato).
+ */
+int dormi_su(_Atomic uint32_t *indirizzo, uint32_t atteso, int millisecondi)
+{
+    struct timespec durata = {.tv_sec = millisecondi / 1000, .tv_nsec = (long)(millisecondi % 1000) * 1000000};
+
+    if (syscall(SYS_futex, (uint32_t *)indirizzo, FUTEX_WAIT_PRIVATE, atteso,
+                (millisecondi < 0) ? NULL : &durata, NULL, 0) == -1)
+    {
+        if (errno == ETIMEDOUT)
+            return TEMPO_SCADUTO;
+        if (errno != EAGAIN && errno != EINTR)
+            perror("Errore futex wait");
+    }
+    return SVEGLIATO;
+}
+
+/**
+ * @brief Sveglia fino a `quanti` thread addormentati su `indirizzo`.
+ */
+void sveglia_su(_Atomic uint32_t *indirizzo, int quanti)
+{
+    if (syscall(SYS_futex, (uint32_t *)indirizzo, FUTEX_WAKE_PRIVATE, quanti, NULL, NULL, 0) == -1)
+        perror("Errore futex wake");
+}
+
+void *esegui_worker(void *argomento);
+
+/**
+ * @brief Avvia un worker nel primo posto libero, aspettando il thread uscito che lo occupava. Il chiamante possiede
+ *        `mutexPosti`.
+ *
+ * @return SUCCESS anche se non c'è nessun posto libero, ERR_SYSTEM_CALL se pthread_create fallisce.
+ */
+int avvia_worker(struct pool_worker *pool)
+{
+    for (size_t index = 0; index < pool->massimo; index++)
+    {
+        struct postoWorker *posto = pool->posti + index;
+        int stato = atomic_load(&(posto->stato));
+
+        if (stato == PW_USCITO)
+        {
+            pthread_join(posto->thread, NULL);
+            atomic_store(&(posto->stato), PW_LIBERO);
+            stato = PW_LIBERO;
+        }
+        if (stato != PW_LIBERO)
+            continue;
+
+        atomic_store(&(posto->stato), PW_ATTIVO);
+        atomic_fetch_add(&(pool->attivi), 1);
+
+        // i worker ereditano una maschera che blocca tutti i segnali, così il signal handler del server non viene mai
+        // eseguito da un worker (che aspetterebbe sé stesso in pw_distruggi)
+        sigset_t tutti, precedenti;
+        sigfillset(&tutti);
+        pthread_sigmask(SIG_BLOCK, &tutti, &precedenti);
+        int errore = pthread_create(&(posto->thread), NULL, esegui_worker, posto);
+        pthread_sigmask(SIG_SETMASK, &precedenti, NULL);
+        if (errore)
+        {
+            printf("pthread_create fallita: %s\n", strerror(errore));
+            atomic_fetch_sub(&(pool->attivi), 1);
+            atomic_store(&(posto->stato), PW_LIBERO);
+            return ERR_SYSTEM_CALL;
+        }
+        return SUCCESS;
+    }
+    return SUCCESS;
+}
+
+/**
+ * @brief Aggiunge un worker se il pool non è al massimo. Se un altro thread sta già aggiungendo un worker (o il pool
+ *        si sta chiudendo) non fa niente, invece di aspettarlo.
+ */
+void aggiungi_worker(struct pool_worker *pool)
+{
+    if (atomic_load(&(pool->attivi)) >= pool->massimo || pthread_mutex_trylock(&(pool->mutexPosti)))
+        return;
+
+    if (!atomic_load(&(pool->chiuso)) && atomic_load(&(pool->attivi)) < pool->massimo)
+        avvia_worker(pool);
+
+    pthread_mutex_unlock(&(pool->mutexPosti));
+}
+
+/**
+ * @brief Toglie un worker dal conto degli attivi, se restano almeno `minimo` worker.
+ *
+ * @return 1 se il worker deve uscire, 0 altrimenti.
+ */
+int ritira_worker(struct pool_worker *pool, struct postoWorker *posto)
+{
+    size_t attivi = atomic_load(&(pool->attivi));
+
+    while (attivi > pool->minimo)
+    {
+        if (atomic_compare_exchange_weak(&(pool->attivi), &attivi, attivi - 1))
+        {
+            atomic_store(&(posto->stato), PW_USCENTE);
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/**
+ * @brief Prende una richiesta dalla coda del posto `indice` o, se è vuota, la ruba da quelle successive.
+ *
+ * @return 1 se una richiesta è stata presa, 0 se tutte le code sono vuote.
+ */
+int prendi_richiesta(struct pool_worker *pool, size_t indice, struct elementoCoda *buffer)
+{
+    for (size_t passo = 0; passo < pool->massimo; passo++)
+    {
+        if (cc_provaGet(&(pool->posti[(indice + passo) % pool->massimo].coda), buffer))
+            return 1;
+    }
+    return 0;
+}
+
+/**
+ * @brief Inserisce la richiesta nella coda di un worker attivo, scelto a turno.
+ *
+ * @return 1 se la richiesta è stata inserita, 0 se le code dei worker attivi sono tutte piene.
+ */
+int inserisci_a_turno(struct pool_worker *pool, const struct elementoCoda *richiesta)
+{
+    size_t inizio = atomic_fetch_add_explicit(&(pool->prossimo), 1, memory_order_relaxed);
+
+    for (size_t passo = 0; passo < pool->massimo; passo++)
+    {
+        struct postoWorker *posto = pool->posti + (inizio + passo) % pool->massimo;
+
+        if (atomic_load(&(posto->stato)) == PW_ATTIVO && cc_provaPut(&(posto->coda), richiesta))
+            return 1;
+    }
+    return 0;
+}
+
+/**
+ * @brief Segnala il prelievo a chi aspetta spazio nelle code, aggiunge un worker se la richiesta ha aspettato troppo
+ *        e la gestisce.
+ */
+void esegui_richiesta(struct pool_worker *pool, struct elementoCoda *richiesta)
+{
+    atomic_fetch_add(&(pool->prelievi), 1);
+    if (atomic_load(&(pool->produttoriInAttesa)) > 0)
+        sveglia_su(&(pool->prelievi), 1);
+
+    // chi ha trovato le code piene senza aspettare viene avvisato una volta sola, dal primo prelievo successivo
+    if (atomic_load(&(pool->avvisoRichiesto)) && atomic_exchange(&(pool->avvisoRichiesto), 0) && pool->avviso_fd != -1)
+    {
+        uint64_t uno = 1;
+        if (write(pool->avviso_fd, &uno, sizeof(uint64_t)) == -1)
+            perror("Write dell'eventfd di avviso fallita");
+    }
+
+    if (adesso_ns() - richiesta->inserimento > PW_SOGLIA_ATTESA_NS)
+        aggiungi_worker(pool);
+
+    pool->gestisci(richiesta);
+}
+
+void *esegui_worker(void *argomento)
+{
+    struct postoWorker *posto = (struct postoWorker *)argomento;
+    struct pool_worker *pool = posto->pool;
+    struct elementoCoda richiesta;
+    int tentativi = 0;
+
+    while (1)
+    {
+        // letto prima di cercare: le richieste inserite prima della chiusura sono visibili alla ricerca successiva
+        int chiusura = atomic_load(&(pool->chiuso));
+
+        if (prendi_richiesta(pool, posto->indice, &richiesta))
+        {
+            esegui_richiesta(pool, &richiesta);
+            tentativi = 0;
+            continue;
+        }
+        if (chiusura)
+            break;
+        if (++tentativi < TENTATIVI_PRIMA_DI_DORMIRE)
+            continue;
+        tentativi = 0;
+
+        // come in coda_condivisa: legge il contatore, si conta tra chi aspetta e riprova prima di dormire
+        uint32_t visti = atomic_load(&(pool->inserimenti));
+        atomic_fetch_add(&(pool->workerInAttesa), 1);
+        if (prendi_richiesta(pool, posto->indice, &richiesta))
+        {
+            atomic_fetch_sub(&(pool->workerInAttesa), 1);
+            esegui_richiesta(pool, &richiesta);
+            continue;
+        }
+        int risveglio = atomic_load(&(pool->chiuso)) ? SVEGLIATO : dormi_su(&(pool->inserimenti), visti, PW_INATTIVITA_MS);
+        atomic_fetch_sub(&(pool->workerInAttesa), 1);
+
+        if (risveglio == TEMPO_SCADUTO && ritira_worker(pool, posto))
+        {
+            // le richieste inserite dopo questo svuotamento vengono rubate dagli altri worker
+            while (cc_provaGet(&(posto->coda), &richiesta))
+                esegui_richiesta(pool, &richiesta);
+            break;
+        }
+    }
+
+    atomic_store(&(posto->stato), PW_USCITO);
+    return NULL;
+}
+
+//! FUNZIONI PUBBLICHE
+
+int pw_crea(struct pool_worker *pool, size_t minimo, size_t massimo, void (*gestisci)(struct elementoCoda *richiesta))
+{
+    size_t index;
+
+    if (minimo < 1)
+        minimo = 1;
+    if (massimo < minimo)
+        massimo = minimo;
+
+    pool->minimo = minimo;
+    pool->massimo = massimo;
+    pool->gestisci = gestisci;
+    atomic_init(&(pool->attivi), 0);
+    atomic_init(&(pool->prossimo), 0);
+    atomic_init(&(pool->inserimenti), 0);
+    atomic_init(&(pool->workerInAttesa), 0);
+    atomic_init(&(pool->prelievi), 0);
+    atomic_init(&(pool->produttoriInAttesa), 0);
+    atomic_init(&(pool->avvisoRichiesto), 0);
+    pool->avviso_fd = -1;
+    atomic_init(&(pool->chiuso), 0);
+
+    pool->posti = (struct postoWorker *)malloc(sizeof(struct postoWorker) * massimo);
+    if (!pool->posti)
+    {
+        perror("Malloc fallita");
+        return ERR_SYSTEM_CALL;
+    }
+
+    for (index = 0; index < massimo; index++)
+    {
+        if (cc_crea(&(pool->posti[index].coda), PW_DIMENSIONE_CODA_WORKER) == ERR_SYSTEM_CALL)
+            goto error_exit;
+        atomic_init(&(pool->posti[index].stato), PW_LIBERO);
+        pool->posti[index].indice = index;
+        pool->posti[index].pool = pool;
+    }
+
+    if (pthread_mutex_init(&(pool->mutexPosti), NULL))
+    {
+        perror("Inizializzazione mutex fallita");
+        goto error_exit;
+    }
+
+    pthread_mutex_lock(&(pool->mutexPosti));
+    for (size_t avviati = 0; avviati < minimo; avviati++)
+    {
+        if (avvia_worker(pool) == ERR_SYSTEM_CALL)
+        {
+            pthread_mutex_unlock(&(pool->mutexPosti));
+            pw_distruggi(pool);
+            return ERR_SYSTEM_CALL;
+        }
+    }
+    pthread_mutex_unlock(&(pool->mutexPosti));
+
+    return SUCCESS;
+
+error_exit:
+    while (index > 0)
+        cc_destroy(&(pool->posti[--index].coda));
+    free(pool->posti);
+    pool->posti = NULL;
+    return ERR_SYSTEM_CALL;
+}
+
+int pw_inserisci(struct pool_worker *pool, struct elementoCoda *richiesta)
+{
+    int cresciuto = 0;
+
+    richiesta->inserimento = adesso_ns();
+
+    while (!inserisci_a_turno(pool, richiesta))
+    {
+        // tutte le code sono piene: i worker non bastano
+        if (!cresciuto)
+        {
+            aggiungi_worker(pool);
+            cresciuto = 1;
+            continue;
+        }
+
+        uint32_t visti = atomic_load(&(pool->prelievi));
+        atomic_fetch_add(&(pool->produttoriInAttesa), 1);
+        if (inserisci_a_turno(pool, richiesta))
+        {
+            atomic_fetch_sub(&(pool->produttoriInAttesa), 1);
+            break;
+        }
+        dormi_su(&(pool->prelievi), visti, -1);
+        atomic_fetch_sub(&(pool->produttoriInAttesa), 1);
+    }
+
+    atomic_fetch_add(&(pool->inserimenti), 1);
+    if (atomic_load(&(pool->workerInAttesa)) > 0)
+        sveglia_su(&(pool->inserimenti), 1);
+
+    return SUCCESS;
+}
+
+int pw_provaInserisci(struct pool_worker *pool, struct elementoCoda *richiesta)
+{
+    return pw_provaInserisciLotto(pool, richiesta, 1) == 1 ? SUCCESS : PW_CODE_PIENE;
+}
+
+size_t pw_provaInserisciLotto(struct pool_worker *pool, struct elementoCoda *richieste, size_t numero)
+{
+    int64_t adesso = adesso_ns();
+    size_t inserite = 0;
+    int cresciuto = 0;
+
+    while (inserite < numero)
+    {
+        richieste[inserite].inserimento = adesso;
+        if (inserisci_a_turno(pool, richieste + inserite))
+        {
+            inserite++;
+            continue;
+        }
+
+        // tutte le code sono piene: i worker non bastano
+        if (!cresciuto)
+        {
+            aggiungi_worker(pool);
+            cresciuto = 1;
+            continue;
+        }
+
+        // come per chi dorme su prelievi: prima chiede l'avviso e poi riprova, così un prelievo avvenuto nel frattempo
+        // o lascia il posto a questo tentativo o vede la richiesta di avviso
+        atomic_store(&(pool->avvisoRichiesto), 1);
+        if (!inserisci_a_turno(pool, richieste + inserite))
+            break;
+        inserite++;
+    }
+
+    if (inserite > 0)
+    {
+        atomic_fetch_add(&(pool->inserimenti), (uint32_t)inserite);
+        if (atomic_load(&(pool->workerInAttesa)) > 0)
+            sveglia_su(&(pool->inserimenti), inserite > INT_MAX ? INT_MAX : (int)inserite);
+    }
+
+    return inserite;
+}
+
+void pw_impostaAvviso(struct pool_worker *pool, int avviso_fd)
+{
+    pool->avviso_fd = avviso_fd;
+}
+
+size_t pw_numeroWorker(struct pool_worker *pool)
+{
+    return atomic_load(&(pool->attivi));
+}
+
+void pw_distruggi(struct pool_worker *pool)
+{
+    if (!pool->posti)
+        return;
+
+    // tenendo il mutex nessun worker può avviarne un altro o aspettarne uno uscito mentre li aspettiamo tutti
+    pthread_mutex_lock(&(pool->mutexPosti));
+    atomic_store(&(pool->chiuso), 1);
+    atomic_fetch_add(&(pool->inserimenti), 1);
+    sveglia_su(&(pool->inserimenti), INT_MAX);
+
+    for (size_t index = 0; index < pool->massimo; index++)
+    {
+        if (atomic_load(&(pool->posti[index].stato)) != PW_LIBERO)
+        {
+            if (pthread_join(pool->posti[index].thread, NULL))
+                printf("Errore durante la chiamata a pthread_join\n");
+            atomic_store(&(pool->posti[index].stato), PW_LIBERO);
+        }
+    }
+    pthread_mutex_unlock(&(pool->mutexPosti));
+
+    for (size_t index = 0; index < pool->massimo; index++)
+        cc_destroy(&(pool->posti[index].coda));
+
+    pthread_mutex_destroy(&(pool->mutexPosti));
+    free(pool->posti);
+    pool->posti = NULL;
+}
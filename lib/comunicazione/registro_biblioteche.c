@@ -0,0 +1,163 @@
+#include "../../include/comunicazione/registro_biblioteche.h"
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+//! FUNZIONI PRIVATE
+
+/**
+ * @return 1 se il posto con pid `pid` si può prendere: è libero o il suo server non esiste più.
+ */
+int posto_libero(int32_t pid)
+{
+    return pid == 0 || (kill((pid_t)pid, 0) == -1 && errno == ESRCH);
+}
+
+//! FUNZIONI PUBBLICHE
+
+struct registroBiblioteche *reg_apri(int scrittura)
+{
+    struct stat stato;
+    int descrittore = shm_open(REG_NOME, scrittura ? (O_RDWR | O_CREAT) : O_RDONLY, 0666);
+    if (descrittore == -1)
+    {
+        if (scrittura || errno != ENOENT)
+            perror("Errore nell'apertura del registro delle biblioteche");
+        return NULL;
+    }
+
+    // allungare un oggetto lo riempie di zeri: un registro appena creato ha tutti i posti liberi
+    if (fstat(descrittore, &stato) == -1 ||
+        (scrittura && stato.st_size < (off_t)sizeof(struct registroBiblioteche) &&
+         ftruncate(descrittore, sizeof(struct registroBiblioteche)) == -1))
+    {
+        perror("Errore nel dimensionamento del registro delle biblioteche");
+        close(descrittore);
+        return NULL;
+    }
+    if (!scrittura && stato.st_size < (off_t)sizeof(struct registroBiblioteche))
+    {
+        printf("Il registro delle biblioteche è più piccolo del previsto\n");
+        close(descrittore);
+        return NULL;
+    }
+
+    struct registroBiblioteche *registro = (struct registroBiblioteche *)mmap(
+        NULL, sizeof(struct registroBiblioteche), scrittura ? (PROT_READ | PROT_WRITE) : PROT_READ, MAP_SHARED, descrittore, 0);
+    close(descrittore); // la mappatura resta valida anche senza descrittore
+    if (registro == MAP_FAILED)
+    {
+        perror("Errore nella mappatura del registro delle biblioteche");
+        return NULL;
+    }
+
+    uint32_t formato = 0;
+    if (scrittura)
+        atomic_compare_exchange_strong(&(registro->reg_formato), &formato, REG_FORMATO);
+    else
+        formato = atomic_load(&(registro->reg_formato));
+
+    // 0: il primo server non ha ancora scritto il formato, e il registro è vuoto
+    if (formato != 0 && formato != REG_FORMATO)
+    {
+        printf("Il registro delle biblioteche ha il formato %u invece di %u\n", formato, REG_FORMATO);
+        reg_chiudi(registro);
+        return NULL;
+    }
+
+    return registro;
+}
+
+void reg_chiudi(struct registroBiblioteche *registro)
+{
+    if (registro)
+        munmap(registro, sizeof(struct registroBiblioteche));
+}
+
+int reg_pubblica(struct registroBiblioteche *registro, const char *nome, const char *socket)
+{
+    if (strlen(nome) >= REG_MAX_NOME || strlen(socket) >= MAX_PATH)
+    {
+        printf("Nome della biblioteca o percorso del socket troppo lungo per il registro\n");
+        return ERR_BUFFER_OVERFLOW;
+    }
+
+    for (int posto = 0; posto < REG_NUMERO_POSTI; posto++)
+    {
+        struct postoRegistro *corrente = &(registro->reg_posti[posto]);
+        int32_t pid = atomic_load(&(corrente->reg_pid));
+
+        // il posto è di chi ci scrive il proprio pid: da qui in poi un crash lascia un pid che non esiste più, e il
+        // posto si può riprendere
+        if (!posto_libero(pid) || !atomic_compare_exchange_strong(&(corrente->reg_pid), &pid, (int32_t)getpid()))
+            continue;
+
+        // la versione è già dispari se il server precedente è terminato mentre scriveva il posto
+        uint64_t versione = atomic_load(&(corrente->reg_versione)) | 1;
+        atomic_store(&(corrente->reg_versione), versione);
+        atomic_thread_fence(memory_order_release);
+
+        strcpy(corrente->reg_nome, nome);
+        strcpy(corrente->reg_socket, socket);
+        atomic_store_explicit(&(corrente->reg_versione), versione + 1, memory_order_release);
+        return posto;
+    }
+
+    errno = ENOSPC;
+    perror("Nessun posto libero nel registro delle biblioteche");
+    return ERR_SYSTEM_CALL;
+}
+
+int reg_ritira(struct registroBiblioteche *registro, int posto)
+{
+    if (posto < 0 || posto >= REG_NUMERO_POSTI)
+        return ERR_SYSTEM_CALL;
+
+    struct postoRegistro *corrente = &(registro->reg_posti[posto]);
+    int32_t pid = (int32_t)getpid();
+
+    // basta azzerare il pid: un client trova il posto libero, e chi lo prende dopo ne riscrive nome e socket
+    return atomic_compare_exchange_strong(&(corrente->reg_pid), &pid, 0) ? SUCCESS : ERR_SYSTEM_CALL;
+}
+
+int reg_leggi(struct registroBiblioteche *registro, int posto, struct bibliotecaRegistrata *dst)
+{
+    struct postoRegistro *corrente = &(registro->reg_posti[posto]);
+
+    for (int tentativo = 0; tentativo < REG_TENTATIVI_LETTURA; tentativo++)
+    {
+        uint64_t prima = atomic_load_explicit(&(corrente->reg_versione), memory_order_acquire);
+        if (prima & 1)
+        {
+            // un server lo sta scrivendo, o è terminato mentre lo scriveva e non serve aspettarlo
+            if (posto_libero(atomic_load(&(corrente->reg_pid))))
+                return 0;
+            continue;
+        }
+
+        int32_t pid = atomic_load_explicit(&(corrente->reg_pid), memory_order_relaxed);
+        if (pid != 0)
+        {
+            memcpy(dst->nome, corrente->reg_nome, REG_MAX_NOME);
+            memcpy(dst->socket, corrente->reg_socket, MAX_PATH);
+        }
+
+        // la copia è coerente solo se nessun server ha scritto il posto mentre veniva fatta
+        atomic_thread_fence(memory_order_acquire);
+        if (atomic_load_explicit(&(corrente->reg_versione), memory_order_relaxed) != prima)
+            continue;
+
+        if (pid == 0)
+            return 0;
+        dst->nome[REG_MAX_NOME - 1] = '\0';
+        dst->socket[MAX_PATH - 1] = '\0';
+        return 1;
+    }
+
+    return 0;
+}
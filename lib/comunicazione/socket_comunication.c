@@ -1,5 +1,6 @@
 #include "../../include/comunicazione/socket_comunication.h"
 #include <sys/socket.h>
+#include <string.h>
 #include <sys/un.h>
 #include <stdio.h>
 #include <poll.h>
@@ -7,7 +8,12 @@
 #include <stdio.h>
 #include <limits.h>
 #include <unistd.h>
+#include <fcntl.h>
 #include <errno.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/signalfd.h>
+#include <sys/uio.h>
 
 int sockcom_apriServer(char socket_path_univoco[108])
 {
@@ -36,7 +42,7 @@ int sockcom_apriServer(char socket_path_univoco[108])
         return ERR_SYSTEM_CALL;
     }
 
-    if (listen(server_fd, MAX_CLIENTS) == -1)
+    if (listen(server_fd, SOMAXCONN) == -1)
     {
         perror("Errore listen fallita");
         close(server_fd);
@@ -47,245 +53,1048 @@ int sockcom_apriServer(char socket_path_univoco[108])
     return server_fd;
 }
 
-//-poll_fds[0].fd deve essere il file descriptor del server
-int sockcom_avviaServer(struct pollfd poll_fds[MAX_CLIENTS + 1], struct coda_condivisa *coda)
+//! FUNZIONI PRIVATE DEL REATTORE
+
+/**
+ * @brief Cambia gli eventi per cui epoll segnala la connessione `fd`; con 0 la toglie da epoll.
+ *
+ * @return SUCCESS, o ERR_SYSTEM_CALL.
+ */
+int imposta_eventi(struct reattore *reattore, int fd, uint32_t eventi)
 {
-    struct elementoCoda daInviare;
+    struct connessione *connessione = (struct connessione *)da_at(&(reattore->connessioni), fd);
+    struct epoll_event evento = {.events = eventi, .data.fd = fd};
+    int operazione;
+
+    if (connessione->eventi == eventi)
+        return SUCCESS;
+
+    if (connessione->eventi == 0)
+        operazione = EPOLL_CTL_ADD;
+    else if (eventi == 0)
+        operazione = EPOLL_CTL_DEL;
+    else
+        operazione = EPOLL_CTL_MOD;
+
+    if (epoll_ctl(reattore->epoll_fd, operazione, fd, &evento) == -1)
+    {
+        perror("Errore epoll_ctl");
+        return ERR_SYSTEM_CALL;
+    }
+    connessione->eventi = eventi;
+    return SUCCESS;
+}
+
+/**
+ * @brief Libera una risposta e i suoi dati, se le appartengono.
+ */
+void libera_risposta(struct rispostaPronta *risposta)
+{
+    free(risposta->memoria);
+    free(risposta);
+}
+
+/**
+ * @brief Mette la richiesta in fondo alle richieste in attesa di posto nel pool; la sua connessione smette di leggere.
+ *
+ * @return SUCCESS, o ERR_SYSTEM_CALL se la malloc fallisce (la richiesta resta al chiamante).
+ */
+int metti_in_attesa(struct reattore *reattore, const struct elementoCoda *elemento)
+{
+    struct richiestaInAttesa *attesa = (struct richiestaInAttesa *)malloc(sizeof(struct richiestaInAttesa));
+    if (!attesa)
+    {
+        perror("Malloc fallita");
+        return ERR_SYSTEM_CALL;
+    }
+    attesa->prossima = NULL;
+    attesa->elemento = *elemento;
+
+    if (reattore->ultimaInAttesa)
+        reattore->ultimaInAttesa->prossima = attesa;
+    else
+        reattore->primaInAttesa = attesa;
+    reattore->ultimaInAttesa = attesa;
+
+    ((struct connessione *)da_at(&(reattore->connessioni), elemento->client_fd))->inAttesa++;
+    return SUCCESS;
+}
+
+/**
+ * @brief Passa la richiesta al pool senza bloccarsi. Se le code dei worker sono piene, o se altre richieste aspettano
+ *        già (che non vanno scavalcate), la mette in attesa.
+ *
+ * @return SUCCESS, o ERR_SYSTEM_CALL se la malloc fallisce (la richiesta resta al chiamante).
+ */
+int affida_al_pool(struct reattore *reattore, struct elementoCoda *elemento)
+{
+    if (!(reattore->primaInAttesa) && pw_provaInserisci(reattore->pool, elemento) == SUCCESS)
+        return SUCCESS;
+    return metti_in_attesa(reattore, elemento);
+}
+
+/**
+ * @brief Se la risposta è un pezzo, rimette nel pool la sua richiesta per il pezzo successivo, o per liberarla se
+ *        `annulla` è 1. Con il pool già chiuso (o senza memoria per metterla in attesa) il worker viene eseguito qui, e
+ *        la richiesta viene solo liberata.
+ */
+void prosegui_risposta(struct reattore *reattore, struct rispostaPronta *risposta, int annulla)
+{
+    if (!(risposta->continua))
+        return;
+    risposta->continua = 0;
+
+    struct elementoCoda *continuazione = &(risposta->continuazione);
+    if (annulla)
+        continuazione->annullata = 1;
+
+    if (!atomic_load(&(reattore->pool->chiuso)) && affida_al_pool(reattore, continuazione) == SUCCESS)
+        return;
+
+    // la risposta finale del worker arriva al reattore come tutte le altre
+    continuazione->annullata = 1;
+    reattore->pool->gestisci(continuazione);
+}
+
+/**
+ * @brief Libera le risposte non ancora scritte della connessione, annullando le richieste dei pezzi.
+ */
+void scarta_uscite(struct reattore *reattore, struct connessione *connessione)
+{
+    while (connessione->primaUscita)
+    {
+        struct rispostaPronta *prossima = connessione->primaUscita->prossima;
+        prosegui_risposta(reattore, connessione->primaUscita, 1);
+        libera_risposta(connessione->primaUscita);
+        connessione->primaUscita = prossima;
+    }
+    connessione->ultimaUscita = NULL;
+}
 
-    poll_fds[0].events = POLLIN;
-    for (int i = 1; i < MAX_CLIENTS + 1; i++)
-        poll_fds[i].fd = -1;
+/**
+ * @brief Aggiunge `fd` alla tabella delle connessioni e lo registra su epoll, raddoppiando la tabella se serve.
+ *
+ * @return SUCCESS, o ERR_SYSTEM_CALL (e il chiamante deve chiudere `fd`).
+ */
+int aggiungi_connessione(struct reattore *reattore, int fd)
+{
+    size_t capacita = reattore->connessioni.da_arrayCapacity;
+
+    if ((size_t)fd >= capacita)
+    {
+        while ((size_t)fd >= capacita)
+            capacita *= 2;
+
+        if (da_updateCapacity(&(reattore->connessioni), capacita) == FAILURE)
+        {
+            perror("Impossibile ingrandire la tabella delle connessioni");
+            return ERR_SYSTEM_CALL;
+        }
+    }
+
+    struct connessione connessione = {.fd = fd, .richiesta = {.data = NULL}, .primaUscita = NULL, .ultimaUscita = NULL};
+    da_set(&(reattore->connessioni), fd, &connessione);
+
+    if (imposta_eventi(reattore, fd, EPOLLIN) == ERR_SYSTEM_CALL)
+    {
+        da_clean(&(reattore->connessioni), fd);
+        return ERR_SYSTEM_CALL;
+    }
+
+    reattore->numeroConnessioni++;
+    return SUCCESS;
+}
+
+/**
+ * @brief Toglie la connessione `fd` dalla tabella e la chiude, liberando la richiesta letta a metà e le risposte non
+ *        ancora scritte. La connessione non deve avere richieste nel pool.
+ */
+void chiudi_connessione(struct reattore *reattore, int fd)
+{
+    struct connessione *connessione = (struct connessione *)da_at(&(reattore->connessioni), fd);
+
+    if (connessione->richiesta.data)
+        free(connessione->richiesta.data);
+    scarta_uscite(reattore, connessione);
+
+    imposta_eventi(reattore, fd, 0);
+    da_clean(&(reattore->connessioni), fd);
+    reattore->numeroConnessioni--;
+    close(fd);
+}
+
+/**
+ * @brief Decide cosa aspettare per la connessione `fd` dopo che il suo stato è cambiato, e la chiude se ha finito.
+ *
+ * La connessione legge finché il client non chiude il suo lato: una connessione normale solo prima della richiesta e
+ * dopo aver scritto la risposta (per vedere la chiusura del client), una sessione finché ha meno di
+ * `SOCKCOM_MAX_IN_VOLO` richieste nel pool; nessuna delle due mentre ha richieste in attesa di posto nel pool. Aspetta
+ * EPOLLOUT se ha risposte da scrivere. Viene chiusa quando non ha
+ * più niente da leggere, da elaborare o da scrivere, o subito dopo un errore se non ha richieste nel pool.
+ */
+void aggiorna_connessione(struct reattore *reattore, int fd)
+{
+    struct connessione *connessione = (struct connessione *)da_at(&(reattore->connessioni), fd);
+    uint32_t eventi = 0;
+
+    // le risposte di una connessione guasta non verranno mai scritte
+    if (connessione->guasta)
+        scarta_uscite(reattore, connessione);
+
+    if (connessione->inVolo == 0 &&
+        (connessione->guasta || (connessione->fineInput && !(connessione->primaUscita))))
+    {
+        chiudi_connessione(reattore, fd);
+        return;
+    }
+
+    if (!(connessione->guasta))
+    {
+        int inAttesaDiRisposta = connessione->inVolo > 0 || connessione->primaUscita;
+
+        if (!(connessione->fineInput) && connessione->inAttesa == 0 &&
+            (connessione->sessione ? connessione->inVolo < SOCKCOM_MAX_IN_VOLO
+                                   : connessione->richiesteRicevute == 0 || !inAttesaDiRisposta))
+            eventi |= EPOLLIN;
+
+        if (connessione->primaUscita)
+            eventi |= EPOLLOUT;
+    }
+
+    // una connessione guasta con richieste nel pool esce da epoll, che altrimenti continuerebbe a segnalarne l'errore
+    if (imposta_eventi(reattore, fd, eventi) == ERR_SYSTEM_CALL)
+    {
+        connessione->guasta = 1;
+        if (connessione->inVolo == 0)
+            chiudi_connessione(reattore, fd);
+    }
+}
 
+/**
+ * @brief Accetta tutte le connessioni in attesa sul socket server.
+ *
+ * @return SUCCESS, anche se il processo ha finito i file descriptor (le connessioni restano in attesa), o
+ *         ERR_SYSTEM_CALL.
+ */
+int accetta_connessioni(struct reattore *reattore)
+{
     while (1)
     {
-        int num_events = poll(poll_fds, MAX_CLIENTS + 1, -1);
-        if (num_events == -1 && errno != EINTR)
+        int client_fd = accept(reattore->server_fd, NULL, NULL);
+        if (client_fd == -1)
+        {
+            if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR || errno == ECONNABORTED)
+                return SUCCESS;
+
+            perror("Errore con accept");
+            return (errno == EMFILE || errno == ENFILE || errno == ENOBUFS || errno == ENOMEM) ? SUCCESS : ERR_SYSTEM_CALL;
+        }
+
+        int flags = fcntl(client_fd, F_GETFL);
+        if (flags == -1 || fcntl(client_fd, F_SETFL, flags | O_NONBLOCK) == -1)
         {
-            perror("Errore poll");
+            perror("Impossibile rendere non bloccante il socket del client");
+            close(client_fd);
+            continue;
+        }
+
+        if (aggiungi_connessione(reattore, client_fd) == ERR_SYSTEM_CALL)
+            close(client_fd);
+    }
+}
+
+/**
+ * @brief Passa al pool la richiesta appena completata della connessione `fd`, insieme alla risposta in cui il worker
+ *        metterà il risultato. Se il pool è pieno la richiesta resta in attesa nel reattore.
+ *
+ * @return SUCCESS, anche se la malloc fallisce (la connessione diventa guasta).
+ */
+int consegna_richiesta(struct reattore *reattore, int fd)
+{
+    struct connessione *connessione = (struct connessione *)da_at(&(reattore->connessioni), fd);
+
+    struct rispostaPronta *risposta = (struct rispostaPronta *)malloc(sizeof(struct rispostaPronta));
+    if (!risposta)
+    {
+        perror("Malloc fallita");
+        connessione->guasta = 1;
+        return SUCCESS;
+    }
+    *risposta = (struct rispostaPronta){
+        .prossima = NULL,
+        .client_fd = fd,
+        .id = connessione->id,
+        .parti = NULL,
+        .numeroParti = 0,
+        .memoria = NULL,
+        .dimensioneIntestazione = connessione->sessione ? SOCKCOM_INTESTAZIONE_SESSIONE : SOCKCOM_INTESTAZIONE};
+
+    struct elementoCoda daInviare = {.richiesta = connessione->richiesta, .client_fd = fd, .risposta = risposta};
+    connessione->richiesta.data = NULL;
+
+    if (affida_al_pool(reattore, &daInviare) == ERR_SYSTEM_CALL)
+    {
+        free(daInviare.richiesta.data);
+        free(risposta);
+        connessione->guasta = 1;
+        return SUCCESS;
+    }
+    connessione->inVolo++;
+    return SUCCESS;
+}
+
+/**
+ * @brief Controlla le richieste del lotto `lotto` (vedere "protocollo_comunicazione.h").
+ *
+ * @return Il numero di richieste nel lotto, o 0 se il lotto non è valido.
+ */
+size_t conta_lotto(struct messaggio *lotto)
+{
+    size_t numero = 0,
+           posizione = 0,
+           lunghezza = (size_t)lotto->length;
+
+    while (posizione < lunghezza)
+    {
+        int32_t length;
+
+        if (lunghezza - posizione < SOCKCOM_INTESTAZIONE || numero == SOCKCOM_MAX_PER_LOTTO)
+            return 0;
+
+        memcpy(&length, lotto->data + posizione + sizeof(char), sizeof(int32_t));
+        if ((lotto->data[posizione] != MSG_QUERY && lotto->data[posizione] != MSG_LOAN) ||
+            length < 1 || (size_t)length > lunghezza - posizione - SOCKCOM_INTESTAZIONE)
+            return 0;
+
+        posizione += SOCKCOM_INTESTAZIONE + length;
+        numero++;
+    }
+    return numero;
+}
+
+/**
+ * @brief Passa al pool, tutte insieme, le richieste del lotto appena completato della connessione `fd`, ognuna con la
+ *        sua risposta. Quelle che non trovano posto nel pool restano in attesa nel reattore.
+ *
+ * @return SUCCESS, anche se il lotto non è valido o la malloc fallisce (la connessione diventa guasta).
+ */
+int consegna_lotto(struct reattore *reattore, int fd)
+{
+    struct connessione *connessione = (struct connessione *)da_at(&(reattore->connessioni), fd);
+    struct messaggio *lotto = &(connessione->richiesta);
+    struct elementoCoda *daInviare;
+    size_t numero, preparate, inserite, posizione = 0;
+
+    numero = conta_lotto(lotto);
+    if (numero == 0)
+    {
+        printf("Il client ha mandato un lotto non valido\n");
+        connessione->guasta = 1;
+        return SUCCESS;
+    }
+
+    daInviare = (struct elementoCoda *)malloc(sizeof(struct elementoCoda) * numero);
+    if (!daInviare)
+    {
+        perror("Malloc fallita");
+        connessione->guasta = 1;
+        return SUCCESS;
+    }
+
+    for (preparate = 0; preparate < numero; preparate++)
+    {
+        struct elementoCoda *elemento = daInviare + preparate;
+
+        elemento->client_fd = fd;
+        elemento->stato = NULL;
+        elemento->annullata = 0;
+        elemento->richiesta.type = lotto->data[posizione];
+        memcpy(&(elemento->richiesta.length), lotto->data + posizione + sizeof(char), sizeof(int32_t));
+        posizione += SOCKCOM_INTESTAZIONE;
+
+        // il worker libera i dati della sua richiesta, quindi ognuna ha la sua copia
+        elemento->richiesta.data = (char *)malloc(sizeof(char) * elemento->richiesta.length);
+        elemento->risposta = (struct rispostaPronta *)malloc(sizeof(struct rispostaPronta));
+        if (!(elemento->richiesta.data) || !(elemento->risposta))
+        {
+            perror("Malloc fallita");
+            free(elemento->richiesta.data);
+            free(elemento->risposta);
+            break;
+        }
+
+        memcpy(elemento->richiesta.data, lotto->data + posizione, elemento->richiesta.length);
+        elemento->richiesta.data[elemento->richiesta.length - 1] = '\0';
+        posizione += elemento->richiesta.length;
+
+        // le risposte di un lotto hanno sempre l'id, anche su una connessione normale
+        *(elemento->risposta) = (struct rispostaPronta){
+            .prossima = NULL,
+            .client_fd = fd,
+            .id = (connessione->sessione ? connessione->id : 0) + (uint32_t)preparate,
+            .parti = NULL,
+            .numeroParti = 0,
+            .memoria = NULL,
+            .dimensioneIntestazione = SOCKCOM_INTESTAZIONE_SESSIONE};
+    }
+
+    free(lotto->data);
+    lotto->data = NULL;
+
+    if (preparate < numero)
+    {
+        for (size_t index = 0; index < preparate; index++)
+        {
+            free(daInviare[index].richiesta.data);
+            free(daInviare[index].risposta);
+        }
+        free(daInviare);
+        connessione->guasta = 1;
+        return SUCCESS;
+    }
+
+    // nessuna richiesta del lotto scavalca quelle già in attesa
+    inserite = reattore->primaInAttesa ? 0 : pw_provaInserisciLotto(reattore->pool, daInviare, numero);
+    for (; inserite < numero; inserite++)
+    {
+        if (metti_in_attesa(reattore, daInviare + inserite) == ERR_SYSTEM_CALL)
+        {
+            // le richieste già passate al pool tornano comunque con la loro risposta
+            for (size_t index = inserite; index < numero; index++)
+            {
+                free(daInviare[index].richiesta.data);
+                free(daInviare[index].risposta);
+            }
+            connessione->guasta = 1;
             break;
         }
+    }
+    connessione->inVolo += inserite;
+    free(daInviare);
+    return SUCCESS;
+}
+
+/**
+ * @brief Gestisce una richiesta appena completata: la prima richiesta `MSG_SESSIONE` rende la connessione una
+ *        sessione, un lotto passa al pool una richiesta per volta, le altre richieste passano al pool così come sono.
+ *
+ * @return SUCCESS, o ERR_SYSTEM_CALL.
+ */
+int richiesta_completa(struct reattore *reattore, int fd)
+{
+    struct connessione *connessione = (struct connessione *)da_at(&(reattore->connessioni), fd);
+
+    connessione->letti = 0;
+
+    if (connessione->richiesta.type == MSG_SESSIONE && !(connessione->sessione) && connessione->richiesteRicevute == 0)
+    {
+        free(connessione->richiesta.data);
+        connessione->richiesta.data = NULL;
+        connessione->sessione = 1;
+        return SUCCESS;
+    }
+
+    connessione->richiesteRicevute++;
+    if (connessione->richiesta.type == MSG_LOTTO)
+        return consegna_lotto(reattore, fd);
+    return consegna_richiesta(reattore, fd);
+}
+
+/**
+ * @brief Legge senza bloccarsi quello che il client `fd` ha mandato e lo aggiunge alla richiesta che sta arrivando.
+ *        Ogni richiesta completa passa al pool; su una sessione la lettura continua con la successiva.
+ *
+ * Legge al massimo fino alla fine della richiesta: eventuali byte in più restano nel socket finché la connessione non
+ * può riceverli.
+ *
+ * @return SUCCESS, anche se la connessione è guasta, o ERR_SYSTEM_CALL.
+ */
+int leggi_richieste(struct reattore *reattore, int fd)
+{
+    struct connessione *connessione = (struct connessione *)da_at(&(reattore->connessioni), fd);
+
+    // una connessione normale che ha già la sua richiesta legge solo per vedere la chiusura del client
+    if (!(connessione->sessione) && connessione->richiesteRicevute > 0)
+    {
+        char buffer;
+        ssize_t bytes_read = read(fd, &buffer, sizeof(char));
+
+        if (bytes_read == 0)
+            connessione->fineInput = 1;
+        else if (bytes_read > 0)
+        {
+            printf("Alcuni dati inviati dal client sono stati persi,"
+                   "chiudiamo la connessione e cancelliamo la richiesta per sicurezza\n");
+            shutdown(fd, SHUT_RDWR);
+            connessione->guasta = 1;
+        }
+        else if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)
+        {
+            printf("Il client ha chiuso la comunicazione\n");
+            connessione->guasta = 1;
+        }
+        return SUCCESS;
+    }
+
+    while (!(connessione->guasta))
+    {
+        size_t dimensioneIntestazione = connessione->sessione ? SOCKCOM_INTESTAZIONE_SESSIONE : SOCKCOM_INTESTAZIONE;
+        char *destinazione;
+        size_t daLeggere;
+
+        // una sessione con troppe richieste nel pool, o una connessione normale con la sua richiesta, smette di leggere;
+        // così anche una connessione con richieste in attesa di posto nel pool
+        if (connessione->letti == 0 &&
+            (connessione->inAttesa > 0 ||
+             (connessione->sessione ? connessione->inVolo >= SOCKCOM_MAX_IN_VOLO : connessione->richiesteRicevute > 0)))
+            return SUCCESS;
 
-        if (poll_fds[0].revents & POLLIN)
+        if (connessione->letti < dimensioneIntestazione)
         {
-            int fd_libero;
-            for (fd_libero = 1; fd_libero < MAX_CLIENTS + 1 && poll_fds[fd_libero].fd != -1; fd_libero++)
+            destinazione = connessione->intestazione + connessione->letti;
+            daLeggere = dimensioneIntestazione - connessione->letti;
+        }
+        else
+        {
+            size_t lettiData = connessione->letti - dimensioneIntestazione;
+            destinazione = connessione->richiesta.data + lettiData;
+            daLeggere = connessione->richiesta.length - lettiData;
+        }
+
+        ssize_t bytes_read = read(fd, destinazione, daLeggere);
+        if (bytes_read == -1)
+        {
+            if (errno == EAGAIN || errno == EWOULDBLOCK)
+                return SUCCESS; // il resto arriverà con un altro evento
+            if (errno == EINTR)
+                continue;
+
+            perror("Read della richiesta fallita");
+            connessione->guasta = 1;
+            return SUCCESS;
+        }
+        else if (bytes_read == 0)
+        {
+            // una sessione può chiudere tra una richiesta e l'altra, e riceve ancora le risposte che mancano
+            if (connessione->letti > 0 || (!(connessione->sessione) && connessione->richiesteRicevute == 0))
             {
-                // trovo fd libero
+                printf("Client ha chiuso la comunicazione in anticipo\n");
+                connessione->guasta = 1;
             }
+            connessione->fineInput = 1;
+            return SUCCESS;
+        }
+
+        connessione->letti += bytes_read;
 
-            if (fd_libero < MAX_CLIENTS + 1)
+        if (connessione->letti == dimensioneIntestazione)
+        {
+            connessione->richiesta.type = connessione->intestazione[0];
+            if (connessione->sessione)
             {
-                int client_fd = accept(poll_fds[0].fd, NULL, NULL);
-                if (client_fd == -1)
+                memcpy(&(connessione->id), connessione->intestazione + sizeof(char), sizeof(uint32_t));
+                memcpy(&(connessione->richiesta.length), connessione->intestazione + sizeof(char) + sizeof(uint32_t),
+                       sizeof(int32_t));
+            }
+            else
+                memcpy(&(connessione->richiesta.length), connessione->intestazione + sizeof(char), sizeof(int32_t));
+
+            if (connessione->richiesta.length < 1 || connessione->richiesta.length > SOCKCOM_MAX_RICHIESTA)
+            {
+                printf("Il client ha annunciato una richiesta di lunghezza non valida (%d)\n", connessione->richiesta.length);
+                connessione->guasta = 1;
+                return SUCCESS;
+            }
+
+            connessione->richiesta.data = (char *)malloc(sizeof(char) * connessione->richiesta.length);
+            if (!(connessione->richiesta.data))
+            {
+                perror("Malloc fallita");
+                return ERR_SYSTEM_CALL;
+            }
+        }
+
+        if (connessione->letti == dimensioneIntestazione + (size_t)connessione->richiesta.length)
+        {
+            // la richiesta deve essere una stringa
+            connessione->richiesta.data[connessione->richiesta.length - 1] = '\0';
+            if (richiesta_completa(reattore, fd) == ERR_SYSTEM_CALL)
+                return ERR_SYSTEM_CALL;
+        }
+    }
+    return SUCCESS;
+}
+
+/**
+ * @brief Scrive senza bloccarsi le risposte in uscita della connessione `fd`, più risposte (intestazioni e dati) con
+ *        una sola chiamata. Se il socket si riempie si ferma: la connessione aspetterà EPOLLOUT.
+ */
+void scrivi_risposte(struct reattore *reattore, int fd)
+{
+    struct connessione *connessione = (struct connessione *)da_at(&(reattore->connessioni), fd);
+
+    while (connessione->primaUscita && !(connessione->guasta))
+    {
+        struct iovec parti[SOCKCOM_PARTI_PER_SCRITTURA];
+        int numeroParti = 0;
+
+        for (struct rispostaPronta *risposta = connessione->primaUscita;
+             risposta && numeroParti < SOCKCOM_PARTI_PER_SCRITTURA; risposta = risposta->prossima)
+        {
+            if (risposta->scritti < risposta->dimensioneIntestazione)
+                parti[numeroParti++] = (struct iovec){.iov_base = risposta->intestazione + risposta->scritti,
+                                                      .iov_len = risposta->dimensioneIntestazione - risposta->scritti};
+
+            // le parti del contenuto già scritte si saltano, anche quella scritta a metà
+            size_t daSaltare = (risposta->scritti > risposta->dimensioneIntestazione)
+                                   ? risposta->scritti - risposta->dimensioneIntestazione
+                                   : 0;
+            for (int parte = 0; parte < risposta->numeroParti && numeroParti < SOCKCOM_PARTI_PER_SCRITTURA; parte++)
+            {
+                struct iovec *contenuto = risposta->parti + parte;
+                if (daSaltare >= contenuto->iov_len)
                 {
-                    perror("Errore con accept");
+                    daSaltare -= contenuto->iov_len;
                     continue;
                 }
-                poll_fds[fd_libero].fd = client_fd;
-                poll_fds[fd_libero].events = POLLIN;
+                parti[numeroParti++] = (struct iovec){.iov_base = (char *)contenuto->iov_base + daSaltare,
+                                                      .iov_len = contenuto->iov_len - daSaltare};
+                daSaltare = 0;
             }
         }
 
-        for (int j = 1; j < MAX_CLIENTS + 1; j++)
+        // sendmsg al posto di writev per non ricevere SIGPIPE se il client ha già chiuso
+        struct msghdr messaggio = {.msg_iov = parti, .msg_iovlen = numeroParti};
+        ssize_t bytes_written = sendmsg(fd, &messaggio, MSG_NOSIGNAL);
+        if (bytes_written == -1)
         {
-            if (poll_fds[j].fd == -1)
+            if (errno == EINTR)
                 continue;
+            if (errno != EAGAIN && errno != EWOULDBLOCK)
+            {
+                perror("Scrittura della risposta fallita");
+                connessione->guasta = 1;
+            }
+            return;
+        }
 
-            if (poll_fds[j].revents & (POLLERR | POLLHUP | POLLNVAL))
+        // toglie dalla lista le risposte scritte per intero
+        while (bytes_written > 0)
+        {
+            struct rispostaPronta *risposta = connessione->primaUscita;
+            size_t mancanti = risposta->dimensioneIntestazione + (size_t)risposta->length - risposta->scritti;
+
+            if ((size_t)bytes_written < mancanti)
             {
+                risposta->scritti += bytes_written;
+                break;
+            }
 
-                if (poll_fds[j].revents & POLLERR)
-                    printf("La poll ha riportato un problema\n");
+            bytes_written -= mancanti;
+            connessione->primaUscita = risposta->prossima;
+            if (!(connessione->primaUscita))
+                connessione->ultimaUscita = NULL;
+            prosegui_risposta(reattore, risposta, 0);
+            libera_risposta(risposta);
+        }
+    }
+}
 
-                if (poll_fds[j].revents & POLLHUP)
-                    printf("Il cliente ha chiuso\n");
+/**
+ * @brief Toglie dalle richieste in attesa la prima e la restituisce, senza toccare la sua connessione.
+ */
+struct richiestaInAttesa *togli_in_attesa(struct reattore *reattore)
+{
+    struct richiestaInAttesa *prima = reattore->primaInAttesa;
 
-                if (poll_fds[j].revents & POLLNVAL)
-                    printf("File descriptor invalido\n");
+    reattore->primaInAttesa = prima->prossima;
+    if (!(reattore->primaInAttesa))
+        reattore->ultimaInAttesa = NULL;
+    return prima;
+}
 
-                close(poll_fds[j].fd);
-                poll_fds[j].fd = -1;
-                continue;
-            }
+/**
+ * @brief Scarta una richiesta in attesa che non arriverà più al pool: una richiesta nuova viene solo liberata, la
+ *        continuazione di una risposta a pezzi viene annullata eseguendo qui il worker, che ne libera lo stato.
+ */
+void annulla_in_attesa(struct reattore *reattore, struct elementoCoda *elemento)
+{
+    struct connessione *connessione = (struct connessione *)da_at(&(reattore->connessioni), elemento->client_fd);
 
-            if (poll_fds[j].revents & POLLIN)
-            {
-                daInviare.richiesta.data = NULL;
+    connessione->inAttesa--;
+    if (elemento->richiesta.data)
+    {
+        free(elemento->richiesta.data);
+        free(elemento->risposta);
+        connessione->inVolo--;
+        return;
+    }
 
-                ssize_t bytes_read = read(poll_fds[j].fd, &(daInviare.richiesta.type), sizeof(char));
-                if (bytes_read == -1)
-                {
-                    perror("Read di type fallita");
-                    goto error_exit;
-                }
-                else if (bytes_read == 0)
-                {
-                    printf("Client ha chiuso la comunicazione in anticipo\n");
-                    goto client_ha_chiuso;
-                }
+    elemento->annullata = 1;
+    reattore->pool->gestisci(elemento);
+}
 
-                bytes_read = read(poll_fds[j].fd, &(daInviare.richiesta.length), sizeof(int32_t));
-                if (bytes_read == -1)
-                {
-                    perror("Read di length fallita");
-                    goto error_exit;
-                }
-                else if (bytes_read == 0)
-                {
-                    printf("Client ha chiuso la comunicazione in anticipo\n");
-                    goto client_ha_chiuso;
-                }
+/**
+ * @brief Passa al pool, nell'ordine di arrivo, le richieste in attesa finché c'è posto nelle code dei worker, e
+ *        riprende a leggere dalle loro connessioni. Con il pool chiuso le scarta.
+ */
+void affida_in_attesa(struct reattore *reattore)
+{
+    while (reattore->primaInAttesa)
+    {
+        struct richiestaInAttesa *prima = reattore->primaInAttesa;
+        int fd = prima->elemento.client_fd;
 
-                size_t lenData = sizeof(char) * daInviare.richiesta.length;
-                daInviare.richiesta.data = (char *)malloc(lenData);
-                if (!(daInviare.richiesta.data))
-                {
-                    perror("Malloc fallita");
-                    goto error_exit;
-                }
+        if (atomic_load(&(reattore->pool->chiuso)))
+            annulla_in_attesa(reattore, &(prima->elemento));
+        else if (pw_provaInserisci(reattore->pool, &(prima->elemento)) == SUCCESS)
+            ((struct connessione *)da_at(&(reattore->connessioni), fd))->inAttesa--;
+        else
+            return; // il pool avviserà di nuovo con l'eventfd
 
-                bytes_read = 0;
-                while (bytes_read < lenData)
-                {
-                    ssize_t result = read(poll_fds[j].fd, daInviare.richiesta.data + bytes_read, lenData - bytes_read);
-                    if (result == -1)
-                    {
-                        perror("Read di data fallita");
-                        free(daInviare.richiesta.data);
-                        goto error_exit;
-                    }
-                    else if (result == 0)
-                    {
-                        printf("Client ha chiuso la comunicazione in anticipo\n");
-                        free(daInviare.richiesta.data);
-                        goto client_ha_chiuso;
-                    }
-
-                    bytes_read += result;
-                }
+        free(togli_in_attesa(reattore));
+        aggiorna_connessione(reattore, fd);
+    }
+}
+
+/**
+ * @brief Prende tutte le risposte restituite dai worker, le accoda alle loro connessioni e comincia a scriverle. Poi
+ *        passa al pool le richieste in attesa, per cui lo stesso eventfd avvisa che c'è di nuovo posto.
+ */
+void raccogli_risposte(struct reattore *reattore)
+{
+    uint64_t segnalazioni;
+    struct rispostaPronta *pronte = NULL,
+                          *lista;
+
+    if (read(reattore->evento_fd, &segnalazioni, sizeof(uint64_t)) == -1 && errno != EAGAIN)
+        perror("Read dell'eventfd fallita");
+
+    // la pila è in ordine inverso di arrivo: la giriamo per rispondere prima a chi ha finito prima
+    lista = atomic_exchange(&(reattore->risposte), NULL);
+    while (lista)
+    {
+        struct rispostaPronta *prossima = lista->prossima;
+        lista->prossima = pronte;
+        pronte = lista;
+        lista = prossima;
+    }
+
+    while (pronte)
+    {
+        struct rispostaPronta *risposta = pronte;
+        int fd = risposta->client_fd;
+        struct connessione *connessione = (struct connessione *)da_at(&(reattore->connessioni), fd);
+        pronte = pronte->prossima;
+
+        risposta->prossima = NULL;
+        risposta->scritti = 0;
+        risposta->intestazione[0] = risposta->type;
+        if (risposta->dimensioneIntestazione == SOCKCOM_INTESTAZIONE_SESSIONE)
+        {
+            memcpy(risposta->intestazione + sizeof(char), &(risposta->id), sizeof(uint32_t));
+            memcpy(risposta->intestazione + sizeof(char) + sizeof(uint32_t), &(risposta->length), sizeof(int32_t));
+        }
+        else
+            memcpy(risposta->intestazione + sizeof(char), &(risposta->length), sizeof(int32_t));
+
+        // un pezzo non chiude la sua richiesta, che torna nel pool dopo la scrittura
+        if (!(risposta->continua))
+            connessione->inVolo--;
+
+        if (connessione->guasta)
+        {
+            prosegui_risposta(reattore, risposta, 1);
+            libera_risposta(risposta);
+        }
+        else
+        {
+            if (connessione->ultimaUscita)
+                connessione->ultimaUscita->prossima = risposta;
+            else
+                connessione->primaUscita = risposta;
+            connessione->ultimaUscita = risposta;
+        }
+
+        scrivi_risposte(reattore, fd);
+        aggiorna_connessione(reattore, fd);
+    }
+
+    affida_in_attesa(reattore);
+}
+
+//! FUNZIONI PUBBLICHE DEL REATTORE
+
+int sockcom_creaReattore(struct reattore *reattore, int server_fd, const sigset_t *segnali)
+{
+    reattore->server_fd = server_fd;
+    reattore->evento_fd = -1;
+    reattore->segnale_fd = -1;
+    reattore->numeroConnessioni = 0;
+    reattore->pool = NULL;
+    reattore->primaInAttesa = NULL;
+    reattore->ultimaInAttesa = NULL;
+    atomic_init(&(reattore->risposte), NULL);
+    reattore->connessioni = da_create(sizeof(struct connessione), SOCKCOM_CONNESSIONI_INIZIALI);
+    if (!(reattore->connessioni.da_ptrArray))
+    {
+        perror("Creazione tabella delle connessioni fallita");
+        reattore->epoll_fd = -1;
+        return ERR_SYSTEM_CALL;
+    }
+
+    reattore->epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    if (reattore->epoll_fd == -1)
+    {
+        perror("Errore epoll_create1");
+        da_destroy(&(reattore->connessioni));
+        return ERR_SYSTEM_CALL;
+    }
+
+    // il socket server non è bloccante: accetta_connessioni accetta finché ci sono connessioni in attesa
+    int flags = fcntl(server_fd, F_GETFL);
+    struct epoll_event evento = {.events = EPOLLIN, .data.fd = server_fd};
+    if (flags == -1 || fcntl(server_fd, F_SETFL, flags | O_NONBLOCK) == -1 ||
+        epoll_ctl(reattore->epoll_fd, EPOLL_CTL_ADD, server_fd, &evento) == -1)
+    {
+        perror("Impossibile registrare il socket server");
+        sockcom_chiudiReattore(reattore);
+        return ERR_SYSTEM_CALL;
+    }
+
+    reattore->evento_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    evento = (struct epoll_event){.events = EPOLLIN, .data.fd = reattore->evento_fd};
+    if (reattore->evento_fd == -1 || epoll_ctl(reattore->epoll_fd, EPOLL_CTL_ADD, reattore->evento_fd, &evento) == -1)
+    {
+        perror("Impossibile creare l'eventfd delle risposte");
+        sockcom_chiudiReattore(reattore);
+        return ERR_SYSTEM_CALL;
+    }
+
+    if (!segnali)
+        return SUCCESS;
+
+    reattore->segnale_fd = signalfd(-1, segnali, SFD_NONBLOCK | SFD_CLOEXEC);
+    evento = (struct epoll_event){.events = EPOLLIN, .data.fd = reattore->segnale_fd};
+    if (reattore->segnale_fd == -1 || epoll_ctl(reattore->epoll_fd, EPOLL_CTL_ADD, reattore->segnale_fd, &evento) == -1)
+    {
+        perror("Impossibile creare il signalfd del reattore");
+        sockcom_chiudiReattore(reattore);
+        return ERR_SYSTEM_CALL;
+    }
+
+    return SUCCESS;
+}
+
+int sockcom_avviaServer(struct reattore *reattore, struct pool_worker *pool)
+{
+    struct epoll_event eventi[SOCKCOM_EVENTI_PER_ATTESA];
+
+    reattore->pool = pool;
+    pw_impostaAvviso(pool, reattore->evento_fd);
+    while (1)
+    {
+        int num_events = epoll_wait(reattore->epoll_fd, eventi, SOCKCOM_EVENTI_PER_ATTESA, -1);
+        if (num_events == -1)
+        {
+            if (errno == EINTR)
+                continue;
+            perror("Errore epoll_wait");
+            break;
+        }
 
-                daInviare.client_fd = poll_fds[j].fd;
+        for (int j = 0; j < num_events; j++)
+        {
+            int fd = eventi[j].data.fd;
+            uint32_t revents = eventi[j].events;
 
-                if (cc_put(coda, &daInviare) == ERR_SYSTEM_CALL)
-                {
-                    perror("cc_put fallita");
-                    free(daInviare.richiesta.data);
+            if (fd == reattore->server_fd)
+            {
+                if (accetta_connessioni(reattore) == ERR_SYSTEM_CALL)
                     goto error_exit;
-                }
+                continue;
+            }
 
-                poll_fds[j].fd = -1;
+            if (fd == reattore->evento_fd)
+            {
+                raccogli_risposte(reattore);
                 continue;
+            }
 
-            client_ha_chiuso:
-                if (poll_fds[j].fd != -1)
-                {
-                    close(poll_fds[j].fd);
-                    poll_fds[j].fd = -1;
-                }
+            // la chiusura la fa il chiamante, fuori dal ciclo degli eventi
+            struct signalfd_siginfo segnale;
+            if (fd == reattore->segnale_fd)
+            {
+                if (read(reattore->segnale_fd, &segnale, sizeof(segnale)) == (ssize_t)sizeof(segnale))
+                    return SUCCESS;
+                continue;
+            }
+
+            // una risposta raccolta prima in questo giro può aver già chiuso la connessione
+            if ((size_t)fd >= reattore->connessioni.da_arrayCapacity || da_isCellEmpty(&(reattore->connessioni), fd))
                 continue;
+
+            struct connessione *connessione = (struct connessione *)da_at(&(reattore->connessioni), fd);
+
+            if (revents & EPOLLERR)
+            {
+                printf("La epoll ha riportato un problema\n");
+                connessione->guasta = 1;
+            }
+            else if ((revents & EPOLLHUP) && !(revents & EPOLLIN))
+            {
+                // senza EPOLLIN non c'è più niente da leggere, nemmeno la fine della richiesta
+                if (!(connessione->fineInput))
+                    printf("Il cliente ha chiuso\n");
+                connessione->guasta = 1;
+            }
+            else
+            {
+                if ((revents & EPOLLOUT))
+                    scrivi_risposte(reattore, fd);
+                if ((revents & (EPOLLIN | EPOLLHUP)) && leggi_richieste(reattore, fd) == ERR_SYSTEM_CALL)
+                    goto error_exit;
+                // le risposte di richieste annullate dal client non vanno scritte
+                if ((revents & EPOLLHUP) && !(connessione->guasta) && connessione->primaUscita)
+                    connessione->guasta = 1;
             }
+
+            aggiorna_connessione(reattore, fd);
         }
     }
 
 error_exit:
-    for (int i = 1; i < MAX_CLIENTS + 1; i++)
+    sockcom_chiudiReattore(reattore);
+    return ERR_SYSTEM_CALL;
+}
+
+int sockcom_server_consegnaRisposta(struct reattore *reattore, struct rispostaPronta *risposta,
+                                     struct messaggio *messaggio, int liberaData)
+{
+    risposta->dati = (struct iovec){.iov_base = messaggio->data, .iov_len = messaggio->length};
+    return sockcom_server_consegnaParti(reattore, risposta, messaggio->type, &(risposta->dati),
+                                        messaggio->length > 0 ? 1 : 0, liberaData ? messaggio->data : NULL);
+}
+
+int sockcom_server_consegnaParti(struct reattore *reattore, struct rispostaPronta *risposta, char type,
+                                 struct iovec *parti, int numeroParti, void *memoria)
+{
+    size_t lunghezza = 0;
+    for (int parte = 0; parte < numeroParti; parte++)
+        lunghezza += parti[parte].iov_len;
+
+    risposta->type = type;
+    risposta->length = (int32_t)lunghezza;
+    risposta->parti = parti;
+    risposta->numeroParti = numeroParti;
+    risposta->memoria = memoria;
+
+    struct rispostaPronta *testa = atomic_load(&(reattore->risposte));
+    do
+        risposta->prossima = testa;
+    while (!atomic_compare_exchange_weak(&(reattore->risposte), &testa, risposta));
+
+    // se la pila non era vuota il reattore è già stato avvisato e non l'ha ancora svuotata
+    if (testa == NULL)
     {
-        if (poll_fds[i].fd != -1)
+        uint64_t uno = 1;
+        if (write(reattore->evento_fd, &uno, sizeof(uint64_t)) == -1)
         {
-            shutdown(poll_fds[i].fd, SHUT_RDWR);
-            close(poll_fds[i].fd);
-            poll_fds[i].fd = -1;
+            perror("Write dell'eventfd fallita");
+            return ERR_SYSTEM_CALL;
         }
     }
-    return ERR_SYSTEM_CALL;
+    return SUCCESS;
 }
 
-// se la funzione riporta un qualsiasi errore, il chiamante deve chiudere il file descriptor del client
-// e liberare la memoria di risposta.data
-int sockcom_server_trasmettiRisposta(int client_fd, struct messaggio *risposta)
+int sockcom_server_consegnaPezzo(struct reattore *reattore, struct elementoCoda *richiesta, struct iovec *parti,
+                                 int numeroParti, void *memoria)
 {
-    struct pollfd client = {.fd = client_fd, .events = POLLOUT};
-
-    int num_events = poll(&client, 1, -1);
-    if (num_events == -1 && errno != EINTR)
+    struct rispostaPronta *risposta = richiesta->risposta,
+                          *prossima = (struct rispostaPronta *)malloc(sizeof(struct rispostaPronta));
+    if (!prossima)
     {
-        perror("Errore poll");
+        perror("Malloc fallita");
         return ERR_SYSTEM_CALL;
     }
+    *prossima = (struct rispostaPronta){
+        .prossima = NULL,
+        .client_fd = risposta->client_fd,
+        .id = risposta->id,
+        .parti = NULL,
+        .numeroParti = 0,
+        .memoria = NULL,
+        .dimensioneIntestazione = risposta->dimensioneIntestazione};
 
-    if (client.revents & (POLLERR | POLLHUP | POLLNVAL))
-    {
-        if (client.revents & POLLERR)
-            printf("La poll ha riportato un problema\n");
-
-        if (client.revents & POLLHUP)
-            printf("Il cliente ha chiuso\n");
+    risposta->continua = 1;
+    risposta->continuazione = *richiesta;
+    risposta->continuazione.risposta = prossima;
+    risposta->continuazione.richiesta.data = NULL;
 
-        if (client.revents & POLLNVAL)
-            printf("File descriptor invalido\n");
-
-        return ERR_COMUNICAZIONE;
-    }
+    // anche se il reattore non è stato svegliato il pezzo è già suo: lo troverà al prossimo risveglio
+    if (sockcom_server_consegnaParti(reattore, risposta, MSG_PEZZO, parti, numeroParti, memoria) == ERR_SYSTEM_CALL)
+        printf("Il reattore non è stato avvisato del pezzo\n");
+    return SUCCESS;
+}
 
-    if (client.revents & POLLOUT)
+void sockcom_chiudiReattore(struct reattore *reattore)
+{
+    if (reattore->connessioni.da_ptrArray)
     {
-        ssize_t bytes_written = write(client.fd, &(risposta->type), sizeof(char));
-        if (bytes_written == -1)
-        {
-            perror("write di type fallita");
-            return ERR_SYSTEM_CALL;
-        }
+        // le risposte già pronte hanno un ultimo tentativo di scrittura prima della chiusura
+        if (reattore->evento_fd != -1)
+            raccogli_risposte(reattore);
 
-        bytes_written = write(client.fd, &(risposta->length), sizeof(int32_t));
-        if (bytes_written == -1)
+        // dopo un errore del reattore il pool è ancora aperto e alcune richieste possono essere rimaste in attesa
+        while (reattore->primaInAttesa)
         {
-            perror("write di length fallita");
-            return ERR_SYSTEM_CALL;
+            struct richiestaInAttesa *prima = togli_in_attesa(reattore);
+            annulla_in_attesa(reattore, &(prima->elemento));
+            free(prima);
         }
 
-        size_t lenData = sizeof(char) * risposta->length;
-        bytes_written = 0;
-        while (bytes_written < lenData)
+        for (size_t fd = 0; fd < reattore->connessioni.da_arrayCapacity && reattore->numeroConnessioni > 0; fd++)
         {
-            ssize_t result = write(client.fd, risposta->data + bytes_written, lenData - bytes_written);
-            if (result == -1)
+            if (!da_isCellEmpty(&(reattore->connessioni), fd))
             {
-                perror("write di data fallita");
-                return ERR_SYSTEM_CALL;
+                shutdown(fd, SHUT_RDWR);
+                chiudi_connessione(reattore, fd);
             }
-            bytes_written += result;
         }
+        da_destroy(&(reattore->connessioni));
 
-        char buffer = 'r';
-        ssize_t bytes_read = read(client.fd, &buffer, sizeof(char));
-        if (bytes_read == -1)
-        {
-            printf("Il client ha chiuso la comunicazione\n");
-            return ERR_SYSTEM_CALL;
-        }
-        else if (bytes_read != 0)
+        // restano le risposte finali delle richieste annullate chiudendo le connessioni
+        struct rispostaPronta *rimaste = atomic_exchange(&(reattore->risposte), NULL);
+        while (rimaste)
         {
-            printf("Alcuni dati inviati dal client sono stati persi,"
-                   "chiudiamo la connessione e cancelliamo la richiesta per sicurezza\n");
-            return ERR_SYSTEM_CALL;
+            struct rispostaPronta *prossima = rimaste->prossima;
+            libera_risposta(rimaste);
+            rimaste = prossima;
         }
+    }
 
-        if (shutdown(client.fd, SHUT_RDWR) == -1)
-        {
-            perror("shutdown fallita");
-            return ERR_SYSTEM_CALL;
-        }
+    if (reattore->evento_fd != -1)
+    {
+        close(reattore->evento_fd);
+        reattore->evento_fd = -1;
+    }
 
-        return SUCCESS;
+    if (reattore->segnale_fd != -1)
+    {
+        close(reattore->segnale_fd);
+        reattore->segnale_fd = -1;
     }
 
-    printf("La poll è uscita con revents!= POLLOUT | POLLERR | POLLHUP | POLLNVAL\n");
-    return ERR_COMUNICAZIONE;
+    if (reattore->epoll_fd != -1)
+    {
+        close(reattore->epoll_fd);
+        reattore->epoll_fd = -1;
+    }
 }
 
 int sockcom_client_mandaRichiesta(char socketServerPath[108], struct messaggio *richiesta)
 {
-    int sock_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    int errore, sock_fd = socket(AF_UNIX, SOCK_STREAM, 0);
     if (sock_fd == -1)
     {
         perror("creazione socket fallita");
@@ -298,7 +1107,9 @@ int sockcom_client_mandaRichiesta(char socketServerPath[108], struct messaggio *
     int result = connect(sock_fd, (struct sockaddr *)&server_addr, sizeof(struct sockaddr_un));
     if (result == -1)
     {
+        errore = errno;
         perror("connessione rifiutata");
+        errno = errore;
         goto error_exit;
     }
 
@@ -335,16 +1146,20 @@ int sockcom_client_mandaRichiesta(char socketServerPath[108], struct messaggio *
     return sock_fd;
 
 error_exit:
-    if (sock_fd != -1)
-    {
-        shutdown(sock_fd, SHUT_RDWR);
-        close(sock_fd);
-    }
+    // il chiamante distingue dall'errno un server non più attivo (ECONNREFUSED, ENOENT)
+    errore = errno;
+    shutdown(sock_fd, SHUT_RDWR);
+    close(sock_fd);
+    errno = errore;
     return ERR_SYSTEM_CALL;
 }
 
-// chiamante deve deallocare risposta e chiudere sock_fd
-int sockcom_client_riceviRisposta(int sock_fd, struct messaggio *risposta)
+/**
+ * @brief Riceve un solo messaggio dal server, che può essere un pezzo della risposta.
+ *
+ * @return SUCCESS, ERR_SYSTEM_CALL o ERR_COMUNICAZIONE.
+ */
+int ricevi_messaggio(int sock_fd, struct messaggio *risposta)
 {
     ssize_t bytes_read = read(sock_fd, &(risposta->type), sizeof(char));
     if (bytes_read == -1)
@@ -405,8 +1220,351 @@ int sockcom_client_riceviRisposta(int sock_fd, struct messaggio *risposta)
     }
 
 success_exit:
+    return SUCCESS;
+}
+/**
+ * @brief Aggiunge `lunghezza` byte di `dati` in fondo ai pezzi già ricevuti, raddoppiando lo spazio quando serve.
+ *
+ * @return SUCCESS, o ERR_SYSTEM_CALL.
+ */
+int aggiungi_pezzo(char **pezzi, size_t *lunghezzaPezzi, size_t *capacitaPezzi, const char *dati, size_t lunghezza)
+{
+    if (*lunghezzaPezzi + lunghezza > *capacitaPezzi)
+    {
+        size_t capacita = *capacitaPezzi ? *capacitaPezzi : lunghezza;
+        while (capacita < *lunghezzaPezzi + lunghezza)
+            capacita *= 2;
+
+        char *temp = (char *)realloc(*pezzi, capacita);
+        if (!temp)
+        {
+            perror("realloc fallita");
+            return ERR_SYSTEM_CALL;
+        }
+        *pezzi = temp;
+        *capacitaPezzi = capacita;
+    }
+
+    memcpy(*pezzi + *lunghezzaPezzi, dati, lunghezza);
+    *lunghezzaPezzi += lunghezza;
+    return SUCCESS;
+}
+
+/**
+ * @brief Completa con il messaggio finale `finale` una risposta arrivata a pezzi: con `MSG_RECORD` i dati di `finale`
+ *        diventano i pezzi seguiti dai suoi dati, altrimenti i pezzi vengono scartati. I pezzi passano a `finale`.
+ *
+ * @return SUCCESS, o ERR_SYSTEM_CALL (e `finale` non ha più dati).
+ */
+int completa_risposta(struct messaggio *finale, char **pezzi, size_t *lunghezzaPezzi, size_t *capacitaPezzi)
+{
+    int esito = SUCCESS;
+
+    if (*pezzi && finale->type == MSG_RECORD)
+    {
+        esito = aggiungi_pezzo(pezzi, lunghezzaPezzi, capacitaPezzi, finale->data, finale->length);
+        free(finale->data);
+        finale->data = NULL;
+        if (esito == SUCCESS)
+        {
+            finale->data = *pezzi;
+            finale->length = (int32_t)*lunghezzaPezzi;
+            *pezzi = NULL;
+        }
+    }
+
+    free(*pezzi);
+    *pezzi = NULL;
+    *lunghezzaPezzi = *capacitaPezzi = 0;
+    return esito;
+}
+
+// chiamante deve deallocare risposta e chiudere sock_fd
+int sockcom_client_riceviRisposta(int sock_fd, struct messaggio *risposta)
+{
+    char *pezzi = NULL;
+    size_t lunghezzaPezzi = 0, capacitaPezzi = 0;
+    int esito;
+
+    // i pezzi di una risposta lunga si accumulano fino al messaggio finale
+    while ((esito = ricevi_messaggio(sock_fd, risposta)) == SUCCESS && risposta->type == MSG_PEZZO)
+    {
+        esito = aggiungi_pezzo(&pezzi, &lunghezzaPezzi, &capacitaPezzi, risposta->data, risposta->length);
+        free(risposta->data);
+        if (esito != SUCCESS)
+            break;
+    }
+
+    if (esito != SUCCESS)
+    {
+        free(pezzi);
+        return esito;
+    }
+
+    esito = completa_risposta(risposta, &pezzi, &lunghezzaPezzi, &capacitaPezzi);
+    if (esito != SUCCESS)
+        return esito;
+
     if (shutdown(sock_fd, SHUT_RD) == -1)
         perror("Shutdown fallita");
 
     return SUCCESS;
-}
\ No newline at end of file
+}
+
+int sockcom_client_continuaRisposta(int sock_fd, struct rispostaInArrivo *arrivo)
+{
+    char *destinazione;
+    size_t daLeggere;
+    int esito;
+
+    if (arrivo->letti < SOCKCOM_INTESTAZIONE)
+    {
+        destinazione = arrivo->intestazione + arrivo->letti;
+        daLeggere = SOCKCOM_INTESTAZIONE - arrivo->letti;
+    }
+    else
+    {
+        size_t lettiData = arrivo->letti - SOCKCOM_INTESTAZIONE;
+        destinazione = arrivo->risposta.data + lettiData;
+        daLeggere = arrivo->risposta.length - lettiData;
+    }
+
+    ssize_t bytes_read = read(sock_fd, destinazione, daLeggere);
+    if (bytes_read == -1)
+    {
+        if (errno == EINTR || errno == EAGAIN || errno == EWOULDBLOCK)
+            return RISPOSTA_INCOMPLETA;
+        perror("Read della risposta fallita");
+        esito = ERR_SYSTEM_CALL;
+        goto error_exit;
+    }
+    else if (bytes_read == 0)
+    {
+        printf("Server ha chiuso la comunicazione in anticipo\n");
+        esito = ERR_COMUNICAZIONE;
+        goto error_exit;
+    }
+
+    arrivo->letti += bytes_read;
+
+    if (arrivo->letti < SOCKCOM_INTESTAZIONE)
+        return RISPOSTA_INCOMPLETA;
+
+    if (arrivo->letti == SOCKCOM_INTESTAZIONE)
+    {
+        arrivo->risposta.type = arrivo->intestazione[0];
+        memcpy(&(arrivo->risposta.length), arrivo->intestazione + sizeof(char), sizeof(int32_t));
+        arrivo->risposta.data = NULL;
+
+        if (arrivo->risposta.length < 0)
+        {
+            printf("Il server ha mandato una risposta di lunghezza non valida\n");
+            esito = ERR_COMUNICAZIONE;
+            goto error_exit;
+        }
+        if (arrivo->risposta.length > 0)
+        {
+            arrivo->risposta.data = (char *)malloc(sizeof(char) * arrivo->risposta.length);
+            if (!arrivo->risposta.data)
+            {
+                perror("malloc fallita");
+                esito = ERR_SYSTEM_CALL;
+                goto error_exit;
+            }
+        }
+    }
+
+    if (arrivo->letti < SOCKCOM_INTESTAZIONE + (size_t)arrivo->risposta.length)
+        return RISPOSTA_INCOMPLETA;
+
+    // un pezzo completo si aggiunge ai precedenti e si ricomincia dal messaggio successivo
+    if (arrivo->risposta.type == MSG_PEZZO)
+    {
+        esito = aggiungi_pezzo(&(arrivo->pezzi), &(arrivo->lunghezzaPezzi), &(arrivo->capacitaPezzi),
+                               arrivo->risposta.data, arrivo->risposta.length);
+        if (esito != SUCCESS)
+            goto error_exit;
+
+        free(arrivo->risposta.data);
+        arrivo->risposta.data = NULL;
+        arrivo->letti = 0;
+        return RISPOSTA_INCOMPLETA;
+    }
+
+    return completa_risposta(&(arrivo->risposta), &(arrivo->pezzi), &(arrivo->lunghezzaPezzi), &(arrivo->capacitaPezzi));
+
+error_exit:
+    free(arrivo->risposta.data);
+    arrivo->risposta.data = NULL;
+    free(arrivo->pezzi);
+    arrivo->pezzi = NULL;
+    return esito;
+}
+
+//! SESSIONI
+
+/**
+ * @brief Scrive tutti i `dimensione` byte di `buffer`, anche con più write.
+ *
+ * @return SUCCESS, o ERR_SYSTEM_CALL.
+ */
+int sessione_scrivi(int sock_fd, const char *buffer, size_t dimensione)
+{
+    size_t bytes_written = 0;
+    while (bytes_written < dimensione)
+    {
+        ssize_t result = send(sock_fd, buffer + bytes_written, dimensione - bytes_written, MSG_NOSIGNAL);
+        if (result == -1)
+        {
+            if (errno == EINTR)
+                continue;
+            perror("Write della richiesta fallita");
+            return ERR_SYSTEM_CALL;
+        }
+        bytes_written += result;
+    }
+    return SUCCESS;
+}
+
+/**
+ * @brief Legge esattamente `dimensione` byte in `buffer`, anche con più read.
+ *
+ * @return SUCCESS, ERR_SYSTEM_CALL, o ERR_COMUNICAZIONE se il server chiude prima.
+ */
+int sessione_leggi(int sock_fd, char *buffer, size_t dimensione)
+{
+    size_t bytes_read = 0;
+    while (bytes_read < dimensione)
+    {
+        ssize_t result = read(sock_fd, buffer + bytes_read, dimensione - bytes_read);
+        if (result == -1)
+        {
+            if (errno == EINTR)
+                continue;
+            perror("Read della risposta fallita");
+            return ERR_SYSTEM_CALL;
+        }
+        else if (result == 0)
+        {
+            printf("Server ha chiuso la comunicazione in anticipo\n");
+            return ERR_COMUNICAZIONE;
+        }
+        bytes_read += result;
+    }
+    return SUCCESS;
+}
+
+int sockcom_client_apriSessione(char socketServerPath[108])
+{
+    int sock_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (sock_fd == -1)
+    {
+        perror("creazione socket fallita");
+        return ERR_SYSTEM_CALL;
+    }
+
+    struct sockaddr_un server_addr = {.sun_family = AF_UNIX};
+    strcpy(server_addr.sun_path, socketServerPath);
+
+    if (connect(sock_fd, (struct sockaddr *)&server_addr, sizeof(struct sockaddr_un)) == -1)
+    {
+        perror("connessione rifiutata");
+        close(sock_fd);
+        return ERR_SYSTEM_CALL;
+    }
+
+    // la richiesta di apertura ha il formato normale e un solo carattere di dati, il terminatore
+    char apertura[SOCKCOM_INTESTAZIONE + 1] = {MSG_SESSIONE};
+    int32_t length = 1;
+    memcpy(apertura + sizeof(char), &length, sizeof(int32_t));
+
+    if (sessione_scrivi(sock_fd, apertura, sizeof(apertura)) == ERR_SYSTEM_CALL)
+    {
+        close(sock_fd);
+        return ERR_SYSTEM_CALL;
+    }
+    return sock_fd;
+}
+
+int sockcom_client_mandaRichiestaSessione(int sock_fd, uint32_t id, struct messaggio *richiesta)
+{
+    char intestazione[SOCKCOM_INTESTAZIONE_SESSIONE];
+    intestazione[0] = richiesta->type;
+    memcpy(intestazione + sizeof(char), &id, sizeof(uint32_t));
+    memcpy(intestazione + sizeof(char) + sizeof(uint32_t), &(richiesta->length), sizeof(int32_t));
+
+    if (sessione_scrivi(sock_fd, intestazione, SOCKCOM_INTESTAZIONE_SESSIONE) == ERR_SYSTEM_CALL)
+        return ERR_SYSTEM_CALL;
+    return sessione_scrivi(sock_fd, richiesta->data, sizeof(char) * richiesta->length);
+}
+
+int sockcom_client_riceviRispostaSessione(int sock_fd, uint32_t *id, struct messaggio *risposta)
+{
+    char intestazione[SOCKCOM_INTESTAZIONE_SESSIONE];
+    int esito = sessione_leggi(sock_fd, intestazione, SOCKCOM_INTESTAZIONE_SESSIONE);
+    if (esito != SUCCESS)
+        return esito;
+
+    risposta->type = intestazione[0];
+    memcpy(id, intestazione + sizeof(char), sizeof(uint32_t));
+    memcpy(&(risposta->length), intestazione + sizeof(char) + sizeof(uint32_t), sizeof(int32_t));
+
+    if (risposta->length == 0)
+    {
+        risposta->data = NULL;
+        return SUCCESS;
+    }
+
+    risposta->data = (char *)malloc(sizeof(char) * risposta->length);
+    if (!risposta->data)
+    {
+        perror("malloc fallita");
+        return ERR_SYSTEM_CALL;
+    }
+
+    esito = sessione_leggi(sock_fd, risposta->data, sizeof(char) * risposta->length);
+    if (esito != SUCCESS)
+        free(risposta->data);
+    return esito;
+}
+
+//! LOTTI
+
+int sockcom_componiLotto(struct messaggio *lotto, struct messaggio *richieste, size_t numero)
+{
+    size_t lunghezza = 0,
+           posizione = 0;
+
+    if (numero == 0 || numero > SOCKCOM_MAX_PER_LOTTO)
+    {
+        printf("Un lotto deve avere da 1 a %d richieste\n", SOCKCOM_MAX_PER_LOTTO);
+        return ERR_SYSTEM_CALL;
+    }
+
+    for (size_t index = 0; index < numero; index++)
+        lunghezza += SOCKCOM_INTESTAZIONE + richieste[index].length;
+    if (lunghezza > SOCKCOM_MAX_RICHIESTA)
+    {
+        printf("Il lotto supera la lunghezza massima di una richiesta\n");
+        return ERR_SYSTEM_CALL;
+    }
+
+    lotto->data = (char *)malloc(sizeof(char) * lunghezza);
+    if (!lotto->data)
+    {
+        perror("malloc fallita");
+        return ERR_SYSTEM_CALL;
+    }
+
+    for (size_t index = 0; index < numero; index++)
+    {
+        lotto->data[posizione] = richieste[index].type;
+        memcpy(lotto->data + posizione + sizeof(char), &(richieste[index].length), sizeof(int32_t));
+        memcpy(lotto->data + posizione + SOCKCOM_INTESTAZIONE, richieste[index].data, richieste[index].length);
+        posizione += SOCKCOM_INTESTAZIONE + richieste[index].length;
+    }
+
+    lotto->type = MSG_LOTTO;
+    lotto->length = (int32_t)lunghezza;
+    return SUCCESS;
+}
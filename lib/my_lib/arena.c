@@ -0,0 +1,157 @@
+#include "../../include/my_lib/arena.h"
+#include <stdlib.h>
+#include <string.h>
+#include <stdalign.h>
+
+//! INTERNAL FUNCTIONS
+
+#define ALIGNMENT alignof(max_align_t)
+
+/**
+ * @return `size` rounded up to a multiple of ALIGNMENT.
+ */
+size_t align_size(size_t size)
+{
+    return (size + ALIGNMENT - 1) & ~(ALIGNMENT - 1);
+}
+
+/**
+ * @return Pointer to the first byte served by `block`.
+ */
+char *block_memory(struct arena_block *block)
+{
+    return (char *)block + align_size(sizeof(struct arena_block));
+}
+
+/**
+ * @brief Allocates a new block able to serve at least `size` bytes and makes it the current one.
+ *
+ * @return Pointer to the new block, NULL if malloc fails.
+ */
+struct arena_block *add_block(struct arena *object, size_t size)
+{
+    size_t blockSize = (size > object->ar_blockSize) ? size : object->ar_blockSize,
+           totalSize = align_size(sizeof(struct arena_block)) + blockSize;
+
+    struct arena_block *block = (struct arena_block *)malloc(totalSize);
+    if (!block)
+        return NULL;
+
+    block->ar_size = blockSize;
+    block->ar_used = 0;
+    object->ar_bytesAllocated += totalSize;
+
+    // a block for a single big allocation goes behind the current one, so that the free space of the current one is not lost
+    if (size > object->ar_blockSize && object->ar_blocks)
+    {
+        block->ar_next = object->ar_blocks->ar_next;
+        object->ar_blocks->ar_next = block;
+    }
+    else
+    {
+        block->ar_next = object->ar_blocks;
+        object->ar_blocks = block;
+    }
+
+    return block;
+}
+
+/**
+ * @brief Serves `size` bytes aligned to `alignment` (a power of 2 not bigger than ALIGNMENT).
+ * @return Pointer to the memory, NULL if malloc fails.
+ */
+void *allocate(struct arena *object, size_t size, size_t alignment)
+{
+    struct arena_block *block = object->ar_blocks;
+    size_t start = block ? (block->ar_used + alignment - 1) & ~(alignment - 1) : 0;
+
+    if (!block || start > block->ar_size || block->ar_size - start < size)
+    {
+        if (!(block = add_block(object, size)))
+            return NULL;
+        start = block->ar_used; // a new block is empty, and its memory is aligned to ALIGNMENT
+    }
+
+    object->ar_bytesUsed += start + size - block->ar_used;
+    block->ar_used = start + size;
+
+    return block_memory(block) + start;
+}
+
+//! PUBLIC FUNCTIONS
+
+struct arena ar_create(size_t blockSize)
+{
+    return (struct arena){NULL, blockSize ? blockSize : AR_BLOCK_SIZE, 0, 0};
+}
+
+void *ar_alloc(struct arena *object, size_t size)
+{
+    return allocate(object, size ? size : 1, ALIGNMENT);
+}
+
+char *ar_strdup(struct arena *object, const char *string)
+{
+    return ar_strndup(object, string, strlen(string));
+}
+
+char *ar_strndup(struct arena *object, const char *string, size_t length)
+{
+    char *result = (char *)allocate(object, length + 1, 1);
+
+    if (result)
+    {
+        memcpy(result, string, length);
+        result[length] = '\0';
+    }
+    return result;
+}
+
+size_t ar_bytesUsed(const struct arena *object)
+{
+    return object->ar_bytesUsed;
+}
+
+size_t ar_bytesAllocated(const struct arena *object)
+{
+    return object->ar_bytesAllocated;
+}
+
+void ar_merge(struct arena *object, struct arena *other)
+{
+    struct arena_block *last = other->ar_blocks;
+
+    if (!last)
+        return;
+
+    while (last->ar_next)
+        last = last->ar_next;
+
+    // the blocks of `other` go behind the current block, which keeps serving the allocations of `object`
+    if (object->ar_blocks)
+    {
+        last->ar_next = object->ar_blocks->ar_next;
+        object->ar_blocks->ar_next = other->ar_blocks;
+    }
+    else
+        object->ar_blocks = other->ar_blocks;
+
+    object->ar_bytesUsed += other->ar_bytesUsed;
+    object->ar_bytesAllocated += other->ar_bytesAllocated;
+
+    *other = ar_create(other->ar_blockSize);
+}
+
+void ar_destroy(struct arena *object)
+{
+    struct arena_block *block = object->ar_blocks;
+
+    while (block)
+    {
+        struct arena_block *next = block->ar_next;
+        free(block);
+        block = next;
+    }
+
+    *object = ar_create(object->ar_blockSize);
+}
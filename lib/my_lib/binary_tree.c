@@ -1,27 +1,175 @@
 #include "../../include/my_lib/binary_tree.h"
 #include <string.h>
 #include <stdlib.h>
+#include <stdalign.h>
 
-//* FUNCTIONS TO WORK DIRECTLY ON THE NODES
+//! INTERNAL FUNCTIONS
 
-struct binary_tree_node *bt_node_createNode(const void *element, size_t elementSize)
+// the element is allocated together with its node, right after it
+#define NODE_SIZE ((sizeof(struct binary_tree_node) + alignof(max_align_t) - 1) & ~(alignof(max_align_t) - 1))
+
+/**
+ * @brief Allocates a node and its element with a single allocation, from `arena` if it is not NULL.
+ *
+ * @return Pointer to the new node, or NULL if the allocation fails.
+ */
+struct binary_tree_node *create_node(const void *element, size_t elementSize, struct arena *arena)
 {
-    struct binary_tree_node *node = (struct binary_tree_node *)malloc(sizeof(struct binary_tree_node));
+    struct binary_tree_node *node = (struct binary_tree_node *)(arena ? ar_alloc(arena, NODE_SIZE + elementSize)
+                                                                      : malloc(NODE_SIZE + elementSize));
     if (!node)
         return NULL;
 
-    node->bt_node_element = malloc(elementSize);
-    if (!(node->bt_node_element))
+    node->bt_node_element = (char *)node + NODE_SIZE;
+    memcpy(node->bt_node_element, element, elementSize);
+
+    node->bt_node_right = node->bt_node_left = NULL;
+    node->bt_node_height = 1;
+
+    return node;
+}
+
+//* AVL BALANCING
+
+/**
+ * @brief Recomputes the height of a node from the heights of its children.
+ */
+void update_height(struct binary_tree_node *node)
+{
+    int left = bt_node_height(node->bt_node_left),
+        right = bt_node_height(node->bt_node_right);
+
+    node->bt_node_height = 1 + (left > right ? left : right);
+}
+
+/**
+ * @return The height of the left subtree minus the height of the right one.
+ */
+int balance_factor(struct binary_tree_node *node)
+{
+    return bt_node_height(node->bt_node_left) - bt_node_height(node->bt_node_right);
+}
+
+/**
+ * @brief Rotates the subtree to the right, the left child becomes the new root.
+ *
+ * @return The new root of the subtree.
+ */
+struct binary_tree_node *rotate_right(struct binary_tree_node *root)
+{
+    struct binary_tree_node *newRoot = root->bt_node_left;
+
+    root->bt_node_left = newRoot->bt_node_right;
+    newRoot->bt_node_right = root;
+
+    update_height(root);
+    update_height(newRoot);
+
+    return newRoot;
+}
+
+/**
+ * @brief Rotates the subtree to the left, the right child becomes the new root.
+ *
+ * @return The new root of the subtree.
+ */
+struct binary_tree_node *rotate_left(struct binary_tree_node *root)
+{
+    struct binary_tree_node *newRoot = root->bt_node_right;
+
+    root->bt_node_right = newRoot->bt_node_left;
+    newRoot->bt_node_left = root;
+
+    update_height(root);
+    update_height(newRoot);
+
+    return newRoot;
+}
+
+/**
+ * @brief Restores the AVL property of a node whose children are already balanced.
+ *
+ * @return The new root of the subtree.
+ */
+struct binary_tree_node *rebalance(struct binary_tree_node *root)
+{
+    update_height(root);
+
+    int balance = balance_factor(root);
+
+    if (balance > 1)
+    {
+        if (balance_factor(root->bt_node_left) < 0)
+            root->bt_node_left = rotate_left(root->bt_node_left);
+        return rotate_right(root);
+    }
+
+    if (balance < -1)
+    {
+        if (balance_factor(root->bt_node_right) > 0)
+            root->bt_node_right = rotate_right(root->bt_node_right);
+        return rotate_left(root);
+    }
+
+    return root;
+}
+
+/**
+ * @brief Recursive part of bt_node_insertBalanced.
+ *
+ * @param arena The arena of the tree, NULL if the nodes are allocated with malloc.
+ * @param inserted Where to save the pointer to the new node, it stays NULL if the allocation fails.
+ * @return The new root of the subtree.
+ */
+struct binary_tree_node *insert_balanced(struct binary_tree_node *root, const void *element, size_t elementSize, int (*compare_function)(const void *, const void *), struct arena *arena, struct binary_tree_node **inserted)
+{
+    if (root == NULL)
+        return *inserted = create_node(element, elementSize, arena);
+
+    if (compare_function(element, root->bt_node_element) < 0)
+        root->bt_node_left = insert_balanced(root->bt_node_left, element, elementSize, compare_function, arena, inserted);
+    else
+        root->bt_node_right = insert_balanced(root->bt_node_right, element, elementSize, compare_function, arena, inserted);
+
+    if (*inserted == NULL)
+        return root; // malloc failed, the tree has not changed
+
+    return rebalance(root);
+}
+
+/**
+ * @brief Recursive part of bt_buildFromSorted.
+ *
+ * @param failed Set to 1 if an allocation fails.
+ * @return The root of the subtree built from `count` elements.
+ */
+struct binary_tree_node *build_sorted(const char *elements, size_t count, size_t elementSize, struct arena *arena, int *failed)
+{
+    if (count == 0 || *failed)
+        return NULL;
+
+    size_t middle = count / 2;
+    struct binary_tree_node *root = create_node(elements + middle * elementSize, elementSize, arena);
+    if (!root)
     {
-        free(node);
+        *failed = 1;
         return NULL;
     }
 
-    memmove(node->bt_node_element, element, elementSize);
+    root->bt_node_left = build_sorted(elements, middle, elementSize, arena, failed);
+    root->bt_node_right = build_sorted(elements + (middle + 1) * elementSize, count - middle - 1, elementSize, arena, failed);
+    update_height(root);
 
-    node->bt_node_right = node->bt_node_left = NULL;
+    return root;
+}
 
-    return node;
+//! PUBLIC FUNCTIONS
+
+//* FUNCTIONS TO WORK DIRECTLY ON THE NODES
+
+struct binary_tree_node *bt_node_createNode(const void *element, size_t elementSize)
+{
+    return create_node(element, elementSize, NULL);
 }
 
 struct binary_tree_node *bt_node_insert(struct binary_tree_node **root, const void *element, size_t elementSize, int(compare_function)(const void *, const void *))
@@ -66,8 +214,6 @@ struct binary_tree_node *bt_node_delete(struct binary_tree_node *root, const voi
         if (root->bt_node_left == NULL)
         {
             struct binary_tree_node *temp = root->bt_node_right;
-            if (root->bt_node_element)
-                free(root->bt_node_element);
             free(root);
             return temp;
         }
@@ -75,8 +221,6 @@ struct binary_tree_node *bt_node_delete(struct binary_tree_node *root, const voi
         if (root->bt_node_right == NULL)
         {
             struct binary_tree_node *temp = root->bt_node_left;
-            if (root->bt_node_element)
-                free(root->bt_node_element);
             free(root);
             return temp;
         }
@@ -91,6 +235,51 @@ struct binary_tree_node *bt_node_delete(struct binary_tree_node *root, const voi
     return root;
 }
 
+int bt_node_height(struct binary_tree_node *root)
+{
+    return root ? root->bt_node_height : 0;
+}
+
+struct binary_tree_node *bt_node_insertBalanced(struct binary_tree_node **root, const void *element, size_t elementSize, int (*compare_function)(const void *, const void *))
+{
+    struct binary_tree_node *inserted = NULL;
+
+    *root = insert_balanced(*root, element, elementSize, compare_function, NULL, &inserted);
+
+    return inserted;
+}
+
+struct binary_tree_node *bt_node_deleteBalanced(struct binary_tree_node *root, const void *element, size_t elementSize, int (*compare_function)(const void *, const void *))
+{
+    if (root == NULL)
+        return root;
+
+    int comparison = compare_function(element, root->bt_node_element);
+
+    if (comparison < 0)
+        root->bt_node_left = bt_node_deleteBalanced(root->bt_node_left, element, elementSize, compare_function);
+    else if (comparison > 0)
+        root->bt_node_right = bt_node_deleteBalanced(root->bt_node_right, element, elementSize, compare_function);
+
+    else
+    {
+        if (root->bt_node_left == NULL || root->bt_node_right == NULL)
+        {
+            struct binary_tree_node *temp = root->bt_node_left ? root->bt_node_left : root->bt_node_right;
+            free(root);
+            return temp;
+        }
+
+        struct binary_tree_node *temp = bt_node_findMin(root->bt_node_right);
+
+        memcpy(root->bt_node_element, temp->bt_node_element, elementSize);
+
+        root->bt_node_right = bt_node_deleteBalanced(root->bt_node_right, temp->bt_node_element, elementSize, compare_function);
+    }
+
+    return rebalance(root);
+}
+
 struct binary_tree_node *bt_node_search(struct binary_tree_node *root, const void *element, size_t elementSize, int (*compare_function)(const void *, const void *))
 {
     if (root == NULL)
@@ -119,8 +308,6 @@ void bt_node_freeTree(struct binary_tree_node *root)
     {
         bt_node_freeTree(root->bt_node_left);
         bt_node_freeTree(root->bt_node_right);
-        if (root->bt_node_element)
-            free(root->bt_node_element);
         free(root);
     }
 }
@@ -129,19 +316,64 @@ void bt_node_freeTree(struct binary_tree_node *root)
 
 struct binary_tree bt_create(size_t elementSize, int (*compare_function)(const void *, const void *))
 {
-    return (struct binary_tree){NULL, elementSize, compare_function};
+    return (struct binary_tree){NULL, elementSize, compare_function, 0, NULL};
+}
+
+struct binary_tree bt_createBalanced(size_t elementSize, int (*compare_function)(const void *, const void *))
+{
+    return (struct binary_tree){NULL, elementSize, compare_function, 1, NULL};
+}
+
+struct binary_tree bt_createInArena(size_t elementSize, int (*compare_function)(const void *, const void *), struct arena *arena)
+{
+    return (struct binary_tree){NULL, elementSize, compare_function, 1, arena};
+}
+
+void *bt_insertElement(struct binary_tree *object, const void *element)
+{
+    struct binary_tree_node *inserted = NULL;
+
+    if (object->bt_balanced)
+        object->bt_root = insert_balanced(object->bt_root, element, object->bt_elementSize, object->bt_compareFunction, object->bt_arena, &inserted);
+    else
+        inserted = bt_node_insert(&(object->bt_root), element, object->bt_elementSize, object->bt_compareFunction);
+
+    return inserted ? inserted->bt_node_element : NULL;
+}
+
+int bt_buildFromSorted(struct binary_tree *object, const void *elements, size_t count)
+{
+    int failed = 0;
+
+    if (object->bt_root)
+        return FAILURE;
+
+    object->bt_root = build_sorted((const char *)elements, count, object->bt_elementSize, object->bt_arena, &failed);
+    if (failed)
+    {
+        bt_freeTree(object);
+        return FAILURE;
+    }
+
+    return SUCCESS;
 }
 
 int bt_insert(struct binary_tree *object, const void *element)
 {
-    if (bt_node_insert(&(object->bt_root), element, object->bt_elementSize, object->bt_compareFunction) == NULL)
+    if (bt_insertElement(object, element) == NULL)
         return FAILURE;
     return SUCCESS;
 }
 
 void bt_delete(struct binary_tree *object, const void *element)
 {
-    object->bt_root = bt_node_delete(object->bt_root, element, object->bt_elementSize, object->bt_compareFunction);
+    if (object->bt_arena)
+        return; // the nodes of an arena cannot be freed one by one
+
+    if (object->bt_balanced)
+        object->bt_root = bt_node_deleteBalanced(object->bt_root, element, object->bt_elementSize, object->bt_compareFunction);
+    else
+        object->bt_root = bt_node_delete(object->bt_root, element, object->bt_elementSize, object->bt_compareFunction);
 }
 
 void *bt_search(struct binary_tree *object, const void *element)
@@ -159,6 +391,7 @@ void bt_visitInOrder(struct binary_tree *object, void (*visualizeElement)(const
 
 void bt_freeTree(struct binary_tree *object)
 {
-    bt_node_freeTree(object->bt_root);
+    if (!(object->bt_arena))
+        bt_node_freeTree(object->bt_root);
     object->bt_root = NULL;
 }
@@ -0,0 +1,686 @@
+#include "../../include/my_lib/compressed_bitmap.h"
+#include <stdlib.h>
+#include <string.h>
+
+//! INTERNAL FUNCTIONS
+
+#define HIGH(value) ((uint16_t)((value) >> 16))
+#define LOW(value) ((uint16_t)((value) & 0xFFFF))
+
+/**
+ * @brief Searches the container with key `key`.
+ *
+ * @param found Set to 1 if the container exists, 0 otherwise.
+ * @return The position of the container, or the position where it should be inserted.
+ */
+uint32_t container_position(const struct compressed_bitmap *object, uint16_t key, int *found)
+{
+    uint32_t low = 0, high = object->cb_size;
+
+    // fast path for the insertions in increasing order
+    if (high > 0 && object->cb_containers[high - 1].cb_key < key)
+    {
+        *found = 0;
+        return high;
+    }
+
+    while (low < high)
+    {
+        uint32_t middle = low + (high - low) / 2;
+        if (object->cb_containers[middle].cb_key < key)
+            low = middle + 1;
+        else
+            high = middle;
+    }
+
+    *found = (low < object->cb_size && object->cb_containers[low].cb_key == key);
+    return low;
+}
+
+/**
+ * @brief Inserts an empty array container with key `key` at position `position`.
+ *
+ * @return Pointer to the new container, NULL if malloc fails.
+ */
+struct cb_container *insert_container(struct compressed_bitmap *object, uint32_t position, uint16_t key)
+{
+    if (object->cb_size == object->cb_capacity)
+    {
+        uint32_t newCapacity = object->cb_capacity ? object->cb_capacity * 2 : 4;
+        struct cb_container *newContainers = (struct cb_container *)realloc(object->cb_containers, newCapacity * sizeof(struct cb_container));
+        if (!newContainers)
+            return NULL;
+        object->cb_containers = newContainers;
+        object->cb_capacity = newCapacity;
+    }
+
+    struct cb_container *container = object->cb_containers + position;
+    memmove(container + 1, container, (object->cb_size - position) * sizeof(struct cb_container));
+    *container = (struct cb_container){.cb_key = key, .cb_type = CB_ARRAY};
+    object->cb_size++;
+
+    return container;
+}
+
+void remove_container(struct compressed_bitmap *object, uint32_t position)
+{
+    free(object->cb_containers[position].cb_data);
+    memmove(object->cb_containers + position, object->cb_containers + position + 1,
+            (object->cb_size - position - 1) * sizeof(struct cb_container));
+    object->cb_size--;
+}
+
+/**
+ * @brief Converts an array container in a bitmap container.
+ * @return SUCCESS on success, FAILURE if malloc fails (the container is left unchanged).
+ */
+int array_to_bitmap(struct cb_container *container)
+{
+    uint64_t *words = (uint64_t *)calloc(CB_BITMAP_WORDS, sizeof(uint64_t));
+    if (!words)
+        return FAILURE;
+
+    uint16_t *array = (uint16_t *)container->cb_data;
+    for (uint32_t i = 0; i < container->cb_cardinality; i++)
+        words[array[i] >> 6] |= 1ULL << (array[i] & 63);
+
+    free(container->cb_data);
+    container->cb_data = words;
+    container->cb_type = CB_BITMAP;
+    container->cb_capacity = 0;
+
+    return SUCCESS;
+}
+
+/**
+ * @brief Converts a bitmap container in an array container, `cb_cardinality` must be already up to date.
+ * @return SUCCESS on success, FAILURE if malloc fails (the container is left unchanged).
+ */
+int bitmap_to_array(struct cb_container *container)
+{
+    uint16_t *array = (uint16_t *)malloc((container->cb_cardinality ? container->cb_cardinality : 1) * sizeof(uint16_t));
+    if (!array)
+        return FAILURE;
+
+    uint64_t *words = (uint64_t *)container->cb_data;
+    uint32_t inserted = 0;
+    for (uint32_t i = 0; i < CB_BITMAP_WORDS; i++)
+    {
+        for (uint64_t word = words[i]; word; word &= word - 1)
+            array[inserted++] = (uint16_t)(i * 64 + __builtin_ctzll(word));
+    }
+
+    free(container->cb_data);
+    container->cb_data = array;
+    container->cb_type = CB_ARRAY;
+    container->cb_capacity = container->cb_cardinality ? container->cb_cardinality : 1;
+
+    return SUCCESS;
+}
+
+/**
+ * @brief Makes a bitmap container an array container if it is small enough.
+ * @return SUCCESS on success, FAILURE if malloc fails.
+ */
+int shrink_container(struct cb_container *container)
+{
+    if (container->cb_type == CB_BITMAP && container->cb_cardinality <= CB_ARRAY_MAX)
+        return bitmap_to_array(container);
+    return SUCCESS;
+}
+
+int container_add(struct cb_container *container, uint16_t low)
+{
+    if (container->cb_type == CB_BITMAP)
+    {
+        uint64_t *words = (uint64_t *)container->cb_data, bit = 1ULL << (low & 63);
+        if (!(words[low >> 6] & bit))
+        {
+            words[low >> 6] |= bit;
+            container->cb_cardinality++;
+        }
+        return SUCCESS;
+    }
+
+    uint16_t *array = (uint16_t *)container->cb_data;
+    uint32_t position = container->cb_cardinality;
+
+    // fast path for the insertions in increasing order, otherwise binary search
+    if (position > 0 && array[position - 1] >= low)
+    {
+        uint32_t start = 0, end = container->cb_cardinality;
+        while (start < end)
+        {
+            uint32_t middle = start + (end - start) / 2;
+            if (array[middle] < low)
+                start = middle + 1;
+            else
+                end = middle;
+        }
+        if (array[start] == low)
+            return SUCCESS;
+        position = start;
+    }
+
+    if (container->cb_cardinality == CB_ARRAY_MAX)
+    {
+        if (array_to_bitmap(container) == FAILURE)
+            return FAILURE;
+        return container_add(container, low);
+    }
+
+    if (container->cb_cardinality == container->cb_capacity)
+    {
+        uint32_t newCapacity = container->cb_capacity ? container->cb_capacity * 2 : 4;
+        if (newCapacity > CB_ARRAY_MAX)
+            newCapacity = CB_ARRAY_MAX;
+        array = (uint16_t *)realloc(container->cb_data, newCapacity * sizeof(uint16_t));
+        if (!array)
+            return FAILURE;
+        container->cb_data = array;
+        container->cb_capacity = newCapacity;
+    }
+
+    memmove(array + position + 1, array + position, (container->cb_cardinality - position) * sizeof(uint16_t));
+    array[position] = low;
+    container->cb_cardinality++;
+
+    return SUCCESS;
+}
+
+int bitmap_contains(const uint64_t *words, uint16_t low)
+{
+    return (words[low >> 6] >> (low & 63)) & 1;
+}
+
+int container_contains(const struct cb_container *container, uint16_t low)
+{
+    if (container->cb_type == CB_BITMAP)
+        return bitmap_contains((const uint64_t *)container->cb_data, low);
+
+    const uint16_t *array = (const uint16_t *)container->cb_data;
+    uint32_t start = 0, end = container->cb_cardinality;
+    while (start < end)
+    {
+        uint32_t middle = start + (end - start) / 2;
+        if (array[middle] < low)
+            start = middle + 1;
+        else
+            end = middle;
+    }
+    return start < container->cb_cardinality && array[start] == low;
+}
+
+/**
+ * @brief Keeps in `container` only the values that are also in `other`.
+ * @return SUCCESS on success, FAILURE if malloc fails.
+ */
+int container_and(struct cb_container *container, const struct cb_container *other)
+{
+    if (container->cb_type == CB_BITMAP && other->cb_type == CB_BITMAP)
+    {
+        uint64_t *words = (uint64_t *)container->cb_data;
+        const uint64_t *otherWords = (const uint64_t *)other->cb_data;
+        uint32_t cardinality = 0;
+
+        // word-wide loop without branches, the compiler can vectorize it
+        for (uint32_t i = 0; i < CB_BITMAP_WORDS; i++)
+        {
+            words[i] &= otherWords[i];
+            cardinality += __builtin_popcountll(words[i]);
+        }
+        container->cb_cardinality = cardinality;
+        return shrink_container(container);
+    }
+
+    if (container->cb_type == CB_BITMAP)
+    {
+        // the result is at most as big as the array of `other`
+        uint16_t *array = (uint16_t *)malloc((other->cb_cardinality ? other->cb_cardinality : 1) * sizeof(uint16_t));
+        if (!array)
+            return FAILURE;
+
+        const uint16_t *otherArray = (const uint16_t *)other->cb_data;
+        uint32_t inserted = 0;
+        for (uint32_t i = 0; i < other->cb_cardinality; i++)
+        {
+            if (bitmap_contains((const uint64_t *)container->cb_data, otherArray[i]))
+                array[inserted++] = otherArray[i];
+        }
+
+        free(container->cb_data);
+        *container = (struct cb_container){.cb_key = container->cb_key, .cb_type = CB_ARRAY, .cb_cardinality = inserted,
+                                           .cb_capacity = other->cb_cardinality ? other->cb_cardinality : 1, .cb_data = array};
+        return SUCCESS;
+    }
+
+    uint16_t *array = (uint16_t *)container->cb_data;
+    uint32_t inserted = 0;
+
+    if (other->cb_type == CB_BITMAP)
+    {
+        for (uint32_t i = 0; i < container->cb_cardinality; i++)
+        {
+            if (bitmap_contains((const uint64_t *)other->cb_data, array[i]))
+                array[inserted++] = array[i];
+        }
+    }
+    else
+    {
+        const uint16_t *otherArray = (const uint16_t *)other->cb_data;
+        uint32_t i = 0, j = 0;
+        while (i < container->cb_cardinality && j < other->cb_cardinality)
+        {
+            if (array[i] < otherArray[j])
+                i++;
+            else if (array[i] > otherArray[j])
+                j++;
+            else
+            {
+                array[inserted++] = array[i];
+                i++;
+                j++;
+            }
+        }
+    }
+
+    container->cb_cardinality = inserted;
+    return SUCCESS;
+}
+
+/**
+ * @brief Adds to `container` all the values of `other`.
+ * @return SUCCESS on success, FAILURE if malloc fails.
+ */
+int container_or(struct cb_container *container, const struct cb_container *other)
+{
+    if (container->cb_type == CB_ARRAY && other->cb_type == CB_ARRAY &&
+        container->cb_cardinality + other->cb_cardinality <= CB_ARRAY_MAX)
+    {
+        uint32_t total = container->cb_cardinality + other->cb_cardinality;
+        uint16_t *array = (uint16_t *)malloc((total ? total : 1) * sizeof(uint16_t));
+        if (!array)
+            return FAILURE;
+
+        const uint16_t *first = (const uint16_t *)container->cb_data, *second = (const uint16_t *)other->cb_data;
+        uint32_t i = 0, j = 0, inserted = 0;
+        while (i < container->cb_cardinality || j < other->cb_cardinality)
+        {
+            if (j == other->cb_cardinality || (i < container->cb_cardinality && first[i] < second[j]))
+                array[inserted++] = first[i++];
+            else if (i == container->cb_cardinality || second[j] < first[i])
+                array[inserted++] = second[j++];
+            else
+            {
+                array[inserted++] = first[i++];
+                j++;
+            }
+        }
+
+        free(container->cb_data);
+        container->cb_data = array;
+        container->cb_cardinality = inserted;
+        container->cb_capacity = total ? total : 1;
+        return SUCCESS;
+    }
+
+    if (container->cb_type == CB_ARRAY && array_to_bitmap(container) == FAILURE)
+        return FAILURE;
+
+    uint64_t *words = (uint64_t *)container->cb_data;
+    uint32_t cardinality = 0;
+
+    if (other->cb_type == CB_BITMAP)
+    {
+        const uint64_t *otherWords = (const uint64_t *)other->cb_data;
+        for (uint32_t i = 0; i < CB_BITMAP_WORDS; i++)
+        {
+            words[i] |= otherWords[i];
+            cardinality += __builtin_popcountll(words[i]);
+        }
+        container->cb_cardinality = cardinality;
+        return SUCCESS;
+    }
+
+    const uint16_t *otherArray = (const uint16_t *)other->cb_data;
+    for (uint32_t i = 0; i < other->cb_cardinality; i++)
+    {
+        uint64_t bit = 1ULL << (otherArray[i] & 63);
+        if (!(words[otherArray[i] >> 6] & bit))
+        {
+            words[otherArray[i] >> 6] |= bit;
+            container->cb_cardinality++;
+        }
+    }
+    return SUCCESS;
+}
+
+int copy_container(struct cb_container *destination, const struct cb_container *source)
+{
+    size_t bytes = (source->cb_type == CB_BITMAP) ? CB_BITMAP_WORDS * sizeof(uint64_t)
+                                                  : (source->cb_cardinality ? source->cb_cardinality : 1) * sizeof(uint16_t);
+
+    *destination = *source;
+    destination->cb_data = malloc(bytes);
+    if (!(destination->cb_data))
+        return FAILURE;
+
+    memcpy(destination->cb_data, source->cb_data, bytes);
+    if (source->cb_type == CB_ARRAY)
+        destination->cb_capacity = source->cb_cardinality ? source->cb_cardinality : 1;
+
+    return SUCCESS;
+}
+
+//! PUBLIC FUNCTIONS
+
+struct compressed_bitmap cb_create(void)
+{
+    return (struct compressed_bitmap){NULL, 0, 0};
+}
+
+int cb_add(struct compressed_bitmap *object, uint32_t value)
+{
+    int found;
+    uint32_t position = container_position(object, HIGH(value), &found);
+    struct cb_container *container = object->cb_containers + position;
+
+    if (!found)
+    {
+        if (!(container = insert_container(object, position, HIGH(value))))
+            return FAILURE;
+        if (container_add(container, LOW(value)) == FAILURE)
+        {
+            remove_container(object, position);
+            return FAILURE;
+        }
+        return SUCCESS;
+    }
+
+    return container_add(container, LOW(value));
+}
+
+int cb_contains(const struct compressed_bitmap *object, uint32_t value)
+{
+    int found;
+    uint32_t position = container_position(object, HIGH(value), &found);
+
+    return found && container_contains(object->cb_containers + position, LOW(value));
+}
+
+uint64_t cb_cardinality(const struct compressed_bitmap *object)
+{
+    uint64_t cardinality = 0;
+    for (uint32_t i = 0; i < object->cb_size; i++)
+        cardinality += object->cb_containers[i].cb_cardinality;
+    return cardinality;
+}
+
+int cb_andInPlace(struct compressed_bitmap *object, const struct compressed_bitmap *other)
+{
+    int result = SUCCESS;
+    uint32_t kept = 0, j = 0;
+
+    for (uint32_t i = 0; i < object->cb_size; i++)
+    {
+        struct cb_container *container = object->cb_containers + i;
+
+        while (j < other->cb_size && other->cb_containers[j].cb_key < container->cb_key)
+            j++;
+
+        if (j < other->cb_size && other->cb_containers[j].cb_key == container->cb_key)
+        {
+            if (container_and(container, other->cb_containers + j) == FAILURE)
+                result = FAILURE;
+            else if (container->cb_cardinality > 0)
+            {
+                object->cb_containers[kept++] = *container;
+                continue;
+            }
+        }
+
+        // the container is empty, or it is dropped to keep the bitmap valid after a failure
+        free(container->cb_data);
+    }
+
+    object->cb_size = kept;
+    return result;
+}
+
+int cb_orInPlace(struct compressed_bitmap *object, const struct compressed_bitmap *other)
+{
+    for (uint32_t j = 0; j < other->cb_size; j++)
+    {
+        int found;
+        const struct cb_container *otherContainer = other->cb_containers + j;
+        uint32_t position = container_position(object, otherContainer->cb_key, &found);
+
+        if (found)
+        {
+            if (container_or(object->cb_containers + position, otherContainer) == FAILURE)
+                return FAILURE;
+            continue;
+        }
+
+        struct cb_container *container = insert_container(object, position, otherContainer->cb_key);
+        if (!container)
+            return FAILURE;
+        if (copy_container(container, otherContainer) == FAILURE)
+        {
+            container->cb_data = NULL;
+            remove_container(object, position);
+            return FAILURE;
+        }
+    }
+
+    return SUCCESS;
+}
+
+int cb_copy(struct compressed_bitmap *destination, const struct compressed_bitmap *source)
+{
+    *destination = cb_create();
+    if (source->cb_size == 0)
+        return SUCCESS;
+
+    destination->cb_containers = (struct cb_container *)malloc(source->cb_size * sizeof(struct cb_container));
+    if (!(destination->cb_containers))
+        return FAILURE;
+    destination->cb_capacity = source->cb_size;
+
+    for (uint32_t i = 0; i < source->cb_size; i++)
+    {
+        if (copy_container(destination->cb_containers + i, source->cb_containers + i) == FAILURE)
+        {
+            cb_destroy(destination);
+            return FAILURE;
+        }
+        destination->cb_size++;
+    }
+
+    return SUCCESS;
+}
+
+size_t cb_toArray(const struct compressed_bitmap *object, uint32_t *buffer)
+{
+    size_t written = 0;
+
+    for (uint32_t i = 0; i < object->cb_size; i++)
+    {
+        const struct cb_container *container = object->cb_containers + i;
+        uint32_t high = (uint32_t)container->cb_key << 16;
+
+        if (container->cb_type == CB_ARRAY)
+        {
+            const uint16_t *array = (const uint16_t *)container->cb_data;
+            for (uint32_t j = 0; j < container->cb_cardinality; j++)
+                buffer[written++] = high | array[j];
+            continue;
+        }
+
+        const uint64_t *words = (const uint64_t *)container->cb_data;
+        for (uint32_t j = 0; j < CB_BITMAP_WORDS; j++)
+        {
+            for (uint64_t word = words[j]; word; word &= word - 1)
+                buffer[written++] = high | (j * 64 + __builtin_ctzll(word));
+        }
+    }
+
+    return written;
+}
+
+size_t cb_sizeInBytes(const struct compressed_bitmap *object)
+{
+    size_t bytes = object->cb_capacity * sizeof(struct cb_container);
+
+    for (uint32_t i = 0; i < object->cb_size; i++)
+    {
+        const struct cb_container *container = object->cb_containers + i;
+        bytes += (container->cb_type == CB_BITMAP) ? CB_BITMAP_WORDS * sizeof(uint64_t) : container->cb_capacity * sizeof(uint16_t);
+    }
+
+    return bytes;
+}
+
+// header of a container in the serialized format
+#define SERIALIZED_HEADER (2 * sizeof(uint16_t) + sizeof(uint32_t))
+
+/**
+ * @return The number of bytes of the data of `container`, both in memory and in the serialized format.
+ */
+size_t container_bytes(uint16_t type, uint32_t cardinality)
+{
+    return (type == CB_BITMAP) ? CB_BITMAP_WORDS * sizeof(uint64_t) : cardinality * sizeof(uint16_t);
+}
+
+size_t cb_serializedSize(const struct compressed_bitmap *object)
+{
+    size_t bytes = sizeof(uint32_t) + object->cb_size * SERIALIZED_HEADER;
+
+    for (uint32_t i = 0; i < object->cb_size; i++)
+        bytes += container_bytes(object->cb_containers[i].cb_type, object->cb_containers[i].cb_cardinality);
+
+    return bytes;
+}
+
+size_t cb_serialize(const struct compressed_bitmap *object, void *buffer)
+{
+    char *position = (char *)buffer;
+
+    memcpy(position, &(object->cb_size), sizeof(uint32_t));
+    position += sizeof(uint32_t);
+
+    for (uint32_t i = 0; i < object->cb_size; i++)
+    {
+        const struct cb_container *container = object->cb_containers + i;
+        memcpy(position, &(container->cb_key), sizeof(uint16_t));
+        memcpy(position + sizeof(uint16_t), &(container->cb_type), sizeof(uint16_t));
+        memcpy(position + 2 * sizeof(uint16_t), &(container->cb_cardinality), sizeof(uint32_t));
+        position += SERIALIZED_HEADER;
+    }
+
+    for (uint32_t i = 0; i < object->cb_size; i++)
+    {
+        const struct cb_container *container = object->cb_containers + i;
+        size_t bytes = container_bytes(container->cb_type, container->cb_cardinality);
+        memcpy(position, container->cb_data, bytes);
+        position += bytes;
+    }
+
+    return position - (char *)buffer;
+}
+
+/**
+ * @return 1 if the data of `container` is consistent with its header and all its values are below `limit`, 0 otherwise.
+ */
+int container_valid(const struct cb_container *container, uint64_t limit)
+{
+    uint64_t high = (uint64_t)container->cb_key << 16;
+
+    if (container->cb_type == CB_ARRAY)
+    {
+        const uint16_t *array = (const uint16_t *)container->cb_data;
+        for (uint32_t i = 1; i < container->cb_cardinality; i++)
+            if (array[i] <= array[i - 1])
+                return 0;
+        return high + array[container->cb_cardinality - 1] < limit;
+    }
+
+    const uint64_t *words = (const uint64_t *)container->cb_data;
+    uint32_t cardinality = 0;
+    int last = -1; // index of the last non empty word
+    for (int i = 0; i < CB_BITMAP_WORDS; i++)
+    {
+        cardinality += __builtin_popcountll(words[i]);
+        if (words[i])
+            last = i;
+    }
+    if (cardinality != container->cb_cardinality || last == -1)
+        return 0;
+    return high + (uint64_t)last * 64 + (63 - __builtin_clzll(words[last])) < limit;
+}
+
+int cb_deserialize(struct compressed_bitmap *object, const void *buffer, size_t size, uint64_t limit)
+{
+    const char *position = (const char *)buffer, *end = position + size;
+    uint32_t containers;
+
+    *object = cb_create();
+    if (size < sizeof(uint32_t))
+        return FAILURE;
+
+    memcpy(&containers, position, sizeof(uint32_t));
+    position += sizeof(uint32_t);
+    if (containers > (size - sizeof(uint32_t)) / SERIALIZED_HEADER)
+        return FAILURE;
+    if (containers == 0)
+        return SUCCESS;
+
+    object->cb_containers = (struct cb_container *)malloc(containers * sizeof(struct cb_container));
+    if (!(object->cb_containers))
+        return FAILURE;
+    object->cb_capacity = containers;
+
+    const char *data = position + containers * SERIALIZED_HEADER;
+
+    for (uint32_t i = 0; i < containers; i++, position += SERIALIZED_HEADER)
+    {
+        struct cb_container container = {0};
+        memcpy(&(container.cb_key), position, sizeof(uint16_t));
+        memcpy(&(container.cb_type), position + sizeof(uint16_t), sizeof(uint16_t));
+        memcpy(&(container.cb_cardinality), position + 2 * sizeof(uint16_t), sizeof(uint32_t));
+
+        size_t bytes = container_bytes(container.cb_type, container.cb_cardinality);
+        if ((container.cb_type != CB_ARRAY && container.cb_type != CB_BITMAP) ||
+            (container.cb_type == CB_ARRAY && (container.cb_cardinality == 0 || container.cb_cardinality > CB_ARRAY_MAX)) ||
+            (i > 0 && container.cb_key <= object->cb_containers[i - 1].cb_key) ||
+            (size_t)(end - data) < bytes || !(container.cb_data = malloc(bytes)))
+        {
+            cb_destroy(object);
+            return FAILURE;
+        }
+
+        memcpy(container.cb_data, data, bytes);
+        data += bytes;
+        if (container.cb_type == CB_ARRAY)
+            container.cb_capacity = container.cb_cardinality;
+
+        if (!container_valid(&container, limit))
+        {
+            free(container.cb_data);
+            cb_destroy(object);
+            return FAILURE;
+        }
+
+        object->cb_containers[object->cb_size++] = container;
+    }
+
+    return SUCCESS;
+}
+
+void cb_destroy(struct compressed_bitmap *object)
+{
+    for (uint32_t i = 0; i < object->cb_size; i++)
+        free(object->cb_containers[i].cb_data);
+    free(object->cb_containers);
+    *object = cb_create();
+}
@@ -0,0 +1,259 @@
+#include "../../include/my_lib/hash_table.h"
+#include <stdlib.h>
+#include <string.h>
+
+//! INTERNAL FUNCTIONS
+
+#ifndef OCCUPIED
+#define OCCUPIED 1
+#endif
+
+#ifndef EMPTY
+#define EMPTY 0
+#endif
+
+// the table grows when ht_inserted / ht_capacity would exceed LOAD_FACTOR_NUM / LOAD_FACTOR_DEN
+#define LOAD_FACTOR_NUM 7
+#define LOAD_FACTOR_DEN 10
+
+/**
+ * @return Pointer to the slot at position `index`.
+ */
+void *slot_at(struct hash_table *object, size_t index)
+{
+    return (char *)object->ht_slots + index * object->ht_elementSize;
+}
+
+/**
+ * @return The smallest power of 2 that can hold `capacity` elements without exceeding the load factor.
+ */
+size_t capacity_for(size_t capacity)
+{
+    size_t result = 8;
+    while (result * LOAD_FACTOR_NUM < capacity * LOAD_FACTOR_DEN)
+        result <<= 1;
+    return result;
+}
+
+/**
+ * @brief Finds the slot of the element with the same key of `element`, or the empty slot where it would go.
+ *
+ * @param found Set to 1 if the returned slot holds an element with the same key, 0 if it is empty.
+ * @return The index of the slot.
+ * @note The table must have at least one empty slot, which is guaranteed by the load factor.
+ */
+size_t find_slot(struct hash_table *object, const void *element, int *found)
+{
+    size_t mask = object->ht_capacity - 1,
+           index = object->ht_hashFunction(element) & mask;
+
+    while (object->ht_occupied[index] == OCCUPIED)
+    {
+        if (object->ht_compareFunction(element, slot_at(object, index)) == 0)
+        {
+            *found = 1;
+            return index;
+        }
+        index = (index + 1) & mask;
+    }
+
+    *found = 0;
+    return index;
+}
+
+/**
+ * @brief Moves all the elements in new arrays of `newCapacity` slots.
+ *
+ * @return SUCCESS on success, FAILURE if malloc fails (the table is left unchanged).
+ */
+int rehash(struct hash_table *object, size_t newCapacity)
+{
+    struct hash_table newTable = *object;
+    int found;
+
+    newTable.ht_capacity = newCapacity;
+    newTable.ht_slots = malloc(newCapacity * object->ht_elementSize);
+    newTable.ht_occupied = (unsigned char *)calloc(newCapacity, sizeof(unsigned char));
+    if (!newTable.ht_slots || !newTable.ht_occupied)
+    {
+        free(newTable.ht_slots);
+        free(newTable.ht_occupied);
+        return FAILURE;
+    }
+
+    for (size_t i = 0; i < object->ht_capacity; i++)
+    {
+        if (object->ht_occupied[i] == EMPTY)
+            continue;
+
+        size_t index = find_slot(&newTable, slot_at(object, i), &found);
+        memcpy(slot_at(&newTable, index), slot_at(object, i), object->ht_elementSize);
+        newTable.ht_occupied[index] = OCCUPIED;
+    }
+
+    free(object->ht_slots);
+    free(object->ht_occupied);
+    *object = newTable;
+
+    return SUCCESS;
+}
+
+//! PUBLIC FUNCTIONS
+
+struct hash_table ht_create(size_t elementSize, size_t capacity, uint64_t (*hash_function)(const void *), int (*compare_function)(const void *, const void *))
+{
+    struct hash_table result = {
+        .ht_inserted = 0,
+        .ht_capacity = capacity_for(capacity),
+        .ht_elementSize = elementSize,
+        .ht_hashFunction = hash_function,
+        .ht_compareFunction = compare_function};
+
+    result.ht_slots = malloc(result.ht_capacity * elementSize);
+    result.ht_occupied = (unsigned char *)calloc(result.ht_capacity, sizeof(unsigned char));
+
+    if (!result.ht_slots || !result.ht_occupied)
+    {
+        free(result.ht_slots);
+        free(result.ht_occupied);
+        result.ht_slots = NULL;
+        result.ht_occupied = NULL;
+    }
+
+    return result;
+}
+
+void *ht_search(struct hash_table *object, const void *element)
+{
+    int found;
+    size_t index = find_slot(object, element, &found);
+
+    return found ? slot_at(object, index) : NULL;
+}
+
+void *ht_insert(struct hash_table *object, const void *element)
+{
+    int found;
+    size_t index = find_slot(object, element, &found);
+
+    if (found)
+        return slot_at(object, index);
+
+    if ((object->ht_inserted + 1) * LOAD_FACTOR_DEN > object->ht_capacity * LOAD_FACTOR_NUM)
+    {
+        if (rehash(object, object->ht_capacity * 2) == FAILURE)
+            return NULL;
+        index = find_slot(object, element, &found);
+    }
+
+    memcpy(slot_at(object, index), element, object->ht_elementSize);
+    object->ht_occupied[index] = OCCUPIED;
+    object->ht_inserted++;
+
+    return slot_at(object, index);
+}
+
+int ht_delete(struct hash_table *object, const void *element)
+{
+    int found;
+    size_t mask = object->ht_capacity - 1,
+           hole = find_slot(object, element, &found),
+           next = hole;
+
+    if (!found)
+        return FAILURE;
+
+    // backward shift: the elements after the hole that would not be found anymore are moved back into it
+    while (1)
+    {
+        next = (next + 1) & mask;
+        if (object->ht_occupied[next] == EMPTY)
+            break;
+
+        size_t ideal = object->ht_hashFunction(slot_at(object, next)) & mask;
+
+        // the element can stay where it is if its ideal slot is cyclically in (hole, next]
+        if ((hole <= next) ? (hole < ideal && ideal <= next) : (hole < ideal || ideal <= next))
+            continue;
+
+        memcpy(slot_at(object, hole), slot_at(object, next), object->ht_elementSize);
+        hole = next;
+    }
+
+    object->ht_occupied[hole] = EMPTY;
+    object->ht_inserted--;
+
+    return SUCCESS;
+}
+
+void ht_visit(struct hash_table *object, void (*visitElement)(void *))
+{
+    for (size_t i = 0; i < object->ht_capacity; i++)
+    {
+        if (object->ht_occupied[i] == OCCUPIED)
+            visitElement(slot_at(object, i));
+    }
+}
+
+void *ht_next(struct hash_table *object, size_t *position)
+{
+    while (*position < object->ht_capacity)
+    {
+        size_t index = (*position)++;
+        if (object->ht_occupied[index] == OCCUPIED)
+            return slot_at(object, index);
+    }
+    return NULL;
+}
+
+void ht_destroy(struct hash_table *object)
+{
+    if (object->ht_slots)
+    {
+        free(object->ht_slots);
+        object->ht_slots = NULL;
+    }
+    if (object->ht_occupied)
+    {
+        free(object->ht_occupied);
+        object->ht_occupied = NULL;
+    }
+    object->ht_inserted = object->ht_capacity = 0;
+}
+
+uint64_t ht_hashBytes(const void *data, size_t length)
+{
+    const unsigned char *bytes = (const unsigned char *)data;
+    uint64_t hash = 14695981039346656037ULL;
+
+    for (size_t i = 0; i < length; i++)
+    {
+        hash ^= bytes[i];
+        hash *= 1099511628211ULL;
+    }
+
+    return hash;
+}
+
+uint64_t ht_hashString(const char *string)
+{
+    uint64_t hash = 14695981039346656037ULL;
+
+    for (; *string; string++)
+    {
+        hash ^= (unsigned char)*string;
+        hash *= 1099511628211ULL;
+    }
+
+    return hash;
+}
+
+uint64_t ht_hashInteger(uint64_t key)
+{
+    key ^= key >> 33;
+    key *= 0xff51afd7ed558ccdULL;
+    key ^= key >> 33;
+    key *= 0xc4ceb9fe1a85ec53ULL;
+    key ^= key >> 33;
+    return key;
+}
@@ -5,29 +5,26 @@
 //! FUNZIONI PRIVATE
 
 /**
- * @brief Confronta due elementi `valoreLibro`, considerando uguali se uno contiene l'altro.
+ * @brief Ordina due elementi `valoreLibro` per `valoreCampo`, con strcmp.
  *
- * Confronta le stringhe `valoreCampo` di due elementi `valoreLibro`. Se `elemento2` contiene `elemento1`,
- * considera i due elementi uguali, altrimenti usa strcmp per il confronto diretto.
+ * Usata come funzione di confronto degli alberi dei valori: è un ordinamento totale, quindi le rotazioni
+ * dell'albero bilanciato non rompono la proprietà di albero di ricerca.
  *
- * @return int 0 se `elemento2` contiene `elemento1`, altrimenti il risultato di strcmp.
+ * @return int il risultato di strcmp tra i due `valoreCampo`.
  */
-int valoreLibro_confronta(const void *elemento1, const void *elemento2)
+int valoreLibro_ordina(const void *elemento1, const void *elemento2)
 {
     const struct valoreLibro *elemento1Cast = (const struct valoreLibro *)elemento1;
     const struct valoreLibro *elemento2Cast = (const struct valoreLibro *)elemento2;
 
-    if (strstr(elemento2Cast->valoreCampo, elemento1Cast->valoreCampo))
-        return 0;
-
     return strcmp(elemento1Cast->valoreCampo, elemento2Cast->valoreCampo);
 }
 
 /**
  * @brief Libera un elemento `valoreLibro`.
  *
- * Questa è una funzione privata che libera la memoria allocata per la stringa `valoreCampo` di un elemento `valoreLibro`.
- * Imposta anche i puntatori `valoreCampo` e `libroAssociato` a NULL.
+ * Questa è una funzione privata che libera la bitmap dei libri di un elemento `valoreLibro`. La stringa `valoreCampo`
+ * appartiene all'arena e viene liberata con essa; qui il puntatore viene solo impostato a NULL.
  */
 void valoreLibro_free(const void *elemento)
 {
@@ -36,13 +33,282 @@ void valoreLibro_free(const void *elemento)
 
     struct valoreLibro *elementoCast = (struct valoreLibro *)elemento;
 
-    free(elementoCast->valoreCampo);
     elementoCast->valoreCampo = NULL;
-    elementoCast->libroAssociato = NULL;
+    cb_destroy(&(elementoCast->libriAssociati));
+}
+
+//* DIRETTORIO DEI CAMPI
+
+uint64_t voceDirettorio_hash(const void *elemento)
+{
+    return ht_hashString(((const struct voceDirettorio *)elemento)->nomeCampo);
+}
+
+int voceDirettorio_confronta(const void *elemento1, const void *elemento2)
+{
+    return strcmp(((const struct voceDirettorio *)elemento1)->nomeCampo, ((const struct voceDirettorio *)elemento2)->nomeCampo);
+}
+
+//* INDICE DEI TRIGRAMMI
+
+uint64_t trigrammaValori_hash(const void *elemento)
+{
+    return ht_hashInteger(((const struct trigrammaValori *)elemento)->trigramma);
+}
+
+int trigrammaValori_confronta(const void *elemento1, const void *elemento2)
+{
+    return ((const struct trigrammaValori *)elemento1)->trigramma != ((const struct trigrammaValori *)elemento2)->trigramma;
+}
+
+void trigrammaValori_free(void *elemento)
+{
+    da_destroy(&(((struct trigrammaValori *)elemento)->valori));
+}
+
+/**
+ * @return I primi `LUNGHEZZA_TRIGRAMMA` byte di `stringa` impacchettati in un intero.
+ * @warning `stringa` deve avere almeno `LUNGHEZZA_TRIGRAMMA` caratteri.
+ */
+uint32_t calcola_trigramma(const char *stringa)
+{
+    const unsigned char *byte = (const unsigned char *)stringa;
+    return ((uint32_t)byte[0] << 16) | ((uint32_t)byte[1] << 8) | (uint32_t)byte[2];
 }
 
 /**
- * @brief Libera un elemento `campoAlbero` e il suo albero binario associato.
+ * @brief Aggiunge un valore appena inserito nell'albero all'indice dei trigrammi del suo campo.
+ *
+ * @return int SUCCESS se l'operazione è riuscita, ERR_SYSTEM_CALL in caso di errore.
+ */
+int indicizza_trigrammi(struct campoAlbero *campo, struct valoreLibro *valore)
+{
+    size_t lunghezza = strlen(valore->valoreCampo);
+
+    for (size_t i = 0; i + LUNGHEZZA_TRIGRAMMA <= lunghezza; i++)
+    {
+        struct trigrammaValori cercato = {.trigramma = calcola_trigramma(valore->valoreCampo + i)},
+                               *trovato = (struct trigrammaValori *)ht_search(&(campo->indiceTrigrammi), &cercato);
+
+        if (!trovato)
+        {
+            cercato.valori = da_create(sizeof(struct valoreLibro *), 1);
+            if (!(cercato.valori.da_ptrArray) || !(trovato = (struct trigrammaValori *)ht_insert(&(campo->indiceTrigrammi), &cercato)))
+            {
+                da_destroy(&(cercato.valori));
+                printf("Errore nell'inserimento di un trigramma nell'indice\n");
+                return ERR_SYSTEM_CALL;
+            }
+        }
+
+        // un valore con lo stesso trigramma ripetuto va indicizzato una sola volta
+        if (trovato->valori.da_inserted > 0 && *(struct valoreLibro **)da_at(&(trovato->valori), trovato->valori.da_inserted - 1) == valore)
+            continue;
+
+        if (da_append(&(trovato->valori), &valore) == FAILURE)
+        {
+            printf("Errore nell'append alla lista di un trigramma\n");
+            return ERR_SYSTEM_CALL;
+        }
+    }
+
+    return SUCCESS;
+}
+
+/**
+ * @brief Aggiunge a `risultati` tutti i valori del sottoalbero che contengono `cercato`.
+ *
+ * Usata per i valori cercati più corti di un trigramma, che l'indice non può risolvere.
+ *
+ * @return int SUCCESS se l'operazione è riuscita, ERR_SYSTEM_CALL in caso di errore.
+ */
+int visita_valori_contenenti(struct binary_tree_node *nodo, const char *cercato, struct dynamic_array *risultati)
+{
+    if (!nodo)
+        return SUCCESS;
+
+    struct valoreLibro *valore = (struct valoreLibro *)nodo->bt_node_element;
+
+    if (visita_valori_contenenti(nodo->bt_node_left, cercato, risultati) == ERR_SYSTEM_CALL ||
+        (strstr(valore->valoreCampo, cercato) && da_append(risultati, &valore) == FAILURE))
+        return ERR_SYSTEM_CALL;
+
+    return visita_valori_contenenti(nodo->bt_node_right, cercato, risultati);
+}
+
+/**
+ * @brief Trova tutti i valori di un campo che contengono `cercato`.
+ *
+ * Se `cercato` è lungo almeno un trigramma, un valore che lo contiene deve contenere anche tutti i suoi trigrammi:
+ * si prende quindi la lista più corta tra quelle dei trigrammi di `cercato` e si verificano con strstr solo quei valori.
+ * Se un trigramma non è nell'indice nessun valore può contenere `cercato`.
+ *
+ * @param risultati Array dinamico di `struct valoreLibro *` dove aggiungere i valori trovati.
+ * @return int SUCCESS se l'operazione è riuscita, ERR_SYSTEM_CALL in caso di errore.
+ */
+int cerca_valori(struct campoAlbero *campo, const char *cercato, struct dynamic_array *risultati)
+{
+    size_t lunghezza = strlen(cercato);
+
+    if (lunghezza < LUNGHEZZA_TRIGRAMMA)
+        return visita_valori_contenenti((campo->alberoValori).bt_root, cercato, risultati);
+
+    struct trigrammaValori *piuCorto = NULL;
+
+    for (size_t i = 0; i + LUNGHEZZA_TRIGRAMMA <= lunghezza; i++)
+    {
+        struct trigrammaValori chiave = {.trigramma = calcola_trigramma(cercato + i)},
+                               *trovato = (struct trigrammaValori *)ht_search(&(campo->indiceTrigrammi), &chiave);
+        if (!trovato)
+            return SUCCESS;
+
+        if (!piuCorto || trovato->valori.da_inserted < piuCorto->valori.da_inserted)
+            piuCorto = trovato;
+    }
+
+    for (int index = 0; index < piuCorto->valori.da_inserted; index++)
+    {
+        struct valoreLibro *candidato = *(struct valoreLibro **)da_at(&(piuCorto->valori), index);
+        if (strstr(candidato->valoreCampo, cercato) && da_append(risultati, &candidato) == FAILURE)
+            return ERR_SYSTEM_CALL;
+    }
+
+    return SUCCESS;
+}
+
+/**
+ * @brief Coppia campo:valore di una richiesta, con le informazioni usate per pianificarne la ricerca.
+ *
+ * @param campo, valore Puntano alla copia della richiesta, già separata da lib_estraiCoppia.
+ * @param idCampo Id del campo, con cui controllare la coppia sulle coppie dei libri.
+ * @param valori Array dinamico di `struct valoreLibro *` che contengono `valore`, calcolato solo se `stimaEsatta`.
+ * @param stima Somma dei libri dei valori trovati se `stimaEsatta`, altrimenti il numero di occorrenze del campo.
+ * @param operazione 'G' se la coppia guida la ricerca, 'I' se i suoi libri vengono intersecati con i candidati,
+ *                   'R' se viene controllata libro per libro.
+ */
+struct coppiaPiano
+{
+    char *campo, *valore;
+    int idCampo;
+    struct campoAlbero *campoAlbero;
+    struct dynamic_array valori;
+    size_t stima;
+    int stimaEsatta;
+    char operazione;
+};
+
+/**
+ * @brief Stima quanti libri soddisfano una coppia della richiesta.
+ *
+ * Se il valore cercato è lungo almeno un trigramma, trovare i valori che lo contengono costa poco: la stima è la somma
+ * delle cardinalità delle loro bitmap (esatta a meno di libri ripetuti tra più valori) e i valori vengono salvati
+ * nella coppia. Altrimenti servirebbe visitare tutto l'albero, quindi si usa il numero di occorrenze del campo, che è
+ * il caso peggiore.
+ *
+ * @return int SUCCESS se l'operazione è riuscita, ERR_SYSTEM_CALL in caso di errore.
+ */
+int stima_coppia(struct coppiaPiano *coppia)
+{
+    coppia->valori = da_create(sizeof(struct valoreLibro *), 10);
+    if (!(coppia->valori.da_ptrArray))
+        return ERR_SYSTEM_CALL;
+
+    if (strlen(coppia->valore) < LUNGHEZZA_TRIGRAMMA)
+    {
+        coppia->stima = coppia->campoAlbero->numeroOccorrenze;
+        return SUCCESS;
+    }
+
+    coppia->stimaEsatta = 1;
+    if (cerca_valori(coppia->campoAlbero, coppia->valore, &(coppia->valori)) == ERR_SYSTEM_CALL)
+        return ERR_SYSTEM_CALL;
+
+    for (int index = 0; index < coppia->valori.da_inserted; index++)
+        coppia->stima += cb_cardinality(&((*(struct valoreLibro **)da_at(&(coppia->valori), index))->libriAssociati));
+
+    return SUCCESS;
+}
+
+/**
+ * @brief Ordina le coppie per stima crescente; a parità di stima, quelle con la stima esatta vengono prima.
+ */
+int coppiaPiano_ordina(const void *elemento1, const void *elemento2)
+{
+    const struct coppiaPiano *coppia1 = (const struct coppiaPiano *)elemento1,
+                             *coppia2 = (const struct coppiaPiano *)elemento2;
+
+    if (coppia1->stima != coppia2->stima)
+        return (coppia1->stima < coppia2->stima) ? -1 : 1;
+    return coppia2->stimaEsatta - coppia1->stimaEsatta;
+}
+
+/**
+ * @brief Calcola in `libri` l'unione delle bitmap dei libri di tutti i valori della coppia.
+ *
+ * @param libri Bitmap non inizializzata.
+ * @return int SUCCESS se l'operazione è riuscita, ERR_SYSTEM_CALL in caso di errore.
+ */
+int unisci_libri(struct coppiaPiano *coppia, struct compressed_bitmap *libri)
+{
+    *libri = cb_create();
+
+    for (int index = 0; index < coppia->valori.da_inserted; index++)
+    {
+        struct valoreLibro *valore = *(struct valoreLibro **)da_at(&(coppia->valori), index);
+        if (cb_orInPlace(libri, &(valore->libriAssociati)) == FAILURE)
+        {
+            cb_destroy(libri);
+            return ERR_SYSTEM_CALL;
+        }
+    }
+
+    return SUCCESS;
+}
+
+/**
+ * @brief Lascia in `candidati` solo i libri che soddisfano anche `coppia`.
+ *
+ * Se la coppia ha un solo valore si interseca direttamente la sua bitmap, senza copiarla.
+ *
+ * @return int SUCCESS se l'operazione è riuscita, ERR_SYSTEM_CALL in caso di errore.
+ */
+int interseca_coppia(struct coppiaPiano *coppia, struct compressed_bitmap *candidati)
+{
+    if (coppia->valori.da_inserted == 1)
+    {
+        struct valoreLibro *valore = *(struct valoreLibro **)da_at(&(coppia->valori), 0);
+        return (cb_andInPlace(candidati, &(valore->libriAssociati)) == FAILURE) ? ERR_SYSTEM_CALL : SUCCESS;
+    }
+
+    struct compressed_bitmap libriCoppia;
+    if (unisci_libri(coppia, &libriCoppia) == ERR_SYSTEM_CALL)
+        return ERR_SYSTEM_CALL;
+
+    int risultato = (cb_andInPlace(candidati, &libriCoppia) == FAILURE) ? ERR_SYSTEM_CALL : SUCCESS;
+    cb_destroy(&libriCoppia);
+    return risultato;
+}
+
+#ifdef SPIEGA_PIANO
+/**
+ * @brief Stampa il piano scelto per una richiesta, in stile EXPLAIN.
+ */
+void spiega_piano(struct dynamic_array *coppie, size_t candidati)
+{
+    printf("PIANO (%zu coppie, %zu candidati prima dei controlli residui):\n", coppie->da_inserted, candidati);
+    for (int index = 0; index < coppie->da_inserted; index++)
+    {
+        struct coppiaPiano *coppia = (struct coppiaPiano *)da_at(coppie, index);
+        printf("  %c %s:%s; stima=%zu%s valori=%zu campo(valori=%d, occorrenze=%d)\n",
+               coppia->operazione ? coppia->operazione : '-', coppia->campo, coppia->valore, coppia->stima,
+               coppia->stimaEsatta ? "" : " (caso peggiore)", coppia->valori.da_inserted,
+               coppia->campoAlbero->numeroValori, coppia->campoAlbero->numeroOccorrenze);
+    }
+}
+#endif
+
+/**
+ * @brief Libera un elemento `campoAlbero`, il suo albero binario e il suo indice dei trigrammi.
  *
  * Questa funzione privata libera la memoria allocata per la stringa `nomeCampo` di un elemento `campoAlbero` e
  * libera ricorsivamente l'intero albero binario di elementi `valoreLibro` ad esso associato.
@@ -55,144 +321,636 @@ void campoAlbero_free(struct campoAlbero *elemento)
         elemento->nomeCampo = NULL;
         bt_visitInOrder(&(elemento->alberoValori), valoreLibro_free);
         bt_freeTree(&(elemento->alberoValori));
+        if ((elemento->indiceTrigrammi).ht_slots)
+        {
+            ht_visit(&(elemento->indiceTrigrammi), trigrammaValori_free);
+            ht_destroy(&(elemento->indiceTrigrammi));
+        }
+    }
+}
+
+/**
+ * @brief Crea un nuovo campo vuoto in fondo all'array e lo registra nel direttorio con il primo id libero.
+ *
+ * @param arena Arena da cui verranno allocati i nodi dell'albero dei valori del campo.
+ * @return int L'id del nuovo campo, o ID_CAMPO_ASSENTE in caso di errore.
+ */
+int crea_campo(struct dynamic_array *arrayCampi, struct hash_table *direttorioCampi, struct arena *arena, const char *campo)
+{
+    struct campoAlbero nuovoCampo = {.nomeCampo = strdup(campo),
+                                     .alberoValori = bt_createInArena(sizeof(struct valoreLibro), valoreLibro_ordina, arena),
+                                     .indiceTrigrammi = ht_create(sizeof(struct trigrammaValori), 16, trigrammaValori_hash, trigrammaValori_confronta)};
+    struct voceDirettorio nuovaVoce = {.nomeCampo = nuovoCampo.nomeCampo, .idCampo = arrayCampi->da_inserted};
+
+    if (!(nuovoCampo.nomeCampo) || !(nuovoCampo.indiceTrigrammi.ht_slots) || !ht_insert(direttorioCampi, &nuovaVoce))
+    {
+        printf("Errore nella creazione del nuovo campo o nella sua registrazione nel direttorio\n");
+        free(nuovoCampo.nomeCampo);
+        ht_destroy(&(nuovoCampo.indiceTrigrammi));
+        return ID_CAMPO_ASSENTE;
     }
+    if (da_append(arrayCampi, &nuovoCampo) == FAILURE)
+    {
+        printf("Errore nell'appending del nuovo campo all'array dinamico\n");
+        ht_delete(direttorioCampi, &nuovaVoce);
+        free(nuovoCampo.nomeCampo);
+        ht_destroy(&(nuovoCampo.indiceTrigrammi));
+        return ID_CAMPO_ASSENTE;
+    }
+
+    return nuovaVoce.idCampo;
 }
 
 /**
- * @brief Aggiunge una coppia chiave-valore all'array dinamico specificato di elementi `campoAlbero`.
+ * @brief Aggiunge una coppia chiave-valore di un libro all'array dinamico specificato di elementi `campoAlbero`.
  *
- * Questa funzione inserisce una nuova coppia chiave-valore nell'array dinamico. Se la chiave (campo) esiste già, aggiunge il valore all'albero binario
- * della chiave esistente. Se la chiave non esiste, crea un nuovo elemento `campoAlbero`, inizializza un albero binario per esso
- * e inserisce il valore.
+ * Il campo viene cercato nel direttorio; se non esiste viene creato con crea_campo. Se il valore esiste già nell'albero del campo
+ * aggiunge il libro alla sua lista, altrimenti inserisce il nuovo valore nell'albero e, se `indicizzaTrigrammi` è
+ * diverso da 0, nell'indice dei trigrammi.
+ * L'id del campo viene salvato nella coppia del libro. I nodi dell'albero e le stringhe dei valori vengono allocati da `arena`.
  *
  * @return int SUCCESS se l'operazione è riuscita, ERR_SYSTEM_CALL in caso di errore.
  */
-int arrCampi_aggiungiCoppia(struct dynamic_array *arrayCampi, const char *campo, const char *valore, struct libro *puntatoreLibro)
+int arrCampi_aggiungiCoppia(struct dynamic_array *arrayCampi, struct hash_table *direttorioCampi, struct arena *arena, struct coppiaLibro *coppia, struct libro *puntatoreLibro, int indicizzaTrigrammi)
 {
-    struct valoreLibro elementoDaInserire = {.valoreCampo = strdup(valore), .libroAssociato = puntatoreLibro};
-    if (!(elementoDaInserire.valoreCampo))
-    {
-        perror("Errore in strdup per valoreCampo");
+    const char *campo = coppia->lib_campo, *valore = coppia->lib_valore;
+    int idCampo = arrCampi_idCampo(direttorioCampi, campo);
+
+    if (idCampo == ID_CAMPO_ASSENTE && (idCampo = crea_campo(arrayCampi, direttorioCampi, arena, campo)) == ID_CAMPO_ASSENTE)
         return ERR_SYSTEM_CALL;
-    }
 
-    for (int index = 0; index < arrayCampi->da_inserted; ++index)
+    struct campoAlbero *corrente = (struct campoAlbero *)da_at(arrayCampi, idCampo);
+
+    coppia->lib_idCampo = idCampo;
+
+    corrente->numeroOccorrenze++;
+
+    struct valoreLibro chiave = {.valoreCampo = (char *)valore},
+                       *trovato = (struct valoreLibro *)bt_search(&(corrente->alberoValori), &chiave);
+    if (trovato)
     {
-        struct campoAlbero *corrente = (struct campoAlbero *)da_at(arrayCampi, index);
-        if (strcmp(corrente->nomeCampo, campo) == 0)
+        if (cb_add(&(trovato->libriAssociati), puntatoreLibro->lib_ordinale) == FAILURE)
         {
-            if (bt_insert(&(corrente->alberoValori), &elementoDaInserire) != FAILURE)
-                return SUCCESS;
-            else
-            {
-                printf("Errore nell'inserimento nel binary tree\n");
-                goto cleanup;
-            }
+            printf("Errore nell'aggiunta del libro alla lista del valore\n");
+            return ERR_SYSTEM_CALL;
         }
+        return SUCCESS;
     }
 
-    struct campoAlbero nuovoCampo = {.nomeCampo = strdup(campo), .alberoValori = bt_create(sizeof(struct valoreLibro), valoreLibro_confronta)};
-    if (!(nuovoCampo.nomeCampo))
+    struct valoreLibro elementoDaInserire = {.valoreCampo = ar_strdup(arena, valore), .libriAssociati = cb_create()};
+    if (!(elementoDaInserire.valoreCampo) || cb_add(&(elementoDaInserire.libriAssociati), puntatoreLibro->lib_ordinale) == FAILURE)
     {
-        perror("Errore in strdup per nuovoCampo.nomeCampo");
+        perror("Errore nella creazione del nuovo valore");
         goto cleanup;
     }
 
-    if (bt_insert(&(nuovoCampo.alberoValori), &elementoDaInserire) == FAILURE || da_append(arrayCampi, &nuovoCampo) == FAILURE)
+    struct valoreLibro *inserito = (struct valoreLibro *)bt_insertElement(&(corrente->alberoValori), &elementoDaInserire);
+    if (!inserito)
     {
-        printf("Errore nell'inserimento del nuovo campo o nell'appending all'array dinamico\n");
-        campoAlbero_free(&nuovoCampo);
+        printf("Errore nell'inserimento nel binary tree\n");
         goto cleanup;
     }
+    corrente->numeroValori++;
 
-    return SUCCESS;
+    return indicizzaTrigrammi ? indicizza_trigrammi(corrente, inserito) : SUCCESS;
 
 cleanup:
     valoreLibro_free(&elementoDaInserire);
     return ERR_SYSTEM_CALL;
 }
-//! FUNZIONI PUBBLICHE
 
-int arrCampi_aggiungiLibro(struct dynamic_array *arrayCampi, struct libro *libro)
+/**
+ * @brief Sposta nel campo `globale` tutti i valori del sottoalbero di un indice parziale.
+ *
+ * I valori già presenti in `globale` ricevono l'unione delle bitmap, quelli nuovi vengono inseriti nell'albero (la
+ * bitmap viene spostata, non copiata) e nell'indice dei trigrammi. La stringa del valore resta quella dell'indice
+ * parziale, che appartiene a un'arena unita a quella dell'indice completo.
+ *
+ * @return int SUCCESS se l'operazione è riuscita, ERR_SYSTEM_CALL in caso di errore.
+ */
+int unisci_valori(struct binary_tree_node *nodo, struct campoAlbero *globale)
 {
-    char *stringa_libro = strdup(libro->lib_stringa),
-         *campo_temp, *valore_temp;
+    if (!nodo)
+        return SUCCESS;
+
+    if (unisci_valori(nodo->bt_node_left, globale) == ERR_SYSTEM_CALL)
+        return ERR_SYSTEM_CALL;
 
-    if (!stringa_libro)
+    struct valoreLibro *valore = (struct valoreLibro *)nodo->bt_node_element,
+                       *trovato = (struct valoreLibro *)bt_search(&(globale->alberoValori), valore);
+    if (trovato)
+    {
+        if (cb_orInPlace(&(trovato->libriAssociati), &(valore->libriAssociati)) == FAILURE)
+        {
+            printf("Errore nell'unione delle liste di un valore\n");
+            return ERR_SYSTEM_CALL;
+        }
+    }
+    else
     {
-        perror("Errore in strdup per stringa_libro");
+        struct valoreLibro *inserito = (struct valoreLibro *)bt_insertElement(&(globale->alberoValori), valore);
+        if (!inserito)
+        {
+            printf("Errore nell'inserimento nel binary tree\n");
+            return ERR_SYSTEM_CALL;
+        }
+        valore->libriAssociati = cb_create(); // ora la bitmap appartiene all'indice completo
+        globale->numeroValori++;
+
+        if (indicizza_trigrammi(globale, inserito) == ERR_SYSTEM_CALL)
+            return ERR_SYSTEM_CALL;
+    }
+
+    return unisci_valori(nodo->bt_node_right, globale);
+}
+
+/**
+ * @brief Inserisce nell'indice dei trigrammi di `campo` tutti i valori del sottoalbero.
+ *
+ * @return int SUCCESS se l'operazione è riuscita, ERR_SYSTEM_CALL in caso di errore.
+ */
+int indicizza_albero(struct binary_tree_node *nodo, struct campoAlbero *campo)
+{
+    if (!nodo)
+        return SUCCESS;
+
+    if (indicizza_albero(nodo->bt_node_left, campo) == ERR_SYSTEM_CALL ||
+        indicizza_trigrammi(campo, (struct valoreLibro *)nodo->bt_node_element) == ERR_SYSTEM_CALL)
         return ERR_SYSTEM_CALL;
+
+    return indicizza_albero(nodo->bt_node_right, campo);
+}
+
+//* SNAPSHOT
+
+/**
+ * @brief Salva in `valori`, a partire da `*posizione`, i puntatori ai valori del sottoalbero in ordine crescente.
+ */
+void raccogli_valori(struct binary_tree_node *nodo, struct valoreLibro **valori, size_t *posizione)
+{
+    if (!nodo)
+        return;
+
+    raccogli_valori(nodo->bt_node_left, valori, posizione);
+    valori[(*posizione)++] = (struct valoreLibro *)nodo->bt_node_element;
+    raccogli_valori(nodo->bt_node_right, valori, posizione);
+}
+
+/**
+ * @brief Elemento della tabella che traduce i puntatori ai valori di un campo nelle loro posizioni nello snapshot.
+ */
+struct posizioneValore
+{
+    const struct valoreLibro *valore;
+    uint32_t posizione;
+};
+
+uint64_t posizioneValore_hash(const void *elemento)
+{
+    return ht_hashInteger((uintptr_t)((const struct posizioneValore *)elemento)->valore);
+}
+
+int posizioneValore_confronta(const void *elemento1, const void *elemento2)
+{
+    return ((const struct posizioneValore *)elemento1)->valore != ((const struct posizioneValore *)elemento2)->valore;
+}
+
+/**
+ * @brief Scrive nello snapshot i valori e l'indice dei trigrammi di un campo, e ne compila `snap_campo`.
+ *
+ * @param offsetCampo Offset della `struct snap_campo` già riservata per il campo.
+ * @return int SUCCESS se l'operazione è riuscita, ERR_SYSTEM_CALL in caso di errore.
+ */
+int scrivi_campo(struct campoAlbero *campo, struct snapshotScrittura *snapshot, uint64_t offsetCampo)
+{
+    int risultato = ERR_SYSTEM_CALL;
+    size_t numeroValori = 0;
+    struct valoreLibro **valori = (struct valoreLibro **)malloc((campo->numeroValori + 1) * sizeof(struct valoreLibro *));
+    struct hash_table posizioni = ht_create(sizeof(struct posizioneValore), campo->numeroValori + 1, posizioneValore_hash, posizioneValore_confronta);
+    struct snap_campo scritto = {.snap_numeroValori = campo->numeroValori, .snap_numeroOccorrenze = campo->numeroOccorrenze,
+                                 .snap_numeroTrigrammi = (campo->indiceTrigrammi).ht_inserted};
+
+    if (!valori || !(posizioni.ht_slots))
+        goto cleanup;
+    raccogli_valori((campo->alberoValori).bt_root, valori, &numeroValori);
+
+    if ((scritto.snap_nome = snap_aggiungiStringa(snapshot, campo->nomeCampo)) == SNAP_OFFSET_NULLO ||
+        (scritto.snap_valori = snap_aggiungi(snapshot, NULL, numeroValori * sizeof(struct snap_valore))) == SNAP_OFFSET_NULLO ||
+        (scritto.snap_trigrammi = snap_aggiungi(snapshot, NULL, scritto.snap_numeroTrigrammi * sizeof(struct snap_trigramma))) == SNAP_OFFSET_NULLO)
+        goto cleanup;
+
+    for (size_t index = 0; index < numeroValori; index++)
+    {
+        struct snap_valore valore = {.snap_stringa = snap_aggiungiStringa(snapshot, valori[index]->valoreCampo),
+                                     .snap_dimensioneBitmap = cb_serializedSize(&(valori[index]->libriAssociati))};
+
+        if (valore.snap_stringa == SNAP_OFFSET_NULLO ||
+            (valore.snap_bitmap = snap_aggiungi(snapshot, NULL, valore.snap_dimensioneBitmap)) == SNAP_OFFSET_NULLO)
+            goto cleanup;
+
+        // snap_aggiungi può spostare i dati: i puntatori si chiedono solo dopo l'ultima aggiunta
+        cb_serialize(&(valori[index]->libriAssociati), snap_at(snapshot, valore.snap_bitmap));
+        ((struct snap_valore *)snap_at(snapshot, scritto.snap_valori))[index] = valore;
+
+        struct posizioneValore posizione = {.valore = valori[index], .posizione = index};
+        if (!ht_insert(&posizioni, &posizione))
+            goto cleanup;
     }
 
-    lib_estraiCoppia(stringa_libro, &campo_temp, &valore_temp);
-    do
+    size_t iteratore = 0, numeroTrigramma = 0;
+    struct trigrammaValori *trigramma;
+    while ((trigramma = (struct trigrammaValori *)ht_next(&(campo->indiceTrigrammi), &iteratore)))
+    {
+        struct snap_trigramma scrittoTrigramma = {.snap_trigramma = trigramma->trigramma,
+                                                  .snap_numeroValori = trigramma->valori.da_inserted};
+
+        if ((scrittoTrigramma.snap_valori = snap_aggiungi(snapshot, NULL, scrittoTrigramma.snap_numeroValori * sizeof(uint32_t))) == SNAP_OFFSET_NULLO)
+            goto cleanup;
+
+        uint32_t *scritte = (uint32_t *)snap_at(snapshot, scrittoTrigramma.snap_valori);
+        for (int index = 0; index < trigramma->valori.da_inserted; index++)
+        {
+            struct posizioneValore chiave = {.valore = *(struct valoreLibro **)da_at(&(trigramma->valori), index)};
+            scritte[index] = ((struct posizioneValore *)ht_search(&posizioni, &chiave))->posizione;
+        }
+
+        ((struct snap_trigramma *)snap_at(snapshot, scritto.snap_trigrammi))[numeroTrigramma++] = scrittoTrigramma;
+    }
+
+    *(struct snap_campo *)snap_at(snapshot, offsetCampo) = scritto;
+    risultato = SUCCESS;
+
+cleanup:
+    if (risultato == ERR_SYSTEM_CALL)
+        printf("Errore di allocazione nella scrittura di un campo dello snapshot\n");
+    ht_destroy(&posizioni);
+    free(valori);
+    return risultato;
+}
+
+/**
+ * @brief Ricostruisce l'albero dei valori e l'indice dei trigrammi di un campo appena creato da una `snap_campo`.
+ *
+ * Controlla che i valori siano in ordine strettamente crescente, che le posizioni dei trigrammi siano valide e che le
+ * bitmap contengano solo ordinali minori di `numeroLibri` (vedi cb_deserialize), così uno snapshot rovinato non può
+ * produrre un albero non ordinato o puntatori fuori dagli array.
+ *
+ * @return int SUCCESS se l'operazione è riuscita, ERR_SYSTEM_CALL in caso di errore.
+ */
+int leggi_campo(struct campoAlbero *campo, const struct snapshotLettura *snapshot, const struct snap_campo *letto,
+                uint32_t numeroLibri)
+{
+    int risultato = ERR_SYSTEM_CALL;
+    size_t numeroValori = letto->snap_numeroValori, numeroLetti = 0;
+    const struct snap_valore *valoriLetti = (const struct snap_valore *)snap_leggi(snapshot, letto->snap_valori, numeroValori * sizeof(struct snap_valore));
+    const struct snap_trigramma *trigrammiLetti = (const struct snap_trigramma *)snap_leggi(snapshot, letto->snap_trigrammi,
+                                                                                             letto->snap_numeroTrigrammi * sizeof(struct snap_trigramma));
+    struct valoreLibro *valori = NULL, **puntatori = NULL;
+
+    // i numeri letti dallo snapshot si usano per allocare solo dopo aver controllato che gli array siano nel file
+    if (!valoriLetti || !trigrammiLetti ||
+        !(valori = (struct valoreLibro *)malloc((numeroValori + 1) * sizeof(struct valoreLibro))) ||
+        !(puntatori = (struct valoreLibro **)malloc((numeroValori + 1) * sizeof(struct valoreLibro *))))
+        goto cleanup;
+
+    for (; numeroLetti < numeroValori; numeroLetti++)
+    {
+        const void *bitmap = snap_leggi(snapshot, valoriLetti[numeroLetti].snap_bitmap, valoriLetti[numeroLetti].snap_dimensioneBitmap);
+
+        valori[numeroLetti].valoreCampo = (char *)snap_leggiStringa(snapshot, valoriLetti[numeroLetti].snap_stringa);
+        if (!valori[numeroLetti].valoreCampo || !bitmap ||
+            (numeroLetti > 0 && strcmp(valori[numeroLetti - 1].valoreCampo, valori[numeroLetti].valoreCampo) >= 0) ||
+            cb_deserialize(&(valori[numeroLetti].libriAssociati), bitmap, valoriLetti[numeroLetti].snap_dimensioneBitmap, numeroLibri) == FAILURE)
+            goto cleanup;
+    }
+
+    if (bt_buildFromSorted(&(campo->alberoValori), valori, numeroValori) == FAILURE)
+        goto cleanup;
+    numeroLetti = 0; // ora le bitmap appartengono ai nodi dell'albero
+
+    size_t posizione = 0;
+    raccogli_valori((campo->alberoValori).bt_root, puntatori, &posizione);
+
+    for (uint64_t index = 0; index < letto->snap_numeroTrigrammi; index++)
+    {
+        const uint32_t *posizioni = (const uint32_t *)snap_leggi(snapshot, trigrammiLetti[index].snap_valori,
+                                                                 (uint64_t)trigrammiLetti[index].snap_numeroValori * sizeof(uint32_t));
+        if (!posizioni)
+            goto cleanup;
+
+        struct trigrammaValori trigramma = {.trigramma = trigrammiLetti[index].snap_trigramma,
+                                            .valori = da_create(sizeof(struct valoreLibro *), trigrammiLetti[index].snap_numeroValori + 1)};
+        size_t inseriti = (campo->indiceTrigrammi).ht_inserted;
+
+        if (!(trigramma.valori.da_ptrArray))
+            goto cleanup;
+        for (uint32_t indexValore = 0; indexValore < trigrammiLetti[index].snap_numeroValori; indexValore++)
+        {
+            if (posizioni[indexValore] >= numeroValori || da_append(&(trigramma.valori), puntatori + posizioni[indexValore]) == FAILURE)
+            {
+                da_destroy(&(trigramma.valori));
+                goto cleanup;
+            }
+        }
+
+        // un trigramma ripetuto non viene inserito di nuovo da ht_insert: lo snapshot non è coerente
+        if (!ht_insert(&(campo->indiceTrigrammi), &trigramma) || (campo->indiceTrigrammi).ht_inserted == inseriti)
+        {
+            da_destroy(&(trigramma.valori));
+            goto cleanup;
+        }
+    }
+
+    campo->numeroValori = numeroValori;
+    campo->numeroOccorrenze = letto->snap_numeroOccorrenze;
+    risultato = SUCCESS;
+
+cleanup:
+    for (size_t index = 0; index < numeroLetti; index++)
+        cb_destroy(&(valori[index].libriAssociati));
+    free(valori);
+    free(puntatori);
+    return risultato;
+}
+
+//! FUNZIONI PUBBLICHE
+
+struct hash_table arrCampi_creaDirettorio(void)
+{
+    return ht_create(sizeof(struct voceDirettorio), 16, voceDirettorio_hash, voceDirettorio_confronta);
+}
+
+int arrCampi_idCampo(struct hash_table *direttorioCampi, const char *nomeCampo)
+{
+    struct voceDirettorio chiave = {.nomeCampo = (char *)nomeCampo},
+                          *trovata = (struct voceDirettorio *)ht_search(direttorioCampi, &chiave);
+
+    return trovata ? trovata->idCampo : ID_CAMPO_ASSENTE;
+}
+
+int arrCampi_aggiungiLibro(struct dynamic_array *arrayCampi, struct hash_table *direttorioCampi, struct arena *arena, struct libro *libro)
+{
+    for (int index = 0; index < libro->lib_numeroCoppie; index++)
     {
-        lib_formattaStringa(campo_temp);
-        lib_formattaStringa(valore_temp);
+        if (arrCampi_aggiungiCoppia(arrayCampi, direttorioCampi, arena, libro->lib_coppie + index, libro, 1) == ERR_SYSTEM_CALL)
+        {
+            printf("Errore nell'aggiunta di una coppia campo-valore\n");
+            return ERR_SYSTEM_CALL;
+        }
+    }
 
-        if (arrCampi_aggiungiCoppia(arrayCampi, campo_temp, valore_temp, libro) == ERR_SYSTEM_CALL)
+    return SUCCESS;
+}
+
+int arrCampi_aggiungiLibroParziale(struct dynamic_array *arrayCampi, struct hash_table *direttorioCampi, struct arena *arena, struct libro *libro)
+{
+    for (int index = 0; index < libro->lib_numeroCoppie; index++)
+    {
+        if (arrCampi_aggiungiCoppia(arrayCampi, direttorioCampi, arena, libro->lib_coppie + index, libro, 0) == ERR_SYSTEM_CALL)
         {
-            free(stringa_libro);
             printf("Errore nell'aggiunta di una coppia campo-valore\n");
             return ERR_SYSTEM_CALL;
         }
+    }
+
+    return SUCCESS;
+}
+
+int arrCampi_unisci(struct dynamic_array *arrayCampi, struct hash_table *direttorioCampi, struct arena *arena,
+                    struct dynamic_array *arrayParziale, struct hash_table *direttorioParziale, struct dynamic_array *libri)
+{
+    int risultato = ERR_SYSTEM_CALL;
+    int *idGlobali = NULL;
+
+    // il primo indice parziale diventa l'indice completo così com'è, con gli stessi id: mancano solo i trigrammi
+    if (arrayCampi->da_inserted == 0)
+    {
+        struct dynamic_array tempArray = *arrayCampi;
+        struct hash_table tempDirettorio = *direttorioCampi;
+
+        *arrayCampi = *arrayParziale;
+        *direttorioCampi = *direttorioParziale;
+        *arrayParziale = tempArray;
+        *direttorioParziale = tempDirettorio;
+
+        for (int idCampo = 0; idCampo < arrayCampi->da_inserted; idCampo++)
+        {
+            struct campoAlbero *campo = (struct campoAlbero *)da_at(arrayCampi, idCampo);
+            (campo->alberoValori).bt_arena = arena;
+            if (indicizza_albero((campo->alberoValori).bt_root, campo) == ERR_SYSTEM_CALL)
+                goto cleanup;
+        }
+
+        risultato = SUCCESS;
+        goto cleanup;
+    }
+
+    idGlobali = (int *)malloc((arrayParziale->da_inserted + 1) * sizeof(int));
+    if (!idGlobali)
+    {
+        perror("Errore di allocazione per l'unione di un indice parziale");
+        goto cleanup;
+    }
+
+    // i campi vengono visitati nell'ordine in cui compaiono nella porzione, così gli id sono gli stessi di un caricamento sequenziale
+    for (int idParziale = 0; idParziale < arrayParziale->da_inserted; idParziale++)
+    {
+        struct campoAlbero *parziale = (struct campoAlbero *)da_at(arrayParziale, idParziale);
+        int idCampo = arrCampi_idCampo(direttorioCampi, parziale->nomeCampo);
+
+        if (idCampo == ID_CAMPO_ASSENTE && (idCampo = crea_campo(arrayCampi, direttorioCampi, arena, parziale->nomeCampo)) == ID_CAMPO_ASSENTE)
+            goto cleanup;
+
+        struct campoAlbero *globale = (struct campoAlbero *)da_at(arrayCampi, idCampo);
+        globale->numeroOccorrenze += parziale->numeroOccorrenze;
+
+        if (unisci_valori((parziale->alberoValori).bt_root, globale) == ERR_SYSTEM_CALL)
+            goto cleanup;
+
+        idGlobali[idParziale] = idCampo;
+    }
+
+    for (int index = 0; index < libri->da_inserted; index++)
+    {
+        struct libro *libro = *(struct libro **)da_at(libri, index);
+        for (int coppia = 0; coppia < libro->lib_numeroCoppie; coppia++)
+            libro->lib_coppie[coppia].lib_idCampo = idGlobali[libro->lib_coppie[coppia].lib_idCampo];
+    }
+
+    risultato = SUCCESS;
+
+cleanup:
+    free(idGlobali);
+    arrCampi_free(arrayParziale, direttorioParziale);
+    return risultato;
+}
+
+uint64_t arrCampi_scriviSnapshot(struct dynamic_array *arrayCampi, struct snapshotScrittura *snapshot)
+{
+    uint64_t offsetCampi = snap_aggiungi(snapshot, NULL, arrayCampi->da_inserted * sizeof(struct snap_campo));
+    if (offsetCampi == SNAP_OFFSET_NULLO)
+        return SNAP_OFFSET_NULLO;
+
+    for (int idCampo = 0; idCampo < arrayCampi->da_inserted; idCampo++)
+    {
+        if (scrivi_campo((struct campoAlbero *)da_at(arrayCampi, idCampo), snapshot, offsetCampi + idCampo * sizeof(struct snap_campo)) == ERR_SYSTEM_CALL)
+            return SNAP_OFFSET_NULLO;
+    }
+
+    return offsetCampi;
+}
+
+int arrCampi_leggiSnapshot(struct dynamic_array *arrayCampi, struct hash_table *direttorioCampi, struct arena *arena,
+                           const struct snapshotLettura *snapshot, uint64_t offsetCampi, uint32_t numeroCampi, uint32_t numeroLibri)
+{
+    const struct snap_campo *campi = (const struct snap_campo *)snap_leggi(snapshot, offsetCampi, (uint64_t)numeroCampi * sizeof(struct snap_campo));
+    if (!campi)
+        return ERR_SYSTEM_CALL;
+
+    for (uint32_t idCampo = 0; idCampo < numeroCampi; idCampo++)
+    {
+        const char *nome = snap_leggiStringa(snapshot, campi[idCampo].snap_nome);
 
-    } while (lib_estraiCoppia(NULL, &campo_temp, &valore_temp)); // Continua estraendo la coppia successiva
+        // un nome ripetuto avrebbe già un id: i campi devono essere creati nell'ordine degli id
+        if (!nome || arrCampi_idCampo(direttorioCampi, nome) != ID_CAMPO_ASSENTE ||
+            crea_campo(arrayCampi, direttorioCampi, arena, nome) != (int)idCampo ||
+            leggi_campo((struct campoAlbero *)da_at(arrayCampi, idCampo), snapshot, campi + idCampo, numeroLibri) == ERR_SYSTEM_CALL)
+        {
+            printf("Errore nella lettura di un campo dello snapshot\n");
+            return ERR_SYSTEM_CALL;
+        }
+    }
 
-    free(stringa_libro);
     return SUCCESS;
 }
 
-int arrCampi_generaLista(struct dynamic_array *arrayCampi, struct dynamic_array *lista_libri, const char *richiesta, pthread_mutex_t *mutex, pthread_cond_t *cond)
+int arrCampi_generaLista(struct dynamic_array *arrayCampi, struct hash_table *direttorioCampi, struct dynamic_array *ptrLibri, struct dynamic_array *lista_libri, const char *richiesta)
 {
-    char *primo_campo, *primo_valore,
+    int risultato = ERR_SYSTEM_CALL, controlliResidui = 0;
+    char *campo_temp, *valore_temp,
         *copia_richiesta = strdup(richiesta);
-    if (!copia_richiesta)
+    uint32_t *ordinali = NULL;
+    struct dynamic_array coppie = da_create(sizeof(struct coppiaPiano), 4);
+    struct compressed_bitmap candidati = cb_create();
+
+    if (!copia_richiesta || !(coppie.da_ptrArray))
     {
-        perror("Errore in strdup per copia_richiesta");
-        return ERR_SYSTEM_CALL;
+        perror("Errore di allocazione per la pianificazione della richiesta");
+        goto cleanup;
+    }
+
+    if (!lib_estraiCoppia(copia_richiesta, &campo_temp, &valore_temp))
+    {
+        risultato = SUCCESS;
+        goto cleanup;
     }
 
-    lib_estraiCoppia(copia_richiesta, &primo_campo, &primo_valore);
+    // stima del costo di ogni coppia: se una coppia non ha libri, nessun libro soddisfa la richiesta
+    do
+    {
+        struct coppiaPiano coppia = {.campo = campo_temp, .valore = valore_temp,
+                                     .idCampo = arrCampi_idCampo(direttorioCampi, campo_temp)};
+        if (coppia.idCampo == ID_CAMPO_ASSENTE)
+        {
+            risultato = SUCCESS;
+            goto cleanup;
+        }
+        coppia.campoAlbero = (struct campoAlbero *)da_at(arrayCampi, coppia.idCampo);
+
+        if (da_append(&coppie, &coppia) == FAILURE ||
+            stima_coppia((struct coppiaPiano *)da_at(&coppie, coppie.da_inserted - 1)) == ERR_SYSTEM_CALL)
+        {
+            printf("Errore nella stima del costo di una coppia della richiesta\n");
+            goto cleanup;
+        }
+        if (((struct coppiaPiano *)da_at(&coppie, coppie.da_inserted - 1))->stima == 0)
+        {
+            risultato = SUCCESS;
+            goto cleanup;
+        }
+    } while (lib_estraiCoppia(NULL, &campo_temp, &valore_temp));
+
+    // la coppia più selettiva guida la ricerca, le altre la restringono in ordine di selettività
+    qsort(coppie.da_ptrArray, coppie.da_inserted, sizeof(struct coppiaPiano), coppiaPiano_ordina);
 
-    struct campoAlbero *corrente = NULL;
-    int index;
+    struct coppiaPiano *guida = (struct coppiaPiano *)da_at(&coppie, 0);
+    if ((!(guida->stimaEsatta) && cerca_valori(guida->campoAlbero, guida->valore, &(guida->valori)) == ERR_SYSTEM_CALL) ||
+        unisci_libri(guida, &candidati) == ERR_SYSTEM_CALL)
+    {
+        printf("Errore nella raccolta dei libri della coppia guida\n");
+        goto cleanup;
+    }
+    guida->operazione = 'G';
 
-    // troviamo l'albero relativo al campo che corrisponde alla richiesta
-    for (index = 0; index < arrayCampi->da_inserted; index++)
+    for (int index = 1; index < coppie.da_inserted; index++)
     {
-        corrente = (struct campoAlbero *)da_at(arrayCampi, index);
-        if (strcmp(corrente->nomeCampo, primo_campo) == 0)
-            break;
+        struct coppiaPiano *coppia = (struct coppiaPiano *)da_at(&coppie, index);
+
+        if (coppia->stimaEsatta)
+        {
+            if (cb_cardinality(&candidati) > 0 && interseca_coppia(coppia, &candidati) == ERR_SYSTEM_CALL)
+            {
+                printf("Errore nell'intersezione dei libri di una coppia\n");
+                goto cleanup;
+            }
+            coppia->operazione = 'I';
+        }
+        else
+        {
+            // i valori di questa coppia si trovano solo visitando tutto l'albero: conviene controllarla sui candidati
+            coppia->operazione = 'R';
+            controlliResidui++;
+        }
     }
-    if (index == arrayCampi->da_inserted)
-        return 0;
 
-    struct binary_tree_node *nodo_albero = (corrente->alberoValori).bt_root;
+    size_t numeroCandidati = cb_cardinality(&candidati);
+
+#ifdef SPIEGA_PIANO
+    spiega_piano(&coppie, numeroCandidati);
+#endif
 
-    struct valoreLibro da_cercare = (struct valoreLibro){.valoreCampo = primo_valore, .libroAssociato = NULL},
-                       *trovato;
+    if (!(ordinali = (uint32_t *)malloc((numeroCandidati ? numeroCandidati : 1) * sizeof(uint32_t))))
+    {
+        perror("Errore di allocazione per gli ordinali dei candidati");
+        goto cleanup;
+    }
+    cb_toArray(&candidati, ordinali);
 
-    while ((nodo_albero = bt_node_search(nodo_albero, &da_cercare, sizeof(struct valoreLibro), valoreLibro_confronta)) != NULL)
+    for (size_t index = 0; index < numeroCandidati; index++)
     {
-        trovato = (struct valoreLibro *)nodo_albero->bt_node_element;
-        int controllo = lib_controllaRichiestaThreadSafe(trovato->libroAssociato, richiesta, mutex, cond);
-        if (controllo == ERR_SYSTEM_CALL || (controllo && da_append(lista_libri, &(trovato->libroAssociato)) == FAILURE))
+        struct libro *libro = *(struct libro **)da_at(ptrLibri, ordinali[index]);
+        int controllo = 1;
+
+        for (int indexCoppia = 1; indexCoppia < coppie.da_inserted && controllo && controlliResidui > 0; indexCoppia++)
         {
-            printf("Errore durante la verifica della richiesta thread-safe o durante l'append alla lista dei libri\n");
-            free(copia_richiesta);
-            return ERR_SYSTEM_CALL;
+            struct coppiaPiano *coppia = (struct coppiaPiano *)da_at(&coppie, indexCoppia);
+            if (coppia->operazione == 'R')
+                controllo = lib_contieneCoppia(libro, coppia->idCampo, coppia->valore);
+        }
+
+        if (controllo && da_append(lista_libri, &libro) == FAILURE)
+        {
+            printf("Errore durante l'append alla lista dei libri\n");
+            goto cleanup;
         }
-        nodo_albero = nodo_albero->bt_node_right;
     }
 
-    free(copia_richiesta);
+    risultato = SUCCESS;
 
-    return SUCCESS;
+cleanup:
+    for (int index = 0; index < coppie.da_inserted; index++)
+        da_destroy(&(((struct coppiaPiano *)da_at(&coppie, index))->valori));
+    da_destroy(&coppie);
+    cb_destroy(&candidati);
+    free(ordinali);
+    free(copia_richiesta);
+    return risultato;
 }
 
-void arrCampi_free(struct dynamic_array *arrayCampi)
+void arrCampi_free(struct dynamic_array *arrayCampi, struct hash_table *direttorioCampi)
 {
+    if (direttorioCampi)
+        ht_destroy(direttorioCampi); // le voci non possiedono i nomi, che vengono liberati con i campi
     if (!arrayCampi)
         return;
     for (int index = 0; index < arrayCampi->da_inserted; index++)
@@ -0,0 +1,289 @@
+#include "../../include/struttura_dati/cache_richieste.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+//! FUNZIONI PRIVATE
+
+/**
+ * @return L'hash della richiesta di una voce della tabella (un `struct voceCache *`).
+ */
+uint64_t hash_voce(const void *elemento)
+{
+    return ht_hashString((*(struct voceCache *const *)elemento)->cache_richiesta);
+}
+
+/**
+ * @return 0 se le due voci della tabella hanno la stessa richiesta.
+ */
+int confronta_voci(const void *a, const void *b)
+{
+    return strcmp((*(struct voceCache *const *)a)->cache_richiesta, (*(struct voceCache *const *)b)->cache_richiesta);
+}
+
+/**
+ * @return La partizione di `richiesta`. Usa i bit alti dell'hash: quelli bassi scelgono la posizione nella tabella.
+ */
+struct partizioneCache *partizione_di(struct cacheRichieste *cache, const char *richiesta)
+{
+    return &(cache->cache_partizioni[(ht_hashString(richiesta) >> 32) % CACHE_PARTIZIONI]);
+}
+
+void libera_voce(struct voceCache *voce)
+{
+    free(voce->cache_richiesta);
+    free(voce->cache_risposta);
+    free(voce->cache_ordinali);
+    free(voce);
+}
+
+/**
+ * @brief Stacca la voce dalla lista LRU della partizione.
+ */
+void stacca_voce(struct partizioneCache *partizione, struct voceCache *voce)
+{
+    if (voce->cache_precedente)
+        voce->cache_precedente->cache_successiva = voce->cache_successiva;
+    else
+        partizione->cache_piuRecente = voce->cache_successiva;
+
+    if (voce->cache_successiva)
+        voce->cache_successiva->cache_precedente = voce->cache_precedente;
+    else
+        partizione->cache_menoRecente = voce->cache_precedente;
+
+    voce->cache_precedente = voce->cache_successiva = NULL;
+}
+
+/**
+ * @brief Mette la voce in testa alla lista LRU della partizione, come la più recente.
+ */
+void metti_in_testa(struct partizioneCache *partizione, struct voceCache *voce)
+{
+    voce->cache_precedente = NULL;
+    voce->cache_successiva = partizione->cache_piuRecente;
+    if (partizione->cache_piuRecente)
+        partizione->cache_piuRecente->cache_precedente = voce;
+    else
+        partizione->cache_menoRecente = voce;
+    partizione->cache_piuRecente = voce;
+}
+
+/**
+ * @brief Toglie la voce dalla partizione e restituisce il riferimento della cache. Va chiamata con il mutex della
+ *        partizione.
+ */
+void togli_voce(struct partizioneCache *partizione, struct voceCache *voce)
+{
+    ht_delete(&(partizione->cache_voci), &voce);
+    stacca_voce(partizione, voce);
+    partizione->cache_numeroVoci--;
+    partizione->cache_byte -= voce->cache_lunghezza;
+    cache_rilascia(voce);
+}
+
+/**
+ * @return 1 se `ordinale` è tra gli ordinali (in ordine crescente) della voce.
+ */
+int contiene_ordinale(const struct voceCache *voce, uint32_t ordinale)
+{
+    int inizio = 0, fine = voce->cache_numeroLibri;
+    if (fine == 0 || ordinale < voce->cache_ordinali[0] || ordinale > voce->cache_ordinali[fine - 1])
+        return 0;
+
+    while (inizio < fine)
+    {
+        int centro = inizio + (fine - inizio) / 2;
+        if (voce->cache_ordinali[centro] < ordinale)
+            inizio = centro + 1;
+        else
+            fine = centro;
+    }
+    return voce->cache_ordinali[inizio] == ordinale;
+}
+
+//! FUNZIONI PUBBLICHE
+
+struct cacheRichieste cache_nonAttiva(void)
+{
+    struct cacheRichieste cache;
+    memset(&cache, 0, sizeof(cache));
+    atomic_init(&(cache.cache_invalidazioni), 0);
+    return cache;
+}
+
+int cache_crea(struct cacheRichieste *cache)
+{
+    *cache = cache_nonAttiva();
+
+    for (int i = 0; i < CACHE_PARTIZIONI; i++)
+    {
+        struct partizioneCache *partizione = &(cache->cache_partizioni[i]);
+        partizione->cache_voci = ht_create(sizeof(struct voceCache *), CACHE_MAX_VOCI / CACHE_PARTIZIONI,
+                                           hash_voce, confronta_voci);
+        if (!(partizione->cache_voci.ht_slots) || pthread_mutex_init(&(partizione->cache_mutex), NULL) != 0)
+        {
+            perror("Errore nella creazione della cache delle richieste");
+            ht_destroy(&(partizione->cache_voci));
+            for (int j = 0; j < i; j++)
+            {
+                ht_destroy(&(cache->cache_partizioni[j].cache_voci));
+                pthread_mutex_destroy(&(cache->cache_partizioni[j].cache_mutex));
+            }
+            *cache = cache_nonAttiva();
+            return ERR_SYSTEM_CALL;
+        }
+    }
+
+    cache->cache_attiva = 1;
+    return SUCCESS;
+}
+
+struct voceCache *cache_cerca(struct cacheRichieste *cache, const char *richiesta)
+{
+    if (!cache->cache_attiva)
+        return NULL;
+
+    struct partizioneCache *partizione = partizione_di(cache, richiesta);
+    struct voceCache chiave = {.cache_richiesta = (char *)richiesta}, *ptrChiave = &chiave, *voce = NULL;
+
+    pthread_mutex_lock(&(partizione->cache_mutex));
+    struct voceCache **trovata = (struct voceCache **)ht_search(&(partizione->cache_voci), &ptrChiave);
+    if (trovata)
+    {
+        voce = *trovata;
+        if ((int64_t)time(NULL) > voce->cache_scadenza)
+        {
+            // è scaduto il prestito di un libro della risposta, che ora sarebbe diversa
+            togli_voce(partizione, voce);
+            voce = NULL;
+        }
+        else
+        {
+            stacca_voce(partizione, voce);
+            metti_in_testa(partizione, voce);
+            atomic_fetch_add(&(voce->cache_riferimenti), 1);
+        }
+    }
+    pthread_mutex_unlock(&(partizione->cache_mutex));
+
+    return voce;
+}
+
+void cache_rilascia(struct voceCache *voce)
+{
+    if (atomic_fetch_sub(&(voce->cache_riferimenti), 1) == 1)
+        libera_voce(voce);
+}
+
+uint64_t cache_inizioRisposta(struct cacheRichieste *cache)
+{
+    return atomic_load(&(cache->cache_invalidazioni));
+}
+
+int cache_inserisci(struct cacheRichieste *cache, const char *richiesta, char *risposta, size_t lunghezza,
+                    uint32_t *ordinali, int numeroLibri, int64_t scadenza, uint64_t invalidazioni)
+{
+    if (!cache->cache_attiva || lunghezza > CACHE_MAX_RISPOSTA || (int64_t)time(NULL) > scadenza)
+    {
+        free(risposta);
+        free(ordinali);
+        return SUCCESS;
+    }
+
+    struct voceCache *voce = (struct voceCache *)malloc(sizeof(struct voceCache));
+    char *copiaRichiesta = strdup(richiesta);
+    if (!voce || !copiaRichiesta)
+    {
+        perror("Errore nell'allocazione di una voce della cache");
+        free(voce);
+        free(copiaRichiesta);
+        free(risposta);
+        free(ordinali);
+        return ERR_SYSTEM_CALL;
+    }
+    *voce = (struct voceCache){
+        .cache_richiesta = copiaRichiesta,
+        .cache_risposta = risposta,
+        .cache_lunghezza = lunghezza,
+        .cache_ordinali = ordinali,
+        .cache_numeroLibri = numeroLibri,
+        .cache_scadenza = scadenza};
+    atomic_init(&(voce->cache_riferimenti), 1);
+
+    struct partizioneCache *partizione = partizione_di(cache, richiesta);
+    int errore = SUCCESS, salvata = 0;
+
+    pthread_mutex_lock(&(partizione->cache_mutex));
+    // letto con il mutex: un prestito che lo incrementa dopo toglie la voce quando visita questa partizione
+    if (atomic_load(&(cache->cache_invalidazioni)) == invalidazioni)
+    {
+        struct voceCache **presente = (struct voceCache **)ht_insert(&(partizione->cache_voci), &voce);
+        if (!presente)
+        {
+            perror("Errore nell'inserimento di una voce della cache");
+            errore = ERR_SYSTEM_CALL;
+        }
+        else if (*presente == voce)
+        {
+            salvata = 1;
+            metti_in_testa(partizione, voce);
+            partizione->cache_numeroVoci++;
+            partizione->cache_byte += lunghezza;
+
+            // la voce appena inserita è la più recente, quindi non viene tolta (resta anche se da sola supera il limite)
+            while (partizione->cache_menoRecente != voce &&
+                   (partizione->cache_numeroVoci > CACHE_MAX_VOCI / CACHE_PARTIZIONI ||
+                    partizione->cache_byte > CACHE_MAX_BYTE / CACHE_PARTIZIONI))
+                togli_voce(partizione, partizione->cache_menoRecente);
+        }
+        // altrimenti un altro worker ha salvato la stessa risposta nel frattempo
+    }
+    pthread_mutex_unlock(&(partizione->cache_mutex));
+
+    if (!salvata)
+        libera_voce(voce);
+    return errore;
+}
+
+void cache_invalidaLibro(struct cacheRichieste *cache, uint32_t ordinale)
+{
+    if (!cache->cache_attiva)
+        return;
+
+    // prima di visitare le partizioni: chi costruisce una risposta con il vecchio prestito non la salva più
+    atomic_fetch_add(&(cache->cache_invalidazioni), 1);
+
+    for (int i = 0; i < CACHE_PARTIZIONI; i++)
+    {
+        struct partizioneCache *partizione = &(cache->cache_partizioni[i]);
+        pthread_mutex_lock(&(partizione->cache_mutex));
+        struct voceCache *voce = partizione->cache_piuRecente;
+        while (voce)
+        {
+            struct voceCache *successiva = voce->cache_successiva;
+            if (contiene_ordinale(voce, ordinale))
+                togli_voce(partizione, voce);
+            voce = successiva;
+        }
+        pthread_mutex_unlock(&(partizione->cache_mutex));
+    }
+}
+
+void cache_distruggi(struct cacheRichieste *cache)
+{
+    if (!cache->cache_attiva)
+        return;
+
+    for (int i = 0; i < CACHE_PARTIZIONI; i++)
+    {
+        struct partizioneCache *partizione = &(cache->cache_partizioni[i]);
+        while (partizione->cache_menoRecente)
+            togli_voce(partizione, partizione->cache_menoRecente);
+        ht_destroy(&(partizione->cache_voci));
+        pthread_mutex_destroy(&(partizione->cache_mutex));
+    }
+
+    *cache = cache_nonAttiva();
+}
@@ -0,0 +1,428 @@
+#include "../../include/struttura_dati/giornale.h"
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/stat.h>
+
+//! FUNZIONI PRIVATE
+
+#define VOCI_PER_LETTURA 4096
+
+/**
+ * @return Offset della voce `indice` nel file del giornale.
+ */
+off_t offset_voce(uint64_t indice)
+{
+    return (off_t)(sizeof(struct intestazioneGiornale) + indice * sizeof(struct voceGiornale));
+}
+
+/**
+ * @return Checksum FNV-1a dei campi di `voce` che precedono `gior_controllo`.
+ */
+uint32_t controllo_voce(const struct voceGiornale *voce)
+{
+    const unsigned char *byte = (const unsigned char *)voce;
+    uint32_t hash = 2166136261u;
+
+    for (size_t i = 0; i < offsetof(struct voceGiornale, gior_controllo); i++)
+        hash = (hash ^ byte[i]) * 16777619u;
+    return hash;
+}
+
+/**
+ * @return L'identità del file record descritto da `record`.
+ */
+struct identitaRecord identita_di(const struct stat *record)
+{
+    return (struct identitaRecord){.gior_dimensione = (uint64_t)record->st_size,
+                                   .gior_modifica = (int64_t)record->st_mtim.tv_sec,
+                                   .gior_modificaNs = (int64_t)record->st_mtim.tv_nsec,
+                                   .gior_inode = (uint64_t)record->st_ino};
+}
+
+/**
+ * @return L'intestazione di un giornale di `numeroLibri` libri, legato al file record `record`.
+ */
+struct intestazioneGiornale crea_intestazione(uint64_t numeroLibri, const struct stat *record)
+{
+    struct intestazioneGiornale intestazione = {.gior_versione = GIOR_VERSIONE, .gior_controllo = GIOR_CONTROLLO,
+                                                .gior_numeroLibri = numeroLibri, .gior_record = identita_di(record)};
+    memcpy(intestazione.gior_magico, GIOR_MAGICO, sizeof(GIOR_MAGICO));
+    return intestazione;
+}
+
+/**
+ * @return 1 se l'intestazione `letta` è di questa versione, di questi libri e del file record di `attesa` (come file
+ *         attuale o come file annunciato con gior_nuovoRecord), 0 altrimenti.
+ */
+int intestazione_valida(const struct intestazioneGiornale *letta, const struct intestazioneGiornale *attesa)
+{
+    return memcmp(letta, attesa, offsetof(struct intestazioneGiornale, gior_record)) == 0 &&
+           (memcmp(&(letta->gior_record), &(attesa->gior_record), sizeof(struct identitaRecord)) == 0 ||
+            memcmp(&(letta->gior_recordNuovo), &(attesa->gior_record), sizeof(struct identitaRecord)) == 0);
+}
+
+/**
+ * @brief Scrive tutti i `dimensione` byte di `dati` all'offset `offset`, anche se pwrite ne scrive di meno.
+ *
+ * @return SUCCESS se l'operazione è riuscita, ERR_SYSTEM_CALL altrimenti.
+ */
+int scrivi_a(int descrittore, const void *dati, size_t dimensione, off_t offset)
+{
+    const char *byte = (const char *)dati;
+
+    while (dimensione > 0)
+    {
+        ssize_t scritti = pwrite(descrittore, byte, dimensione, offset);
+        if (scritti == -1)
+            return ERR_SYSTEM_CALL;
+        byte += scritti;
+        dimensione -= scritti;
+        offset += scritti;
+    }
+    return SUCCESS;
+}
+
+/**
+ * @brief Legge le voci del giornale aperto in `giornale->gior_fd` e le passa ad `applica`, fino alla prima non valida.
+ *
+ * @return Il numero di voci valide, che sono le prime del file.
+ */
+uint64_t riapplica_voci(struct giornale *giornale, void (*applica)(void *, const struct voceGiornale *), void *argomento)
+{
+    struct voceGiornale voci[VOCI_PER_LETTURA];
+    uint64_t valide = 0;
+
+    while (1)
+    {
+        ssize_t letti = pread(giornale->gior_fd, voci, sizeof(voci), offset_voce(valide));
+        if (letti <= 0)
+            return valide;
+
+        size_t numero = (size_t)letti / sizeof(struct voceGiornale);
+        for (size_t i = 0; i < numero; i++)
+        {
+            if (voci[i].gior_controllo != controllo_voce(voci + i) || voci[i].gior_ordinale >= giornale->gior_intestazione.gior_numeroLibri)
+                return valide;
+            applica(argomento, voci + i);
+            valide++;
+        }
+
+        if (numero < VOCI_PER_LETTURA)
+            return valide; // resta al più una voce scritta a metà
+    }
+}
+
+/**
+ * @brief Toglie dal giornale le prime `voci` voci, già contenute nel file record.
+ *
+ * Le voci scritte dopo vengono copiate in un nuovo giornale temporaneo, sincronizzato sul disco e rinominato al posto
+ * di quello attuale. Durante la copia nessuna voce può essere aggiunta, ma sono poche: solo quelle scritte mentre il
+ * file record veniva riscritto. Il nuovo giornale è legato solo al file record annunciato da gior_nuovoRecord.
+ *
+ * @return SUCCESS se l'operazione è riuscita, ERR_SYSTEM_CALL altrimenti (il giornale attuale resta valido).
+ */
+int tronca_giornale(struct giornale *giornale, uint64_t voci)
+{
+    int risultato = ERR_SYSTEM_CALL, nuovo = -1;
+    char *temporaneo = (char *)malloc(strlen(giornale->gior_percorso) + strlen(".tmp") + 1);
+    struct intestazioneGiornale intestazione;
+
+    if (!temporaneo)
+    {
+        perror("Errore di allocazione per il nome del giornale temporaneo");
+        return ERR_SYSTEM_CALL;
+    }
+    sprintf(temporaneo, "%s.tmp", giornale->gior_percorso);
+
+    pthread_mutex_lock(&(giornale->gior_mutex));
+
+    // il descrittore viene sostituito: nessun fdatasync deve essere in corso su quello vecchio
+    while (giornale->gior_sincronizzazioneInCorso)
+        pthread_cond_wait(&(giornale->gior_condSincronizzazione), &(giornale->gior_mutex));
+
+    // un inode a 0 indica che nessun file record è stato annunciato
+    intestazione = giornale->gior_intestazione;
+    if (intestazione.gior_recordNuovo.gior_inode != 0)
+    {
+        intestazione.gior_record = intestazione.gior_recordNuovo;
+        intestazione.gior_recordNuovo = (struct identitaRecord){0};
+    }
+
+    if ((nuovo = open(temporaneo, O_RDWR | O_CREAT | O_TRUNC, 0644)) == -1 ||
+        scrivi_a(nuovo, &intestazione, sizeof(intestazione), 0) == ERR_SYSTEM_CALL)
+        goto cleanup;
+
+    struct voceGiornale buffer[VOCI_PER_LETTURA];
+    for (uint64_t copiate = 0; voci + copiate < giornale->gior_scritte;)
+    {
+        uint64_t numero = giornale->gior_scritte - voci - copiate;
+        if (numero > VOCI_PER_LETTURA)
+            numero = VOCI_PER_LETTURA;
+
+        if (pread(giornale->gior_fd, buffer, numero * sizeof(struct voceGiornale), offset_voce(voci + copiate)) != (ssize_t)(numero * sizeof(struct voceGiornale)) ||
+            scrivi_a(nuovo, buffer, numero * sizeof(struct voceGiornale), offset_voce(copiate)) == ERR_SYSTEM_CALL)
+            goto cleanup;
+        copiate += numero;
+    }
+
+    if (fdatasync(nuovo) == -1 || rename(temporaneo, giornale->gior_percorso) == -1)
+        goto cleanup;
+
+    close(giornale->gior_fd);
+    giornale->gior_fd = nuovo;
+    giornale->gior_intestazione = intestazione;
+    nuovo = -1;
+    giornale->gior_scritte -= voci;
+    giornale->gior_sincronizzate = giornale->gior_scritte; // il nuovo file è già tutto sul disco
+    pthread_cond_broadcast(&(giornale->gior_condSincronizzazione));
+    risultato = SUCCESS;
+
+cleanup:
+    if (risultato == ERR_SYSTEM_CALL)
+        perror("Errore nella compattazione del giornale dei prestiti");
+    if (nuovo != -1)
+    {
+        close(nuovo);
+        unlink(temporaneo);
+    }
+    pthread_mutex_unlock(&(giornale->gior_mutex));
+    free(temporaneo);
+    return risultato;
+}
+
+/**
+ * @brief Thread di compattazione: aspetta che il giornale superi la soglia, fa riscrivere il file record e tronca il giornale.
+ *
+ * Le voci contate prima di chiamare `gior_compatta` sono già state applicate ai libri (ogni prestito modifica il libro
+ * prima di essere registrato), quindi sono contenute nel file record riscritto.
+ */
+void *compattatore(void *arg)
+{
+    struct giornale *giornale = (struct giornale *)arg;
+
+    pthread_mutex_lock(&(giornale->gior_mutex));
+    while (1)
+    {
+        while (!(giornale->gior_chiusura) && giornale->gior_scritte < giornale->gior_prossimaCompattazione)
+            pthread_cond_wait(&(giornale->gior_condCompattazione), &(giornale->gior_mutex));
+        if (giornale->gior_chiusura)
+            break;
+
+        uint64_t voci = giornale->gior_scritte;
+        pthread_mutex_unlock(&(giornale->gior_mutex));
+
+        int risultato = giornale->gior_compatta(giornale->gior_argomento);
+        if (risultato == SUCCESS)
+            risultato = tronca_giornale(giornale, voci);
+
+        pthread_mutex_lock(&(giornale->gior_mutex));
+        // se la compattazione fallisce si riprova solo dopo altre `gior_soglia` voci, invece che subito
+        giornale->gior_prossimaCompattazione = (risultato == SUCCESS) ? giornale->gior_soglia : giornale->gior_scritte + giornale->gior_soglia;
+    }
+    pthread_mutex_unlock(&(giornale->gior_mutex));
+
+    return NULL;
+}
+
+//! FUNZIONI PUBBLICHE
+
+struct giornale gior_crea(void)
+{
+    return (struct giornale){.gior_fd = -1};
+}
+
+int gior_apri(struct giornale *giornale, const char *percorso, const struct stat *record, uint32_t numeroLibri,
+              void (*applica)(void *, const struct voceGiornale *), void *argomento)
+{
+    struct intestazioneGiornale attesa = crea_intestazione(numeroLibri, record), letta;
+    struct stat informazioni;
+
+    *giornale = gior_crea();
+    giornale->gior_intestazione = attesa;
+    if (!(giornale->gior_percorso = strdup(percorso)))
+    {
+        perror("Errore di allocazione per il percorso del giornale");
+        return ERR_SYSTEM_CALL;
+    }
+
+    if ((giornale->gior_fd = open(percorso, O_RDWR | O_CREAT, 0644)) == -1 || fstat(giornale->gior_fd, &informazioni) == -1)
+    {
+        perror("Impossibile aprire il giornale dei prestiti");
+        goto errore;
+    }
+
+    if (informazioni.st_size >= (off_t)sizeof(letta) && pread(giornale->gior_fd, &letta, sizeof(letta), 0) == (ssize_t)sizeof(letta) &&
+        intestazione_valida(&letta, &attesa))
+    {
+        giornale->gior_scritte = riapplica_voci(giornale, applica, argomento);
+        if (informazioni.st_size != offset_voce(giornale->gior_scritte))
+            printf("Il giornale %s termina con una voce non valida, verrà scartata\n", percorso);
+    }
+    else if (informazioni.st_size > 0)
+        printf("Il giornale %s non è di questo file record o di questa versione, verrà ignorato\n", percorso);
+
+    // toglie le voci non valide e lega il giornale al file record attuale, anche se era stato annunciato come nuovo
+    if (ftruncate(giornale->gior_fd, offset_voce(giornale->gior_scritte)) == -1 ||
+        scrivi_a(giornale->gior_fd, &attesa, sizeof(attesa), 0) == ERR_SYSTEM_CALL ||
+        fdatasync(giornale->gior_fd) == -1)
+    {
+        perror("Errore nella preparazione del giornale dei prestiti");
+        goto errore;
+    }
+    giornale->gior_sincronizzate = giornale->gior_scritte;
+
+    pthread_mutex_init(&(giornale->gior_mutex), NULL);
+    pthread_cond_init(&(giornale->gior_condSincronizzazione), NULL);
+    pthread_cond_init(&(giornale->gior_condCompattazione), NULL);
+    return SUCCESS;
+
+errore:
+    if (giornale->gior_fd != -1)
+        close(giornale->gior_fd);
+    free(giornale->gior_percorso);
+    *giornale = gior_crea();
+    return ERR_SYSTEM_CALL;
+}
+
+int gior_avviaCompattazione(struct giornale *giornale, uint64_t soglia, int (*compatta)(void *), void *argomento, int compattaSubito)
+{
+    int errore;
+
+    giornale->gior_soglia = soglia;
+    giornale->gior_prossimaCompattazione = compattaSubito ? 0 : soglia;
+    giornale->gior_compatta = compatta;
+    giornale->gior_argomento = argomento;
+
+    // come i worker del pool, il thread di compattazione blocca tutti i segnali: il signal handler del server non deve
+    // essere eseguito da lui, che in gior_chiudi aspetterebbe sé stesso
+    sigset_t tutti, precedenti;
+    sigfillset(&tutti);
+    pthread_sigmask(SIG_BLOCK, &tutti, &precedenti);
+    errore = pthread_create(&(giornale->gior_compattatore), NULL, compattatore, giornale);
+    pthread_sigmask(SIG_SETMASK, &precedenti, NULL);
+    if (errore)
+    {
+        printf("Impossibile avviare il thread di compattazione del giornale: %s\n", strerror(errore));
+        return ERR_SYSTEM_CALL;
+    }
+    giornale->gior_compattatoreAvviato = 1;
+    return SUCCESS;
+}
+
+int gior_registra(struct giornale *giornale, uint32_t ordinale, int64_t tempo, uint64_t *sequenza)
+{
+    *sequenza = 0;
+    if (!(giornale->gior_percorso))
+        return SUCCESS;
+
+    struct voceGiornale voce = {.gior_tempo = tempo, .gior_ordinale = ordinale};
+    voce.gior_controllo = controllo_voce(&voce);
+
+    pthread_mutex_lock(&(giornale->gior_mutex));
+
+    if (scrivi_a(giornale->gior_fd, &voce, sizeof(voce), offset_voce(giornale->gior_scritte)) == ERR_SYSTEM_CALL)
+    {
+        pthread_mutex_unlock(&(giornale->gior_mutex));
+        perror("Errore nella scrittura di un prestito nel giornale");
+        return ERR_SYSTEM_CALL;
+    }
+    *sequenza = ++(giornale->gior_scritte);
+
+    if (giornale->gior_compattatoreAvviato && giornale->gior_scritte >= giornale->gior_prossimaCompattazione)
+        pthread_cond_signal(&(giornale->gior_condCompattazione));
+
+    pthread_mutex_unlock(&(giornale->gior_mutex));
+    return SUCCESS;
+}
+
+int gior_attendi(struct giornale *giornale, uint64_t sequenza)
+{
+    if (!(giornale->gior_percorso) || sequenza == 0)
+        return SUCCESS;
+
+    int risultato = SUCCESS;
+    pthread_mutex_lock(&(giornale->gior_mutex));
+
+    // una compattazione può abbassare gior_scritte: le voci già copiate nel nuovo file sono sincronizzate
+    while (giornale->gior_sincronizzate < sequenza && giornale->gior_sincronizzate < giornale->gior_scritte)
+    {
+        if (giornale->gior_sincronizzazioneInCorso)
+        {
+            pthread_cond_wait(&(giornale->gior_condSincronizzazione), &(giornale->gior_mutex));
+            continue;
+        }
+
+        // questo thread sincronizza per tutti quelli che hanno scritto fin qui
+        uint64_t obiettivo = giornale->gior_scritte;
+        int descrittore = giornale->gior_fd; // tronca_giornale non lo sostituisce finché la sincronizzazione è in corso
+        giornale->gior_sincronizzazioneInCorso = 1;
+        pthread_mutex_unlock(&(giornale->gior_mutex));
+
+        int esito = fdatasync(descrittore);
+
+        pthread_mutex_lock(&(giornale->gior_mutex));
+        giornale->gior_sincronizzazioneInCorso = 0;
+        pthread_cond_broadcast(&(giornale->gior_condSincronizzazione));
+        if (esito == -1)
+        {
+            perror("Errore nella sincronizzazione del giornale dei prestiti");
+            risultato = ERR_SYSTEM_CALL;
+            break;
+        }
+        if (obiettivo > giornale->gior_sincronizzate)
+            giornale->gior_sincronizzate = obiettivo;
+    }
+
+    pthread_mutex_unlock(&(giornale->gior_mutex));
+    return risultato;
+}
+
+int gior_nuovoRecord(struct giornale *giornale, const struct stat *record)
+{
+    if (!(giornale->gior_percorso))
+        return SUCCESS;
+
+    int risultato = SUCCESS;
+    pthread_mutex_lock(&(giornale->gior_mutex));
+
+    // con il mutex tronca_giornale non può sostituire il descrittore durante la scrittura
+    giornale->gior_intestazione.gior_recordNuovo = identita_di(record);
+    if (scrivi_a(giornale->gior_fd, &(giornale->gior_intestazione), sizeof(struct intestazioneGiornale), 0) == ERR_SYSTEM_CALL ||
+        fdatasync(giornale->gior_fd) == -1)
+    {
+        perror("Errore nell'aggiornamento dell'intestazione del giornale dei prestiti");
+        risultato = ERR_SYSTEM_CALL;
+    }
+
+    pthread_mutex_unlock(&(giornale->gior_mutex));
+    return risultato;
+}
+
+void gior_chiudi(struct giornale *giornale)
+{
+    if (!(giornale->gior_percorso))
+        return;
+
+    if (giornale->gior_compattatoreAvviato)
+    {
+        pthread_mutex_lock(&(giornale->gior_mutex));
+        giornale->gior_chiusura = 1;
+        pthread_cond_signal(&(giornale->gior_condCompattazione));
+        pthread_mutex_unlock(&(giornale->gior_mutex));
+        pthread_join(giornale->gior_compattatore, NULL);
+    }
+
+    if (fdatasync(giornale->gior_fd) == -1 || close(giornale->gior_fd) == -1)
+        perror("Errore nella chiusura del giornale dei prestiti");
+
+    pthread_mutex_destroy(&(giornale->gior_mutex));
+    pthread_cond_destroy(&(giornale->gior_condSincronizzazione));
+    pthread_cond_destroy(&(giornale->gior_condCompattazione));
+    free(giornale->gior_percorso);
+    *giornale = gior_crea();
+}
@@ -8,146 +8,9 @@
 
 //! FUNZIONI PRIVATE
 
-//* FUNZIONI DI ACCESSO AL LIBRO
-/**
- * @brief Acquisisce l'accesso ad un libro in modo thread-safe.
- *
- * @param cond Puntatore alla variabile di condizione utilizzata per attendere che il libro diventi disponibile.
- * @return int Restituisce `SUCCESS` se l'accesso al libro è acquisito con successo; `ERR_SYSTEM_CALL` se falliscono le chiamate di sistema.
- *
- * @note È cruciale assicurarsi che `pthread_mutex_unlock` venga chiamato prima di ritornare per evitare deadlock.
- * @warning Da grandi poteri derivano grandi responsabilità. L'uso improprio dei mutex e delle variabili di condizione può portare
- *          a deadlock, inversione di priorità e altre problematiche di concorrenza. Assicurarsi che i primitivi di sincronizzazione
- *          siano utilizzati correttamente e che tutte le vie d'uscita dalla funzione rilascino le risorse acquisite.
- */
-int accedi_libro(struct libro *libro, pthread_mutex_t *mutex, pthread_cond_t *cond)
-{
-    // lock(mutex)
-    // while(libro->in_uso==1)
-    //   cond_wait(cond,mutex)
-    // libro->in_uso=1
-    // unlock(mutex)
-
-    if (pthread_mutex_lock(mutex))
-    {
-        perror("Errore lock mutex in accedi_libro");
-        return ERR_SYSTEM_CALL;
-    }
-
-    while (libro->lib_inUso == 1)
-    {
-        if (pthread_cond_wait(cond, mutex))
-        {
-            pthread_mutex_unlock(mutex);
-            perror("Errore wait cond in accedi_libro");
-            return ERR_SYSTEM_CALL;
-        }
-    }
-    libro->lib_inUso = 1;
-
-    if (pthread_mutex_unlock(mutex))
-    {
-        perror("Errore unlock mutex in accedi_libro");
-        return ERR_SYSTEM_CALL;
-    }
-
-    return SUCCESS;
-}
-
-/**
- * @brief Rilascia l'accesso ad un libro in modo thread-safe.
- *
- * Questa funzione rilascia l'accesso a una risorsa libro precedentemente acquisita, impostando il campo `in_uso`
- * della struttura `libro` a 0. Utilizza un mutex per garantire l'esclusione mutua durante l'aggiornamento dello stato del libro
- * e segnala a un altro thread in attesa (se presente) che il libro è ora disponibile utilizzando una variabile di condizione.
- *
- * @return int Restituisce `SUCCESS` se il libro è stato rilasciato con successo; `ERR_SYSTEM_CALL` se falliscono le chiamate di sistema.
- *
- * @note Questa funzione dovrebbe essere chiamata dopo aver completato l'accesso al libro per permettere ad altri thread
- *       di accedere alla risorsa in modo ordinato e senza conflitti.
- * @warning Da grandi poteri derivano grandi responsabilità. È importante assicurarsi che tutte le operazioni su mutex e variabili di condizione
- *          siano eseguite correttamente per prevenire deadlock e garantire l'integrità dei dati tra i thread.
- */
-int esci_libro(struct libro *libro, pthread_mutex_t *mutex, pthread_cond_t *cond)
-{
-
-    // lock(mutex)
-    // libro->in_uso=0
-    // cond_signal(cond)
-    // unlock(mutex)
-
-    if (pthread_mutex_lock(mutex))
-    {
-        perror("Errore lock mutex in esci_libro");
-        return ERR_SYSTEM_CALL;
-    }
-
-    libro->lib_inUso = 0;
-
-    if (pthread_cond_signal(cond))
-    {
-        pthread_mutex_unlock(mutex);
-        perror("Errore signal cond in esci_libro");
-        return ERR_SYSTEM_CALL;
-    }
-
-    if (pthread_mutex_unlock(mutex))
-    {
-        perror("Errore unlock mutex in esci_libro");
-        return ERR_SYSTEM_CALL;
-    }
-
-    return SUCCESS;
-}
-
 //*FUNZIONI PER IL PRESTITO
 /**
- * @brief Controlla lo stato del prestito di un libro e determina se il periodo di prestito è scaduto.
- *
- * Questa funzione verifica se un libro, rappresentato dalla struttura `libro`, è attualmente in prestito.
- * Se il libro non è in prestito, la funzione ritorna immediatamente. Altrimenti, calcola la differenza
- * tra la data corrente e la data di inizio del prestito (`data_prestito`). Se questa differenza supera
- * 30 secondi, il prestito viene considerato scaduto, il libro viene marcato come non in prestito
- * (`prestito` impostato a 0), e la funzione ritorna 0. Se il calcolo della differenza di tempo fallisce,
- * ritorna un codice di errore.
- *
- * @return int Restituisce 0 se il libro non è in prestito o se il prestito è scaduto, 1 se il libro è ancora in prestito,
- *         o `ERR_SYSTEM_CALL` in caso di fallimento delle chiamate di sistema durante il controllo.
- *
- * @warning Gestire accuratamente i valori di ritorno e gli stati di errore per evitare comportamenti imprevisti o inconsistenze nei dati.
- */
-int controllo_prestito(struct libro *libro)
-{
-    int error;
-
-    if (libro->lib_inPrestito == 0)
-        return 0;
-
-    struct tm now;
-    if (pt_currentTime(&now) == ERR_SYSTEM_CALL)
-    {
-        perror("Errore ottenimento tempo corrente in controllo_prestito");
-        return ERR_SYSTEM_CALL;
-    }
-
-    error = pt_secDiff(&(libro->lib_dataPrestito), &now);
-    if ((error) > 30)
-    {
-        libro->lib_inPrestito = 0;
-        return 0;
-    }
-    else if (error == ERR_SYSTEM_CALL)
-    {
-        perror("Errore differenza secondi in controllo_prestito");
-        return ERR_SYSTEM_CALL;
-    }
-
-    return 1;
-}
-
-/**
- * @brief Rimuove il campo "prestito" dalla stringa di dettagli di un libro e aggiorna le informazioni di prestito
- *        nello struct data `lib_dataPrestito`.
+ * @brief Rimuove il campo "prestito" dalla stringa di dettagli di un libro e ne scrive l'istante in `lib_prestito`.
  *
  * Questa funzione cerca il campo "prestito" all'interno della stringa di dettagli `lib_stringa` di un libro.
  * Se il campo viene trovato, viene rimosso dalla stringa e le informazioni relative vengono utilizzate per aggiornare
@@ -178,7 +41,8 @@ int rimuoviCampoPrestito(struct libro *libro)
 
         lib_formattaStringa(valore);
 
-        int result = pt_estraiData(&(libro->lib_dataPrestito), valore);
+        time_t tempo;
+        int result = pt_estraiTempo(&tempo, valore);
         if (result == ERR_FORMATO || result == ERR_SYSTEM_CALL)
         {
             free(valore);
@@ -186,20 +50,14 @@ int rimuoviCampoPrestito(struct libro *libro)
             return (result == ERR_FORMATO) ? ERR_FORMATO_DATA : ERR_SYSTEM_CALL;
         }
 
-        libro->lib_inPrestito = 1;
+        atomic_init(&(libro->lib_prestito), (int64_t)tempo);
 
         free(valore);
+        // la stringa si accorcia sul posto: la memoria dell'arena non si può riallocare
         memmove(campoPrestito, puntoEVirgola + 1, strlen(puntoEVirgola + 1) + 1);
-
-        libro->lib_stringa = realloc(libro->lib_stringa, strlen(libro->lib_stringa) + 1);
-        if (!(libro->lib_stringa))
-        {
-            perror("Errore reallocazione memoria in rimuoviCampoPrestito");
-            return ERR_SYSTEM_CALL;
-        }
     }
     else
-        libro->lib_inPrestito = 0;
+        atomic_init(&(libro->lib_prestito), LIB_NESSUN_PRESTITO);
 
     return SUCCESS;
 }
@@ -263,12 +121,56 @@ void formattaPerVisualizzazione(char *str)
     str[j] = '\0';
 }
 
+//* FUNZIONI PER LE COPPIE DEL LIBRO
+
+/**
+ * @brief Divide `lib_stringa` nelle coppie campo:valore del libro, normalizzate con lib_formattaStringa.
+ *
+ * Campi e valori vengono salvati in `lib_normalizzata`, una copia di `lib_stringa` in cui i delimitatori sono
+ * sostituiti da '\0', e `lib_coppie` punta al loro interno. Gli id dei campi restano ID_COPPIA_NON_ASSEGNATO finché
+ * la struttura dati non li assegna.
+ *
+ * Tutta la memoria viene presa da `arena`: l'array delle coppie è dimensionato una volta sola sul numero di ':'
+ * della stringa, che è un limite superiore al numero di coppie.
+ *
+ * @return int `SUCCESS` se l'operazione è riuscita, `ERR_SYSTEM_CALL` in caso di errore di allocazione.
+ */
+int analizzaCoppie(struct libro *libro, struct arena *arena)
+{
+    char *campo, *valore;
+    size_t capacita = 1;
+
+    for (const char *carattere = libro->lib_stringa; *carattere; carattere++)
+        capacita += (*carattere == ':');
+
+    libro->lib_normalizzata = ar_strdup(arena, libro->lib_stringa);
+    libro->lib_coppie = (struct coppiaLibro *)ar_alloc(arena, capacita * sizeof(struct coppiaLibro));
+    if (!(libro->lib_normalizzata) || !(libro->lib_coppie))
+        return ERR_SYSTEM_CALL;
+
+    if (!lib_estraiCoppia(libro->lib_normalizzata, &campo, &valore))
+        return SUCCESS;
+
+    do
+    {
+        lib_formattaStringa(campo);
+        lib_formattaStringa(valore);
+        libro->lib_coppie[libro->lib_numeroCoppie++] = (struct coppiaLibro){.lib_campo = campo, .lib_valore = valore, .lib_idCampo = ID_COPPIA_NON_ASSEGNATO};
+
+    } while (lib_estraiCoppia(NULL, &campo, &valore));
+
+    return SUCCESS;
+}
+
 //! FUNZIONI PUBLICCHE
 
 int lib_estraiCoppia(char *stringa, char **campo, char **valore)
 {
-    if (((*campo) = strtok(stringa, ":")) &&
-        ((*valore) = strtok(NULL, ";")))
+    // la posizione raggiunta è per thread, così thread diversi possono estrarre coppie da stringhe diverse
+    static _Thread_local char *posizione = NULL;
+
+    if (((*campo) = strtok_r(stringa, ":", &posizione)) &&
+        ((*valore) = strtok_r(NULL, ";", &posizione)))
         return 1;
     return 0;
 }
@@ -325,12 +227,14 @@ int lib_controllaFormatoCorretto(const char *stringa)
     return 1;
 }
 
-int lib_crea(struct libro *dst, const char *str)
+int lib_crea(struct libro *dst, const char *str, size_t lunghezza, struct arena *arena)
 {
     *dst = (struct libro){
-        .lib_stringa = (char *)malloc(strlen(str) + 1),
-        .lib_inUso = 0,
-        .lib_inPrestito = 0};
+        .lib_stringa = ar_strndup(arena, str, lunghezza),
+        .lib_normalizzata = NULL,
+        .lib_coppie = NULL,
+        .lib_numeroCoppie = 0};
+    atomic_init(&(dst->lib_prestito), LIB_NESSUN_PRESTITO);
 
     if (!(dst->lib_stringa))
     {
@@ -338,7 +242,8 @@ int lib_crea(struct libro *dst, const char *str)
         return ERR_SYSTEM_CALL;
     }
 
-    strcpy(dst->lib_stringa, str);
+    if (!lib_controllaFormatoCorretto(dst->lib_stringa))
+        return ERR_FORMATO_STR;
 
     if ((dst->lib_stringa)[strlen(dst->lib_stringa) - 1] == '\n')
         (dst->lib_stringa)[strlen(dst->lib_stringa) - 1] = '\0';
@@ -348,189 +253,107 @@ int lib_crea(struct libro *dst, const char *str)
     int op = rimuoviCampoPrestito(dst);
     if (op == ERR_FORMATO_DATA || op == ERR_SYSTEM_CALL)
     {
-        free(dst->lib_stringa);
         perror("Errore nella rimozione del campo prestito");
         return op;
     }
+    dst->lib_lunghezza = strlen(dst->lib_stringa);
+
+    if (analizzaCoppie(dst, arena) == ERR_SYSTEM_CALL)
+    {
+        perror("Errore nell'analisi delle coppie del libro");
+        return ERR_SYSTEM_CALL;
+    }
 
     return SUCCESS;
 }
 
 char *lib_leggi(struct libro *libro)
 {
-    char *result = (char *)malloc(strlen(libro->lib_stringa) + 2);
+    char *result = (char *)malloc(libro->lib_lunghezza + LIB_DIMENSIONE_PRESTITO);
     if (!result)
     {
         perror("Errore di allocazione per result in lib_leggi");
         return NULL;
     }
 
-    strcpy(result, libro->lib_stringa);
-    int prestito = controllo_prestito(libro);
-    if (prestito == ERR_SYSTEM_CALL)
+    memcpy(result, libro->lib_stringa, libro->lib_lunghezza);
+    if (lib_scriviPrestito(libro, result + libro->lib_lunghezza) == ERR_SYSTEM_CALL)
     {
         free(result);
-        perror("Errore di sistema in controllo_prestito");
         return NULL;
     }
-    if (prestito)
-    {
-        result = realloc(result, strlen(libro->lib_stringa) + strlen(" prestito: gg-mm-aaaa hh:mn:sc;\n") + 1);
-        if (!result)
-        {
-            perror("Errore di reallocazione per result in lib_leggi");
-            return NULL;
-        }
-
-        char valore[20] = "gg-mm-aaaa hh:mn:sc";
-        if (pt_creaStringaData(valore, sizeof(valore), &(libro->lib_dataPrestito)) == ERR_SYSTEM_CALL)
-        {
-            free(result);
-            perror("Errore nella creazione della stringa data");
-            return NULL;
-        }
-
-        strcat(result, " prestito: ");
-        strcat(result, valore);
-        strcat(result, ";");
-    }
-    strcat(result, "\n");
 
     return result;
 }
 
-char *lib_leggiThreadSafe(struct libro *libro, pthread_mutex_t *mutex, pthread_cond_t *cond)
+int lib_scriviPrestito(struct libro *libro, char *dst)
 {
-    char *result;
-
-    if (accedi_libro(libro, mutex, cond) == ERR_SYSTEM_CALL)
+    // un solo load: data e stato del prestito stampati sono sempre della stessa parola
+    int64_t prestito = atomic_load(&(libro->lib_prestito));
+    if (!lib_prestitoInCorso(prestito, (int64_t)time(NULL)))
     {
-        perror("Errore di accesso thread-safe al libro");
-        return NULL;
+        strcpy(dst, "\n");
+        return 1;
     }
 
-    result = lib_leggi(libro);
-
-    if (esci_libro(libro, mutex, cond) == ERR_SYSTEM_CALL)
+    char valore[20] = "gg-mm-aaaa hh:mn:sc";
+    if (pt_creaStringaTempo(valore, sizeof(valore), (time_t)prestito) == ERR_SYSTEM_CALL)
     {
-        if (result)
-            free(result);
-        perror("Errore nell'uscita thread-safe dal libro");
-        return NULL;
+        perror("Errore nella creazione della stringa data");
+        return ERR_SYSTEM_CALL;
     }
 
-    return result;
+    return snprintf(dst, LIB_DIMENSIONE_PRESTITO, " prestito: %s;\n", valore);
 }
 
-int lib_prestaThreadSafe(struct libro *libro, pthread_mutex_t *mutex, pthread_cond_t *cond)
+int lib_prestitoInCorso(int64_t prestito, int64_t adesso)
 {
-    if (accedi_libro(libro, mutex, cond) == ERR_SYSTEM_CALL)
-    {
-        perror("Errore di accesso thread-safe al libro per prestito");
-        return ERR_SYSTEM_CALL;
-    }
-
-    int statoPrestito = controllo_prestito(libro);
-    if (statoPrestito == ERR_SYSTEM_CALL)
-    {
-        esci_libro(libro, mutex, cond);
-        perror("Errore di sistema nel controllo del prestito");
-        return ERR_SYSTEM_CALL;
-    }
-
-    if (statoPrestito == 1)
-    {
-        if (esci_libro(libro, mutex, cond) == ERR_SYSTEM_CALL)
-        {
-            perror("Errore nell'uscita thread-safe dal libro dopo controllo prestito");
-            return ERR_SYSTEM_CALL;
-        }
-        return 0; // libro già in prestito
-    }
-
-    if (pt_currentTime(&(libro->lib_dataPrestito)) == ERR_SYSTEM_CALL)
-    {
-        esci_libro(libro, mutex, cond);
-        perror("Errore nell'impostazione della data corrente per il prestito");
-        return ERR_SYSTEM_CALL;
-    }
-    libro->lib_inPrestito = 1;
-
-    if (esci_libro(libro, mutex, cond) == ERR_SYSTEM_CALL)
-    {
-        perror("Errore nell'uscita thread-safe dal libro dopo prestito");
-        return ERR_SYSTEM_CALL;
-    }
-
-    return 1;
+    return prestito != LIB_NESSUN_PRESTITO && adesso - prestito <= LIB_DURATA_PRESTITO;
 }
 
-int lib_controllaRichiestaThreadSafe(struct libro *libro, const char *richiesta, pthread_mutex_t *mutex, pthread_cond_t *cond)
+int lib_prestaThreadSafe(struct libro *libro, int64_t *tempoPrestito, int64_t *precedente)
 {
-    char *copia_ric, *stringa_libro;
-
-    copia_ric = strdup(richiesta);
-    if (!copia_ric)
-    {
-        perror("Errore di duplicazione della richiesta");
-        return ERR_SYSTEM_CALL;
-    }
-
-    stringa_libro = lib_leggiThreadSafe(libro, mutex, cond);
-    if (!stringa_libro)
-    {
-        free(copia_ric);
-        perror("Errore nella lettura thread-safe del libro");
-        return ERR_SYSTEM_CALL;
-    }
-
-    lib_formattaStringa(stringa_libro);
-
-    char *campo_temp, *valore_temp;
-
-    lib_estraiCoppia(copia_ric, &campo_temp, &valore_temp);
+    int64_t adesso = (int64_t)time(NULL);
+    int64_t prestito = atomic_load(&(libro->lib_prestito));
 
+    // se la compare-and-swap fallisce `prestito` riceve il valore scritto dall'altro thread e si ricontrolla
     do
     {
-        lib_formattaStringa(campo_temp);
-        lib_formattaStringa(valore_temp);
-
-        char *ricorrenza_campo = stringa_libro, *ricorrenza_valore, *puntoEVirgola;
-        int trovato = 0;
-        while ((ricorrenza_campo = strstr(ricorrenza_campo, campo_temp)))
-        {
-            trovato = (ricorrenza_valore = strstr(ricorrenza_campo, valore_temp)) &&
-                      (puntoEVirgola = strchr(ricorrenza_campo, ';')) &&
-                      (ricorrenza_valore < puntoEVirgola);
-
-            if (trovato)
-                break;
-
-            ricorrenza_campo++;
-        }
+        if (lib_prestitoInCorso(prestito, adesso))
+            return 0; // libro già in prestito
+    } while (!atomic_compare_exchange_weak(&(libro->lib_prestito), &prestito, adesso));
 
-        if (!trovato)
-        {
-            free(copia_ric);
-            free(stringa_libro);
-            return 0;
-        }
+    if (tempoPrestito)
+        *tempoPrestito = adesso;
+    if (precedente)
+        *precedente = prestito;
 
-    } while (lib_estraiCoppia(NULL, &campo_temp, &valore_temp));
-
-    free(copia_ric);
-    free(stringa_libro);
     return 1;
 }
 
-void lib_free(struct libro *libro)
+int lib_annullaPrestito(struct libro *libro, int64_t tempoPrestito, int64_t precedente)
+{
+    return atomic_compare_exchange_strong(&(libro->lib_prestito), &tempoPrestito, precedente);
+}
+
+void lib_copiaThreadSafe(const struct libro *libro, struct libro *copia)
 {
-    if (!libro)
-        return;
+    *copia = (struct libro){
+        .lib_stringa = libro->lib_stringa,
+        .lib_lunghezza = libro->lib_lunghezza,
+        .lib_normalizzata = libro->lib_normalizzata,
+        .lib_coppie = libro->lib_coppie,
+        .lib_numeroCoppie = libro->lib_numeroCoppie,
+        .lib_ordinale = libro->lib_ordinale};
+    atomic_init(&(copia->lib_prestito), atomic_load(&(libro->lib_prestito)));
+}
 
-    if (libro->lib_stringa)
+int lib_contieneCoppia(const struct libro *libro, int idCampo, const char *valore)
+{
+    for (int index = 0; index < libro->lib_numeroCoppie; index++)
     {
-        free(libro->lib_stringa);
-        libro->lib_stringa = NULL;
+        if (libro->lib_coppie[index].lib_idCampo == idCampo && strstr(libro->lib_coppie[index].lib_valore, valore))
+            return 1;
     }
+    return 0;
 }
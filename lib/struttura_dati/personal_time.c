@@ -31,18 +31,15 @@ int pt_estraiData(struct tm *dst, const char *src)
 int pt_currentTime(struct tm *dst)
 {
     time_t t;
-    struct tm *now;
 
+    // localtime_r scrive direttamente in dst: localtime userebbe un buffer condiviso da tutti i thread
     time(&t);
-    now = localtime(&t);
-    if (!now)
+    if (!localtime_r(&t, dst))
     {
-        perror("Errore in localtime: impossibile ottenere l'ora locale");
+        perror("Errore in localtime_r: impossibile ottenere l'ora locale");
         return ERR_SYSTEM_CALL;
     }
 
-    memcpy(dst, now, sizeof(struct tm)); // Copia i valori in dst
-
     return SUCCESS;
 }
 
@@ -76,3 +73,33 @@ int pt_creaStringaData(char *dst, size_t size, const struct tm *src)
 
     return SUCCESS;
 }
+
+int pt_estraiTempo(time_t *dst, const char *src)
+{
+    struct tm data;
+    int risultato = pt_estraiData(&data, src);
+    if (risultato != SUCCESS)
+        return risultato;
+
+    data.tm_isdst = -1; // l'ora legale la decide mktime, come per la data scritta da pt_creaStringaTempo
+    *dst = mktime(&data);
+    if (*dst == (time_t)-1)
+    {
+        perror("Errore in mktime: impossibile convertire la data");
+        return ERR_SYSTEM_CALL;
+    }
+
+    return SUCCESS;
+}
+
+int pt_creaStringaTempo(char *dst, size_t size, time_t src)
+{
+    struct tm data;
+    if (!localtime_r(&src, &data))
+    {
+        perror("Errore in localtime_r: impossibile convertire l'istante");
+        return ERR_SYSTEM_CALL;
+    }
+
+    return pt_creaStringaData(dst, size, &data);
+}
@@ -0,0 +1,185 @@
+#include "../../include/struttura_dati/snapshot.h"
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+
+//! FUNZIONI PRIVATE
+
+#define ALLINEAMENTO 8
+
+/**
+ * @brief Scrive tutti i `dimensione` byte di `dati` nel file `descrittore`, anche se write ne scrive di meno.
+ *
+ * @return SUCCESS se l'operazione è riuscita, FAILURE altrimenti.
+ */
+int scrivi_tutto(int descrittore, const char *dati, size_t dimensione)
+{
+    while (dimensione > 0)
+    {
+        ssize_t scritti = write(descrittore, dati, dimensione);
+        if (scritti == -1)
+            return FAILURE;
+        dati += scritti;
+        dimensione -= scritti;
+    }
+    return SUCCESS;
+}
+
+//! FUNZIONI PUBBLICHE
+
+struct snapshotScrittura snap_creaScrittura(void)
+{
+    return (struct snapshotScrittura){NULL, 0, 0};
+}
+
+uint64_t snap_aggiungi(struct snapshotScrittura *snapshot, const void *dati, size_t dimensione)
+{
+    size_t offset = (snapshot->snap_dimensione + ALLINEAMENTO - 1) & ~(size_t)(ALLINEAMENTO - 1);
+
+    if (offset + dimensione > snapshot->snap_capacita)
+    {
+        size_t nuovaCapacita = snapshot->snap_capacita ? snapshot->snap_capacita : 4096;
+        while (nuovaCapacita < offset + dimensione)
+            nuovaCapacita *= 2;
+
+        char *nuoviDati = (char *)realloc(snapshot->snap_dati, nuovaCapacita);
+        if (!nuoviDati)
+            return SNAP_OFFSET_NULLO;
+        snapshot->snap_dati = nuoviDati;
+        snapshot->snap_capacita = nuovaCapacita;
+    }
+
+    // anche il padding viene azzerato, così lo stesso contenuto produce sempre lo stesso file
+    memset(snapshot->snap_dati + snapshot->snap_dimensione, 0, offset - snapshot->snap_dimensione);
+    if (dati)
+        memcpy(snapshot->snap_dati + offset, dati, dimensione);
+    else
+        memset(snapshot->snap_dati + offset, 0, dimensione);
+
+    snapshot->snap_dimensione = offset + dimensione;
+    return offset;
+}
+
+uint64_t snap_aggiungiStringa(struct snapshotScrittura *snapshot, const char *stringa)
+{
+    return snap_aggiungi(snapshot, stringa, strlen(stringa) + 1);
+}
+
+void *snap_at(struct snapshotScrittura *snapshot, uint64_t offset)
+{
+    return snapshot->snap_dati + offset;
+}
+
+int snap_salva(struct snapshotScrittura *snapshot, const char *percorso)
+{
+    char *temporaneo = (char *)malloc(strlen(percorso) + strlen(".tmp") + 1);
+    if (!temporaneo)
+    {
+        perror("Errore di allocazione per il nome del file temporaneo dello snapshot");
+        return FAILURE;
+    }
+    sprintf(temporaneo, "%s.tmp", percorso);
+
+    int descrittore = open(temporaneo, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (descrittore == -1)
+    {
+        perror("Impossibile creare il file temporaneo dello snapshot");
+        free(temporaneo);
+        return FAILURE;
+    }
+
+    if (scrivi_tutto(descrittore, snapshot->snap_dati, snapshot->snap_dimensione) == FAILURE || fsync(descrittore) == -1)
+    {
+        perror("Errore nella scrittura dello snapshot");
+        close(descrittore);
+        unlink(temporaneo);
+        free(temporaneo);
+        return FAILURE;
+    }
+
+    if (close(descrittore) == -1 || rename(temporaneo, percorso) == -1)
+    {
+        perror("Errore nella sostituzione dello snapshot");
+        unlink(temporaneo);
+        free(temporaneo);
+        return FAILURE;
+    }
+
+    free(temporaneo);
+    return SUCCESS;
+}
+
+void snap_distruggiScrittura(struct snapshotScrittura *snapshot)
+{
+    free(snapshot->snap_dati);
+    *snapshot = snap_creaScrittura();
+}
+
+int snap_apri(struct snapshotLettura *snapshot, const char *percorso, const struct stat *record)
+{
+    struct stat informazioni;
+    *snapshot = (struct snapshotLettura){NULL, 0};
+
+    int descrittore = open(percorso, O_RDONLY);
+    if (descrittore == -1)
+        return FAILURE; // nessuno snapshot, succede al primo avvio
+
+    if (fstat(descrittore, &informazioni) == -1 || (size_t)informazioni.st_size < sizeof(struct snap_intestazione))
+    {
+        close(descrittore);
+        return FAILURE;
+    }
+
+    void *dati = mmap(NULL, informazioni.st_size, PROT_READ, MAP_PRIVATE, descrittore, 0);
+    close(descrittore);
+    if (dati == MAP_FAILED)
+    {
+        perror("Errore nella mappatura in memoria dello snapshot");
+        return FAILURE;
+    }
+
+    const struct snap_intestazione *intestazione = (const struct snap_intestazione *)dati;
+    if (memcmp(intestazione->snap_magico, SNAP_MAGICO, sizeof(SNAP_MAGICO)) != 0 ||
+        intestazione->snap_versione != SNAP_VERSIONE || intestazione->snap_controllo != SNAP_CONTROLLO ||
+        intestazione->snap_dimensione != (uint64_t)informazioni.st_size)
+    {
+        printf("Lo snapshot %s non è valido o è di un'altra versione, verrà ignorato\n", percorso);
+        munmap(dati, informazioni.st_size);
+        return FAILURE;
+    }
+
+    if (intestazione->snap_dimensioneRecord != (uint64_t)record->st_size || intestazione->snap_inodeRecord != (uint64_t)record->st_ino ||
+        intestazione->snap_modificaRecord != (int64_t)record->st_mtim.tv_sec || intestazione->snap_modificaRecordNs != (int64_t)record->st_mtim.tv_nsec)
+    {
+        printf("Il file record è cambiato dopo lo snapshot %s, verrà ignorato\n", percorso);
+        munmap(dati, informazioni.st_size);
+        return FAILURE;
+    }
+
+    *snapshot = (struct snapshotLettura){(const char *)dati, (size_t)informazioni.st_size};
+    return SUCCESS;
+}
+
+const void *snap_leggi(const struct snapshotLettura *snapshot, uint64_t offset, uint64_t dimensione)
+{
+    if (offset > snapshot->snap_dimensione || dimensione > snapshot->snap_dimensione - offset)
+        return NULL;
+    return snapshot->snap_dati + offset;
+}
+
+const char *snap_leggiStringa(const struct snapshotLettura *snapshot, uint64_t offset)
+{
+    if (offset >= snapshot->snap_dimensione || !memchr(snapshot->snap_dati + offset, '\0', snapshot->snap_dimensione - offset))
+        return NULL;
+    return snapshot->snap_dati + offset;
+}
+
+void snap_chiudi(struct snapshotLettura *snapshot)
+{
+    if (snapshot->snap_dati)
+        munmap((void *)snapshot->snap_dati, snapshot->snap_dimensione);
+    *snapshot = (struct snapshotLettura){NULL, 0};
+}
@@ -3,189 +3,438 @@
 #include <string.h>
 #include <stdio.h>
 #include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
 
 //! FUNZIONI PRIVATE
 
+//* CARICAMENTO PARALLELO DEL FILE RECORD
+
 /**
- * @brief Legge o presta una lista di libri.
+ * @brief Porzione del file record caricata da un thread.
  *
- * Itera attraverso un array dinamico di libri, prestando o leggendo ciascun libro basandosi sul parametro `presta`.
- * Aggrega le stringhe dei libri letti o prestati in un'unica stringa di risposta. Ritorna NULL in caso di fallimento dell'allocazione
- * di memoria o se la lettura/prestito fallisce.
+ * @param inizio, fine La porzione di file mappato, che inizia all'inizio di una riga e finisce dopo un '\n' o alla fine del file.
+ * @param arena Arena del thread, unita a quella della struttura dati alla fine del caricamento.
+ * @param libri Array dinamico di `struct libro *`, i libri della porzione nell'ordine del file.
+ * @param arrayCampi, direttorioCampi Indice parziale dei libri della porzione.
+ * @param primoOrdinale Ordinale del primo libro della porzione, noto solo dopo che tutte le porzioni sono state analizzate.
+ * @param errore `SUCCESS`, o l'errore che ha interrotto il thread.
+ */
+struct porzioneFile
+{
+    const char *inizio, *fine;
+    struct arena arena;
+    struct dynamic_array libri;
+    struct dynamic_array arrayCampi;
+    struct hash_table direttorioCampi;
+    uint32_t primoOrdinale;
+    int errore;
+};
+
+/**
+ * @brief Sceglie quanti thread usare per caricare un file record di `dimensione` byte.
+ *
+ * Uno per processore, ma mai più di MAX_THREAD_CARICAMENTO e mai con porzioni più piccole di MIN_PORZIONE_CARICAMENTO,
+ * per cui per i file piccoli basta il thread chiamante.
+ */
+int numero_thread_caricamento(size_t dimensione)
+{
+    long processori = sysconf(_SC_NPROCESSORS_ONLN);
+    size_t numero = (processori > 0) ? (size_t)processori : 1;
+
+    if (numero > MAX_THREAD_CARICAMENTO)
+        numero = MAX_THREAD_CARICAMENTO;
+    if (numero > dimensione / MIN_PORZIONE_CARICAMENTO + 1)
+        numero = dimensione / MIN_PORZIONE_CARICAMENTO + 1;
+
+    return (int)numero;
+}
+
+/**
+ * @brief Divide il file mappato in al più `massimo` porzioni di dimensione simile, tagliando solo dopo un '\n'.
  *
- * @param libri_prestati_o_letti Puntatore a un intero per tenere traccia del numero di libri letti o prestati.
- * @param presta Flag che indica se prestare i libri (1) o solo leggerli (0).
- * @return char* Stringa aggregata contenente i libri letti o prestati, o NULL in caso di errore di allocazione di memoria
- * o fallimento nel prestito/lettura dei libri.
+ * @return int Il numero di porzioni, minore di `massimo` se alcune righe sono più lunghe di una porzione.
  */
-char *leggi_o_presta_lista(struct dynamic_array *lista_libri, int *libri_prestati_o_letti, const int presta, pthread_mutex_t *mutex, pthread_cond_t *cond)
+int dividi_file(const char *file, size_t dimensione, struct porzioneFile *porzioni, int massimo)
 {
-    struct libro **corrente = NULL;
-    char *stringa_libro = NULL, *risposta = NULL;
-    *libri_prestati_o_letti = 0;
+    const char *inizio = file, *fineFile = file + dimensione;
+    int numero = 0;
 
-    risposta = (char *)malloc(sizeof(char));
-    if (!risposta)
+    while (inizio < fineFile && numero < massimo)
     {
-        perror("Errore di allocazione memoria per risposta");
-        return NULL;
+        const char *fine = fineFile;
+
+        if (numero < massimo - 1 && (size_t)(fineFile - inizio) > dimensione / massimo)
+        {
+            const char *nuovaRiga = memchr(inizio + dimensione / massimo, '\n', fineFile - (inizio + dimensione / massimo));
+            if (nuovaRiga)
+                fine = nuovaRiga + 1;
+        }
+
+        porzioni[numero++] = (struct porzioneFile){.inizio = inizio, .fine = fine, .errore = SUCCESS};
+        inizio = fine;
     }
-    *risposta = '\0';
 
-    for (int index = 0; index < lista_libri->da_inserted; index++)
+    return numero;
+}
+
+/**
+ * @brief Funzione dei thread del caricamento: crea in `arg` (una `struct porzioneFile`) i libri della sua porzione.
+ *
+ * Le righe troppo corte per contenere un libro vengono ignorate. Non c'è un limite alla lunghezza delle righe.
+ */
+void *analizza_porzione(void *arg)
+{
+    struct porzioneFile *porzione = (struct porzioneFile *)arg;
+    const char *riga = porzione->inizio;
+
+    while (riga < porzione->fine)
     {
-        corrente = (struct libro **)da_at(lista_libri, index);
+        const char *nuovaRiga = memchr(riga, '\n', porzione->fine - riga),
+                   *fineRiga = nuovaRiga ? nuovaRiga : porzione->fine;
+        size_t lunghezza = fineRiga - riga;
 
-        if (presta)
+        if (lunghezza >= 2)
         {
-            int prestato = lib_prestaThreadSafe(*corrente, mutex, cond);
-            if (prestato == ERR_SYSTEM_CALL)
+            struct libro *temp = (struct libro *)ar_alloc(&(porzione->arena), sizeof(struct libro));
+            int errore = temp ? lib_crea(temp, riga, lunghezza, &(porzione->arena)) : ERR_SYSTEM_CALL;
+            if (errore != SUCCESS)
             {
-                free(risposta);
-                perror("Fallimento nel prestito del libro in modo thread-safe");
+                printf((errore == ERR_FORMATO_STR) ? "Formato record non corretto nel file\n"
+                                                   : "Errore nella creazione del libro dalla riga del file\n");
+                porzione->errore = (errore == ERR_FORMATO_STR || errore == ERR_FORMATO_DATA) ? errore : ERR_SYSTEM_CALL;
                 return NULL;
             }
-            if (!prestato)
-                continue;
-        }
 
-        stringa_libro = lib_leggiThreadSafe(*corrente, mutex, cond);
-        if (!stringa_libro)
-        {
-            free(risposta);
-            perror("Fallimento nella lettura del libro in modo thread-safe");
-            return NULL;
+            if (da_append(&(porzione->libri), &temp) == FAILURE)
+            {
+                perror("Errore nell'aggiunta del libro alla porzione");
+                porzione->errore = ERR_SYSTEM_CALL;
+                return NULL;
+            }
         }
 
-        char *temp_risposta = realloc(risposta, strlen(risposta) + strlen(stringa_libro) + 1);
-        if (!temp_risposta)
+        riga = fineRiga + 1;
+    }
+
+    return NULL;
+}
+
+/**
+ * @brief Funzione dei thread del caricamento: assegna gli ordinali ai libri di `arg` e costruisce il suo indice parziale.
+ */
+void *indicizza_porzione(void *arg)
+{
+    struct porzioneFile *porzione = (struct porzioneFile *)arg;
+
+    for (int index = 0; index < (porzione->libri).da_inserted; index++)
+    {
+        struct libro *libro = *(struct libro **)da_at(&(porzione->libri), index);
+        libro->lib_ordinale = porzione->primoOrdinale + index;
+
+        if (arrCampi_aggiungiLibroParziale(&(porzione->arrayCampi), &(porzione->direttorioCampi), &(porzione->arena), libro) == ERR_SYSTEM_CALL)
         {
-            free(stringa_libro);
-            free(risposta);
-            perror("Errore di reallocazione per aggiornare la risposta");
+            printf("Errore nell'indicizzazione di un libro della porzione\n");
+            porzione->errore = ERR_SYSTEM_CALL;
             return NULL;
         }
-        risposta = temp_risposta;
-
-        strcat(risposta, stringa_libro);
-        free(stringa_libro);
-        (*libri_prestati_o_letti)++;
     }
 
-    return risposta;
+    return NULL;
 }
 
-//! FUNZIONI PUBBLICHE
-
-int str_d_genera(struct strutturaDati *struttura_dati, const char *file_record)
+/**
+ * @brief Esegue `funzione` su ogni porzione, ognuna in un thread. La prima porzione è eseguita dal thread chiamante,
+ *        come quelle per cui non si riesce a creare un thread.
+ *
+ * @return int `SUCCESS`, o l'errore della prima porzione fallita.
+ */
+int esegui_su_porzioni(void *(*funzione)(void *), struct porzioneFile *porzioni, int numero)
 {
-    struttura_dati->str_d_arrayCampi = da_create(sizeof(struct campoAlbero), 10);
-    if (!((struttura_dati->str_d_arrayCampi).da_ptrArray))
+    pthread_t thread[MAX_THREAD_CARICAMENTO];
+    int creato[MAX_THREAD_CARICAMENTO] = {0};
+
+    for (int index = 1; index < numero; index++)
+        creato[index] = (pthread_create(thread + index, NULL, funzione, porzioni + index) == 0);
+
+    funzione(porzioni);
+
+    for (int index = 1; index < numero; index++)
     {
-        perror("Errore nella creazione dell'array dei campi");
-        return ERR_SYSTEM_CALL;
+        if (creato[index])
+            pthread_join(thread[index], NULL);
+        else
+            funzione(porzioni + index);
     }
 
-    struttura_dati->str_d_ptrLibri = da_create(sizeof(struct libro *), 10);
-    if (!((struttura_dati->str_d_ptrLibri).da_ptrArray))
+    for (int index = 0; index < numero; index++)
     {
-        da_destroy(&(struttura_dati->str_d_arrayCampi));
-        perror("Errore nella creazione dell'array dei puntatori ai libri");
-        return ERR_SYSTEM_CALL;
+        if (porzioni[index].errore != SUCCESS)
+            return porzioni[index].errore;
     }
 
-    FILE *biblioteca = fopen(file_record, "r");
-    if (!biblioteca)
+    return SUCCESS;
+}
+
+/**
+ * @brief Carica nella struttura dati i libri del file mappato `file`.
+ *
+ * Il file viene diviso in porzioni che finiscono con una riga intera; ogni thread crea i libri della sua porzione
+ * nella sua arena e poi, quando gli ordinali sono noti, ne costruisce un indice parziale. Gli indici parziali vengono
+ * infine uniti nell'ordine del file, così il risultato è identico a quello di un caricamento sequenziale.
+ *
+ * @return int `SUCCESS`, altrimenti `ERR_SYSTEM_CALL`, `ERR_FORMATO_STR` o `ERR_FORMATO_DATA`.
+ */
+int carica_file(struct strutturaDati *struttura_dati, const char *file, size_t dimensione)
+{
+    struct porzioneFile porzioni[MAX_THREAD_CARICAMENTO];
+    int numero = dividi_file(file, dimensione, porzioni, numero_thread_caricamento(dimensione)),
+        errore = SUCCESS;
+
+    for (int index = 0; index < numero; index++)
     {
-        perror("Impossibile aprire il file dei record");
-        str_d_dealloca(struttura_dati);
-        return ERR_SYSTEM_CALL;
+        porzioni[index].arena = ar_create(AR_BLOCK_SIZE);
+        porzioni[index].libri = da_create(sizeof(struct libro *), 64);
+        porzioni[index].arrayCampi = da_create(sizeof(struct campoAlbero), 10);
+        porzioni[index].direttorioCampi = arrCampi_creaDirettorio();
+
+        if (!(porzioni[index].libri.da_ptrArray) || !(porzioni[index].arrayCampi.da_ptrArray) || !(porzioni[index].direttorioCampi.ht_slots))
+        {
+            perror("Errore nella creazione delle strutture di una porzione del file");
+            errore = ERR_SYSTEM_CALL;
+        }
     }
 
-    char buffer[MAX_RIGA];
-    int errore = 0;
+    if (errore == SUCCESS)
+        errore = esegui_su_porzioni(analizza_porzione, porzioni, numero);
 
-    while (fgets(buffer, MAX_RIGA, biblioteca))
+    if (errore == SUCCESS)
     {
-        if (strlen(buffer) < 3)
-            continue;
-
-        if (!lib_controllaFormatoCorretto(buffer))
+        uint32_t ordinale = 0;
+        for (int index = 0; index < numero; index++)
         {
-            printf("Formato record non corretto nel file\n");
-            str_d_dealloca(struttura_dati);
-            return ERR_FORMATO_STR;
+            porzioni[index].primoOrdinale = ordinale;
+            ordinale += porzioni[index].libri.da_inserted;
         }
+        errore = esegui_su_porzioni(indicizza_porzione, porzioni, numero);
+    }
 
-        struct libro *temp = (struct libro *)malloc(sizeof(struct libro));
-        if (!temp || (errore = lib_crea(temp, buffer)) != SUCCESS)
+    for (int index = 0; index < numero && errore == SUCCESS; index++)
+    {
+        ar_merge(&(struttura_dati->str_d_arena), &(porzioni[index].arena));
+
+        if (arrCampi_unisci(&(struttura_dati->str_d_arrayCampi), &(struttura_dati->str_d_direttorioCampi), &(struttura_dati->str_d_arena),
+                            &(porzioni[index].arrayCampi), &(porzioni[index].direttorioCampi), &(porzioni[index].libri)) == ERR_SYSTEM_CALL)
         {
-            free(temp);
-            printf("Errore nella creazione del libro da buffer\n");
-            str_d_dealloca(struttura_dati);
-            return (errore == ERR_FORMATO_DATA) ? ERR_FORMATO_DATA : ERR_SYSTEM_CALL;
+            printf("Errore nell'unione dell'indice di una porzione del file\n");
+            errore = ERR_SYSTEM_CALL;
+            break;
         }
 
-        if (arrCampi_aggiungiLibro(&(struttura_dati->str_d_arrayCampi), temp) == ERR_SYSTEM_CALL ||
-            da_append(&(struttura_dati->str_d_ptrLibri), &temp) == FAILURE)
+        for (int posizione = 0; posizione < porzioni[index].libri.da_inserted; posizione++)
         {
-            free(temp);
-            perror("Errore nell'aggiunta del libro agli array dinamici");
-            str_d_dealloca(struttura_dati);
-            return ERR_SYSTEM_CALL;
+            if (da_append(&(struttura_dati->str_d_ptrLibri), da_at(&(porzioni[index].libri), posizione)) == FAILURE)
+            {
+                perror("Errore nell'aggiunta del libro agli array dinamici");
+                errore = ERR_SYSTEM_CALL;
+                break;
+            }
         }
     }
 
-    if (fclose(biblioteca) == EOF)
+    // le arene già unite sono vuote, quelle delle porzioni non unite vengono liberate
+    for (int index = 0; index < numero; index++)
     {
-        perror("Errore nella chiusura del file biblioteca");
-        str_d_dealloca(struttura_dati);
-        return ERR_SYSTEM_CALL;
+        arrCampi_free(&(porzioni[index].arrayCampi), &(porzioni[index].direttorioCampi));
+        da_destroy(&(porzioni[index].arrayCampi));
+        da_destroy(&(porzioni[index].libri));
+        ar_destroy(&(porzioni[index].arena));
     }
 
-    return SUCCESS;
+    return errore;
 }
 
-int str_d_chiediLibri(struct strutturaDati *struttura_dati, char **dst, char *richiesta, const int presta, pthread_mutex_t *mutex, pthread_cond_t *cond)
+/**
+ * @brief Inizializza una struttura dati vuota.
+ *
+ * @return int `SUCCESS`, altrimenti `ERR_SYSTEM_CALL` (in questo caso non c'è nulla da deallocare).
+ */
+int inizializza_struttura(struct strutturaDati *struttura_dati)
 {
-    lib_formattaStringa(richiesta);
+    struttura_dati->str_d_arena = ar_create(AR_BLOCK_SIZE);
+    struttura_dati->str_d_snapshot = (struct snapshotLettura){NULL, 0};
+    struttura_dati->str_d_giornale = gior_crea();
+    struttura_dati->str_d_compattazione = NULL;
 
-    if (!lib_controllaFormatoCorretto(richiesta))
-        return ERR_FORMATO_STR;
+    // senza cache le richieste vengono comunque servite, solo più lentamente
+    if (cache_crea(&(struttura_dati->str_d_cache)) != SUCCESS)
+        printf("Impossibile creare la cache delle richieste, le risposte non verranno salvate\n");
 
-    struct dynamic_array lista_libri_richiesti = da_create(sizeof(struct libro *), 10);
-    if (!(lista_libri_richiesti.da_ptrArray))
+    struttura_dati->str_d_arrayCampi = da_create(sizeof(struct campoAlbero), 10);
+    if (!((struttura_dati->str_d_arrayCampi).da_ptrArray))
     {
-        perror("Errore nella creazione dell'array per i libri richiesti");
+        perror("Errore nella creazione dell'array dei campi");
+        cache_distruggi(&(struttura_dati->str_d_cache));
         return ERR_SYSTEM_CALL;
     }
 
-    if (arrCampi_generaLista(&(struttura_dati->str_d_arrayCampi), &lista_libri_richiesti, richiesta, mutex, cond) == ERR_SYSTEM_CALL)
+    struttura_dati->str_d_direttorioCampi = arrCampi_creaDirettorio();
+    if (!((struttura_dati->str_d_direttorioCampi).ht_slots))
     {
-        da_destroy(&lista_libri_richiesti);
-        perror("Errore nella generazione della lista dei libri richiesti");
+        da_destroy(&(struttura_dati->str_d_arrayCampi));
+        cache_distruggi(&(struttura_dati->str_d_cache));
+        perror("Errore nella creazione del direttorio dei campi");
         return ERR_SYSTEM_CALL;
     }
 
-    if (lista_libri_richiesti.da_inserted == 0)
+    struttura_dati->str_d_ptrLibri = da_create(sizeof(struct libro *), 10);
+    if (!((struttura_dati->str_d_ptrLibri).da_ptrArray))
     {
-        da_destroy(&lista_libri_richiesti);
-        return 0; // nessun libro trovato
+        da_destroy(&(struttura_dati->str_d_arrayCampi));
+        ht_destroy(&(struttura_dati->str_d_direttorioCampi));
+        cache_distruggi(&(struttura_dati->str_d_cache));
+        perror("Errore nella creazione dell'array dei puntatori ai libri");
+        return ERR_SYSTEM_CALL;
     }
-    int libri_prestati_o_letti;
-    *dst = leggi_o_presta_lista(&lista_libri_richiesti, &libri_prestati_o_letti, presta, mutex, cond);
-    if (!(*dst))
+
+    return SUCCESS;
+}
+
+/**
+ * @return Il percorso dello snapshot di `file_record`, da liberare con free, o NULL se l'allocazione fallisce.
+ */
+char *percorso_snapshot(const char *file_record)
+{
+    char *percorso = (char *)malloc(strlen(file_record) + strlen(SNAP_ESTENSIONE) + 1);
+    if (percorso)
+        sprintf(percorso, "%s%s", file_record, SNAP_ESTENSIONE);
+    return percorso;
+}
+
+/**
+ * @brief Ricostruisce un libro dalla sua `snap_libro`.
+ *
+ * Le stringhe del libro restano nello snapshot, solo le coppie vengono allocate nell'arena. Le posizioni delle coppie
+ * e gli id dei campi vengono controllati, così uno snapshot rovinato non può produrre puntatori non validi.
+ *
+ * @return int `SUCCESS`, altrimenti `ERR_SYSTEM_CALL`.
+ */
+int leggi_libro(struct strutturaDati *struttura_dati, struct libro *libro, const struct snap_libro *letto, uint32_t ordinale)
+{
+    const struct snapshotLettura *snapshot = &(struttura_dati->str_d_snapshot);
+    const char *stringa = snap_leggiStringa(snapshot, letto->snap_stringa);
+    size_t lunghezza = stringa ? strlen(stringa) : 0;
+    const char *normalizzata = (const char *)snap_leggi(snapshot, letto->snap_normalizzata, lunghezza + 1);
+    const struct snap_coppia *coppie = (const struct snap_coppia *)snap_leggi(snapshot, letto->snap_coppie,
+                                                                              (uint64_t)letto->snap_numeroCoppie * sizeof(struct snap_coppia));
+
+    if (!stringa || !normalizzata || normalizzata[lunghezza] != '\0' || !coppie || letto->snap_numeroCoppie > lunghezza)
+        return ERR_SYSTEM_CALL;
+
+    *libro = (struct libro){
+        .lib_stringa = (char *)stringa,
+        .lib_lunghezza = lunghezza,
+        .lib_normalizzata = (char *)normalizzata,
+        .lib_coppie = (struct coppiaLibro *)ar_alloc(&(struttura_dati->str_d_arena), letto->snap_numeroCoppie * sizeof(struct coppiaLibro)),
+        .lib_numeroCoppie = letto->snap_numeroCoppie,
+        .lib_ordinale = ordinale};
+    if (!(libro->lib_coppie))
     {
-        da_destroy(&lista_libri_richiesti);
-        perror("Errore nel prestito o lettura della lista dei libri");
+        perror("Errore di allocazione per le coppie di un libro dello snapshot");
         return ERR_SYSTEM_CALL;
     }
+    atomic_init(&(libro->lib_prestito), letto->snap_prestito);
+
+    for (int index = 0; index < libro->lib_numeroCoppie; index++)
+    {
+        if (coppie[index].snap_campo >= lunghezza || coppie[index].snap_valore >= lunghezza ||
+            coppie[index].snap_idCampo < 0 || coppie[index].snap_idCampo >= (struttura_dati->str_d_arrayCampi).da_inserted)
+            return ERR_SYSTEM_CALL;
+
+        libro->lib_coppie[index] = (struct coppiaLibro){.lib_campo = libro->lib_normalizzata + coppie[index].snap_campo,
+                                                        .lib_valore = libro->lib_normalizzata + coppie[index].snap_valore,
+                                                        .lib_idCampo = coppie[index].snap_idCampo};
+    }
 
-    da_destroy(&lista_libri_richiesti);
-    return libri_prestati_o_letti;
+    return SUCCESS;
 }
 
-int str_d_aggiornaFileRecord(struct strutturaDati *struttura_dati, const char *file_record, const char *build_directory)
+/**
+ * @brief Ricostruisce i campi e i libri dallo snapshot già mappato in `str_d_snapshot`.
+ *
+ * Nessun libro viene analizzato: i campi vengono ricostruiti da arrCampi_leggiSnapshot e i libri, allocati tutti
+ * insieme nell'arena, puntano alle loro stringhe nello snapshot.
+ *
+ * @return int `SUCCESS`, altrimenti `ERR_SYSTEM_CALL`.
+ */
+int carica_snapshot(struct strutturaDati *struttura_dati)
+{
+    const struct snapshotLettura *snapshot = &(struttura_dati->str_d_snapshot);
+    const struct snap_intestazione *intestazione = (const struct snap_intestazione *)snap_leggi(snapshot, 0, sizeof(struct snap_intestazione));
+    const struct snap_libro *libriLetti = (const struct snap_libro *)snap_leggi(snapshot, intestazione->snap_libri,
+                                                                               (uint64_t)intestazione->snap_numeroLibri * sizeof(struct snap_libro));
+    if (!libriLetti || intestazione->snap_numeroLibri > INT32_MAX)
+        return ERR_SYSTEM_CALL;
+
+    if (arrCampi_leggiSnapshot(&(struttura_dati->str_d_arrayCampi), &(struttura_dati->str_d_direttorioCampi), &(struttura_dati->str_d_arena),
+                               snapshot, intestazione->snap_campi, intestazione->snap_numeroCampi, intestazione->snap_numeroLibri) == ERR_SYSTEM_CALL)
+        return ERR_SYSTEM_CALL;
+
+    struct libro *libri = (struct libro *)ar_alloc(&(struttura_dati->str_d_arena), intestazione->snap_numeroLibri * sizeof(struct libro));
+    if (!libri)
+    {
+        perror("Errore di allocazione per i libri dello snapshot");
+        return ERR_SYSTEM_CALL;
+    }
+
+    for (uint32_t ordinale = 0; ordinale < intestazione->snap_numeroLibri; ordinale++)
+    {
+        struct libro *libro = libri + ordinale;
+
+        if (leggi_libro(struttura_dati, libro, libriLetti + ordinale, ordinale) == ERR_SYSTEM_CALL ||
+            da_append(&(struttura_dati->str_d_ptrLibri), &libro) == FAILURE)
+        {
+            printf("Errore nella lettura di un libro dello snapshot\n");
+            return ERR_SYSTEM_CALL;
+        }
+    }
+
+    return SUCCESS;
+}
+
+//* SALVATAGGIO
+
+/**
+ * @brief Sincronizza sul disco la cartella che contiene `file`, così una rename al suo interno è durevole.
+ *
+ * @return int SUCCESS, altrimenti ERR_SYSTEM_CALL.
+ */
+int sincronizza_cartella(const char *file)
+{
+    const char *separatore = strrchr(file, '/');
+    char *cartella = separatore ? strndup(file, separatore - file + 1) : strdup(".");
+    if (!cartella)
+        return ERR_SYSTEM_CALL;
+
+    int descrittore = open(cartella, O_RDONLY | O_DIRECTORY), risultato = SUCCESS;
+    if (descrittore == -1 || fsync(descrittore) == -1)
+        risultato = ERR_SYSTEM_CALL;
+    if (descrittore != -1)
+        close(descrittore);
+
+    free(cartella);
+    return risultato;
+}
+
+/**
+ * @brief Scrive i libri di `libri` (array dinamico di `struct libro *`) nel file record, come str_d_aggiornaFileRecord.
+ *
+ * I libri vengono letti senza lock: devono essere copie, o non devono essere prestati durante la scrittura. Il nuovo
+ * file viene annunciato a `giornale` prima di sostituire il file record, così le voci del giornale restano valide.
+ */
+int scrivi_file_record(struct dynamic_array *libri, const char *file_record, const char *build_directory, struct giornale *giornale)
 {
     char temp[MAX_PATH];
     char *format = "%stemp_%d.txt";
@@ -211,9 +460,9 @@ int str_d_aggiornaFileRecord(struct strutturaDati *struttura_dati, const char *f
     }
     char *stringa_libro;
 
-    for (int index = 0; index < (struttura_dati->str_d_ptrLibri).da_inserted; index++)
+    for (int index = 0; index < libri->da_inserted; index++)
     {
-        struct libro **corrente = (struct libro **)da_at(&(struttura_dati->str_d_ptrLibri), index);
+        struct libro **corrente = (struct libro **)da_at(libri, index);
         stringa_libro = lib_leggi(*corrente);
         if (!stringa_libro)
         {
@@ -232,7 +481,24 @@ int str_d_aggiornaFileRecord(struct strutturaDati *struttura_dati, const char *f
         free(stringa_libro);
     }
 
-    if (fclose(bib_temp) == EOF || remove(file_record) == -1 || rename(temp, file_record) == -1)
+    // il file temporaneo è sul disco prima di sostituire il file record, che rename sostituisce in modo atomico
+    struct stat informazioni;
+    if (fflush(bib_temp) == EOF || fsync(fileno(bib_temp)) == -1 || fstat(fileno(bib_temp), &informazioni) == -1)
+    {
+        fclose(bib_temp);
+        perror("Errore nella sincronizzazione del file temporaneo");
+        return ERR_SYSTEM_CALL;
+    }
+
+    // rename non cambia dimensione, inode e data di modifica: sono già quelli del nuovo file record
+    if (gior_nuovoRecord(giornale, &informazioni) != SUCCESS)
+    {
+        fclose(bib_temp);
+        unlink(temp);
+        return ERR_SYSTEM_CALL;
+    }
+
+    if (fclose(bib_temp) == EOF || rename(temp, file_record) == -1 || sincronizza_cartella(file_record) == ERR_SYSTEM_CALL)
     {
         perror("Errore nell'aggiornamento del file record");
         return ERR_SYSTEM_CALL;
@@ -241,22 +507,676 @@ int str_d_aggiornaFileRecord(struct strutturaDati *struttura_dati, const char *f
     return SUCCESS;
 }
 
+/**
+ * @brief Salva lo snapshot della struttura dati con lo stato di prestito dei libri di `ptrLibri`, come str_d_salvaSnapshot.
+ *
+ * `ptrLibri` contiene i libri nell'ordine degli ordinali: quelli della struttura dati, o loro copie. Gli indici dei
+ * campi non cambiano dopo il caricamento, quindi vengono letti senza lock.
+ */
+int scrivi_snapshot(struct strutturaDati *struttura_dati, struct dynamic_array *ptrLibri, const char *file_record)
+{
+    int risultato = ERR_SYSTEM_CALL;
+    struct stat informazioni;
+    struct snapshotScrittura snapshot = snap_creaScrittura();
+    char *percorso = percorso_snapshot(file_record);
+
+    if (!percorso || stat(file_record, &informazioni) == -1)
+    {
+        perror("Errore nella lettura delle informazioni del file record per lo snapshot");
+        goto cleanup;
+    }
+
+    // l'intestazione viene scritta per ultima, quando si conoscono tutti gli offset
+    uint64_t offsetIntestazione = snap_aggiungi(&snapshot, NULL, sizeof(struct snap_intestazione)),
+             offsetLibri = snap_aggiungi(&snapshot, NULL, ptrLibri->da_inserted * sizeof(struct snap_libro));
+    if (offsetIntestazione == SNAP_OFFSET_NULLO || offsetLibri == SNAP_OFFSET_NULLO)
+        goto errore_allocazione;
+
+    for (int index = 0; index < ptrLibri->da_inserted; index++)
+    {
+        struct libro *libro = *(struct libro **)da_at(ptrLibri, index);
+        struct snap_libro scritto = {
+            .snap_stringa = snap_aggiungiStringa(&snapshot, libro->lib_stringa),
+            .snap_normalizzata = snap_aggiungi(&snapshot, libro->lib_normalizzata, strlen(libro->lib_stringa) + 1),
+            .snap_coppie = snap_aggiungi(&snapshot, NULL, libro->lib_numeroCoppie * sizeof(struct snap_coppia)),
+            .snap_numeroCoppie = libro->lib_numeroCoppie,
+            .snap_prestito = atomic_load(&(libro->lib_prestito))};
+
+        if (scritto.snap_stringa == SNAP_OFFSET_NULLO || scritto.snap_normalizzata == SNAP_OFFSET_NULLO || scritto.snap_coppie == SNAP_OFFSET_NULLO)
+            goto errore_allocazione;
+
+        struct snap_coppia *coppie = (struct snap_coppia *)snap_at(&snapshot, scritto.snap_coppie);
+        for (int coppia = 0; coppia < libro->lib_numeroCoppie; coppia++)
+            coppie[coppia] = (struct snap_coppia){.snap_campo = libro->lib_coppie[coppia].lib_campo - libro->lib_normalizzata,
+                                                  .snap_valore = libro->lib_coppie[coppia].lib_valore - libro->lib_normalizzata,
+                                                  .snap_idCampo = libro->lib_coppie[coppia].lib_idCampo};
+
+        ((struct snap_libro *)snap_at(&snapshot, offsetLibri))[index] = scritto;
+    }
+
+    uint64_t offsetCampi = arrCampi_scriviSnapshot(&(struttura_dati->str_d_arrayCampi), &snapshot);
+    if (offsetCampi == SNAP_OFFSET_NULLO)
+        goto errore_allocazione;
+
+    struct snap_intestazione intestazione = {
+        .snap_magico = SNAP_MAGICO,
+        .snap_versione = SNAP_VERSIONE,
+        .snap_controllo = SNAP_CONTROLLO,
+        .snap_dimensione = snapshot.snap_dimensione,
+        .snap_dimensioneRecord = informazioni.st_size,
+        .snap_modificaRecord = informazioni.st_mtim.tv_sec,
+        .snap_modificaRecordNs = informazioni.st_mtim.tv_nsec,
+        .snap_inodeRecord = informazioni.st_ino,
+        .snap_numeroLibri = ptrLibri->da_inserted,
+        .snap_numeroCampi = (struttura_dati->str_d_arrayCampi).da_inserted,
+        .snap_libri = offsetLibri,
+        .snap_campi = offsetCampi};
+    *(struct snap_intestazione *)snap_at(&snapshot, offsetIntestazione) = intestazione;
+
+    if (snap_salva(&snapshot, percorso) == SUCCESS)
+        risultato = SUCCESS;
+    goto cleanup;
+
+errore_allocazione:
+    printf("Errore di allocazione nella costruzione dello snapshot\n");
+cleanup:
+    snap_distruggiScrittura(&snapshot);
+    free(percorso);
+    return risultato;
+}
+
+//* GIORNALE DEI PRESTITI
+
+/**
+ * @brief Argomento di compatta_struttura.
+ *
+ * @param file_record, build_directory Come in str_d_aggiornaFileRecord.
+ */
+struct contestoCompattazione
+{
+    struct strutturaDati *struttura_dati;
+    char *file_record;
+    const char *build_directory;
+};
+
+/**
+ * @brief Riapplica al libro un prestito letto dal giornale. `arg` è la struttura dati.
+ *
+ * Il libro tiene il prestito più recente: una voce già contenuta nel file record non riporta indietro la data.
+ */
+void applica_voce(void *arg, const struct voceGiornale *voce)
+{
+    struct strutturaDati *struttura_dati = (struct strutturaDati *)arg;
+    struct libro *libro = *(struct libro **)da_at(&(struttura_dati->str_d_ptrLibri), voce->gior_ordinale);
+
+    int64_t prestito = atomic_load(&(libro->lib_prestito));
+    if (prestito == LIB_NESSUN_PRESTITO || prestito < voce->gior_tempo)
+        atomic_store(&(libro->lib_prestito), voce->gior_tempo);
+}
+
+/**
+ * @brief Funzione di compattazione del giornale: riscrive il file record e lo snapshot con lo stato attuale dei libri.
+ *
+ * Viene copiato lo stato del prestito di ogni libro, poi file record e snapshot vengono scritti dalle copie mentre i
+ * worker continuano a prestare i libri. `arg` è una `struct contestoCompattazione`.
+ *
+ * @return int SUCCESS solo se il file record è sul disco.
+ */
+int compatta_struttura(void *arg)
+{
+    struct contestoCompattazione *contesto = (struct contestoCompattazione *)arg;
+    struct dynamic_array *ptrLibri = &(contesto->struttura_dati->str_d_ptrLibri);
+    struct dynamic_array libriCopia = da_create(sizeof(struct libro *), ptrLibri->da_inserted > 0 ? ptrLibri->da_inserted : 1);
+    struct libro *copie = (struct libro *)malloc((ptrLibri->da_inserted > 0 ? ptrLibri->da_inserted : 1) * sizeof(struct libro));
+    int risultato = ERR_SYSTEM_CALL;
+
+    if (!(libriCopia.da_ptrArray) || !copie)
+    {
+        perror("Errore di allocazione per le copie dei libri da compattare");
+        goto cleanup;
+    }
+
+    for (int index = 0; index < ptrLibri->da_inserted; index++)
+    {
+        struct libro *copia = copie + index;
+        lib_copiaThreadSafe(*(struct libro **)da_at(ptrLibri, index), copia);
+        if (da_append(&libriCopia, &copia) == FAILURE)
+            goto cleanup;
+    }
+
+    if (scrivi_file_record(&libriCopia, contesto->file_record, contesto->build_directory, &(contesto->struttura_dati->str_d_giornale)) != SUCCESS)
+    {
+        printf("Impossibile compattare il giornale nel file record\n");
+        goto cleanup;
+    }
+    risultato = SUCCESS;
+
+    // senza snapshot il prossimo avvio carica il file record, il giornale può comunque essere compattato
+    if (scrivi_snapshot(contesto->struttura_dati, &libriCopia, contesto->file_record) != SUCCESS)
+        printf("Impossibile salvare lo snapshot, al prossimo avvio verrà caricato il file record.\n");
+
+cleanup:
+    da_destroy(&libriCopia);
+    free(copie);
+    return risultato;
+}
+
+//! FUNZIONI PUBBLICHE
+
+int str_d_genera(struct strutturaDati *struttura_dati, const char *file_record)
+{
+    if (inizializza_struttura(struttura_dati) == ERR_SYSTEM_CALL)
+        return ERR_SYSTEM_CALL;
+
+    int descrittore = open(file_record, O_RDONLY);
+    if (descrittore == -1)
+    {
+        perror("Impossibile aprire il file dei record");
+        str_d_dealloca(struttura_dati);
+        return ERR_SYSTEM_CALL;
+    }
+
+    struct stat informazioni;
+    if (fstat(descrittore, &informazioni) == -1)
+    {
+        perror("Errore nella lettura delle informazioni del file dei record");
+        close(descrittore);
+        str_d_dealloca(struttura_dati);
+        return ERR_SYSTEM_CALL;
+    }
+
+    size_t dimensione = (size_t)informazioni.st_size;
+    if (dimensione == 0)
+    {
+        close(descrittore);
+        return SUCCESS;
+    }
+
+    // uno snapshot generato da questo stesso file record evita di analizzarlo
+    char *snapshot = percorso_snapshot(file_record);
+    if (snapshot && snap_apri(&(struttura_dati->str_d_snapshot), snapshot, &informazioni) == SUCCESS)
+    {
+        if (carica_snapshot(struttura_dati) == SUCCESS)
+        {
+            printf("Struttura dati caricata dallo snapshot %s\n", snapshot);
+            free(snapshot);
+            close(descrittore);
+            return SUCCESS;
+        }
+
+        printf("Lo snapshot %s non è coerente, verrà caricato il file record\n", snapshot);
+        str_d_dealloca(struttura_dati);
+        if (inizializza_struttura(struttura_dati) == ERR_SYSTEM_CALL)
+        {
+            free(snapshot);
+            close(descrittore);
+            return ERR_SYSTEM_CALL;
+        }
+    }
+    free(snapshot);
+
+    // il file viene letto direttamente dalla memoria mappata, senza copiarlo in un buffer riga per riga
+    char *file = (char *)mmap(NULL, dimensione, PROT_READ, MAP_PRIVATE, descrittore, 0);
+    close(descrittore);
+    if (file == MAP_FAILED)
+    {
+        perror("Errore nella mappatura in memoria del file dei record");
+        str_d_dealloca(struttura_dati);
+        return ERR_SYSTEM_CALL;
+    }
+    madvise(file, dimensione, MADV_SEQUENTIAL);
+
+    int errore = carica_file(struttura_dati, file, dimensione);
+
+    if (munmap(file, dimensione) == -1 && errore == SUCCESS)
+    {
+        perror("Errore nella rimozione della mappatura del file dei record");
+        errore = ERR_SYSTEM_CALL;
+    }
+
+    if (errore != SUCCESS)
+    {
+        str_d_dealloca(struttura_dati);
+        return errore;
+    }
+
+    return SUCCESS;
+}
+
+int str_d_apriRisposta(struct strutturaDati *struttura_dati, struct rispostaAPezzi *risposta, char *richiesta, const int presta)
+{
+    lib_formattaStringa(richiesta);
+
+    if (!lib_controllaFormatoCorretto(richiesta))
+        return ERR_FORMATO_STR;
+
+    *risposta = (struct rispostaAPezzi){.prossimo = 0, .presta = presta, .numeroLibri = 0};
+
+    // i prestiti cambiano i libri, quindi vanno sempre fatti sui libri e non vengono salvati
+    if (!presta)
+    {
+        risposta->voce = cache_cerca(&(struttura_dati->str_d_cache), richiesta);
+        if (risposta->voce)
+            return SUCCESS;
+
+        // letti prima di leggere i libri: un prestito da qui in poi impedisce di salvare la risposta
+        risposta->invalidazioni = cache_inizioRisposta(&(struttura_dati->str_d_cache));
+        risposta->inizio = (int64_t)time(NULL);
+        risposta->chiave = strdup(richiesta);
+    }
+
+    risposta->libri = da_create(sizeof(struct libro *), 10);
+    if (!(risposta->libri.da_ptrArray))
+    {
+        perror("Errore nella creazione dell'array per i libri richiesti");
+        free(risposta->chiave);
+        return ERR_SYSTEM_CALL;
+    }
+
+    if (arrCampi_generaLista(&(struttura_dati->str_d_arrayCampi), &(struttura_dati->str_d_direttorioCampi), &(struttura_dati->str_d_ptrLibri), &(risposta->libri), richiesta) == ERR_SYSTEM_CALL)
+    {
+        da_destroy(&(risposta->libri));
+        free(risposta->chiave);
+        perror("Errore nella generazione della lista dei libri richiesti");
+        return ERR_SYSTEM_CALL;
+    }
+
+    return SUCCESS;
+}
+
+/**
+ * @brief Aggiunge al pezzo i `lunghezza` byte appena scritti in fondo a `pezzo->copia`, allungando l'ultima parte se
+ *        finisce proprio lì.
+ */
+void aggiungi_copiati(struct pezzoLibri *pezzo, size_t lunghezza)
+{
+    char *inizio = pezzo->copia + pezzo->copiati;
+    struct iovec *ultima = pezzo->parti + pezzo->numeroParti - 1;
+
+    if (pezzo->numeroParti > 0 && (char *)ultima->iov_base + ultima->iov_len == inizio)
+        ultima->iov_len += lunghezza;
+    else
+        pezzo->parti[pezzo->numeroParti++] = (struct iovec){.iov_base = inizio, .iov_len = lunghezza};
+
+    pezzo->copiati += lunghezza;
+    pezzo->lunghezza += lunghezza;
+}
+
+/**
+ * @brief Copia nel pezzo i prossimi byte della voce della cache da cui viene la risposta.
+ *
+ * I byte vengono copiati e non indicati con una parte perché la voce può uscire dalla cache, ed essere liberata, prima
+ * che il reattore abbia scritto l'ultimo pezzo. I libri della risposta sono i '\n' dei byte serviti.
+ *
+ * @return 1 se restano altri byte, 0 se il pezzo è l'ultimo.
+ */
+int servi_da_cache(struct rispostaAPezzi *risposta, struct pezzoLibri *pezzo)
+{
+    const struct voceCache *voce = risposta->voce;
+    size_t lunghezza = voce->cache_lunghezza - risposta->servito;
+    if (lunghezza > STR_D_DIMENSIONE_PEZZO)
+        lunghezza = STR_D_DIMENSIONE_PEZZO;
+
+    if (lunghezza > 0)
+    {
+        const char *inizio = voce->cache_risposta + risposta->servito, *fine = inizio + lunghezza;
+        for (const char *riga = memchr(inizio, '\n', lunghezza); riga; riga = memchr(riga + 1, '\n', fine - riga - 1))
+            risposta->numeroLibri++;
+
+        memcpy(pezzo->copia, inizio, lunghezza);
+        aggiungi_copiati(pezzo, lunghezza);
+    }
+    risposta->servito += lunghezza;
+
+    return (risposta->servito < voce->cache_lunghezza) ? 1 : 0;
+}
+
+/**
+ * @brief Aggiunge i byte del pezzo a quelli della risposta da salvare nella cache. Se la risposta diventa più lunga di
+ *        CACHE_MAX_RISPOSTA (o un'allocazione fallisce) rinuncia a salvarla.
+ */
+void accumula_pezzo(struct rispostaAPezzi *risposta, const struct pezzoLibri *pezzo)
+{
+    size_t necessaria = risposta->lunghezzaCostruita + pezzo->lunghezza;
+    if (necessaria > CACHE_MAX_RISPOSTA)
+        goto rinuncia;
+
+    if (necessaria > risposta->capacitaCostruita)
+    {
+        size_t capacita = risposta->capacitaCostruita ? risposta->capacitaCostruita : MAX_RIGA;
+        while (capacita < necessaria)
+            capacita *= 2;
+        char *temp = (char *)realloc(risposta->costruita, capacita);
+        if (!temp)
+            goto rinuncia;
+        risposta->costruita = temp;
+        risposta->capacitaCostruita = capacita;
+    }
+
+    for (int parte = 0; parte < pezzo->numeroParti; parte++)
+    {
+        memcpy(risposta->costruita + risposta->lunghezzaCostruita, pezzo->parti[parte].iov_base, pezzo->parti[parte].iov_len);
+        risposta->lunghezzaCostruita += pezzo->parti[parte].iov_len;
+    }
+    return;
+
+rinuncia:
+    free(risposta->chiave);
+    free(risposta->costruita);
+    risposta->chiave = risposta->costruita = NULL;
+    risposta->lunghezzaCostruita = risposta->capacitaCostruita = 0;
+}
+
+/**
+ * @brief Confronta due ordinali per qsort.
+ */
+int confronta_ordinali(const void *a, const void *b)
+{
+    uint32_t primo = *(const uint32_t *)a, secondo = *(const uint32_t *)b;
+    return (primo > secondo) - (primo < secondo);
+}
+
+/**
+ * @return 1 se il prestito `prestito` (o LIB_NESSUN_PRESTITO) era in corso in un istante da `inizio` in poi.
+ */
+int in_corso_da(int64_t prestito, int64_t inizio)
+{
+    return prestito != LIB_NESSUN_PRESTITO && prestito + LIB_DURATA_PRESTITO >= inizio;
+}
+
+/**
+ * @brief Salva nella cache la risposta appena completata, con gli ordinali dei suoi libri e l'istante in cui scade il
+ *        primo dei loro prestiti.
+ *
+ * Gli ordinali sono già in ordine perché arrCampi_generaLista restituisce i libri nell'ordine del file, ma vengono
+ * controllati: la cache li cerca con una ricerca binaria.
+ */
+void salva_in_cache(struct strutturaDati *struttura_dati, struct rispostaAPezzi *risposta)
+{
+    int numero = risposta->libri.da_inserted, ordinati = 1;
+    int64_t scadenza = INT64_MAX;
+    uint32_t *ordinali = (uint32_t *)malloc((numero > 0 ? numero : 1) * sizeof(uint32_t));
+    if (!ordinali)
+    {
+        perror("Errore di allocazione per gli ordinali della risposta");
+        return;
+    }
+
+    for (int index = 0; index < numero; index++)
+    {
+        struct libro *libro = *(struct libro **)da_at(&(risposta->libri), index);
+        int64_t prestito = atomic_load(&(libro->lib_prestito));
+
+        // un prestito in corso mentre la risposta veniva scritta ne fa parte finché non scade
+        if (in_corso_da(prestito, risposta->inizio) && prestito + LIB_DURATA_PRESTITO < scadenza)
+            scadenza = prestito + LIB_DURATA_PRESTITO;
+
+        ordinali[index] = libro->lib_ordinale;
+        if (index > 0 && ordinali[index] < ordinali[index - 1])
+            ordinati = 0;
+    }
+    if (!ordinati)
+        qsort(ordinali, numero, sizeof(uint32_t), confronta_ordinali);
+
+    // la cache diventa proprietaria dei byte e degli ordinali
+    cache_inserisci(&(struttura_dati->str_d_cache), risposta->chiave, risposta->costruita, risposta->lunghezzaCostruita,
+                    ordinali, numero, scadenza, risposta->invalidazioni);
+    risposta->costruita = NULL;
+    risposta->lunghezzaCostruita = risposta->capacitaCostruita = 0;
+}
+
+int str_d_raccogliPezzo(struct strutturaDati *struttura_dati, struct rispostaAPezzi *risposta, struct pezzoLibri *pezzo)
+{
+    uint64_t ultimaVoce = 0;
+    int libriNelPezzo = 0;
+    pezzo->numeroParti = 0;
+    pezzo->lunghezza = 0;
+    pezzo->copiati = 0;
+
+    if (risposta->voce)
+        return servi_da_cache(risposta, pezzo);
+
+    while (libriNelPezzo < STR_D_LIBRI_PER_PEZZO && pezzo->lunghezza < STR_D_DIMENSIONE_PEZZO &&
+           risposta->prossimo < risposta->libri.da_inserted)
+    {
+        struct libro **corrente = (struct libro **)da_at(&(risposta->libri), risposta->prossimo++);
+
+        if (risposta->presta)
+        {
+            int64_t tempoPrestito, precedente;
+            if (!lib_prestaThreadSafe(*corrente, &tempoPrestito, &precedente))
+            {
+                *corrente = NULL; // non fa parte della risposta
+                continue;
+            }
+
+            // da qui la stringa del libro ha la data del prestito: le risposte salvate che lo contengono sono vecchie
+            cache_invalidaLibro(&(struttura_dati->str_d_cache), (*corrente)->lib_ordinale);
+
+            // la voce viene solo scritta: la sincronizzazione sul disco è una sola, alla fine del pezzo. Gli errori di
+            // giornale.c valgono il suo ERR_SYSTEM_CALL, diverso da quello visto qui: si confronta con SUCCESS
+            if (gior_registra(&(struttura_dati->str_d_giornale), (*corrente)->lib_ordinale, tempoPrestito, &ultimaVoce) != SUCCESS)
+            {
+                // un prestito che non è nel giornale sparirebbe al riavvio: il libro torna com'era, e le risposte
+                // salvate nel frattempo con il prestito vanno di nuovo invalidate
+                printf("Impossibile registrare il prestito nel giornale\n");
+                lib_annullaPrestito(*corrente, tempoPrestito, precedente);
+                cache_invalidaLibro(&(struttura_dati->str_d_cache), (*corrente)->lib_ordinale);
+                return ERR_SYSTEM_CALL;
+            }
+        }
+
+        // un libro lungo resta dov'è, uno corto costa meno copiarlo che mandarlo come parte a sé
+        if ((*corrente)->lib_lunghezza >= STR_D_SOGLIA_RIFERIMENTO)
+        {
+            pezzo->parti[pezzo->numeroParti++] = (struct iovec){.iov_base = (*corrente)->lib_stringa,
+                                                                 .iov_len = (*corrente)->lib_lunghezza};
+            pezzo->lunghezza += (*corrente)->lib_lunghezza;
+        }
+        else
+        {
+            memcpy(pezzo->copia + pezzo->copiati, (*corrente)->lib_stringa, (*corrente)->lib_lunghezza);
+            aggiungi_copiati(pezzo, (*corrente)->lib_lunghezza);
+        }
+
+        int lunghezzaPrestito = lib_scriviPrestito(*corrente, pezzo->copia + pezzo->copiati);
+        if (lunghezzaPrestito == ERR_SYSTEM_CALL)
+            return ERR_SYSTEM_CALL;
+        aggiungi_copiati(pezzo, lunghezzaPrestito);
+
+        libriNelPezzo++;
+        risposta->numeroLibri++;
+    }
+
+    // i prestiti vengono confermati al client solo quando sono durevoli
+    if (gior_attendi(&(struttura_dati->str_d_giornale), ultimaVoce) != SUCCESS)
+    {
+        printf("Impossibile sincronizzare il giornale dei prestiti\n");
+        return ERR_SYSTEM_CALL;
+    }
+
+    if (risposta->chiave)
+        accumula_pezzo(risposta, pezzo);
+
+    if (risposta->prossimo < risposta->libri.da_inserted)
+        return 1;
+
+    if (risposta->chiave)
+        salva_in_cache(struttura_dati, risposta);
+    return 0;
+}
+
+int str_d_scriviRisposta(struct rispostaAPezzi *risposta, FILE *file)
+{
+    char prestito[LIB_DIMENSIONE_PRESTITO];
+
+    // i byte serviti dalla cache sono proprio quelli mandati al client
+    if (risposta->voce)
+        return (fwrite(risposta->voce->cache_risposta, sizeof(char), risposta->servito, file) < risposta->servito)
+                   ? ERR_SYSTEM_CALL
+                   : SUCCESS;
+
+    for (int index = 0; index < risposta->prossimo; index++)
+    {
+        struct libro **corrente = (struct libro **)da_at(&(risposta->libri), index);
+        if (!(*corrente))
+            continue;
+
+        if (lib_scriviPrestito(*corrente, prestito) == ERR_SYSTEM_CALL ||
+            fwrite((*corrente)->lib_stringa, sizeof(char), (*corrente)->lib_lunghezza, file) < (*corrente)->lib_lunghezza ||
+            fputs(prestito, file) == EOF)
+            return ERR_SYSTEM_CALL;
+    }
+    return SUCCESS;
+}
+
+void str_d_chiudiRisposta(struct rispostaAPezzi *risposta)
+{
+    da_destroy(&(risposta->libri));
+    if (risposta->voce)
+        cache_rilascia(risposta->voce);
+    free(risposta->chiave);
+    free(risposta->costruita);
+    risposta->voce = NULL;
+    risposta->chiave = risposta->costruita = NULL;
+}
+
+int str_d_chiediLibri(struct strutturaDati *struttura_dati, char **dst, char *richiesta, const int presta)
+{
+    struct rispostaAPezzi risposta;
+    struct pezzoLibri *pezzo;
+    size_t lunghezza = 0, capacita = MAX_RIGA;
+    char *stringa;
+    int esito = str_d_apriRisposta(struttura_dati, &risposta, richiesta, presta);
+    if (esito != SUCCESS)
+        return esito;
+
+    if (risposta.voce ? risposta.voce->cache_numeroLibri == 0 : risposta.libri.da_inserted == 0)
+    {
+        str_d_chiudiRisposta(&risposta);
+        return 0; // nessun libro trovato
+    }
+
+    // la lunghezza della risposta è tenuta a parte, così aggiungere un pezzo non riscorre tutta la stringa
+    pezzo = (struct pezzoLibri *)malloc(sizeof(struct pezzoLibri));
+    stringa = (char *)malloc(capacita);
+    if (!pezzo || !stringa)
+        goto errore_allocazione;
+
+    do
+    {
+        esito = str_d_raccogliPezzo(struttura_dati, &risposta, pezzo);
+        if (esito == ERR_SYSTEM_CALL)
+        {
+            perror("Errore nel prestito o lettura della lista dei libri");
+            goto errore;
+        }
+
+        if (lunghezza + pezzo->lunghezza + 1 > capacita)
+        {
+            while (lunghezza + pezzo->lunghezza + 1 > capacita)
+                capacita *= 2;
+            char *temp = (char *)realloc(stringa, capacita);
+            if (!temp)
+                goto errore_allocazione;
+            stringa = temp;
+        }
+
+        for (int parte = 0; parte < pezzo->numeroParti; parte++)
+        {
+            memcpy(stringa + lunghezza, pezzo->parti[parte].iov_base, pezzo->parti[parte].iov_len);
+            lunghezza += pezzo->parti[parte].iov_len;
+        }
+    } while (esito == 1);
+
+    stringa[lunghezza] = '\0';
+    *dst = stringa;
+    esito = risposta.numeroLibri;
+    free(pezzo);
+    str_d_chiudiRisposta(&risposta);
+    return esito;
+
+errore_allocazione:
+    perror("Errore di allocazione per la risposta");
+errore:
+    free(pezzo);
+    free(stringa);
+    str_d_chiudiRisposta(&risposta);
+    return ERR_SYSTEM_CALL;
+}
+
+int str_d_apriGiornale(struct strutturaDati *struttura_dati, const char *file_record, const char *build_directory)
+{
+    char *percorso = (char *)malloc(strlen(file_record) + strlen(GIOR_ESTENSIONE) + 1);
+    struct contestoCompattazione *contesto = (struct contestoCompattazione *)malloc(sizeof(struct contestoCompattazione));
+    char *copiaFileRecord = strdup(file_record);
+
+    if (!percorso || !contesto || !copiaFileRecord)
+    {
+        perror("Errore di allocazione per il giornale dei prestiti");
+        free(percorso);
+        free(contesto);
+        free(copiaFileRecord);
+        return ERR_SYSTEM_CALL;
+    }
+    sprintf(percorso, "%s%s", file_record, GIOR_ESTENSIONE);
+    *contesto = (struct contestoCompattazione){struttura_dati, copiaFileRecord, build_directory};
+    struttura_dati->str_d_compattazione = contesto;
+
+    // il giornale vale solo per questo file record: quello di un file record sostituito viene ignorato
+    struct stat record;
+    if (stat(file_record, &record) == -1)
+    {
+        perror("Impossibile leggere le informazioni del file record per il giornale");
+        free(percorso);
+        return ERR_SYSTEM_CALL;
+    }
+
+    int risultato = gior_apri(&(struttura_dati->str_d_giornale), percorso, &record, (struttura_dati->str_d_ptrLibri).da_inserted,
+                              applica_voce, struttura_dati);
+    free(percorso);
+    if (risultato != SUCCESS)
+        return ERR_SYSTEM_CALL;
+
+    if (gior_avviaCompattazione(&(struttura_dati->str_d_giornale), GIOR_SOGLIA_COMPATTAZIONE, compatta_struttura, contesto,
+                                (struttura_dati->str_d_snapshot).snap_dati == NULL) != SUCCESS)
+        return ERR_SYSTEM_CALL;
+    return SUCCESS;
+}
+
+int str_d_aggiornaFileRecord(struct strutturaDati *struttura_dati, const char *file_record, const char *build_directory)
+{
+    return scrivi_file_record(&(struttura_dati->str_d_ptrLibri), file_record, build_directory, &(struttura_dati->str_d_giornale));
+}
+
+int str_d_salvaSnapshot(struct strutturaDati *struttura_dati, const char *file_record)
+{
+    return scrivi_snapshot(struttura_dati, &(struttura_dati->str_d_ptrLibri), file_record);
+}
+
 void str_d_dealloca(struct strutturaDati *struttura_dati)
 {
     if (!struttura_dati)
         return;
 
-    arrCampi_free(&(struttura_dati->str_d_arrayCampi));
-
-    // liberiamo i libri
-    struct libro **corrente = NULL;
-    for (int index = 0; index < (struttura_dati->str_d_ptrLibri).da_inserted; index++)
+    // il thread di compattazione legge i libri: va fermato prima di liberarli
+    gior_chiudi(&(struttura_dati->str_d_giornale));
+    cache_distruggi(&(struttura_dati->str_d_cache));
+    if (struttura_dati->str_d_compattazione)
     {
-        corrente = (struct libro **)da_at(&(struttura_dati->str_d_ptrLibri), index);
-        lib_free(*corrente);
-        free(*corrente);
+        free(struttura_dati->str_d_compattazione->file_record);
+        free(struttura_dati->str_d_compattazione);
+        struttura_dati->str_d_compattazione = NULL;
     }
 
+    arrCampi_free(&(struttura_dati->str_d_arrayCampi), &(struttura_dati->str_d_direttorioCampi));
+
     da_destroy(&(struttura_dati->str_d_ptrLibri));
     da_destroy(&(struttura_dati->str_d_arrayCampi));
+
+    // i libri e i nodi degli alberi vengono liberati tutti insieme con l'arena
+    ar_destroy(&(struttura_dati->str_d_arena));
+
+    // solo ora nessuna stringa punta più allo snapshot
+    snap_chiudi(&(struttura_dati->str_d_snapshot));
 }
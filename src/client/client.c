@@ -2,17 +2,24 @@
 #include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
+#include <errno.h>
+#include <poll.h>
 
 #include "../../include/comunicazione/socket_comunication.h"
-#include "../../include/comunicazione/bib_conf.h"
+#include "../../include/comunicazione/registro_biblioteche.h"
 #include "../../include/comunicazione/protocollo_comunicazione.h"
 
+#define SUCCESS 0
+#define FAILURE -1
+
 /**
- * Estrae il nome della biblioteca e il percorso del server da una stringa.
- *
- * @return 1 se l'estrazione ha successo, 0 altrimenti.
+ * Una biblioteca a cui è stata mandata la richiesta e la sua risposta, che arriva un pezzo alla volta.
  */
-int estrai_nome_e_path(char *stringa, char **nomeBib, char **serverPath);
+struct biblioteca
+{
+    char nome[REG_MAX_NOME];
+    struct rispostaInArrivo arrivo;
+};
 
 /**
  * Elabora gli argomenti della linea di comando per costruire la richiesta.
@@ -29,12 +36,28 @@ char *lettura_argomenti(int argc, char **argv);
  */
 char *aggiungi_coppia(char *stringa, char *campo, char *valore);
 
+/**
+ * Stampa il blocco della risposta di una biblioteca.
+ */
+void stampa_risposta(char *nomeBib, struct messaggio *risposta);
+
+/**
+ * Aggiunge una biblioteca, con il socket su cui arriverà la sua risposta, a quelle da aspettare.
+ *
+ * @return SUCCESS in caso di successo, FAILURE altrimenti.
+ */
+int aggiungi_biblioteca(struct biblioteca **biblioteche, struct pollfd **attese, size_t *numero, const char *nomeBib,
+                        int sock_fd);
+
 int main(int argc, char *argv[])
 {
-    char *richiesta,
-        *bibFile,
-        *temp_nomeBib, *temp_serverPath;
+    char *richiesta;
     struct messaggio daInviare;
+    struct registroBiblioteche *registro;
+    struct bibliotecaRegistrata registrata;
+    struct biblioteca *biblioteche = NULL;
+    struct pollfd *attese = NULL; // attese[i] è il socket di biblioteche[i]
+    size_t numeroBiblioteche = 0, registrate = 0;
 
     //* CONTROLLO ARGOMENTI
 
@@ -66,28 +89,29 @@ int main(int argc, char *argv[])
     daInviare.data = richiesta;
     daInviare.length = strlen(richiesta) + 1;
 
-    bibFile = bib_leggi(BIB_CONF_PATH);
-    if (!bibFile)
+    errno = 0;
+    registro = reg_apri(0);
+    if (!registro && errno != ENOENT)
     {
-        printf("chiamata a bib_leggi fallita\n");
+        printf("Impossibile leggere il registro delle biblioteche\n");
         exit(EXIT_FAILURE);
     }
 
-    if (!estrai_nome_e_path(bibFile, &temp_nomeBib, &temp_serverPath))
-    {
-        printf("Nessun server trovato\n");
-        exit(EXIT_SUCCESS);
-    }
+    //* MANDO LA RICHIESTA A TUTTE LE BIBLIOTECHE
 
-    do
+    // ogni posto del registro si legge con qualche load, senza chiamate di sistema
+    for (int posto = 0; registro && posto < REG_NUMERO_POSTI; posto++)
     {
-        printf("\nMANDO LA RICHIESTA ALLA BIBBLIOTECCA: %s\n", temp_nomeBib);
+        if (!reg_leggi(registro, posto, &registrata))
+            continue;
+        registrate++;
 
         errno = 0;
-        int sock_fd = sockcom_client_mandaRichiesta(temp_serverPath, &daInviare);
-        if (errno == ECONNREFUSED)
+        int sock_fd = sockcom_client_mandaRichiesta(registrata.socket, &daInviare);
+        if (sock_fd == ERR_SYSTEM_CALL && (errno == ECONNREFUSED || errno == ENOENT))
         {
-            printf("È stato impossibile connettersi alla biblioteca \"%s\"\n", temp_nomeBib);
+            printf("\nMANDO LA RICHIESTA ALLA BIBBLIOTECCA: %s\n", registrata.nome);
+            printf("È stato impossibile connettersi alla biblioteca \"%s\"\n", registrata.nome);
             continue;
         }
         else if (sock_fd == ERR_SYSTEM_CALL)
@@ -96,36 +120,108 @@ int main(int argc, char *argv[])
             exit(EXIT_FAILURE);
         }
 
-        struct messaggio risposta;
-        if (sockcom_client_riceviRisposta(sock_fd, &risposta) != SUCCESS)
+        if (aggiungi_biblioteca(&biblioteche, &attese, &numeroBiblioteche, registrata.nome, sock_fd) == FAILURE)
         {
-            perror("Errore nella ricezione della risposta dal server");
             close(sock_fd);
             exit(EXIT_FAILURE);
         }
+    }
+    reg_chiudi(registro);
 
-        switch (risposta.type)
+    if (registrate == 0)
+    {
+        printf("Nessun server trovato\n");
+        exit(EXIT_SUCCESS);
+    }
+
+    //* STAMPO OGNI RISPOSTA APPENA È COMPLETA
+
+    // le biblioteche rispondono in parallelo: si aspetta solo la più lenta, non la somma di tutte
+    size_t mancanti = numeroBiblioteche;
+    while (mancanti > 0)
+    {
+        if (poll(attese, numeroBiblioteche, -1) == -1)
         {
-        case MSG_NO:
-            printf("\nNon è stato trovato alcun libro corrispondente alla richiesta\n");
-            break;
-        case MSG_ERROR:
-            printf("\nIl server ha riportato il seguente errore: ");
-        default:
-            printf("\n%s", risposta.data);
-            break;
+            if (errno == EINTR)
+                continue;
+            perror("Errore con poll");
+            exit(EXIT_FAILURE);
         }
 
-        if (risposta.data)
-            free(risposta.data);
-        if (sock_fd != -1)
-            close(sock_fd);
+        for (size_t index = 0; index < numeroBiblioteche; index++)
+        {
+            if (attese[index].fd == -1 || !attese[index].revents)
+                continue;
 
-    } while (estrai_nome_e_path(NULL, &temp_nomeBib, &temp_serverPath));
+            int esito = sockcom_client_continuaRisposta(attese[index].fd, &(biblioteche[index].arrivo));
+            if (esito == RISPOSTA_INCOMPLETA)
+                continue;
+
+            if (esito != SUCCESS)
+            {
+                perror("Errore nella ricezione della risposta dal server");
+                exit(EXIT_FAILURE);
+            }
+
+            stampa_risposta(biblioteche[index].nome, &(biblioteche[index].arrivo.risposta));
+
+            if (biblioteche[index].arrivo.risposta.data)
+                free(biblioteche[index].arrivo.risposta.data);
+            close(attese[index].fd);
+            attese[index].fd = -1; // poll ignora i fd negativi
+            mancanti--;
+        }
+    }
 
     exit(EXIT_SUCCESS);
 }
 
+void stampa_risposta(char *nomeBib, struct messaggio *risposta)
+{
+    printf("\nMANDO LA RICHIESTA ALLA BIBBLIOTECCA: %s\n", nomeBib);
+
+    switch (risposta->type)
+    {
+    case MSG_NO:
+        printf("\nNon è stato trovato alcun libro corrispondente alla richiesta\n");
+        break;
+    case MSG_ERROR:
+        printf("\nIl server ha riportato il seguente errore: ");
+    default:
+        printf("\n%s", risposta->data);
+        break;
+    }
+
+    // il blocco di una biblioteca esce tutto insieme, prima di quello della successiva
+    fflush(stdout);
+}
+
+int aggiungi_biblioteca(struct biblioteca **biblioteche, struct pollfd **attese, size_t *numero, const char *nomeBib,
+                        int sock_fd)
+{
+    struct biblioteca *nuoveBiblioteche = realloc(*biblioteche, sizeof(struct biblioteca) * (*numero + 1));
+    if (!nuoveBiblioteche)
+    {
+        perror("Errore: chiamata a realloc fallita per la variabile \"biblioteche\"");
+        return FAILURE;
+    }
+    *biblioteche = nuoveBiblioteche;
+
+    struct pollfd *nuoveAttese = realloc(*attese, sizeof(struct pollfd) * (*numero + 1));
+    if (!nuoveAttese)
+    {
+        perror("Errore: chiamata a realloc fallita per la variabile \"attese\"");
+        return FAILURE;
+    }
+    *attese = nuoveAttese;
+
+    (*biblioteche)[*numero] = (struct biblioteca){.arrivo = {.letti = 0, .risposta = {.data = NULL}}};
+    strcpy((*biblioteche)[*numero].nome, nomeBib);
+    (*attese)[*numero] = (struct pollfd){.fd = sock_fd, .events = POLLIN};
+    (*numero)++;
+    return SUCCESS;
+}
+
 char *lettura_argomenti(int argc, char **argv)
 {
 
@@ -185,11 +281,3 @@ char *aggiungi_coppia(char *stringa, char *campo, char *valore)
 
     return stringa;
 }
-
-int estrai_nome_e_path(char *stringa, char **nomeBib, char **serverPath)
-{
-    if (((*nomeBib) = strtok(stringa, ":")) &&
-        ((*serverPath) = strtok(NULL, "\n")))
-        return 1;
-    return 0;
-}
@@ -3,35 +3,34 @@
 #include <string.h>
 #include <unistd.h>
 #include <signal.h>
-#include <poll.h>
+#include <sys/resource.h>
 #include <sys/socket.h>
 #include <pthread.h>
 
 #include "../../include/comunicazione/protocollo_comunicazione.h"
 #include "../../include/comunicazione/socket_comunication.h"
-#include "../../include/comunicazione/bib_conf.h"
+#include "../../include/comunicazione/registro_biblioteche.h"
+#include "../../include/comunicazione/pool_worker.h"
 
 #include "../../include/struttura_dati/struttura_dati.h"
 
-#define MSG_STOP 'S'       ///< Codice di messaggio per fermare i worker.
-#define MAX_PATH 108       ///< Lunghezza massima del percorso dei file.
-#define DIMENSIONE_CODA 20 ///< Dimensione della coda di richieste.
+#define MAX_PATH 108          ///< Lunghezza massima del percorso dei file.
+#define FATTORE_MAX_WORKER 4 ///< Se W_max non è specificato il pool può crescere fino a W * FATTORE_MAX_WORKER worker.
 #define SUCCESS 0
 #define FAILURE -1
 
 char socketServerPath[MAX_PATH],
     fileRecordPath[MAX_PATH];
-struct pollfd poll_fds[MAX_CLIENTS + 1];
+int server_fd = -1;
+struct reattore *ptrReattore = NULL;
 struct strutturaDati *ptrStr_d = NULL;
-struct coda_condivisa *ptrCoda = NULL;
-pthread_t *workers = NULL;
-int numeroWorkers = 0;
+struct pool_worker *ptrPool = NULL;
+struct registroBiblioteche *registro = NULL;
+int postoRegistro = -1; ///< Posto del server nel registro delle biblioteche, -1 finché non è pubblicato.
+int numeroWorkers = 0,
+    numeroMassimoWorkers = 0;
 FILE *log_file = NULL;
 pthread_mutex_t mutex_log = PTHREAD_MUTEX_INITIALIZER;
-pthread_mutex_t mutex_libri = PTHREAD_MUTEX_INITIALIZER;
-pthread_cond_t cond_libri = PTHREAD_COND_INITIALIZER;
-
-void signal_handler(int signal);
 
 /**
  * @return 1 se la stringa rappresenta un intero positivo, 0 altrimenti.
@@ -43,7 +42,8 @@ int isStrPositiveInteger(const char *str);
  *
  * @return SUCCESS in caso di successo, FAILURE altrimenti.
  */
-int leggiArgomenti(int argc, char **argv, char *name_bib, char *file_record_path, int *numero_worker_richiesti);
+int leggiArgomenti(int argc, char **argv, char *name_bib, char *file_record_path, int *numero_worker_richiesti,
+                   int *numero_massimo_worker);
 
 /**
  * @param name_bib Nome della biblioteca, usato per generare il nome del file di log.
@@ -53,16 +53,10 @@ int apri_file_log(char name_bib[MAX_PATH]);
 
 /**
  * @param type Tipo di operazione (prestito o query).
- * @param numero_libri Numero di libri coinvolti nell'operazione.
- * @param risposta_data Dati della risposta.
+ * @param risposta La risposta mandata al client: nel log vanno il numero e le stringhe dei libri letti o prestati.
  * @return SUCCESS in caso di successo, FAILURE altrimenti.
  */
-int log_add_op(FILE **log_file, pthread_mutex_t *mutex, char type, int numero_libri, char *risposta_data);
-
-/**
- * Chiude i worker threads e pulisce le risorse.
- */
-void chiudiWorkers();
+int log_add_op(FILE **log_file, pthread_mutex_t *mutex, char type, struct rispostaAPezzi *risposta);
 
 /**
  * Pulisce le risorse e termina l'esecuzione.
@@ -72,31 +66,42 @@ void chiudiWorkers();
 void cleanupAndExit(int exit_status);
 
 /**
- * Funzione eseguita dai worker threads.
+ * Funzione eseguita dai worker del pool per ogni richiesta: cerca i libri e restituisce la risposta al reattore, che
+ * la scrive al client. Una risposta con più di STR_D_LIBRI_PER_PEZZO libri viene mandata a pezzi: il reattore rimette
+ * la richiesta nel pool dopo aver scritto ogni pezzo, e la funzione riprende da `richiesta->stato`. I pezzi non
+ * contengono copie dei libri: il reattore li scrive direttamente dalla struttura dati.
  *
- * @param args Argomenti del thread (non utilizzati).
- * @return NULL.
+ * @param richiesta La richiesta presa dal pool; la funzione ne libera i dati.
  */
-void *worker(void *args);
+void gestisci_richiesta(struct elementoCoda *richiesta);
 
 int main(int argc, char *argv[])
 {
     char nomeBib[MAX_PATH];
     struct strutturaDati struttura_dati;
-    struct coda_condivisa coda;
+    struct pool_worker pool;
+    struct reattore reattore;
+    struct rlimit limiteFile;
+    sigset_t segnali;
     int error;
     pid_t pid;
 
-    //*LEGGO GLI ARGOMENTI
-    if (leggiArgomenti(argc, argv, nomeBib, fileRecordPath, &numeroWorkers) == FAILURE)
-        exit(EXIT_FAILURE);
-
-    //*INIZIALIZZO GLI FD DI POLL_FDS A -1
-    for (int i = 0; i < MAX_CLIENTS + 1; i++)
+    //*BLOCCO I SEGNALI DI CHIUSURA
+    // prima di creare qualsiasi thread, che eredita la maschera: SIGINT e SIGTERM arrivano solo dal signalfd del
+    // reattore, e la chiusura avviene in questo thread dopo il ciclo degli eventi
+    sigemptyset(&segnali);
+    sigaddset(&segnali, SIGINT);
+    sigaddset(&segnali, SIGTERM);
+    if (pthread_sigmask(SIG_BLOCK, &segnali, NULL) != 0)
     {
-        poll_fds[i].fd = -1;
+        printf("Impossibile bloccare i segnali di chiusura\n");
+        exit(EXIT_FAILURE);
     }
 
+    //*LEGGO GLI ARGOMENTI
+    if (leggiArgomenti(argc, argv, nomeBib, fileRecordPath, &numeroWorkers, &numeroMassimoWorkers) == FAILURE)
+        exit(EXIT_FAILURE);
+
     //*APRO IL FILE DI LOG
     if (apri_file_log(nomeBib) == FAILURE)
         exit(EXIT_FAILURE);
@@ -121,31 +126,25 @@ int main(int argc, char *argv[])
     if (error != SUCCESS)
         exit(EXIT_FAILURE);
 
+    printf("Struttura dati generata: %zu byte usati nell'arena, %zu allocati\n",
+           ar_bytesUsed(&(struttura_dati.str_d_arena)), ar_bytesAllocated(&(struttura_dati.str_d_arena)));
+
     ptrStr_d = &struttura_dati;
 
-    //*CREO LA CODA CONDIVISA ED I WORKERS
-    if (cc_crea(&coda, DIMENSIONE_CODA) == ERR_SYSTEM_CALL)
+    //*APRO IL GIORNALE DEI PRESTITI
+    if (str_d_apriGiornale(&struttura_dati, fileRecordPath, BUILD_DIR) != SUCCESS)
     {
-        perror("Errore nella creazione della coda");
+        printf("Impossibile aprire il giornale dei prestiti\n");
         cleanupAndExit(EXIT_FAILURE);
     }
-    ptrCoda = &coda;
 
-    workers = (pthread_t *)malloc(sizeof(pthread_t) * numeroWorkers);
-    if (!workers)
+    //*CREO IL POOL DEI WORKERS
+    if (pw_crea(&pool, numeroWorkers, numeroMassimoWorkers, gestisci_richiesta) == ERR_SYSTEM_CALL)
     {
-        perror("Malloc fallita");
+        printf("Errore nella creazione del pool dei worker\n");
         cleanupAndExit(EXIT_FAILURE);
     }
-
-    for (int i = 0; i < numeroWorkers; i++)
-    {
-        if ((error = pthread_create(workers + i, NULL, worker, NULL)))
-        {
-            printf("pthread_create fallita: %s", strerror(error));
-            cleanupAndExit(EXIT_FAILURE);
-        }
-    }
+    ptrPool = &pool;
 
     //*APRO IL SERVER
     pid = getpid();
@@ -155,208 +154,160 @@ int main(int argc, char *argv[])
         cleanupAndExit(EXIT_FAILURE);
     }
 
-    poll_fds[0].fd = sockcom_apriServer(socketServerPath);
-    if (poll_fds[0].fd == ERR_SYSTEM_CALL)
+    server_fd = sockcom_apriServer(socketServerPath);
+    if (server_fd == ERR_SYSTEM_CALL)
     {
+        server_fd = -1;
         printf("Errore nell'apertura del socket server");
         cleanupAndExit(EXIT_FAILURE);
     }
 
-    //*AGGIUNGO IL SERVER AL FILE DI BIB.CONF
-    error = bib_addSocket(BIB_CONF_PATH, socketServerPath, nomeBib);
-    if (error == ERR_SYSTEM_CALL)
+    //*ALZO IL LIMITE DEI FILE APERTI, UN FILE DESCRIPTOR PER CLIENT CONNESSO
+    if (getrlimit(RLIMIT_NOFILE, &limiteFile) == 0 && limiteFile.rlim_cur < limiteFile.rlim_max)
     {
-        printf("Chiamata a bib_addSocket fallita\n");
+        limiteFile.rlim_cur = limiteFile.rlim_max;
+        if (setrlimit(RLIMIT_NOFILE, &limiteFile) == -1)
+            perror("Impossibile alzare il limite dei file aperti");
+    }
+
+    if (sockcom_creaReattore(&reattore, server_fd, &segnali) == ERR_SYSTEM_CALL)
+    {
+        printf("Errore nella creazione del reattore\n");
         cleanupAndExit(EXIT_FAILURE);
     }
+    ptrReattore = &reattore;
 
-    //*IMPOSTO LA SIGNAL
-    if (signal(SIGINT, signal_handler) == SIG_ERR || signal(SIGTERM, signal_handler) == SIG_ERR)
+    //*PUBBLICO IL SERVER NEL REGISTRO DELLE BIBLIOTECHE
+    registro = reg_apri(1);
+    postoRegistro = registro ? reg_pubblica(registro, nomeBib, socketServerPath) : ERR_SYSTEM_CALL;
+    if (postoRegistro < 0)
     {
-        perror("tentativo di impostare la signal fallito");
+        printf("Impossibile pubblicare il server nel registro delle biblioteche\n");
+        postoRegistro = -1;
         cleanupAndExit(EXIT_FAILURE);
     }
 
-    //*AVVIO IL SERVER
-    if (sockcom_avviaServer(poll_fds, ptrCoda) == ERR_SYSTEM_CALL)
+    //*AVVIO IL SERVER, FINO A SIGINT O SIGTERM
+    if (sockcom_avviaServer(ptrReattore, ptrPool) == ERR_SYSTEM_CALL)
     {
         perror("il server ha avuto un problema");
         cleanupAndExit(EXIT_FAILURE);
     }
 
+    cleanupAndExit(EXIT_SUCCESS);
     return 0;
 }
 
-void *worker(void *args)
+void gestisci_richiesta(struct elementoCoda *richiesta)
 {
-    struct elementoCoda buffCoda;
-    buffCoda.richiesta.data = NULL;
-    struct messaggio risposta = {.data = NULL};
-    int presta, result, libri_letti;
-    char *buffStr = NULL;
-
-    while (1)
+    static char terminatore[1] = {'\0'}; // chiude la stringa dei libri nell'ultimo pezzo
+    struct messaggio risposta = {.type = MSG_ERROR, .length = strlen(STR_ERR_SYSCALL) + 1, .data = STR_ERR_SYSCALL};
+    struct rispostaAPezzi *libri = (struct rispostaAPezzi *)richiesta->stato;
+    struct pezzoLibri *pezzo = NULL;
+    int esito, ultimoPezzo = 0;
+
+    // prima volta che la richiesta viene presa: si cercano i libri, che verranno letti o prestati un pezzo alla volta
+    if (!libri)
     {
-        if (cc_get(ptrCoda, &buffCoda) == -1)
-        {
-            perror("Errore cc_get");
-            break;
-        }
-        if (buffCoda.richiesta.type == MSG_STOP)
-            break;
-
-        presta = (buffCoda.richiesta.type == MSG_LOAN) ? 1 : 0;
-        libri_letti = str_d_chiediLibri(ptrStr_d, &buffStr, buffCoda.richiesta.data, presta, &mutex_libri, &cond_libri);
-
-        switch (libri_letti)
-        {
-        case ERR_SYSTEM_CALL:
-            risposta = (struct messaggio){
-                .type = MSG_ERROR,
-                .length = strlen(STR_ERR_SYSCALL) + 1,
-                .data = STR_ERR_SYSCALL};
-            break;
-
-        case ERR_FORMATO_STR:
-            risposta = (struct messaggio){
-                .type = MSG_ERROR,
-                .length = strlen(STR_ERR_FRMT_RIC) + 1,
-                .data = STR_ERR_FRMT_RIC};
-            break;
-
-        case 0:
-            risposta = (struct messaggio){
-                .type = MSG_NO,
-                .length = 0,
-                .data = NULL};
-
-            log_add_op(&log_file, &mutex_log, buffCoda.richiesta.type, libri_letti, risposta.data);
-            break;
-
-        default:
-            risposta = (struct messaggio){
-                .type = MSG_RECORD,
-                .length = strlen(buffStr) + 1,
-                .data = buffStr};
-            log_add_op(&log_file, &mutex_log, buffCoda.richiesta.type, libri_letti, risposta.data);
-            break;
-        }
-
-        result = sockcom_server_trasmettiRisposta(buffCoda.client_fd, &risposta);
-        if (result == ERR_SYSTEM_CALL)
-        {
-            printf("Errore chiamata a sockom_server_trasmettiRisposta fallita\n");
-            if (shutdown(buffCoda.client_fd, SHUT_RDWR) == -1)
-                perror("Errore shutdown");
-        }
-        else if (result == ERR_COMUNICAZIONE)
-        {
-            printf("C'è stato un errore nella comunicazione con il client\n");
-            if (shutdown(buffCoda.client_fd, SHUT_RDWR) == -1)
-                perror("Errore shutdown");
-        }
+        libri = (struct rispostaAPezzi *)malloc(sizeof(struct rispostaAPezzi));
+        esito = libri ? str_d_apriRisposta(ptrStr_d, libri, richiesta->richiesta.data, richiesta->richiesta.type == MSG_LOAN)
+                      : ERR_SYSTEM_CALL;
 
-        if (buffCoda.client_fd != -1)
-        {
-            if (close(buffCoda.client_fd) == -1)
-                perror("Errore close");
-        }
+        free(richiesta->richiesta.data);
+        richiesta->richiesta.data = NULL;
 
-        if ((buffCoda.richiesta.data))
-        {
-            free((buffCoda.richiesta.data));
-            (buffCoda.richiesta.data) = NULL;
-        }
-        if (buffStr)
+        if (esito != SUCCESS)
         {
-            free(buffStr);
-            buffStr = NULL;
+            if (esito == ERR_FORMATO_STR)
+                risposta = (struct messaggio){
+                    .type = MSG_ERROR,
+                    .length = strlen(STR_ERR_FRMT_RIC) + 1,
+                    .data = STR_ERR_FRMT_RIC};
+            free(libri);
+            libri = NULL;
+            goto consegna;
         }
+        richiesta->stato = libri;
     }
 
-    if (buffStr)
-        free(buffStr);
-    if ((buffCoda.richiesta.data))
-        free((buffCoda.richiesta.data));
-    return NULL;
-}
+    // il client non c'è più: i libri già letti o prestati vanno comunque nel log
+    if (richiesta->annullata)
+        goto chiudi;
 
-void chiudiWorkers()
-{
-    struct elementoCoda msgStop = {
-        .client_fd = -1,
-        .richiesta = (struct messaggio){.type = MSG_STOP, .length = 0, .data = NULL}};
+    // il pezzo passa al reattore, che lo libera dopo averlo scritto
+    pezzo = (struct pezzoLibri *)malloc(sizeof(struct pezzoLibri));
+    esito = pezzo ? str_d_raccogliPezzo(ptrStr_d, libri, pezzo) : ERR_SYSTEM_CALL;
 
-    for (int i = 0; i < numeroWorkers; i++)
+    if (esito == 1)
     {
-        if (cc_put(ptrCoda, &msgStop) == ERR_SYSTEM_CALL)
-        {
-            perror("Errore put msg stop");
-        }
+        if (sockcom_server_consegnaPezzo(ptrReattore, richiesta, pezzo->parti, pezzo->numeroParti, pezzo) == SUCCESS)
+            return; // il reattore rimetterà la richiesta nel pool dopo aver scritto il pezzo
+    }
+    else if (esito == 0 && libri->numeroLibri == 0)
+        risposta = (struct messaggio){.type = MSG_NO, .length = 0, .data = NULL};
+    else if (esito == 0)
+    {
+        pezzo->parti[pezzo->numeroParti++] = (struct iovec){.iov_base = terminatore, .iov_len = sizeof(terminatore)};
+        ultimoPezzo = 1;
     }
 
-    for (int i = 0; i < numeroWorkers; i++)
+chiudi:
+    log_add_op(&log_file, &mutex_log, richiesta->richiesta.type, libri);
+    str_d_chiudiRisposta(libri);
+    free(libri);
+    richiesta->stato = NULL;
+
+consegna:
+    // l'ultimo pezzo è la risposta finale e passa al reattore come gli altri
+    if (ultimoPezzo)
+        esito = sockcom_server_consegnaParti(ptrReattore, richiesta->risposta, MSG_RECORD, pezzo->parti,
+                                             pezzo->numeroParti, pezzo);
+    else
     {
-        if (pthread_join(workers[i], NULL) == -1)
-            printf("Errore durante la chiamata a pthread_join\nImpossibile chiudere i thread worker correttamente,\nsperiamo che il sistema operativo se la gestisca\n");
+        esito = sockcom_server_consegnaRisposta(ptrReattore, richiesta->risposta, &risposta, 0);
+        free(pezzo);
     }
 
-    if (workers)
-        free(workers);
+    if (esito == ERR_SYSTEM_CALL)
+        printf("Errore chiamata a sockcom_server_consegnaRisposta fallita\n");
 }
 
 void cleanupAndExit(int exit_status)
 {
-    int error;
-    if ((error = pthread_mutex_destroy(&mutex_libri)) != 0)
-        printf("Errore distruggendo mutex_libri: %s\n", strerror(error));
-
-    if ((error = pthread_cond_destroy(&cond_libri)) != 0)
-        printf("Errore distruggendo cond_libri: %s\n", strerror(error));
-
-    if (ptrStr_d)
-    {
-
-        if (str_d_aggiornaFileRecord(ptrStr_d, fileRecordPath, BUILD_DIR) != SUCCESS)
-            printf("Impossibile aggiornare il file record.\n");
-
-        str_d_dealloca(ptrStr_d);
-    }
-    if (bib_removeSocket(BIB_CONF_PATH, socketServerPath, BUILD_DIR) == ERR_SYSTEM_CALL)
-        printf("Impossibile rimuovere la socket dal file di configurazione\n");
-
-    if (poll_fds[0].fd != -1)
+    // prima di chiudere il socket, così nessun nuovo client prova a connettersi
+    if (postoRegistro != -1 && reg_ritira(registro, postoRegistro) == ERR_SYSTEM_CALL)
+        printf("Impossibile ritirare il server dal registro delle biblioteche\n");
+    reg_chiudi(registro);
+    registro = NULL;
+    postoRegistro = -1;
+
+    if (server_fd != -1)
     {
-        if (shutdown(poll_fds[0].fd, SHUT_RDWR) == -1)
+        if (shutdown(server_fd, SHUT_RDWR) == -1)
             perror("Errore chiudendo il socket del server (shutdown)");
 
-        if (close(poll_fds[0].fd) == -1)
+        if (close(server_fd) == -1)
             perror("Errore chiudendo il socket del server (close)");
 
         if (unlink(socketServerPath) == -1)
             perror("Errore rimuovendo il socket del server");
     }
 
-    for (int i = 1; i < MAX_CLIENTS + 1; i++)
-    {
-        if (poll_fds[i].fd != -1)
-        {
-            if (shutdown(poll_fds[i].fd, SHUT_RDWR) == -1)
-                perror("Errore chiudendo socket client (shutdown)");
+    // i worker finiscono le richieste già in coda prima di uscire
+    if (ptrPool)
+        pw_distruggi(ptrPool);
 
-            if (close(poll_fds[i].fd) == -1)
-                perror("Errore chiudendo socket client (close)");
-        }
-    }
+    // scrive le risposte dei worker e chiude le connessioni dei client
+    if (ptrReattore)
+        sockcom_chiudiReattore(ptrReattore);
 
-    chiudiWorkers();
+    // ogni prestito è già nel giornale: basta chiuderlo, senza riscrivere il file record
+    if (ptrStr_d)
+        str_d_dealloca(ptrStr_d);
 
     if (log_file && fclose(log_file) == EOF)
         perror("Errore chiudendo log_file");
 
-    if (ptrCoda)
-        cc_destroy(ptrCoda);
-
     exit(exit_status);
 }
 
@@ -384,7 +335,7 @@ int apri_file_log(char name_bib[MAX_PATH])
     return SUCCESS;
 }
 
-int log_add_op(FILE **log_file, pthread_mutex_t *mutex, char type, int numero_libri, char *risposta_data)
+int log_add_op(FILE **log_file, pthread_mutex_t *mutex, char type, struct rispostaAPezzi *risposta)
 {
     if (pthread_mutex_lock(mutex))
     {
@@ -392,33 +343,28 @@ int log_add_op(FILE **log_file, pthread_mutex_t *mutex, char type, int numero_li
         return FAILURE;
     }
 
-    int caratteri_da_scrivere = snprintf(NULL, 0, "%s %d\n\n",
-                                         (type == MSG_LOAN) ? "LOAN" : "QUERY", numero_libri),
+    int esito = SUCCESS,
+        caratteri_da_scrivere = snprintf(NULL, 0, "%s %d\n\n",
+                                         (type == MSG_LOAN) ? "LOAN" : "QUERY", risposta->numeroLibri),
 
         caratteri_scritti = fprintf(*log_file, "%s %d\n\n",
-                                    (type == MSG_LOAN) ? "LOAN" : "QUERY", numero_libri); // scriviamo nel file
+                                    (type == MSG_LOAN) ? "LOAN" : "QUERY", risposta->numeroLibri); // scriviamo nel file
 
     if (caratteri_scritti < caratteri_da_scrivere)
     {
         printf("Errore nella scrittura del file log. Caratteri previsti: %d, scritti: %d\n"
                "Errore di sistema: %s\n",
                caratteri_da_scrivere, caratteri_scritti, strerror(errno));
-        return FAILURE;
+        esito = FAILURE;
     }
-
-    if (numero_libri != 0)
+    // i libri vengono riletti dalla struttura dati, così la risposta non deve restare in memoria intera
+    else if (risposta->numeroLibri != 0 &&
+             (str_d_scriviRisposta(risposta, *log_file) != SUCCESS || fputs("\n\n", *log_file) == EOF))
     {
-        caratteri_da_scrivere = strlen(risposta_data) + 2,
-
-        caratteri_scritti = fprintf(*log_file, "%s\n\n", risposta_data); // scriviamo nel file
-
-        if (caratteri_scritti < caratteri_da_scrivere)
-        {
-            printf("Errore nella scrittura del file log. Caratteri previsti: %d, scritti: %d\n"
-                   "Errore di sistema: %s\n",
-                   caratteri_da_scrivere, caratteri_scritti, strerror(errno));
-            return FAILURE;
-        }
+        printf("Errore nella scrittura del file log\n"
+               "Errore di sistema: %s\n",
+               strerror(errno));
+        esito = FAILURE;
     }
 
     if (pthread_mutex_unlock(mutex))
@@ -426,20 +372,21 @@ int log_add_op(FILE **log_file, pthread_mutex_t *mutex, char type, int numero_li
         perror("Errore: impossibile eseguire operazione su mutex");
         return FAILURE;
     }
-    return SUCCESS;
+    return esito;
 }
 
-int leggiArgomenti(int argc, char **argv, char *name_bib, char *file_record_path, int *numero_worker_richiesti)
+int leggiArgomenti(int argc, char **argv, char *name_bib, char *file_record_path, int *numero_worker_richiesti,
+                   int *numero_massimo_worker)
 {
     if (argc < 4)
     {
-        printf("Errore: parametri mancanti\n Il comando deve essere del tipo:\n $ bibserver name_bib file_record W");
+        printf("Errore: parametri mancanti\n Il comando deve essere del tipo:\n $ bibserver name_bib file_record W [W_max]");
         return FAILURE;
     }
 
     if (strlen(argv[1]) >= MAX_PATH || strlen(argv[2]) >= MAX_PATH - strlen(FILE_RECORDS_DIR) - 4)
     {
-        printf("Errore: nome o path troppo lungo\n Il comando deve essere del tipo:\n $ bibserver name_bib file_record W \n");
+        printf("Errore: nome o path troppo lungo\n Il comando deve essere del tipo:\n $ bibserver name_bib file_record W [W_max] \n");
         return FAILURE;
     }
 
@@ -450,11 +397,28 @@ int leggiArgomenti(int argc, char **argv, char *name_bib, char *file_record_path
     // controllo che il terzo argomento sia un intero positivo
     if (!isStrPositiveInteger(argv[3]))
     {
-        printf("Errore: W deve essere un numero intero positivo\n Il comando deve essere del tipo:\n $ bibserver name_bib file_record W \n");
+        printf("Errore: W deve essere un numero intero positivo\n Il comando deve essere del tipo:\n $ bibserver name_bib file_record W [W_max] \n");
         return FAILURE;
     }
 
     *numero_worker_richiesti = atoi(argv[3]);
+    if (*numero_worker_richiesti < 1)
+    {
+        printf("Errore: W deve essere almeno 1\n");
+        return FAILURE;
+    }
+
+    // il quarto argomento, opzionale, è il numero massimo di worker
+    *numero_massimo_worker = *numero_worker_richiesti * FATTORE_MAX_WORKER;
+    if (argc >= 5)
+    {
+        if (!isStrPositiveInteger(argv[4]) || atoi(argv[4]) < *numero_worker_richiesti)
+        {
+            printf("Errore: W_max deve essere un numero intero non minore di W\n Il comando deve essere del tipo:\n $ bibserver name_bib file_record W [W_max] \n");
+            return FAILURE;
+        }
+        *numero_massimo_worker = atoi(argv[4]);
+    }
 
     return SUCCESS;
 }
@@ -479,7 +443,3 @@ int isStrPositiveInteger(const char *str)
     return 1;
 }
 
-void signal_handler(int signal)
-{
-    cleanupAndExit(EXIT_SUCCESS);
-}
@@ -0,0 +1,432 @@
+#include "../include/my_lib/binary_tree.h"
+#include "../include/struttura_dati/struttura_dati.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+
+#define FILE_CATALOGO "build/bench_catalogo.txt"
+
+// file record di esempio, solo letto
+#define FILE_BIB1 "data/file_records/bib1.txt"
+
+// oltre questa dimensione l'albero non bilanciato impiega troppo (O(N^2)) e la ricorsione rischia lo stack overflow
+#define LIMITE_ALBERO_SEMPLICE 20000
+
+#define NUMERO_LIBRI_DEFAULT 1000000
+
+double secondi_da(struct timespec *inizio)
+{
+    struct timespec fine;
+    clock_gettime(CLOCK_MONOTONIC, &fine);
+    return (fine.tv_sec - inizio->tv_sec) + (fine.tv_nsec - inizio->tv_nsec) / 1e9;
+}
+
+int confronta_stringhe(const void *elemento1, const void *elemento2)
+{
+    return strcmp(*(char *const *)elemento1, *(char *const *)elemento2);
+}
+
+// l'albero semplice non aggiorna bt_node_height, quindi l'altezza va calcolata visitandolo
+int altezza(struct binary_tree_node *nodo)
+{
+    if (!nodo)
+        return 0;
+    int sinistra = altezza(nodo->bt_node_left), destra = altezza(nodo->bt_node_right);
+    return 1 + (sinistra > destra ? sinistra : destra);
+}
+
+/**
+ * Rovina la prima bitmap del primo campo dello snapshot `percorso`: il suo ultimo contenitore passa alla chiave più
+ * alta, quindi contiene ordinali che non corrispondono a nessun libro.
+ */
+int corrompi_bitmap(const char *percorso)
+{
+    FILE *file = fopen(percorso, "r+b");
+    struct snap_intestazione intestazione;
+    struct snap_campo campo;
+    struct snap_valore valore;
+    uint32_t contenitori;
+    uint16_t chiave = UINT16_MAX;
+
+    int letto = file && fread(&intestazione, sizeof(intestazione), 1, file) == 1 && intestazione.snap_numeroCampi > 0 &&
+                fseek(file, (long)intestazione.snap_campi, SEEK_SET) == 0 && fread(&campo, sizeof(campo), 1, file) == 1 &&
+                campo.snap_numeroValori > 0 &&
+                fseek(file, (long)campo.snap_valori, SEEK_SET) == 0 && fread(&valore, sizeof(valore), 1, file) == 1 &&
+                fseek(file, (long)valore.snap_bitmap, SEEK_SET) == 0 && fread(&contenitori, sizeof(contenitori), 1, file) == 1 &&
+                contenitori > 0;
+
+    // dopo il numero dei contenitori vengono le loro intestazioni di 8 byte, che iniziano con la chiave
+    int scritto = letto && fseek(file, (long)(valore.snap_bitmap + sizeof(uint32_t) + (contenitori - 1) * 8), SEEK_SET) == 0 &&
+                  fwrite(&chiave, sizeof(chiave), 1, file) == 1;
+
+    if (file && fclose(file) != 0)
+        scritto = 0;
+    return scritto ? SUCCESS : FAILURE;
+}
+
+/**
+ * Inserisce `n` chiavi già ordinate nell'albero e poi le cerca tutte, stampando i tempi e l'altezza finale.
+ */
+int bench_albero(struct binary_tree *albero, char **chiavi, int n, const char *nome)
+{
+    struct timespec inizio;
+
+    clock_gettime(CLOCK_MONOTONIC, &inizio);
+    for (int i = 0; i < n; i++)
+    {
+        if (bt_insert(albero, &chiavi[i]) == FAILURE)
+        {
+            printf("Errore nell'inserimento nell'albero\n");
+            return FAILURE;
+        }
+    }
+    double tempo_inserimento = secondi_da(&inizio);
+
+    clock_gettime(CLOCK_MONOTONIC, &inizio);
+    for (int i = 0; i < n; i++)
+    {
+        if (!bt_search(albero, &chiavi[i]))
+        {
+            printf("Chiave %s non trovata\n", chiavi[i]);
+            return FAILURE;
+        }
+    }
+    double tempo_ricerca = secondi_da(&inizio);
+
+    printf("%-12s N=%-8d altezza=%-8d inserimento=%9.4fs ricerca=%9.4fs (%.0f ns per ricerca)\n",
+           nome, n, altezza(albero->bt_root), tempo_inserimento, tempo_ricerca, tempo_ricerca * 1e9 / n);
+
+    bt_freeTree(albero);
+    return SUCCESS;
+}
+
+/**
+ * Genera un file record di `n` libri ordinati per autore, come quelli esportati dal catalogo.
+ */
+int genera_catalogo(const char *path, int n)
+{
+    FILE *file = fopen(path, "w");
+    if (!file)
+    {
+        perror("Impossibile creare il catalogo di prova");
+        return FAILURE;
+    }
+
+    for (int i = 0; i < n; i++)
+        fprintf(file, "autore: Autore %08d, Nome; titolo: Titolo del libro %d; editore: Editore %d; anno: %d;\n",
+                i, n - i, i % 500, 1900 + i % 120);
+
+    if (fclose(file) == EOF)
+    {
+        perror("Errore nella chiusura del catalogo di prova");
+        return FAILURE;
+    }
+    return SUCCESS;
+}
+
+/**
+ * Compone in `richiesta` la richiesta numero `i` di una serie su un catalogo di `n` libri.
+ *
+ * @return Il numero di libri che la richiesta deve trovare.
+ */
+typedef int (*componi_richiesta)(char *richiesta, size_t dimensione, int i, int n);
+
+int per_autore(char *richiesta, size_t dimensione, int i, int n)
+{
+    snprintf(richiesta, dimensione, "autore: Autore %08d, Nome;", (int)((long)i * 7919 % n));
+    return 1;
+}
+
+// l'anno è poco selettivo (n/120 libri per anno) ed è la prima coppia: il planner deve guidare con l'autore
+int per_anno_e_autore(char *richiesta, size_t dimensione, int i, int n)
+{
+    int libro = (int)(((long)i * 7919 % (n / 120 + 1)) * 120 + 50) % n;
+    snprintf(richiesta, dimensione, "anno: %d; autore: Autore %08d, Nome;", 1900 + libro % 120, libro);
+    return 1;
+}
+
+// anno ed editore sono entrambi poco selettivi: la richiesta si risolve con l'intersezione delle loro bitmap
+int per_anno_ed_editore(char *richiesta, size_t dimensione, int i, int n)
+{
+    int editore = 50 + i % 70, attesi = 0;
+    for (int j = editore; j < n; j += 3000)
+        attesi++;
+    snprintf(richiesta, dimensione, "anno: %d; editore: Editore %d;", 1900 + editore, editore);
+    return attesi;
+}
+
+/**
+ * Esegue le `numero` richieste composte da `componi` (prestiti se `presta` è 1) e stampa il tempo medio per richiesta.
+ *
+ * @return SUCCESS, o FAILURE alla prima richiesta che non trova i libri attesi.
+ */
+int cronometra_richieste(struct strutturaDati *struttura_dati, componi_richiesta componi, int numero, int n, int presta,
+                         const char *descrizione)
+{
+    struct timespec inizio;
+    char richiesta[SIZE_C_V];
+    char *risposta = NULL;
+
+    clock_gettime(CLOCK_MONOTONIC, &inizio);
+    for (int i = 0; i < numero; i++)
+    {
+        int attesi = componi(richiesta, sizeof(richiesta), i, n),
+            trovati = str_d_chiediLibri(struttura_dati, &risposta, richiesta, presta);
+        free(risposta);
+        risposta = NULL;
+        if (trovati != attesi)
+        {
+            printf("La richiesta \"%s\" ha %s %d libri invece di %d\n", richiesta, presta ? "prestato" : "trovato",
+                   trovati, attesi);
+            return FAILURE;
+        }
+    }
+    double tempo = secondi_da(&inizio);
+    printf("%d %s in %.4fs (%.1f us per %s)\n", numero, descrizione, tempo, tempo * 1e6 / numero,
+           presta ? "prestito" : "ricerca");
+    return SUCCESS;
+}
+
+/**
+ * Controlla che un prestito tolga dalla cache le risposte che contengono il libro: cerca un libro non ancora prestato
+ * (la risposta finisce nella cache), lo presta con una richiesta diversa e ripete la prima, che deve mostrare il prestito.
+ */
+int controlla_invalidazione(struct strutturaDati *struttura_dati, int n)
+{
+    char richiesta[SIZE_C_V];
+    char *risposta = NULL;
+
+    for (int libro = n / 2; libro < n; libro++)
+    {
+        snprintf(richiesta, sizeof(richiesta), "autore: Autore %08d, Nome;", libro);
+        int trovati = str_d_chiediLibri(struttura_dati, &risposta, richiesta, 0),
+            prestato = trovati == 1 && strstr(risposta, "prestito:");
+        free(risposta);
+        risposta = NULL;
+        if (trovati != 1)
+        {
+            printf("La richiesta \"%s\" ha trovato %d libri invece di 1\n", richiesta, trovati);
+            return FAILURE;
+        }
+        if (prestato)
+            continue;
+
+        snprintf(richiesta, sizeof(richiesta), "anno: %d; autore: Autore %08d, Nome;", 1900 + libro % 120, libro);
+        int prestati = str_d_chiediLibri(struttura_dati, &risposta, richiesta, 1);
+        free(risposta);
+        risposta = NULL;
+
+        snprintf(richiesta, sizeof(richiesta), "autore: Autore %08d, Nome;", libro);
+        trovati = str_d_chiediLibri(struttura_dati, &risposta, richiesta, 0);
+        int esito = (prestati == 1 && trovati == 1 && strstr(risposta, "prestito:")) ? SUCCESS : FAILURE;
+        if (esito == FAILURE)
+            printf("Dopo il prestito la richiesta \"%s\" non mostra il prestito (prestati %d, trovati %d)\n", richiesta,
+                   prestati, trovati);
+        free(risposta);
+        return esito;
+    }
+
+    printf("Nessun libro da prestare per controllare la cache\n");
+    return FAILURE;
+}
+
+/**
+ * Controlla le ricerche per sottostringa su FILE_BIB1: una sottostringa in mezzo al valore, risolta con l'indice dei
+ * trigrammi, e una più corta di un trigramma, per cui vengono visitati tutti i valori del campo.
+ */
+int controlla_sottostringhe(void)
+{
+    struct strutturaDati struttura_dati;
+    struct
+    {
+        const char *richiesta;
+        int attesi;
+    } casi[] = {{"titolo: architettura;", 7}, {"titolo: ar;", 11}};
+    int esito = SUCCESS;
+
+    if (str_d_genera(&struttura_dati, FILE_BIB1) != SUCCESS)
+    {
+        printf("Errore nella generazione della struttura dati di %s\n", FILE_BIB1);
+        return FAILURE;
+    }
+
+    for (size_t index = 0; index < sizeof(casi) / sizeof(casi[0]); index++)
+    {
+        char richiesta[SIZE_C_V];
+        char *risposta = NULL;
+
+        snprintf(richiesta, sizeof(richiesta), "%s", casi[index].richiesta);
+        int trovati = str_d_chiediLibri(&struttura_dati, &risposta, richiesta, 0);
+        free(risposta);
+        printf("\"%s\": %d libri (attesi %d)\n", casi[index].richiesta, trovati, casi[index].attesi);
+        if (trovati != casi[index].attesi)
+            esito = FAILURE;
+    }
+
+    str_d_dealloca(&struttura_dati);
+    return esito;
+}
+
+int bench_catalogo(int n)
+{
+    struct strutturaDati struttura_dati;
+    struct timespec inizio;
+    char richiesta[SIZE_C_V];
+    char *risposta = NULL;
+
+    if (genera_catalogo(FILE_CATALOGO, n) == FAILURE)
+        return FAILURE;
+
+    clock_gettime(CLOCK_MONOTONIC, &inizio);
+    if (str_d_genera(&struttura_dati, FILE_CATALOGO) != SUCCESS)
+    {
+        printf("Errore nella generazione della struttura dati\n");
+        remove(FILE_CATALOGO);
+        return FAILURE;
+    }
+    printf("catalogo ordinato di %d libri caricato in %.3fs (arena: %zu byte usati, %zu allocati)\n", n, secondi_da(&inizio),
+           ar_bytesUsed(&(struttura_dati.str_d_arena)), ar_bytesAllocated(&(struttura_dati.str_d_arena)));
+
+    // le richieste ripetute vengono dalla cache, senza intersecare le bitmap né rileggere i libri, e trovano gli stessi
+    int numero_richieste = 1000, richieste_collisioni = 100;
+    if (cronometra_richieste(&struttura_dati, per_autore, numero_richieste, n, 0, "ricerche per autore") == FAILURE ||
+        cronometra_richieste(&struttura_dati, per_anno_e_autore, numero_richieste, n, 0, "ricerche per anno e autore") == FAILURE ||
+        cronometra_richieste(&struttura_dati, per_anno_ed_editore, richieste_collisioni, n, 0,
+                             "ricerche per anno ed editore") == FAILURE ||
+        cronometra_richieste(&struttura_dati, per_anno_ed_editore, richieste_collisioni, n, 0,
+                             "ricerche ripetute per anno ed editore") == FAILURE)
+    {
+        str_d_dealloca(&struttura_dati);
+        remove(FILE_CATALOGO);
+        return FAILURE;
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &inizio);
+    if (str_d_salvaSnapshot(&struttura_dati, FILE_CATALOGO) != SUCCESS)
+    {
+        printf("Errore nel salvataggio dello snapshot\n");
+        str_d_dealloca(&struttura_dati);
+        remove(FILE_CATALOGO);
+        return FAILURE;
+    }
+    printf("snapshot salvato in %.3fs\n", secondi_da(&inizio));
+
+    clock_gettime(CLOCK_MONOTONIC, &inizio);
+    str_d_dealloca(&struttura_dati);
+    printf("catalogo deallocato in %.3fs\n", secondi_da(&inizio));
+
+    // al riavvio il catalogo viene ricostruito dallo snapshot, senza analizzare il file record
+    clock_gettime(CLOCK_MONOTONIC, &inizio);
+    int errore = str_d_genera(&struttura_dati, FILE_CATALOGO);
+    printf("catalogo ricaricato dallo snapshot in %.3fs\n", secondi_da(&inizio));
+
+    if (errore == SUCCESS)
+    {
+        snprintf(richiesta, sizeof(richiesta), "anno: %d; autore: Autore %08d, Nome;", 1900 + (n / 2) % 120, n / 2);
+        int trovati = str_d_chiediLibri(&struttura_dati, &risposta, richiesta, 0);
+        if (trovati != 1)
+        {
+            printf("Dopo il ricaricamento la richiesta \"%s\" ha trovato %d libri invece di 1\n", richiesta, trovati);
+            errore = FAILURE;
+        }
+        free(risposta);
+        risposta = NULL;
+
+        // ogni prestito costa una voce del giornale e la sua sincronizzazione, non la riscrittura del file record; metà
+        // dei libri resta libera per controllare la cache
+        int numero_prestiti = (n / 2 < 1000) ? n / 2 : 1000;
+        if (errore == SUCCESS && str_d_apriGiornale(&struttura_dati, FILE_CATALOGO, "build/") != SUCCESS)
+        {
+            printf("Impossibile aprire il giornale dei prestiti\n");
+            errore = FAILURE;
+        }
+        if (errore == SUCCESS &&
+            (cronometra_richieste(&struttura_dati, per_autore, numero_prestiti, n, 1, "prestiti registrati nel giornale") == FAILURE ||
+             controlla_invalidazione(&struttura_dati, n) == FAILURE))
+            errore = FAILURE;
+        str_d_dealloca(&struttura_dati);
+    }
+
+    // uno snapshot con una bitmap rovinata viene scartato e il catalogo viene ricaricato dal file record
+    if (errore == SUCCESS)
+    {
+        if (corrompi_bitmap(FILE_CATALOGO SNAP_ESTENSIONE) == FAILURE)
+        {
+            printf("Impossibile rovinare lo snapshot\n");
+            errore = FAILURE;
+        }
+        else if ((errore = str_d_genera(&struttura_dati, FILE_CATALOGO)) == SUCCESS)
+        {
+            snprintf(richiesta, sizeof(richiesta), "anno: %d; autore: Autore %08d, Nome;", 1900 + (n / 2) % 120, n / 2);
+            int trovati = str_d_chiediLibri(&struttura_dati, &risposta, richiesta, 0);
+            if (struttura_dati.str_d_snapshot.snap_dati)
+                printf("Lo snapshot con una bitmap rovinata non è stato scartato\n");
+            else if (trovati != 1)
+                printf("Dal file record la richiesta \"%s\" ha trovato %d libri invece di 1\n", richiesta, trovati);
+            if (struttura_dati.str_d_snapshot.snap_dati || trovati != 1)
+                errore = FAILURE;
+            free(risposta);
+            risposta = NULL;
+            str_d_dealloca(&struttura_dati);
+        }
+    }
+
+    remove(FILE_CATALOGO GIOR_ESTENSIONE);
+    remove(FILE_CATALOGO SNAP_ESTENSIONE);
+    remove(FILE_CATALOGO);
+    return (errore == SUCCESS) ? SUCCESS : FAILURE;
+}
+
+int main(int argc, char *argv[])
+{
+    int numero_libri = (argc > 1) ? atoi(argv[1]) : NUMERO_LIBRI_DEFAULT;
+    if (numero_libri <= 0)
+    {
+        printf("Uso: %s [numero_libri]\n", argv[0]);
+        return FAILURE;
+    }
+
+    char **chiavi = (char **)malloc(sizeof(char *) * numero_libri);
+    if (!chiavi)
+    {
+        perror("Malloc fallita");
+        return FAILURE;
+    }
+    for (int i = 0; i < numero_libri; i++)
+    {
+        chiavi[i] = (char *)malloc(32);
+        if (!chiavi[i])
+        {
+            perror("Malloc fallita");
+            return FAILURE;
+        }
+        snprintf(chiavi[i], 32, "autore%08d", i);
+    }
+
+    printf("ALBERI CON CHIAVI INSERITE IN ORDINE\n");
+    for (int n = 1000; n <= numero_libri; n *= 10)
+    {
+        struct binary_tree semplice = bt_create(sizeof(char *), confronta_stringhe),
+                           bilanciato = bt_createBalanced(sizeof(char *), confronta_stringhe);
+
+        if (n <= LIMITE_ALBERO_SEMPLICE && bench_albero(&semplice, chiavi, n, "semplice") == FAILURE)
+            return FAILURE;
+        if (bench_albero(&bilanciato, chiavi, n, "bilanciato") == FAILURE)
+            return FAILURE;
+    }
+    printf("(albero semplice non misurato oltre %d chiavi)\n\n", LIMITE_ALBERO_SEMPLICE);
+
+    for (int i = 0; i < numero_libri; i++)
+        free(chiavi[i]);
+    free(chiavi);
+
+    printf("RICERCHE PER SOTTOSTRINGA IN %s\n", FILE_BIB1);
+    if (controlla_sottostringhe() == FAILURE)
+        return FAILURE;
+    printf("\n");
+
+    printf("CATALOGO COMPLETO\n");
+    return bench_catalogo(numero_libri);
+}
@@ -0,0 +1,212 @@
+#include "../include/comunicazione/coda_condivisa.h"
+#include "../include/my_lib/thread_shared_static_fifo.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <pthread.h>
+
+#define DIMENSIONE_CODA 32
+#define MAX_THREAD 16
+#define ELEMENTI_DEFAULT 1000000
+#define SCAMBI_DEFAULT 100000
+
+/**
+ * @brief La coda usata da cc_ prima dell'anello senza lock: static_fifo protetta da un mutex e da due semafori.
+ */
+struct codaSemafori
+{
+    struct static_fifo fifo;
+    pthread_mutex_t mutex;
+    sem_t spazio_libero, numero_elementi;
+};
+
+/**
+ * @brief Una delle due code misurate, con le sue operazioni.
+ */
+struct codaMisurata
+{
+    const char *nome;
+    int (*crea)(void *, size_t);
+    int (*put)(void *, const struct elementoCoda *);
+    int (*get)(void *, struct elementoCoda *);
+    void (*distruggi)(void *);
+};
+
+int semafori_crea(void *coda, size_t dimensione)
+{
+    struct codaSemafori *c = (struct codaSemafori *)coda;
+    c->fifo = fifost_create(dimensione, sizeof(struct elementoCoda));
+    pthread_mutex_init(&(c->mutex), NULL);
+    if (!(c->fifo.fifost_queue) || sem_init(&(c->numero_elementi), 0, 0) == -1 || sem_init(&(c->spazio_libero), 0, dimensione) == -1)
+        return ERR_SYSTEM_CALL;
+    return SUCCESS;
+}
+
+int semafori_put(void *coda, const struct elementoCoda *elemento)
+{
+    struct codaSemafori *c = (struct codaSemafori *)coda;
+    return fifost_threadSafePut(&(c->fifo), elemento, &(c->mutex), &(c->spazio_libero), &(c->numero_elementi)) == SUCCESS ? SUCCESS : ERR_SYSTEM_CALL;
+}
+
+int semafori_get(void *coda, struct elementoCoda *buffer)
+{
+    struct codaSemafori *c = (struct codaSemafori *)coda;
+    return fifost_threadSafeGet(&(c->fifo), buffer, &(c->mutex), &(c->spazio_libero), &(c->numero_elementi)) == SUCCESS ? SUCCESS : ERR_SYSTEM_CALL;
+}
+
+void semafori_distruggi(void *coda)
+{
+    struct codaSemafori *c = (struct codaSemafori *)coda;
+    fifost_destroy(&(c->fifo));
+    sem_destroy(&(c->numero_elementi));
+    sem_destroy(&(c->spazio_libero));
+    pthread_mutex_destroy(&(c->mutex));
+}
+
+int anello_crea(void *coda, size_t dimensione) { return cc_crea((struct coda_condivisa *)coda, dimensione); }
+int anello_put(void *coda, const struct elementoCoda *elemento) { return cc_put((struct coda_condivisa *)coda, elemento); }
+int anello_get(void *coda, struct elementoCoda *buffer) { return cc_get((struct coda_condivisa *)coda, buffer); }
+void anello_distruggi(void *coda) { cc_destroy((struct coda_condivisa *)coda); }
+
+/**
+ * @brief Memoria grande abbastanza per entrambe le code.
+ */
+union spazioCoda
+{
+    struct codaSemafori semafori;
+    struct coda_condivisa anello;
+};
+
+struct lavoroThread
+{
+    struct codaMisurata *misurata;
+    void *coda, *ritorno;
+    long elementi;
+};
+
+double secondi_da(struct timespec *inizio)
+{
+    struct timespec fine;
+    clock_gettime(CLOCK_MONOTONIC, &fine);
+    return (fine.tv_sec - inizio->tv_sec) + (fine.tv_nsec - inizio->tv_nsec) / 1e9;
+}
+
+void *produttore(void *arg)
+{
+    struct lavoroThread *lavoro = (struct lavoroThread *)arg;
+    struct elementoCoda elemento = {.client_fd = 0};
+
+    for (long i = 0; i < lavoro->elementi; i++)
+        if (lavoro->misurata->put(lavoro->coda, &elemento) == ERR_SYSTEM_CALL)
+            break;
+    return NULL;
+}
+
+void *consumatore(void *arg)
+{
+    struct lavoroThread *lavoro = (struct lavoroThread *)arg;
+    struct elementoCoda elemento;
+
+    for (long i = 0; i < lavoro->elementi; i++)
+        if (lavoro->misurata->get(lavoro->coda, &elemento) == ERR_SYSTEM_CALL)
+            break;
+    return NULL;
+}
+
+/**
+ * Rimanda indietro sulla coda `ritorno` ogni elemento preso da `coda`.
+ */
+void *eco(void *arg)
+{
+    struct lavoroThread *lavoro = (struct lavoroThread *)arg;
+    struct elementoCoda elemento;
+
+    for (long i = 0; i < lavoro->elementi; i++)
+        if (lavoro->misurata->get(lavoro->coda, &elemento) == ERR_SYSTEM_CALL ||
+            lavoro->misurata->put(lavoro->ritorno, &elemento) == ERR_SYSTEM_CALL)
+            break;
+    return NULL;
+}
+
+/**
+ * @return Milioni di elementi al secondo passati da `numeroThread` produttori a `numeroThread` consumatori.
+ */
+double misura_throughput(struct codaMisurata *misurata, int numeroThread, long elementi)
+{
+    union spazioCoda spazio;
+    pthread_t produttori[MAX_THREAD], consumatori[MAX_THREAD];
+    struct lavoroThread lavoro = {misurata, &spazio, NULL, elementi / numeroThread};
+    struct timespec inizio;
+
+    if (misurata->crea(&spazio, DIMENSIONE_CODA) == ERR_SYSTEM_CALL)
+        return 0;
+
+    clock_gettime(CLOCK_MONOTONIC, &inizio);
+    for (int i = 0; i < numeroThread; i++)
+    {
+        pthread_create(consumatori + i, NULL, consumatore, &lavoro);
+        pthread_create(produttori + i, NULL, produttore, &lavoro);
+    }
+    for (int i = 0; i < numeroThread; i++)
+    {
+        pthread_join(produttori[i], NULL);
+        pthread_join(consumatori[i], NULL);
+    }
+    double secondi = secondi_da(&inizio);
+
+    misurata->distruggi(&spazio);
+    return (double)lavoro.elementi * numeroThread / secondi / 1e6;
+}
+
+/**
+ * @return Microsecondi per consegnare un elemento a un thread in attesa: metà del tempo di andata e ritorno.
+ */
+double misura_latenza(struct codaMisurata *misurata, long scambi)
+{
+    union spazioCoda andata, ritorno;
+    pthread_t thread;
+    struct lavoroThread lavoro = {misurata, &andata, &ritorno, scambi};
+    struct elementoCoda elemento = {.client_fd = 0};
+    struct timespec inizio;
+
+    if (misurata->crea(&andata, DIMENSIONE_CODA) == ERR_SYSTEM_CALL || misurata->crea(&ritorno, DIMENSIONE_CODA) == ERR_SYSTEM_CALL)
+        return 0;
+
+    pthread_create(&thread, NULL, eco, &lavoro);
+    clock_gettime(CLOCK_MONOTONIC, &inizio);
+    for (long i = 0; i < scambi; i++)
+        if (misurata->put(&andata, &elemento) == ERR_SYSTEM_CALL || misurata->get(&ritorno, &elemento) == ERR_SYSTEM_CALL)
+            break;
+    double secondi = secondi_da(&inizio);
+    pthread_join(thread, NULL);
+
+    misurata->distruggi(&andata);
+    misurata->distruggi(&ritorno);
+    return secondi / scambi / 2 * 1e6;
+}
+
+int main(int argc, char *argv[])
+{
+    long elementi = (argc > 1) ? atol(argv[1]) : ELEMENTI_DEFAULT;
+    long scambi = (argc > 2) ? atol(argv[2]) : SCAMBI_DEFAULT;
+    if (elementi <= 0 || scambi <= 0)
+    {
+        printf("Uso: %s [elementi] [scambi]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    struct codaMisurata code[] = {
+        {"mutex+semafori", semafori_crea, semafori_put, semafori_get, semafori_distruggi},
+        {"anello", anello_crea, anello_put, anello_get, anello_distruggi}};
+
+    printf("CODA DI %d ELEMENTI (milioni di elementi al secondo, %ld elementi per misura)\n", DIMENSIONE_CODA, elementi);
+    printf("%12s %16s %16s\n", "prod.=cons.", code[0].nome, code[1].nome);
+    for (int numeroThread = 1; numeroThread <= MAX_THREAD; numeroThread *= 2)
+        printf("%12d %16.2f %16.2f\n", numeroThread,
+               misura_throughput(code, numeroThread, elementi), misura_throughput(code + 1, numeroThread, elementi));
+
+    printf("\nLATENZA DI CONSEGNA (microsecondi, %ld andate e ritorni)\n", scambi);
+    printf("%12s %16.2f %16.2f\n", "", misura_latenza(code, scambi), misura_latenza(code + 1, scambi));
+
+    return EXIT_SUCCESS;
+}
@@ -1,22 +1,26 @@
-#include "../include/bib_conf.h"
+#include "../include/comunicazione/registro_biblioteche.h"
 #include <stdio.h>
-#include <stdlib.h> // per free()
+#include <errno.h>
 
 int main()
 {
-    char *bib_path = "config/bib.conf"; // Percorso del file di configurazione
+    struct bibliotecaRegistrata registrata;
 
-    char *content = bib_leggi(bib_path);
-    if (content == NULL)
+    errno = 0;
+    struct registroBiblioteche *registro = reg_apri(0);
+    if (registro == NULL)
     {
-        printf("Errore nella lettura del file.\n");
-        return 1;
+        printf((errno == ENOENT) ? "Nessun server è mai stato avviato.\n" : "Errore nell'apertura del registro.\n");
+        return (errno == ENOENT) ? 0 : 1;
     }
 
     printf("////////////////////////////////////////////\n");
-    printf("CONTENUTO FILE\n\n%s\n", content);
+    printf("CONTENUTO REGISTRO\n\n");
+    for (int posto = 0; posto < REG_NUMERO_POSTI; posto++)
+        if (reg_leggi(registro, posto, &registrata))
+            printf("%d %s:%s\n", posto, registrata.nome, registrata.socket);
     printf("////////////////////////////////////////////\n");
 
-    free(content); // Liberiamo la memoria allocata da bib_leggi
+    reg_chiudi(registro);
     return 0;
 }
@@ -0,0 +1,130 @@
+#include "../include/struttura_dati/libro.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+
+#define NUMERO_LIBRI 4096
+#define LIBRI_POPOLARI 16
+#define MAX_WORKER 64
+#define OPERAZIONI_DEFAULT 2000000
+
+enum modoBench
+{
+    LETTURE,  // ogni worker legge libri di tutto il catalogo
+    PRESTITI, // ogni worker presta i libri popolari, come una raffica di richieste -p sugli stessi titoli
+    MISTO     // metà dei worker presta i libri popolari e l'altra metà li legge
+};
+
+/**
+ * @brief Lavoro di un worker: `operazioni` letture o prestiti di libri pseudo-casuali.
+ */
+struct lavoroWorker
+{
+    struct libro *libri;
+    int operazioni;
+    unsigned int seme;
+    int presta, numeroLibri;
+};
+
+double secondi_da(struct timespec *inizio)
+{
+    struct timespec fine;
+    clock_gettime(CLOCK_MONOTONIC, &fine);
+    return (fine.tv_sec - inizio->tv_sec) + (fine.tv_nsec - inizio->tv_nsec) / 1e9;
+}
+
+void *worker(void *arg)
+{
+    struct lavoroWorker *lavoro = (struct lavoroWorker *)arg;
+    struct libro copia;
+
+    for (int i = 0; i < lavoro->operazioni; i++)
+    {
+        // generatore lineare congruenziale: rand() ha un lock interno che falserebbe la misura
+        lavoro->seme = lavoro->seme * 1103515245u + 12345u;
+        struct libro *libro = lavoro->libri + (lavoro->seme >> 8) % lavoro->numeroLibri;
+
+        if (lavoro->presta)
+            lib_prestaThreadSafe(libro, NULL, NULL);
+        else
+            lib_copiaThreadSafe(libro, &copia);
+    }
+
+    return NULL;
+}
+
+/**
+ * Esegue `operazioni` letture o prestiti divisi fra `numeroWorker` thread e ritorna i milioni di operazioni al secondo.
+ */
+double misura(struct libro *libri, int numeroWorker, int operazioni, enum modoBench modo)
+{
+    pthread_t thread[MAX_WORKER];
+    struct lavoroWorker lavori[MAX_WORKER];
+    struct timespec inizio;
+    int creati = 0;
+
+    clock_gettime(CLOCK_MONOTONIC, &inizio);
+    for (int i = 0; i < numeroWorker; i++)
+    {
+        int presta = (modo == PRESTITI) || (modo == MISTO && i % 2 == 1);
+        lavori[i] = (struct lavoroWorker){libri, operazioni / numeroWorker, (unsigned int)i * 7919u + 1, presta,
+                                          (modo == LETTURE) ? NUMERO_LIBRI : LIBRI_POPOLARI};
+        if (pthread_create(thread + i, NULL, worker, lavori + i))
+        {
+            perror("pthread_create fallita");
+            break;
+        }
+        creati++;
+    }
+    for (int i = 0; i < creati; i++)
+        pthread_join(thread[i], NULL);
+
+    return (double)(operazioni / numeroWorker) * creati / secondi_da(&inizio) / 1e6;
+}
+
+int main(int argc, char *argv[])
+{
+    int operazioni = (argc > 1) ? atoi(argv[1]) : OPERAZIONI_DEFAULT;
+    if (operazioni <= 0)
+    {
+        printf("Uso: %s [operazioni]\n", argv[0]);
+        return FAILURE;
+    }
+
+    struct arena arena = ar_create(AR_BLOCK_SIZE);
+    struct libro *libri = (struct libro *)ar_alloc(&arena, NUMERO_LIBRI * sizeof(struct libro));
+    if (!libri)
+    {
+        perror("Errore di allocazione per i libri");
+        return FAILURE;
+    }
+
+    char stringa[SIZE_C_V];
+    for (int i = 0; i < NUMERO_LIBRI; i++)
+    {
+        int lunghezza = snprintf(stringa, sizeof(stringa), "autore: Autore %08d, Nome; titolo: Titolo %d; anno: %d;", i, i, 1900 + i % 120);
+        if (lib_crea(libri + i, stringa, lunghezza, &arena) != SUCCESS)
+        {
+            printf("Errore nella creazione del libro %d\n", i);
+            ar_destroy(&arena);
+            return FAILURE;
+        }
+        libri[i].lib_ordinale = i;
+    }
+
+    printf("OPERAZIONI SU %d LIBRI (milioni di operazioni al secondo, %d operazioni per misura)\n", NUMERO_LIBRI, operazioni);
+    printf("%8s %12s %12s %12s\n", "worker", "letture", "prestiti", "misto");
+    for (int numeroWorker = 1; numeroWorker <= MAX_WORKER; numeroWorker *= 2)
+    {
+        double risultati[3];
+        for (enum modoBench modo = LETTURE; modo <= MISTO; modo++)
+            risultati[modo] = misura(libri, numeroWorker, operazioni, modo);
+        printf("%8d %12.2f %12.2f %12.2f\n", numeroWorker, risultati[LETTURE], risultati[PRESTITI], risultati[MISTO]);
+    }
+    printf("(prestiti e misto sui primi %d libri)\n", LIBRI_POPOLARI);
+
+    ar_destroy(&arena);
+    return SUCCESS;
+}
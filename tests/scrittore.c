@@ -1,26 +1,33 @@
-#include "../include/bib_conf.h"
+#include "../include/comunicazione/registro_biblioteche.h"
 #include <stdio.h>
 #include <unistd.h> // per sleep()
 
 int main()
 {
-    char *bib_path = "config/bib.conf";   // Percorso del file di configurazione
-    char *socket_path = "path/to/socket"; // Percorso del socket da aggiungere
-    char *bib_name = "NomeBiblioteca";    // Nome della biblioteca da aggiungere
+    char *socket_path = "path/to/socket"; // Percorso del socket da pubblicare
+    char *bib_name = "NomeBiblioteca";    // Nome della biblioteca da pubblicare
 
-    if (bib_addSocket(bib_path, socket_path, bib_name) != SUCCESS)
+    struct registroBiblioteche *registro = reg_apri(1);
+    if (registro == NULL)
+        return 1;
+
+    int posto = reg_pubblica(registro, bib_name, socket_path);
+    if (posto < 0)
     {
-        printf("Errore nell'aggiungere il socket.\n");
+        printf("Errore nel pubblicare il socket.\n");
+        reg_chiudi(registro);
         return 1;
     }
 
     sleep(30); // Attendi 30 secondi
 
-    if (bib_removeSocket(bib_path, socket_path, "build/") != SUCCESS)
+    if (reg_ritira(registro, posto) != SUCCESS)
     {
-        printf("Errore nel rimuovere il socket.\n");
+        printf("Errore nel ritirare il socket.\n");
+        reg_chiudi(registro);
         return 1;
     }
 
+    reg_chiudi(registro);
     return 0;
 }
@@ -0,0 +1,191 @@
+#include "../include/comunicazione/socket_comunication.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#define RICHIESTE_DEFAULT 10000
+#define RICHIESTA_DEFAULT " anno: 1998;"
+
+/**
+ * @brief Tempo trascorso in secondi da `inizio`.
+ */
+double secondi_da(struct timespec *inizio)
+{
+    struct timespec fine;
+    clock_gettime(CLOCK_MONOTONIC, &fine);
+    return (fine.tv_sec - inizio->tv_sec) + (fine.tv_nsec - inizio->tv_nsec) / 1e9;
+}
+
+/**
+ * @brief Manda `richieste` richieste, ognuna con la sua connessione, aspettando ogni risposta prima della richiesta
+ *        successiva.
+ *
+ * @return Le richieste al secondo, o -1.
+ */
+double misura_connessioni(char path[108], struct messaggio *richiesta, long richieste)
+{
+    struct timespec inizio;
+    clock_gettime(CLOCK_MONOTONIC, &inizio);
+
+    for (long i = 0; i < richieste; i++)
+    {
+        struct messaggio risposta;
+        int sock_fd = sockcom_client_mandaRichiesta(path, richiesta);
+        if (sock_fd == ERR_SYSTEM_CALL)
+            return -1;
+        if (sockcom_client_riceviRisposta(sock_fd, &risposta) != SUCCESS)
+        {
+            close(sock_fd);
+            return -1;
+        }
+        free(risposta.data);
+        close(sock_fd);
+    }
+    return richieste / secondi_da(&inizio);
+}
+
+/**
+ * @brief Manda `richieste` richieste su una sola sessione, tenendone al massimo `finestra` senza risposta.
+ *
+ * @return Le richieste al secondo, o -1 anche se una risposta ha un id mai mandato o ripetuto.
+ */
+double misura_sessione(char path[108], struct messaggio *richiesta, long richieste, long finestra)
+{
+    struct timespec inizio;
+    clock_gettime(CLOCK_MONOTONIC, &inizio);
+
+    char *risposte = (char *)calloc(richieste, sizeof(char));
+    int sock_fd = sockcom_client_apriSessione(path);
+    if (!risposte || sock_fd == ERR_SYSTEM_CALL)
+    {
+        free(risposte);
+        return -1;
+    }
+
+    long mandate = 0, ricevute = 0;
+    double risultato = -1;
+    while (ricevute < richieste)
+    {
+        while (mandate < richieste && mandate - ricevute < finestra)
+        {
+            if (sockcom_client_mandaRichiestaSessione(sock_fd, (uint32_t)mandate, richiesta) != SUCCESS)
+                goto exit;
+            mandate++;
+        }
+
+        struct messaggio risposta;
+        uint32_t id;
+        if (sockcom_client_riceviRispostaSessione(sock_fd, &id, &risposta) != SUCCESS)
+            goto exit;
+        free(risposta.data);
+        if (risposta.type == MSG_PEZZO)
+            continue;
+
+        if (id >= (uint32_t)mandate || risposte[id])
+        {
+            printf("Risposta con id %u inatteso\n", id);
+            goto exit;
+        }
+        risposte[id] = 1;
+        ricevute++;
+    }
+    risultato = richieste / secondi_da(&inizio);
+
+exit:
+    close(sock_fd);
+    free(risposte);
+    return risultato;
+}
+
+/**
+ * @brief Manda `richieste` richieste in lotti di `perLotto`, ogni lotto con la sua connessione, aspettando tutte le
+ *        risposte di un lotto prima del successivo.
+ *
+ * @return Le richieste al secondo, o -1 anche se una risposta ha un id fuori dal lotto o ripetuto.
+ */
+double misura_lotti(char path[108], struct messaggio *richiesta, long richieste, long perLotto)
+{
+    struct timespec inizio;
+    clock_gettime(CLOCK_MONOTONIC, &inizio);
+
+    struct messaggio *copie = (struct messaggio *)malloc(sizeof(struct messaggio) * perLotto),
+                     lotto = {.data = NULL};
+    char *risposte = (char *)malloc(sizeof(char) * perLotto);
+    double risultato = -1;
+    if (!copie || !risposte)
+        goto exit;
+
+    for (long i = 0; i < perLotto; i++)
+        copie[i] = *richiesta;
+    if (sockcom_componiLotto(&lotto, copie, perLotto) != SUCCESS)
+        goto exit;
+
+    for (long mandate = 0; mandate < richieste; mandate += perLotto)
+    {
+        int sock_fd = sockcom_client_mandaRichiesta(path, &lotto);
+        if (sock_fd == ERR_SYSTEM_CALL)
+            goto exit;
+
+        memset(risposte, 0, perLotto);
+        for (long ricevute = 0; ricevute < perLotto; ricevute++)
+        {
+            struct messaggio risposta;
+            uint32_t id;
+            if (sockcom_client_riceviRispostaSessione(sock_fd, &id, &risposta) != SUCCESS)
+            {
+                close(sock_fd);
+                goto exit;
+            }
+            free(risposta.data);
+            if (risposta.type == MSG_PEZZO)
+            {
+                ricevute--;
+                continue;
+            }
+
+            if (id >= (uint32_t)perLotto || risposte[id])
+            {
+                printf("Risposta con id %u inatteso\n", id);
+                close(sock_fd);
+                goto exit;
+            }
+            risposte[id] = 1;
+        }
+        close(sock_fd);
+    }
+    risultato = ((richieste + perLotto - 1) / perLotto) * perLotto / secondi_da(&inizio);
+
+exit:
+    free(lotto.data);
+    free(risposte);
+    free(copie);
+    return risultato;
+}
+
+int main(int argc, char *argv[])
+{
+    if (argc < 2 || strlen(argv[1]) >= 108)
+    {
+        printf("Uso: %s socket_server [richieste] [\"campo: valore;\"]\n"
+               "Il server deve essere già avviato (il socket è in sockets/).\n",
+               argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    char path[108];
+    strcpy(path, argv[1]);
+    long richieste = (argc > 2) ? atol(argv[2]) : RICHIESTE_DEFAULT;
+    char *testo = (argc > 3) ? argv[3] : RICHIESTA_DEFAULT;
+    struct messaggio richiesta = {.type = MSG_QUERY, .data = testo, .length = strlen(testo) + 1};
+
+    printf("RICHIESTE AL SECONDO (%ld richieste \"%s\")\n", richieste, testo);
+    printf("%24s %12.0f\n", "una connessione ognuna", misura_connessioni(path, &richiesta, richieste));
+    for (long finestra = 1; finestra <= SOCKCOM_MAX_IN_VOLO; finestra *= 4)
+        printf("%17s %6ld %12.0f\n", "sessione, finestra", finestra, misura_sessione(path, &richiesta, richieste, finestra));
+    for (long perLotto = 4; perLotto <= SOCKCOM_MAX_IN_VOLO; perLotto *= 4)
+        printf("%17s %6ld %12.0f\n", "lotti da", perLotto, misura_lotti(path, &richiesta, richieste, perLotto));
+
+    return EXIT_SUCCESS;
+}